@@ -32,6 +32,10 @@ APT_BEGIN_EXTERN_C
 #define MAX_LOG_FILE_SIZE (8 * 1024 * 1024)
 /** Default max number of log files used in rotation */
 #define MAX_LOG_FILE_COUNT 100
+/** Default size of the per-thread ring used in asynchronous mode (64Kb) */
+#define DEFAULT_LOG_RING_SIZE (64 * 1024)
+/** Default max latency of asynchronous output (msec) */
+#define DEFAULT_LOG_ASYNC_LATENCY 100
 
 /** Opaque log source declaration */
 typedef struct apt_log_source_t apt_log_source_t;
@@ -121,9 +125,28 @@ typedef enum {
 	APT_LOG_MASKING_ENCRYPTED  /**< encrypt private data */
 } apt_log_masking_e;
 
+/** Format of log file output */
+typedef enum {
+	APT_LOG_FORMAT_TEXT,       /**< formatted text */
+	APT_LOG_FORMAT_BINARY      /**< binary records (see apt_log_bin.h) */
+} apt_log_format_e;
+
 /** Opaque logger declaration */
 typedef struct apt_logger_t apt_logger_t;
 
+/** Statistics of asynchronous logging declaration */
+typedef struct apt_log_async_stat_t apt_log_async_stat_t;
+
+/** Statistics of asynchronous logging */
+struct apt_log_async_stat_t {
+	/** Number of log entries output by the writer thread */
+	apr_uint32_t written_count;
+	/** Number of log entries dropped, since the ring of the calling thread was full */
+	apr_uint32_t dropped_count;
+	/** Number of times a ring got full (overflowed) */
+	apr_uint32_t overflow_count;
+};
+
 /** Prototype of extended log handler function */
 typedef apt_bool_t (*apt_log_ext_handler_f)(const char *file, int line,
 											const char *obj, apt_log_priority_e priority,
@@ -277,6 +300,21 @@ APT_DECLARE(apt_log_masking_e) apt_log_masking_get(void);
  */
 APT_DECLARE(apt_log_masking_e) apt_log_masking_translate(const char *str);
 
+/**
+ * Set the format of log file output.
+ * @param format the format to set
+ * @remark The format must be set before the log file is opened. Binary
+ * records refer to format strings by address, which therefore must be
+ * string literals.
+ */
+APT_DECLARE(apt_bool_t) apt_log_format_set(apt_log_format_e format);
+
+/**
+ * Translate the format string to enum.
+ * @param str the string to translate
+ */
+APT_DECLARE(apt_log_format_e) apt_log_format_translate(const char *str);
+
 /**
  * Mask private data based on the masking mode.
  * @param data_in the data to mask
@@ -294,6 +332,29 @@ APT_DECLARE(const char*) apt_log_data_mask(const char *data_in, apr_size_t *leng
  */
 APT_DECLARE(apt_bool_t) apt_log_ext_handler_set(apt_log_ext_handler_f handler);
 
+/**
+ * Start asynchronous output.
+ * @param ring_size the size of the ring each logging thread writes formatted entries to
+ * @param max_latency the max time in msec an entry may wait in the ring before output
+ * @remark Calling threads only format the entries, while a dedicated writer thread
+ *         outputs them to the console, log file and syslog in batches. If the ring
+ *         of the calling thread is full, the entry is dropped and counted.
+ */
+APT_DECLARE(apt_bool_t) apt_log_async_start(apr_size_t ring_size, apr_uint32_t max_latency);
+
+/**
+ * Stop asynchronous output, once all the pending entries are output.
+ * @remark Entries being put concurrently are waited for and output as well,
+ *         subsequent entries are output synchronously.
+ */
+APT_DECLARE(apt_bool_t) apt_log_async_stop(void);
+
+/**
+ * Get statistics of asynchronous logging.
+ * @param stat the statistics to fill
+ */
+APT_DECLARE(apt_bool_t) apt_log_async_stat_get(apt_log_async_stat_t *stat);
+
 /**
  * Do logging.
  * @param log_source the log source
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_LOG_BIN_H
+#define APT_LOG_BIN_H
+
+/**
+ * @file apt_log_bin.h
+ * @brief Binary Log Format
+ *
+ * A binary log file starts with a file header followed by records. Each
+ * call site (log source, file, line and format string) is described once
+ * per file by a format record, while an entry record refers to the call
+ * site by id and carries the raw arguments instead of the formatted text.
+ * Format records may follow the entries which refer to them, so a decoder
+ * should collect them first. All the fields are in the host byte order.
+ */
+
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Magic string the binary log file starts with */
+#define APT_LOG_BIN_MAGIC       "APTBLOG"
+/** Version of the binary log format */
+#define APT_LOG_BIN_VERSION     1
+/** Value to detect the byte order of the binary log file */
+#define APT_LOG_BIN_BYTE_ORDER  0x01020304
+/** Max number of arguments a format string may refer to */
+#define APT_LOG_BIN_MAX_ARG_COUNT 32
+/** Alignment of records in the binary log file */
+#define APT_LOG_BIN_ALIGN(size) (((size) + 7) & ~7)
+
+/** Binary log file header declaration */
+typedef struct apt_log_bin_file_header_t apt_log_bin_file_header_t;
+/** Binary log record declaration */
+typedef struct apt_log_bin_record_t apt_log_bin_record_t;
+/** Format argument declaration */
+typedef struct apt_log_bin_arg_t apt_log_bin_arg_t;
+/** Conversion specification declaration */
+typedef struct apt_log_bin_spec_t apt_log_bin_spec_t;
+
+/** Types of binary log records */
+typedef enum {
+	APT_LOG_BIN_RECORD_FORMAT = 1, /**< call site: line, then null-terminated source name, file and format */
+	APT_LOG_BIN_RECORD_ENTRY  = 2, /**< log entry: encoded arguments of the format referred by id */
+	APT_LOG_BIN_RECORD_TEXT   = 3  /**< log entry: formatted text, the format can't be encoded */
+} apt_log_bin_record_e;
+
+/** Types of format arguments */
+typedef enum {
+	APT_LOG_BIN_ARG_INT,           /**< int, promoted char and short */
+	APT_LOG_BIN_ARG_UINT,          /**< unsigned int */
+	APT_LOG_BIN_ARG_LONG,          /**< long */
+	APT_LOG_BIN_ARG_ULONG,         /**< unsigned long */
+	APT_LOG_BIN_ARG_LLONG,         /**< long long, __int64 */
+	APT_LOG_BIN_ARG_ULLONG,        /**< unsigned long long, unsigned __int64 */
+	APT_LOG_BIN_ARG_SIZE,          /**< size_t, ptrdiff_t */
+	APT_LOG_BIN_ARG_POINTER,       /**< void* */
+	APT_LOG_BIN_ARG_DOUBLE,        /**< double, promoted float */
+	APT_LOG_BIN_ARG_STRING,        /**< const char* */
+	APT_LOG_BIN_ARG_NONE,          /**< no argument (%%) */
+	APT_LOG_BIN_ARG_INVALID        /**< unsupported conversion (%n, long double) */
+} apt_log_bin_arg_e;
+
+/** Binary log file header */
+struct apt_log_bin_file_header_t {
+	/** Magic string (APT_LOG_BIN_MAGIC) */
+	char         magic[8];
+	/** Byte order (APT_LOG_BIN_BYTE_ORDER) */
+	apr_uint32_t byte_order;
+	/** Version (APT_LOG_BIN_VERSION) */
+	apr_uint32_t version;
+};
+
+/** Binary log record header, the payload follows */
+struct apt_log_bin_record_t {
+	/** Size of the record including the header and the padding */
+	apr_uint32_t size;
+	/** Record type (apt_log_bin_record_e) */
+	apr_uint16_t type;
+	/** Log priority (apt_log_priority_e) */
+	apr_uint16_t priority;
+	/** Id of the format defined or referred to */
+	apr_uint32_t format_id;
+	/** Id of the logging thread */
+	apr_uint32_t thread_id;
+	/** Time in usec since the epoch */
+	apr_int64_t  timestamp;
+	/** Object the entry is logged on behalf of (apt_obj_log) */
+	apr_uint64_t obj;
+};
+
+/** Format argument */
+struct apt_log_bin_arg_t {
+	/** Argument type */
+	apt_log_bin_arg_e type;
+	/** Max length of string: static if >= 0, none if -1, preceding argument if -2 */
+	int               precision;
+};
+
+/** Conversion specification of a format string */
+struct apt_log_bin_spec_t {
+	/** Position of '%' in the format string */
+	const char       *begin;
+	/** Length of the specification */
+	apr_size_t        length;
+	/** Type of the argument to convert */
+	apt_log_bin_arg_e type;
+	/** Width is passed as an argument ('*') */
+	apt_bool_t        width_arg;
+	/** Precision is passed as an argument ('.*') */
+	apt_bool_t        precision_arg;
+	/** Static precision, -1 if not specified */
+	int               precision;
+	/** Conversion character */
+	char              conversion;
+};
+
+/**
+ * Find the next conversion specification of the format string.
+ * @param format the position in the format string to search from, advanced past the specification found
+ * @param spec the specification found
+ * @return FALSE at the end of the format string
+ */
+APT_DECLARE(apt_bool_t) apt_log_bin_spec_next(const char **format, apt_log_bin_spec_t *spec);
+
+/**
+ * Compile the format string to the list of arguments to encode.
+ * @param format the format string
+ * @param args the array of arguments to fill
+ * @param max_count the max number of arguments
+ * @return the number of arguments, or -1 if the format can't be encoded
+ */
+APT_DECLARE(int) apt_log_bin_format_compile(const char *format, apt_log_bin_arg_t *args, int max_count);
+
+/**
+ * Encode the arguments.
+ * @param args the arguments compiled from the format string
+ * @param count the number of arguments
+ * @param buf the buffer to encode to
+ * @param max_size the size of the buffer, strings are truncated to fit
+ * @param arg_ptr the arguments to encode
+ * @return the size of the encoded arguments
+ */
+APT_DECLARE(apr_size_t) apt_log_bin_args_encode(const apt_log_bin_arg_t *args, int count, char *buf, apr_size_t max_size, va_list arg_ptr);
+
+/**
+ * Render the encoded arguments according to the format string.
+ * @param format the format string
+ * @param data the encoded arguments
+ * @param size the size of the encoded arguments
+ * @param buf the buffer to render to (null-terminated)
+ * @param max_size the size of the buffer
+ * @return the length of the rendered text
+ */
+APT_DECLARE(apr_size_t) apt_log_bin_args_render(const char *format, const char *data, apr_size_t size, char *buf, apr_size_t max_size);
+
+/**
+ * Get the session id logged by means of APT_SID_FMT or APT_SIDRES_FMT.
+ * @param format the format string
+ * @param data the encoded arguments
+ * @param size the size of the encoded arguments
+ * @param sid the session id found (points to the encoded data)
+ */
+APT_DECLARE(apt_bool_t) apt_log_bin_sid_get(const char *format, const char *data, apr_size_t size, apt_str_t *sid);
+
+APT_END_EXTERN_C
+
+#endif /* APT_LOG_BIN_H */
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef APT_MPSC_QUEUE_H
+#define APT_MPSC_QUEUE_H
+
+/**
+ * @file apt_mpsc_queue.h
+ * @brief Lock-free Multi-Producer/Single-Consumer Queue of Task Messages
+ *
+ * The queue is intrusive (messages are linked through apt_task_msg_t::next),
+ * unbounded and never allocates memory on push. Any number of threads may
+ * push messages, while only one thread may pop them. The consumer blocked
+ * on an empty queue is woken up by an eventfd (Linux) or a condition
+ * variable (other platforms), which is signaled only if the consumer
+ * actually waits.
+ */
+
+#include "apt_task_msg.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque MPSC queue declaration */
+typedef struct apt_mpsc_queue_t apt_mpsc_queue_t;
+
+/**
+ * Create MPSC queue.
+ * @param pool the pool to allocate memory from
+ */
+APT_DECLARE(apt_mpsc_queue_t*) apt_mpsc_queue_create(apr_pool_t *pool);
+
+/**
+ * Push message to the queue (any thread).
+ * @param queue the queue to push message to
+ * @param msg the message to push
+ */
+APT_DECLARE(apt_bool_t) apt_mpsc_queue_push(apt_mpsc_queue_t *queue, apt_task_msg_t *msg);
+
+/**
+ * Pop message from the queue without blocking (consumer thread).
+ * @param queue the queue to pop message from
+ * @return the popped message or NULL, if there is no message available
+ */
+APT_DECLARE(apt_task_msg_t*) apt_mpsc_queue_trypop(apt_mpsc_queue_t *queue);
+
+/**
+ * Pop message from the queue blocking till a message is available (consumer thread).
+ * @param queue the queue to pop message from
+ * @param timeout the timeout in usec to wait for or -1 to wait infinitely
+ * @param msg the popped message
+ * @return APR_SUCCESS if a message is popped, APR_TIMEUP otherwise
+ * @remark The function may return APR_TIMEUP before the timeout elapses.
+ */
+APT_DECLARE(apr_status_t) apt_mpsc_queue_pop(apt_mpsc_queue_t *queue, apr_interval_time_t timeout, apt_task_msg_t **msg);
+
+APT_END_EXTERN_C
+
+#endif /* APT_MPSC_QUEUE_H */
@@ -33,6 +33,8 @@ typedef struct apt_poller_task_t apt_poller_task_t;
 
 /** Function prototype to handle signalled descripors */
 typedef apt_bool_t (*apt_poll_signal_f)(void *obj, const apr_pollfd_t *descriptor);
+/** Function prototype to handle completion of a poll cycle */
+typedef void (*apt_poll_complete_f)(void *obj);
 
 
 /**
@@ -95,6 +97,16 @@ APT_DECLARE(apt_task_vtable_t*) apt_poller_task_vtable_get(const apt_poller_task
  */
 APT_DECLARE(void*) apt_poller_task_object_get(const apt_poller_task_t *task);
 
+/**
+ * Set the handler of poll cycle completion.
+ * @param task the poller task to set the handler for
+ * @param complete_handler the handler invoked once all the signalled descriptors and
+ * expired timers of a poll cycle have been processed
+ * @remark The handler allows to defer work, such as sending of data queued while
+ * processing the descriptors, to the end of the poll cycle.
+ */
+APT_DECLARE(void) apt_poller_task_complete_handler_set(apt_poller_task_t *task, apt_poll_complete_f complete_handler);
+
 /**
  * Add descriptor to pollset.
  * @param task the task which holds the pollset
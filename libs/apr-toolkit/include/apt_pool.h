@@ -42,6 +42,71 @@ APT_DECLARE(apr_pool_t*) apt_pool_create(void);
  */
 APT_DECLARE(apr_pool_t*) apt_subpool_create(apr_pool_t *parent);
 
+
+/** Max size of memory retained per cached pool, if no pool size is specified */
+#define APT_POOL_CACHE_DEFAULT_MAX_FREE (64 * 1024)
+
+/** Opaque pool cache declaration */
+typedef struct apt_pool_cache_t apt_pool_cache_t;
+/** Pool cache statistics declaration */
+typedef struct apt_pool_cache_stat_t apt_pool_cache_stat_t;
+
+/** Pool cache statistics */
+struct apt_pool_cache_stat_t {
+	/** Number of pools in the free list */
+	apr_size_t free_count;
+	/** Number of pools in use */
+	apr_size_t busy_count;
+	/** Max number of pools in use at a time */
+	apr_size_t busy_high_water;
+	/** Number of pools taken from the free list */
+	apr_size_t hit_count;
+	/** Number of pools created, since the free list was empty */
+	apr_size_t miss_count;
+	/** Number of pools destroyed, since the free list was full */
+	apr_size_t discard_count;
+};
+
+/**
+ * Create cache of pools, each having its own allocator.
+ * @param max_count the max number of pools to keep in the free list
+ * @param init_count the number of pools to create in advance
+ * @param pool_size the size of memory to preallocate and retain per pool
+ * (nothing is preallocated and up to APT_POOL_CACHE_DEFAULT_MAX_FREE is retained if 0)
+ * @param pool the pool to allocate the cache from, the cache is destroyed along with the pool
+ * @remark Unlike apt_pool_create(), which creates a new allocator and mutex per pool,
+ * the cache clears released pools and keeps them for reuse along with the memory
+ * retained by their allocators.
+ */
+APT_DECLARE(apt_pool_cache_t*) apt_pool_cache_create(apr_size_t max_count, apr_size_t init_count, apr_size_t pool_size, apr_pool_t *pool);
+
+/**
+ * Destroy the pools kept by the cache ahead of the pool the cache is allocated from.
+ * @param cache the cache to destroy
+ * @remark No pool acquired from the cache may be in use.
+ */
+APT_DECLARE(void) apt_pool_cache_destroy(apt_pool_cache_t *cache);
+
+/**
+ * Acquire pool from the cache.
+ * @param cache the cache to acquire the pool from
+ */
+APT_DECLARE(apr_pool_t*) apt_pool_cache_acquire(apt_pool_cache_t *cache);
+
+/**
+ * Release pool acquired from the cache.
+ * @param cache the cache to release the pool to
+ * @param pool the pool to release (cleared or destroyed)
+ */
+APT_DECLARE(void) apt_pool_cache_release(apt_pool_cache_t *cache, apr_pool_t *pool);
+
+/**
+ * Get pool cache statistics.
+ * @param cache the cache to get statistics of
+ * @param stat the statistics to fill
+ */
+APT_DECLARE(void) apt_pool_cache_stat_get(apt_pool_cache_t *cache, apt_pool_cache_stat_t *stat);
+
 APT_END_EXTERN_C
 
 #endif /* APT_POOL_H */
@@ -29,6 +29,8 @@ APT_BEGIN_EXTERN_C
 
 /** String table item declaration */
 typedef struct apt_str_table_item_t apt_str_table_item_t;
+/** Perfect hash of string table declaration */
+typedef struct apt_str_table_hash_t apt_str_table_hash_t;
 
 /** String table item definition */
 struct apt_str_table_item_t {
@@ -38,6 +40,57 @@ struct apt_str_table_item_t {
 	apr_size_t key;
 };
 
+/** Perfect hash of string table (generated by strtablegen) */
+struct apt_str_table_hash_t {
+	/** Seed of the hash function */
+	apr_uint32_t         seed;
+	/** Number of slots minus one (the number of slots is a power of 2) */
+	apr_uint32_t         mask;
+	/** Slots holding the id of the string plus one, or 0 if empty */
+	const unsigned char *slots;
+};
+
+/**
+ * Compute the case insensitive hash of the string (MurmurHash3 of the lowercase characters).
+ * @param buf the string to compute the hash of
+ * @param length the length of the string
+ * @param seed the seed of the hash function
+ * @remark Any character is lowercased by setting bit 5, which is exact for letters
+ * and may only cause false hits for the other characters, resolved by the final compare.
+ * Characters are composed in little-endian order, so the generated tables are portable.
+ */
+static APR_INLINE apr_uint32_t apt_string_table_hash(const char *buf, apr_size_t length, apr_uint32_t seed)
+{
+	const unsigned char *data = (const unsigned char*)buf;
+	const unsigned char *end = data + (length & ~3);
+	apr_uint32_t hash = seed;
+	apr_uint32_t k;
+	for(; data < end; data += 4) {
+		k = (data[0] | (data[1] << 8) | (data[2] << 16) | ((apr_uint32_t)data[3] << 24)) | 0x20202020;
+		k *= 0xcc9e2d51;
+		k = (k << 15) | (k >> 17);
+		hash ^= k * 0x1b873593;
+		hash = (hash << 13) | (hash >> 19);
+		hash = hash * 5 + 0xe6546b64;
+	}
+
+	k = 0;
+	switch(length & 3) {
+		case 3: k ^= (data[2] | 0x20) << 16;
+		case 2: k ^= (data[1] | 0x20) << 8;
+		case 1: k ^= (data[0] | 0x20);
+			k *= 0xcc9e2d51;
+			k = (k << 15) | (k >> 17);
+			hash ^= k * 0x1b873593;
+	}
+
+	hash ^= (apr_uint32_t)length;
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	return hash;
+}
+
 
 /**
  * Get the string by a given id.
@@ -57,6 +110,16 @@ APT_DECLARE(const apt_str_t*) apt_string_table_str_get(const apt_str_table_item_
  */
 APT_DECLARE(apr_size_t) apt_string_table_id_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_t *value);
 
+/**
+ * Find the id associated with a given string by means of the perfect hash of the table.
+ * @param table the table to search for the id
+ * @param size the size of the table
+ * @param hash the perfect hash of the table, the table is searched linearly if NULL
+ * @param value the string to search for
+ * @return the id associated with the string, or invalid id if string cannot be matched
+ */
+APT_DECLARE(apr_size_t) apt_string_table_hash_id_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_table_hash_t *hash, const apt_str_t *value);
+
 
 APT_END_EXTERN_C
 
@@ -57,6 +57,8 @@ struct apt_task_msg_t {
 	int                  type;
 	/** Task msg sub type */
 	int                  sub_type;
+	/** Link to the next message in a free list or message queue (used internally) */
+	apt_task_msg_t * volatile next;
 	/** Context specific data */
 	char                 data[1];
 };
@@ -65,6 +67,16 @@ struct apt_task_msg_t {
 /** Create pool of task messages with dynamic allocation of messages (no actual pool is created) */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_dynamic(apr_size_t msg_size, apr_pool_t *pool);
 
+/**
+ * Create pool of task messages with per-thread caching of released messages.
+ * @param msg_size the size of context specific data
+ * @param pool the pool to allocate memory from
+ * @remark Each thread acquires messages from its own free list, which is
+ * refilled from (and drained to) a shared free list in batches, so that
+ * the hot path of message exchange doesn't involve malloc/free or locking.
+ */
+APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_cached(apr_size_t msg_size, apr_pool_t *pool);
+
 /** Create pool of task messages with static allocation of messages */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_static(apr_size_t msg_size, apr_size_t msg_pool_size, apr_pool_t *pool);
 
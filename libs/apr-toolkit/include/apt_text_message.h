@@ -60,6 +60,27 @@ APT_DECLARE(void*) apt_message_parser_object_get(apt_message_parser_t *parser);
 /** Set verbose mode for the parser */
 APT_DECLARE(void) apt_message_parser_verbose_set(apt_message_parser_t *parser, apt_bool_t verbose);
 
+/**
+ * Enable zero-copy parsing.
+ * @param parser the parser to enable zero-copy parsing for
+ * @param stream the stream to receive data to, initialized with the rx buffer of the parser
+ * @param size the size of the rx buffer
+ * @remark Header fields and bodies of parsed messages refer to the reference counted rx buffer
+ * instead of being copied, the buffer is kept as long as the pool of the parser (and messages).
+ * Data must be received to stream->pos up to stream->end, see apt_message_parser_stream_scroll().
+ */
+APT_DECLARE(apt_bool_t) apt_message_parser_zero_copy_enable(apt_message_parser_t *parser, apt_text_stream_t *stream, apr_size_t size);
+
+/**
+ * Scroll remaining (not parsed yet) data of the stream.
+ * @param parser the parser
+ * @param stream the stream to scroll
+ * @remark In zero-copy mode, the data parsed messages refer to is kept in place and stream->end
+ * is set to the end of space available to receive data to. Once the rx buffer is exhausted,
+ * the remaining data is moved to a new rx buffer. Otherwise, same as apt_text_stream_scroll().
+ */
+APT_DECLARE(apt_bool_t) apt_message_parser_stream_scroll(apt_message_parser_t *parser, apt_text_stream_t *stream);
+
 
 /** Create message generator */
 APT_DECLARE(apt_message_generator_t*) apt_message_generator_create(void *obj, const apt_message_generator_vtable_t *vtable, apr_pool_t *pool);
@@ -15,17 +15,15 @@
  */
 
 #include <apr_time.h>
-#include <apr_queue.h>
 #include "apt_consumer_task.h"
+#include "apt_mpsc_queue.h"
 #include "apt_log.h"
 
 struct apt_consumer_task_t {
 	void              *obj;
 	apt_task_t        *base;
-	apr_queue_t       *msg_queue;
-#if APR_HAS_QUEUE_TIMEOUT
+	apt_mpsc_queue_t  *msg_queue;
 	apt_timer_queue_t *timer_queue;
-#endif
 };
 
 static apt_bool_t apt_consumer_task_msg_signal(apt_task_t *task, apt_task_msg_t *msg);
@@ -39,8 +37,8 @@ APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create(
 	apt_task_vtable_t *vtable;
 	apt_consumer_task_t *consumer_task = apr_palloc(pool,sizeof(apt_consumer_task_t));
 	consumer_task->obj = obj;
-	consumer_task->msg_queue = NULL;
-	if(apr_queue_create(&consumer_task->msg_queue,1024,pool) != APR_SUCCESS) {
+	consumer_task->msg_queue = apt_mpsc_queue_create(pool);
+	if(!consumer_task->msg_queue) {
 		return NULL;
 	}
 	
@@ -55,9 +53,7 @@ APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create(
 		vtable->signal_msg = apt_consumer_task_msg_signal;
 	}
 
-#if APR_HAS_QUEUE_TIMEOUT
 	consumer_task->timer_queue = apt_timer_queue_create(pool);
-#endif
 
 	return consumer_task;
 }
@@ -83,30 +79,24 @@ APT_DECLARE(apt_timer_t*) apt_consumer_task_timer_create(
 									void *obj, 
 									apr_pool_t *pool)
 {
-#if APR_HAS_QUEUE_TIMEOUT
 	return apt_timer_create(task->timer_queue,proc,obj,pool);
-#else
-	return NULL;
-#endif
 }
 
 static apt_bool_t apt_consumer_task_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
 {
 	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
-	return (apr_queue_push(consumer_task->msg_queue,msg) == APR_SUCCESS) ? TRUE : FALSE;
+	return apt_mpsc_queue_push(consumer_task->msg_queue,msg);
 }
 
 static apt_bool_t apt_consumer_task_run(apt_task_t *task)
 {
 	apr_status_t rv;
-	void *msg;
+	apt_task_msg_t *msg;
 	apt_bool_t *running;
 	apt_consumer_task_t *consumer_task;
-#if APR_HAS_QUEUE_TIMEOUT
 	apr_interval_time_t timeout;
 	apr_uint32_t queue_timeout;
 	apr_time_t time_now, time_last = 0;
-#endif
 	const char *task_name;
 
 	consumer_task = apt_task_object_get(task);
@@ -121,42 +111,32 @@ static apt_bool_t apt_consumer_task_run(apt_task_t *task)
 	}
 
 	while(*running) {
-#if APR_HAS_QUEUE_TIMEOUT
 		if(apt_timer_queue_timeout_get(consumer_task->timer_queue,&queue_timeout) == TRUE) {
 			timeout = (apr_interval_time_t)queue_timeout * 1000;
 			time_last = apr_time_now();
 			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s] timeout [%u]",
 				task_name, queue_timeout);
-			rv = apr_queue_timedpop(consumer_task->msg_queue,timeout,&msg);
+			rv = apt_mpsc_queue_pop(consumer_task->msg_queue,timeout,&msg);
 		}
 		else
 		{
 			timeout = -1;
 			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s]",task_name);
-			rv = apr_queue_pop(consumer_task->msg_queue,&msg);
+			rv = apt_mpsc_queue_pop(consumer_task->msg_queue,timeout,&msg);
 		}
-#else
-		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s]",task_name);
-		rv = apr_queue_pop(consumer_task->msg_queue,&msg);
-#endif
 		if(rv == APR_SUCCESS) {
-			if(msg) {
-				apt_task_msg_t *task_msg = msg;
-				apt_task_msg_process(consumer_task->base,task_msg);
-			}
+			apt_task_msg_process(consumer_task->base,msg);
 		}
 		else if(rv != APR_TIMEUP) {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Pop Message [%s] status: %d",task_name,rv);
 		}
 
-#if APR_HAS_QUEUE_TIMEOUT
 		if(timeout != -1) {
 			time_now = apr_time_now();
 			if(time_now > time_last) {
 				apt_timer_queue_advance(consumer_task->timer_queue,(apr_uint32_t)((time_now - time_last)/1000));
 			}
 		}
-#endif
 	}
 	return TRUE;
 }
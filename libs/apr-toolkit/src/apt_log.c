@@ -28,8 +28,12 @@
 #include <apr_portable.h>
 #include <apr_hash.h>
 #include <apr_xml.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
 #include "apt_pool.h"
 #include "apt_log.h"
+#include "apt_log_bin.h"
 
 #define MAX_LOG_ENTRY_SIZE 4096
 #define MAX_PRIORITY_NAME_LENGTH 9
@@ -46,10 +50,23 @@ static const char priority_snames[APT_PRIO_COUNT][MAX_PRIORITY_NAME_LENGTH+1] =
 	"[DEBUG]  "
 };
 
+/** Size of the batch the writer thread outputs at once */
+#define LOG_ASYNC_BATCH_SIZE (64 * 1024)
+/** Min size of the per-thread ring */
+#define LOG_RING_MIN_SIZE (4 * MAX_LOG_ENTRY_SIZE)
+/** Number of slots in the table of binary log formats (power of 2), half of which may be used */
+#define LOG_BIN_TABLE_SIZE 8192
+
 typedef struct apt_log_file_data_t apt_log_file_data_t;
 typedef struct apt_log_file_settings_t apt_log_file_settings_t;
 typedef struct apt_log_file_entry_t apt_log_file_entry_t;
 typedef struct apt_syslog_settings_t apt_syslog_settings_t;
+typedef struct apt_log_time_cache_t apt_log_time_cache_t;
+typedef struct apt_log_record_t apt_log_record_t;
+typedef struct apt_log_ring_t apt_log_ring_t;
+typedef struct apt_log_async_t apt_log_async_t;
+typedef struct apt_log_bin_format_t apt_log_bin_format_t;
+typedef struct apt_log_bin_table_t apt_log_bin_table_t;
 
 struct apt_log_file_entry_t {
 	APR_RING_ENTRY(apt_log_file_entry_t) link;
@@ -92,6 +109,80 @@ struct apt_log_source_t {
 	apt_log_masking_e         masking;
 };
 
+/** Date and time (up to seconds) strings formatted once per second (seqlock) */
+struct apt_log_time_cache_t {
+	volatile apr_uint32_t     seq;                /* odd while being updated */
+	apr_time_t                sec;
+	char                      date[16];
+	char                      time[16];
+};
+
+/** Header of the formatted log entry in the ring */
+struct apt_log_record_t {
+	apr_uint32_t              size;               /* size of the record in the ring (aligned) */
+	apr_uint32_t              length;             /* length of the entry, 0 for padding up to the end of the ring */
+	apr_uint32_t              data_offset;        /* offset of the message following the headers */
+	apr_uint16_t              priority;
+	apr_uint16_t              binary;             /* binary record (apt_log_bin_record_t) */
+};
+
+/** Ring of formatted log entries written by a single thread and read by the writer thread */
+struct apt_log_ring_t {
+	apt_log_ring_t           *next;
+	char                     *data;
+	apr_uint32_t              capacity;           /* power of 2 */
+	volatile apr_uint32_t     write_pos;
+	volatile apr_uint32_t     read_pos;
+	volatile apr_uint32_t     closed;             /* the thread has exited */
+	apt_bool_t                overflowed;         /* the last entry has been dropped */
+};
+
+/** Asynchronous output */
+struct apt_log_async_t {
+	apr_thread_t             *thread;
+	apr_thread_mutex_t       *guard;
+	apr_thread_cond_t        *wakeup;
+	apr_threadkey_t          *key;
+	apt_log_ring_t * volatile ring_list;
+	apr_size_t                ring_size;
+	apr_interval_time_t       max_latency;
+	volatile apr_uint32_t     running;
+	volatile apr_uint32_t     accepting;
+	volatile apr_uint32_t     writer_count;
+	volatile apr_uint32_t     wakeup_pending;
+
+	char                     *batch;
+	apr_size_t                batch_size;
+	char                     *bin_batch;
+	apr_size_t                bin_batch_size;
+
+	volatile apr_uint32_t     written_count;
+	volatile apr_uint32_t     dropped_count;
+	volatile apr_uint32_t     overflow_count;
+	apr_uint32_t              reported_drop_count;
+};
+
+/** Call site (log source, file, line and format string) of binary log */
+struct apt_log_bin_format_t {
+	const apt_log_source_t   *log_source;
+	const char               *file;
+	int                       line;
+	const char               *format;
+	apr_uint32_t              id;
+	int                       arg_count;
+	apt_log_bin_arg_t         args[APT_LOG_BIN_MAX_ARG_COUNT];
+	char                     *record;             /* format record written to each log file */
+	apr_size_t                record_size;
+};
+
+/** Table of call sites, looked up without locking */
+struct apt_log_bin_table_t {
+	apt_log_bin_format_t * volatile slots[LOG_BIN_TABLE_SIZE];
+	apt_log_bin_format_t * volatile formats[LOG_BIN_TABLE_SIZE / 2 + 1]; /* indexed by id */
+	apr_uint32_t              count;
+	apr_thread_mutex_t       *mutex;              /* serializes insertion */
+};
+
 struct apt_logger_t {
 	apt_log_output_e          mode;
 	int                       header;
@@ -99,12 +190,17 @@ struct apt_logger_t {
 	apt_log_ext_handler_f     ext_handler;
 	apt_log_file_data_t      *file_data;
 	apt_bool_t                syslog;
+	apr_pool_t               *pool;
+	apt_log_async_t          *async;
+	apt_log_format_e          format;
+	apt_log_bin_table_t      *bin_table;
 };
 
 static apt_logger_t *apt_logger = NULL;
 apt_log_source_t def_log_source;
+static apt_log_time_cache_t time_cache;
 
-static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr);
+static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, void *obj, const char *format, va_list arg_ptr);
 
 static apt_bool_t apt_log_file_open_internal(const char *dir_path, const char *prefix, const apt_log_file_settings_t *settings, apr_pool_t *pool);
 static apt_bool_t apt_log_file_create(apt_log_file_data_t *file_data);
@@ -115,6 +211,9 @@ static void apt_log_files_populate(apt_log_file_data_t *file_data);
 static void apt_log_file_entries_clear(apt_log_file_data_t *file_data);
 static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *log_entry, apr_size_t size);
 static apr_xml_doc* apt_log_doc_parse(const char *file_path, apr_pool_t *pool);
+static apt_log_bin_table_t* apt_log_bin_table_create(apr_pool_t *pool);
+static void apt_log_bin_table_destroy(apt_log_bin_table_t *table);
+static apr_size_t apt_log_bin_file_init(FILE *file);
 
 static void apt_log_file_settings_init(apt_log_file_settings_t *settings)
 {
@@ -133,6 +232,10 @@ static apt_logger_t* apt_log_instance_alloc(apr_pool_t *pool)
 	logger->ext_handler = NULL;
 	logger->file_data = NULL;
 	logger->syslog = FALSE;
+	logger->pool = pool;
+	logger->async = NULL;
+	logger->format = APT_LOG_FORMAT_TEXT;
+	logger->bin_table = NULL;
 
 	/* Create hash for custom log sources */
 	logger->log_sources = apr_hash_make(pool);
@@ -229,11 +332,37 @@ static apt_bool_t apt_log_file_settings_load(apt_log_file_settings_t *settings,
 	return TRUE;
 }
 
+static apt_bool_t apt_log_async_settings_load(const apr_xml_elem *elem)
+{
+	const apr_xml_attr *attr;
+	apt_bool_t enable = FALSE;
+	apr_size_t ring_size = DEFAULT_LOG_RING_SIZE;
+	apr_uint32_t max_latency = DEFAULT_LOG_ASYNC_LATENCY;
+
+	for(attr = elem->attr; attr; attr = attr->next) {
+		if(strcasecmp(attr->name,"enable") == 0) {
+			enable = (strcasecmp(attr->value,"true") == 0) ? TRUE : FALSE;
+		}
+		else if(strcasecmp(attr->name,"ring-size") == 0) {
+			ring_size = atol(attr->value) * 1024;
+		}
+		else if(strcasecmp(attr->name,"max-latency") == 0) {
+			max_latency = atol(attr->value);
+		}
+	}
+
+	if(enable == FALSE) {
+		return TRUE;
+	}
+	return apt_log_async_start(ring_size,max_latency);
+}
+
 APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_t *pool)
 {
 	apr_xml_doc *doc;
 	const apr_xml_elem *elem;
 	const apr_xml_elem *root;
+	const apr_xml_elem *async_elem = NULL;
 	char *text;
 
 	if(apt_logger) {
@@ -259,6 +388,11 @@ APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_
 
 	/* Navigate through document */
 	for(elem = root->first_child; elem; elem = elem->next) {
+		if(strcasecmp(elem->name,"async") == 0) {
+			/* started once the whole document is loaded */
+			async_elem = elem;
+			continue;
+		}
 		if(!elem->first_cdata.first || !elem->first_cdata.first->text) 
 			continue;
 
@@ -277,6 +411,9 @@ APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_
 		else if(strcasecmp(elem->name,"masking") == 0) {
 			def_log_source.masking = apt_log_masking_translate(text);
 		}
+		else if(strcasecmp(elem->name,"format") == 0) {
+			apt_log_format_set(apt_log_format_translate(text));
+		}
 		else if(strcasecmp(elem->name,"sources") == 0) {
 			apt_log_sources_load(elem,pool);
 		}
@@ -284,6 +421,10 @@ APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_
 			/* Unknown element */
 		}
 	}
+
+	if(async_elem) {
+		apt_log_async_settings_load(async_elem);
+	}
 	return TRUE;
 }
 
@@ -293,6 +434,10 @@ APT_DECLARE(apt_bool_t) apt_log_instance_destroy()
 		return FALSE;
 	}
 
+	if(apt_logger->async) {
+		apt_log_async_stop();
+	}
+
 	if(apt_logger->file_data) {
 		apt_log_file_close();
 	}
@@ -301,6 +446,11 @@ APT_DECLARE(apt_bool_t) apt_log_instance_destroy()
 		apt_syslog_close();
 	}
 
+	if(apt_logger->bin_table) {
+		apt_log_bin_table_destroy(apt_logger->bin_table);
+		apt_logger->bin_table = NULL;
+	}
+
 	apt_logger = NULL;
 	return TRUE;
 }
@@ -458,6 +608,10 @@ APT_DECLARE(apt_bool_t) apt_log_file_close()
 	if(!apt_logger || !apt_logger->file_data) {
 		return FALSE;
 	}
+	if(apt_logger->async) {
+		/* the writer thread must not outlive the log file */
+		apt_log_async_stop();
+	}
 	file_data = apt_logger->file_data;
 	if(file_data->file) {
 		/* close log file */
@@ -745,6 +899,29 @@ APT_DECLARE(apt_log_masking_e) apt_log_masking_translate(const char *str)
 	return APT_LOG_MASKING_NONE;
 }
 
+APT_DECLARE(apt_bool_t) apt_log_format_set(apt_log_format_e format)
+{
+	if(!apt_logger || apt_logger->file_data) {
+		return FALSE;
+	}
+
+	if(format == APT_LOG_FORMAT_BINARY && !apt_logger->bin_table) {
+		apt_logger->bin_table = apt_log_bin_table_create(apt_logger->pool);
+		if(!apt_logger->bin_table) {
+			return FALSE;
+		}
+	}
+	apt_logger->format = format;
+	return TRUE;
+}
+
+APT_DECLARE(apt_log_format_e) apt_log_format_translate(const char *str)
+{
+	if(strcasecmp(str, "BINARY") == 0)
+		return APT_LOG_FORMAT_BINARY;
+	return APT_LOG_FORMAT_TEXT;
+}
+
 #define APT_MASKED_CONTENT "*** masked ***"
 
 APT_DECLARE(const char*) apt_log_data_mask(const char *data_in, apr_size_t *length, apr_pool_t *pool)
@@ -782,7 +959,7 @@ APT_DECLARE(apt_bool_t) apt_log(apt_log_source_t *log_source, const char *file,
 			status = apt_logger->ext_handler(file,line,NULL,priority,format,arg_ptr);
 		}
 		else {
-			status = apt_do_log(log_source,file,line,priority,format,arg_ptr);
+			status = apt_do_log(log_source,file,line,priority,NULL,format,arg_ptr);
 		}
 		va_end(arg_ptr); 
 	}
@@ -803,7 +980,7 @@ APT_DECLARE(apt_bool_t) apt_obj_log(apt_log_source_t *log_source, const char *fi
 			status = apt_logger->ext_handler(file,line,obj,priority,format,arg_ptr);
 		}
 		else {
-			status = apt_do_log(log_source,file,line,priority,format,arg_ptr);
+			status = apt_do_log(log_source,file,line,priority,obj,format,arg_ptr);
 		}
 		va_end(arg_ptr); 
 	}
@@ -822,7 +999,7 @@ APT_DECLARE(apt_bool_t) apt_va_log(apt_log_source_t *log_source, const char *fil
 			status = apt_logger->ext_handler(file,line,NULL,priority,format,arg_ptr);
 		}
 		else {
-			status = apt_do_log(log_source,file,line,priority,format,arg_ptr);
+			status = apt_do_log(log_source,file,line,priority,NULL,format,arg_ptr);
 		}
 	}
 	return status;
@@ -837,28 +1014,323 @@ static APR_INLINE unsigned long apt_thread_id_get(void)
 #endif
 }
 
-static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr)
+/** Compose date and time headers, the strings are formatted once per second and cached */
+static apr_size_t apt_log_time_header_make(char *buf, int header, apr_time_t now)
 {
-	char log_entry[MAX_LOG_ENTRY_SIZE];
-	apr_size_t max_size = MAX_LOG_ENTRY_SIZE - 2;
+	char date[16];
+	char time[16];
 	apr_size_t offset = 0;
-	apr_size_t data_offset;
+	apr_size_t length;
+	apr_size_t i;
+	apr_int32_t usec;
 	apr_time_exp_t result;
-	apr_time_t now = apr_time_now();
-	apr_time_exp_lt(&result,now);
-
-	if(apt_logger->header & APT_LOG_HEADER_DATE) {
-		offset += apr_snprintf(log_entry+offset,max_size-offset,"%4d-%02d-%02d ",
+	apr_time_t sec = apr_time_sec(now);
+	apr_uint32_t seq = apr_atomic_read32(&time_cache.seq);
+	apt_bool_t cached = FALSE;
+
+	if(!(seq & 1) && time_cache.sec == sec) {
+		memcpy(date,time_cache.date,sizeof(date));
+		memcpy(time,time_cache.time,sizeof(time));
+		cached = (apr_atomic_read32(&time_cache.seq) == seq) ? TRUE : FALSE;
+	}
+	if(cached == FALSE) {
+		apr_time_exp_lt(&result,now);
+		apr_snprintf(date,sizeof(date),"%4d-%02d-%02d ",
 							result.tm_year+1900,
 							result.tm_mon+1,
 							result.tm_mday);
-	}
-	if(apt_logger->header & APT_LOG_HEADER_TIME) {
-		offset += apr_snprintf(log_entry+offset,max_size-offset,"%02d:%02d:%02d:%06d ",
+		apr_snprintf(time,sizeof(time),"%02d:%02d:%02d:",
 							result.tm_hour,
 							result.tm_min,
-							result.tm_sec,
-							result.tm_usec);
+							result.tm_sec);
+		/* update the cache, unless another thread is already doing so */
+		if(!(seq & 1) && apr_atomic_cas32(&time_cache.seq,seq + 1,seq) == seq) {
+			time_cache.sec = sec;
+			memcpy(time_cache.date,date,sizeof(date));
+			memcpy(time_cache.time,time,sizeof(time));
+			apr_atomic_inc32(&time_cache.seq);
+		}
+	}
+
+	if(header & APT_LOG_HEADER_DATE) {
+		length = strlen(date);
+		memcpy(buf+offset,date,length);
+		offset += length;
+	}
+	if(header & APT_LOG_HEADER_TIME) {
+		length = strlen(time);
+		memcpy(buf+offset,time,length);
+		offset += length;
+		usec = (apr_int32_t)apr_time_usec(now);
+		for(i=6; i>0; i--) {
+			buf[offset+i-1] = (char)('0' + usec % 10);
+			usec /= 10;
+		}
+		offset += 6;
+		buf[offset++] = ' ';
+	}
+	return offset;
+}
+
+/*
+ * Binary output.
+ *
+ * Each call site is assigned an id on the first use and its format record
+ * is written to the log file right away, as well as at the beginning of
+ * each subsequent log file. Entries carry the id and the raw arguments,
+ * which are much cheaper to copy than to format.
+ */
+
+static apt_log_bin_table_t* apt_log_bin_table_create(apr_pool_t *pool)
+{
+	apt_log_bin_table_t *table = apr_palloc(pool,sizeof(apt_log_bin_table_t));
+	memset(table,0,sizeof(apt_log_bin_table_t));
+	if(apr_thread_mutex_create(&table->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return table;
+}
+
+static void apt_log_bin_table_destroy(apt_log_bin_table_t *table)
+{
+	apt_log_bin_format_t *bin_format;
+	apr_uint32_t id;
+	for(id=1; id<=table->count; id++) {
+		bin_format = table->formats[id];
+		free(bin_format->record);
+		free(bin_format);
+	}
+	table->count = 0;
+	apr_thread_mutex_destroy(table->mutex);
+}
+
+/** Write the file header and the formats defined so far to the new log file */
+static apr_size_t apt_log_bin_file_init(FILE *file)
+{
+	apt_log_bin_file_header_t header;
+	const apt_log_bin_format_t *bin_format;
+	apr_size_t size = sizeof(header);
+	apr_uint32_t id;
+
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,APT_LOG_BIN_MAGIC,sizeof(APT_LOG_BIN_MAGIC));
+	header.byte_order = APT_LOG_BIN_BYTE_ORDER;
+	header.version = APT_LOG_BIN_VERSION;
+	fwrite(&header,1,sizeof(header),file);
+
+	if(!apt_logger->bin_table) {
+		return size;
+	}
+	for(id=1; id<=LOG_BIN_TABLE_SIZE / 2; id++) {
+		bin_format = apt_logger->bin_table->formats[id];
+		if(!bin_format) {
+			break;
+		}
+		fwrite(bin_format->record,1,bin_format->record_size,file);
+		size += bin_format->record_size;
+	}
+	return size;
+}
+
+/** Create the call site and compose its format record */
+static apt_log_bin_format_t* apt_log_bin_format_create(const apt_log_source_t *log_source, const char *file, int line, const char *format, apr_uint32_t id)
+{
+	apt_log_bin_record_t *record;
+	apr_size_t source_length = strlen(log_source->name) + 1;
+	apr_size_t file_length = strlen(file) + 1;
+	apr_size_t format_length = strlen(format) + 1;
+	apr_uint32_t line_number = (apr_uint32_t)line;
+	apr_size_t offset = sizeof(apt_log_bin_record_t);
+	apt_log_bin_format_t *bin_format = malloc(sizeof(apt_log_bin_format_t));
+	if(!bin_format) {
+		return NULL;
+	}
+
+	bin_format->log_source = log_source;
+	bin_format->file = file;
+	bin_format->line = line;
+	bin_format->format = format;
+	bin_format->id = id;
+	bin_format->arg_count = apt_log_bin_format_compile(format,bin_format->args,APT_LOG_BIN_MAX_ARG_COUNT);
+	bin_format->record_size = APT_LOG_BIN_ALIGN(offset + sizeof(line_number) + source_length + file_length + format_length);
+	bin_format->record = calloc(1,bin_format->record_size);
+	if(!bin_format->record) {
+		free(bin_format);
+		return NULL;
+	}
+
+	record = (apt_log_bin_record_t*)bin_format->record;
+	record->size = (apr_uint32_t)bin_format->record_size;
+	record->type = APT_LOG_BIN_RECORD_FORMAT;
+	record->format_id = id;
+	memcpy(bin_format->record + offset,&line_number,sizeof(line_number));
+	offset += sizeof(line_number);
+	memcpy(bin_format->record + offset,log_source->name,source_length);
+	offset += source_length;
+	memcpy(bin_format->record + offset,file,file_length);
+	offset += file_length;
+	memcpy(bin_format->record + offset,format,format_length);
+	return bin_format;
+}
+
+static APR_INLINE apr_uint32_t apt_log_bin_hash(const char *file, int line, const char *format)
+{
+	apr_uint32_t hash = (apr_uint32_t)((apr_uintptr_t)format >> 3);
+	hash ^= (apr_uint32_t)((apr_uintptr_t)file >> 3) * 31;
+	hash ^= (apr_uint32_t)line * 2654435761u;
+	return hash;
+}
+
+/** Get the call site, define it on the first use */
+static const apt_log_bin_format_t* apt_log_bin_format_get(apt_log_bin_table_t *table, const apt_log_source_t *log_source, const char *file, int line, const char *format)
+{
+	apt_log_bin_format_t *bin_format;
+	apr_uint32_t hash = apt_log_bin_hash(file,line,format);
+	apr_uint32_t i;
+
+	for(i = hash; ; i++) {
+		bin_format = table->slots[i & (LOG_BIN_TABLE_SIZE - 1)];
+		if(!bin_format) {
+			break;
+		}
+		if(bin_format->format == format && bin_format->line == line &&
+			bin_format->file == file && bin_format->log_source == log_source) {
+			return bin_format->arg_count >= 0 ? bin_format : NULL;
+		}
+	}
+
+	apr_thread_mutex_lock(table->mutex);
+	/* the call site might have been defined by another thread meanwhile */
+	for(; ; i++) {
+		bin_format = table->slots[i & (LOG_BIN_TABLE_SIZE - 1)];
+		if(!bin_format) {
+			break;
+		}
+		if(bin_format->format == format && bin_format->line == line &&
+			bin_format->file == file && bin_format->log_source == log_source) {
+			apr_thread_mutex_unlock(table->mutex);
+			return bin_format->arg_count >= 0 ? bin_format : NULL;
+		}
+	}
+
+	if(table->count >= LOG_BIN_TABLE_SIZE / 2) {
+		/* too many call sites, output formatted text */
+		apr_thread_mutex_unlock(table->mutex);
+		return NULL;
+	}
+	bin_format = apt_log_bin_format_create(log_source,file,line,format,table->count + 1);
+	if(!bin_format) {
+		apr_thread_mutex_unlock(table->mutex);
+		return NULL;
+	}
+	table->count++;
+	/* publish, then write to the current log file, so that no file misses the format */
+	apr_atomic_casptr((volatile void**)&table->formats[bin_format->id],bin_format,NULL);
+	apr_atomic_casptr((volatile void**)&table->slots[i & (LOG_BIN_TABLE_SIZE - 1)],bin_format,NULL);
+	if(apt_logger->file_data) {
+		apt_log_file_dump(apt_logger->file_data,bin_format->record,bin_format->record_size);
+	}
+	apr_thread_mutex_unlock(table->mutex);
+	return bin_format->arg_count >= 0 ? bin_format : NULL;
+}
+
+/** Compose binary entry, the arguments of which are either encoded or formatted */
+static apr_size_t apt_log_bin_entry_make(char *buf, apr_size_t max_size, apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, void *obj, const char *format, va_list arg_ptr)
+{
+	apt_log_bin_record_t *record = (apt_log_bin_record_t*)buf;
+	apr_size_t size = sizeof(apt_log_bin_record_t);
+	apr_size_t aligned_size;
+	const apt_log_bin_format_t *bin_format = apt_log_bin_format_get(apt_logger->bin_table,log_source,file,line,format);
+
+	record->priority = (apr_uint16_t)priority;
+	record->thread_id = (apr_uint32_t)apt_thread_id_get();
+	record->timestamp = apr_time_now();
+	record->obj = (apr_uint64_t)(apr_uintptr_t)obj;
+	if(bin_format) {
+		record->type = APT_LOG_BIN_RECORD_ENTRY;
+		record->format_id = bin_format->id;
+		size += apt_log_bin_args_encode(bin_format->args,bin_format->arg_count,buf + size,max_size - size,arg_ptr);
+	}
+	else {
+		record->type = APT_LOG_BIN_RECORD_TEXT;
+		record->format_id = 0;
+		size += apr_vsnprintf(buf + size,max_size - size,format,arg_ptr);
+	}
+
+	/* the alignment is reserved by the caller */
+	aligned_size = APT_LOG_BIN_ALIGN(size);
+	memset(buf + size,0,aligned_size - size);
+	record->size = (apr_uint32_t)aligned_size;
+	return aligned_size;
+}
+
+/** Compose binary entry of formatted text */
+static apr_size_t apt_log_bin_text_make(char *buf, apt_log_priority_e priority, const char *text, apr_size_t length)
+{
+	apt_log_bin_record_t *record = (apt_log_bin_record_t*)buf;
+	apr_size_t size = sizeof(apt_log_bin_record_t) + length;
+	apr_size_t aligned_size = APT_LOG_BIN_ALIGN(size);
+
+	record->size = (apr_uint32_t)aligned_size;
+	record->type = APT_LOG_BIN_RECORD_TEXT;
+	record->priority = (apr_uint16_t)priority;
+	record->format_id = 0;
+	record->thread_id = (apr_uint32_t)apt_thread_id_get();
+	record->timestamp = apr_time_now();
+	record->obj = 0;
+	memcpy(buf + sizeof(apt_log_bin_record_t),text,length);
+	memset(buf + size,0,aligned_size - size);
+	return aligned_size;
+}
+
+/** Render the message of binary entry as text */
+static apr_size_t apt_log_bin_entry_render(const char *entry, char *buf, apr_size_t max_size)
+{
+	const apt_log_bin_record_t *record = (const apt_log_bin_record_t*)entry;
+	const char *data = entry + sizeof(apt_log_bin_record_t);
+	apr_size_t size = record->size - sizeof(apt_log_bin_record_t);
+	const apt_log_bin_format_t *bin_format;
+	apr_size_t i;
+
+	if(record->type == APT_LOG_BIN_RECORD_ENTRY) {
+		bin_format = apt_logger->bin_table->formats[record->format_id];
+		return apt_log_bin_args_render(bin_format->format,data,size,buf,max_size);
+	}
+
+	for(i = 0; i < size && i + 1 < max_size && data[i]; i++) {
+		buf[i] = data[i];
+	}
+	buf[i] = '\0';
+	return i;
+}
+
+static apt_bool_t apt_log_async_put(apt_log_async_t *async, const char *log_entry, apr_size_t length, apr_size_t data_offset, apt_log_priority_e priority, apt_bool_t binary);
+
+static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, void *obj, const char *format, va_list arg_ptr)
+{
+	char log_entry[MAX_LOG_ENTRY_SIZE];
+	apr_uint64_t bin_entry[MAX_LOG_ENTRY_SIZE / sizeof(apr_uint64_t)];
+	apr_size_t bin_size = 0;
+	apr_size_t max_size = MAX_LOG_ENTRY_SIZE - 2;
+	apr_size_t offset = 0;
+	apr_size_t data_offset;
+	apt_log_async_t *async = apt_logger->async;
+
+	if(apt_logger->format == APT_LOG_FORMAT_BINARY && apt_logger->bin_table &&
+		(apt_logger->mode & APT_LOG_OUTPUT_FILE) == APT_LOG_OUTPUT_FILE && apt_logger->file_data) {
+		bin_size = apt_log_bin_entry_make((char*)bin_entry,sizeof(bin_entry) - sizeof(apr_uint64_t),
+						log_source,file,line,priority,obj,format,arg_ptr);
+		if(!async || apt_log_async_put(async,(const char*)bin_entry,bin_size,0,priority,TRUE) == FALSE) {
+			apt_log_file_dump(apt_logger->file_data,(const char*)bin_entry,bin_size);
+		}
+
+		if((apt_logger->mode & (APT_LOG_OUTPUT_CONSOLE | APT_LOG_OUTPUT_SYSLOG)) == 0) {
+			return TRUE;
+		}
+	}
+
+	if(apt_logger->header & (APT_LOG_HEADER_DATE | APT_LOG_HEADER_TIME)) {
+		offset = apt_log_time_header_make(log_entry,apt_logger->header,apr_time_now());
 	}
 	if(apt_logger->header & APT_LOG_HEADER_MARK) {
 		offset += apr_snprintf(log_entry+offset,max_size-offset,"%s:%03d ",file,line);
@@ -872,14 +1344,25 @@ static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int
 	}
 
 	data_offset = offset;
-	offset += apr_vsnprintf(log_entry+offset,max_size-offset,format,arg_ptr);
+	if(bin_size) {
+		/* the arguments have been consumed, render the binary entry instead */
+		offset += apt_log_bin_entry_render((const char*)bin_entry,log_entry+offset,max_size-offset+1);
+	}
+	else {
+		offset += apr_vsnprintf(log_entry+offset,max_size-offset,format,arg_ptr);
+	}
 	log_entry[offset++] = '\n';
 	log_entry[offset] = '\0';
+
+	if(async && apt_log_async_put(async,log_entry,offset,data_offset,priority,FALSE) == TRUE) {
+		return TRUE;
+	}
+
 	if((apt_logger->mode & APT_LOG_OUTPUT_CONSOLE) == APT_LOG_OUTPUT_CONSOLE) {
 		fwrite(log_entry,offset,1,stdout);
 	}
 	
-	if((apt_logger->mode & APT_LOG_OUTPUT_FILE) == APT_LOG_OUTPUT_FILE && apt_logger->file_data) {
+	if((apt_logger->mode & APT_LOG_OUTPUT_FILE) == APT_LOG_OUTPUT_FILE && apt_logger->file_data && !bin_size) {
 		apt_log_file_dump(apt_logger->file_data,log_entry,offset);
 	}
 
@@ -891,6 +1374,424 @@ static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int
 	return TRUE;
 }
 
+/*
+ * Asynchronous output.
+ *
+ * Each logging thread owns a ring, where it writes formatted entries as
+ * records aligned to the size of the record header. The positions are free
+ * running 32-bit counters advanced by atomic add, which also publishes the
+ * data copied before. The ring is registered in a lock-free list on the
+ * first use and is marked closed on thread exit; the writer thread drains
+ * the rings, outputs the entries in large batches and frees the closed rings.
+ */
+
+/** Align the size of a record in the ring */
+#define LOG_RECORD_ALIGN(size) (((size) + sizeof(apt_log_record_t) - 1) & ~(sizeof(apt_log_record_t) - 1))
+
+/** Invoked on exit of the thread owning the ring */
+static void apt_log_ring_close(void *data)
+{
+	apt_log_ring_t *ring = data;
+	if(ring) {
+		apr_atomic_set32(&ring->closed,1);
+	}
+}
+
+/** Get the ring of the calling thread, create and register one if needed */
+static apt_log_ring_t* apt_log_ring_get(apt_log_async_t *async)
+{
+	void *data = NULL;
+	apt_log_ring_t *ring;
+	apt_log_ring_t *head;
+	if(apr_threadkey_private_get(&data,async->key) == APR_SUCCESS && data) {
+		return data;
+	}
+
+	ring = malloc(sizeof(apt_log_ring_t));
+	if(!ring) {
+		return NULL;
+	}
+	ring->data = malloc(async->ring_size);
+	if(!ring->data) {
+		free(ring);
+		return NULL;
+	}
+	ring->capacity = (apr_uint32_t)async->ring_size;
+	ring->write_pos = 0;
+	ring->read_pos = 0;
+	ring->closed = 0;
+	ring->overflowed = FALSE;
+	if(apr_threadkey_private_set(ring,async->key) != APR_SUCCESS) {
+		free(ring->data);
+		free(ring);
+		return NULL;
+	}
+
+	do {
+		head = async->ring_list;
+		ring->next = head;
+	}
+	while(apr_atomic_casptr((volatile void**)&async->ring_list,ring,head) != head);
+	return ring;
+}
+
+static void apt_log_async_wakeup(apt_log_async_t *async)
+{
+	if(apr_atomic_cas32(&async->wakeup_pending,1,0) == 0) {
+		apr_thread_mutex_lock(async->guard);
+		apr_thread_cond_signal(async->wakeup);
+		apr_thread_mutex_unlock(async->guard);
+	}
+}
+
+/** Write formatted entry to the specified ring */
+static void apt_log_ring_put(apt_log_async_t *async, apt_log_ring_t *ring, const char *log_entry, apr_size_t length, apr_size_t data_offset, apt_log_priority_e priority, apt_bool_t binary)
+{
+	apt_log_record_t *record;
+	apr_uint32_t write_pos;
+	apr_uint32_t used;
+	apr_uint32_t offset;
+	apr_uint32_t tail_room;
+	apr_uint32_t size;
+	apr_uint32_t total;
+
+	/* formatted entry is copied along with the terminating null character */
+	if(binary == FALSE) {
+		length++;
+	}
+	size = (apr_uint32_t)LOG_RECORD_ALIGN(sizeof(apt_log_record_t) + length);
+	write_pos = ring->write_pos;
+	used = write_pos - apr_atomic_read32(&ring->read_pos);
+	offset = write_pos & (ring->capacity - 1);
+	tail_room = ring->capacity - offset;
+	/* a record never wraps, the rest of the ring is skipped instead */
+	total = tail_room < size ? tail_room + size : size;
+	if(ring->capacity - used < total) {
+		apr_atomic_inc32(&async->dropped_count);
+		if(ring->overflowed == FALSE) {
+			ring->overflowed = TRUE;
+			apr_atomic_inc32(&async->overflow_count);
+		}
+		apt_log_async_wakeup(async);
+		return;
+	}
+
+	if(tail_room < size) {
+		record = (apt_log_record_t*)(ring->data + offset);
+		record->size = tail_room;
+		record->length = 0;
+		offset = 0;
+	}
+	ring->overflowed = FALSE;
+	record = (apt_log_record_t*)(ring->data + offset);
+	record->size = size;
+	record->length = (apr_uint32_t)(binary == FALSE ? length - 1 : length);
+	record->data_offset = (apr_uint32_t)data_offset;
+	record->priority = (apr_uint16_t)priority;
+	record->binary = (apr_uint16_t)binary;
+	memcpy(record + 1,log_entry,length);
+	apr_atomic_add32(&ring->write_pos,total);
+
+	if(used + total >= ring->capacity / 2) {
+		/* don't wait for the max latency to elapse */
+		apt_log_async_wakeup(async);
+	}
+}
+
+/**
+ * Write formatted entry to the ring of the calling thread.
+ *
+ * The writer is accounted for in writer_count while it touches the ring,
+ * so apt_log_async_stop() doesn't free the rings, or let the writer thread
+ * make its final pass, until all the writers which saw the async output
+ * accepting entries are done.
+ */
+static apt_bool_t apt_log_async_put(apt_log_async_t *async, const char *log_entry, apr_size_t length, apr_size_t data_offset, apt_log_priority_e priority, apt_bool_t binary)
+{
+	apt_log_ring_t *ring;
+	apr_atomic_inc32(&async->writer_count);
+	if(apr_atomic_read32(&async->accepting) == 0) {
+		/* being stopped, output synchronously */
+		apr_atomic_dec32(&async->writer_count);
+		return FALSE;
+	}
+
+	ring = apt_log_ring_get(async);
+	if(!ring) {
+		/* output synchronously */
+		apr_atomic_dec32(&async->writer_count);
+		return FALSE;
+	}
+
+	apt_log_ring_put(async,ring,log_entry,length,data_offset,priority,binary);
+	apr_atomic_dec32(&async->writer_count);
+	return TRUE;
+}
+
+/** Output the batch of entries collected by the writer thread */
+static void apt_log_async_batch_flush(apt_log_async_t *async)
+{
+	if(async->batch_size) {
+		if((apt_logger->mode & APT_LOG_OUTPUT_CONSOLE) == APT_LOG_OUTPUT_CONSOLE) {
+			fwrite(async->batch,async->batch_size,1,stdout);
+			fflush(stdout);
+		}
+
+		if((apt_logger->mode & APT_LOG_OUTPUT_FILE) == APT_LOG_OUTPUT_FILE && apt_logger->file_data &&
+			apt_logger->format == APT_LOG_FORMAT_TEXT) {
+			apt_log_file_dump(apt_logger->file_data,async->batch,async->batch_size);
+		}
+		async->batch_size = 0;
+	}
+
+	if(async->bin_batch_size) {
+		if(apt_logger->file_data) {
+			apt_log_file_dump(apt_logger->file_data,async->bin_batch,async->bin_batch_size);
+		}
+		async->bin_batch_size = 0;
+	}
+}
+
+static void apt_log_async_batch_add(apt_log_async_t *async, const char *log_entry, apr_size_t length, apt_bool_t binary)
+{
+	if(binary == TRUE) {
+		if(async->bin_batch_size + length > LOG_ASYNC_BATCH_SIZE) {
+			apt_log_async_batch_flush(async);
+		}
+		memcpy(async->bin_batch + async->bin_batch_size,log_entry,length);
+		async->bin_batch_size += length;
+		return;
+	}
+
+	if(async->batch_size + length > LOG_ASYNC_BATCH_SIZE) {
+		apt_log_async_batch_flush(async);
+	}
+	memcpy(async->batch + async->batch_size,log_entry,length);
+	async->batch_size += length;
+}
+
+/** Move the entries from the ring to the batch */
+static void apt_log_ring_drain(apt_log_async_t *async, apt_log_ring_t *ring)
+{
+	const apt_log_record_t *record;
+	const char *log_entry;
+	apr_uint32_t read_pos = ring->read_pos;
+	apr_uint32_t write_pos = apr_atomic_read32(&ring->write_pos);
+	apr_uint32_t count = 0;
+
+	while(read_pos != write_pos) {
+		record = (const apt_log_record_t*)(ring->data + (read_pos & (ring->capacity - 1)));
+		if(record->length) {
+			log_entry = (const char*)(record + 1);
+			apt_log_async_batch_add(async,log_entry,record->length,record->binary);
+#ifndef WIN32
+			if(!record->binary && (apt_logger->mode & APT_LOG_OUTPUT_SYSLOG) == APT_LOG_OUTPUT_SYSLOG) {
+				syslog(record->priority,"%s",log_entry + record->data_offset);
+			}
+#endif
+			count++;
+		}
+		read_pos += record->size;
+	}
+
+	if(count) {
+		apr_atomic_add32(&async->written_count,count);
+	}
+	if(read_pos != ring->read_pos) {
+		apr_atomic_add32(&ring->read_pos,read_pos - ring->read_pos);
+	}
+}
+
+/** Unlink the ring from the list, new rings may be concurrently pushed to the head only */
+static void apt_log_ring_unlink(apt_log_async_t *async, apt_log_ring_t *ring, apt_log_ring_t *prev)
+{
+	if(!prev) {
+		if(apr_atomic_casptr((volatile void**)&async->ring_list,ring->next,ring) == ring) {
+			return;
+		}
+		for(prev = async->ring_list; prev->next != ring; prev = prev->next);
+	}
+	prev->next = ring->next;
+}
+
+static void apt_log_async_process(apt_log_async_t *async)
+{
+	char log_entry[MAX_LOG_ENTRY_SIZE];
+	apr_uint64_t bin_entry[MAX_LOG_ENTRY_SIZE / sizeof(apr_uint64_t) + 4];
+	apr_size_t length;
+	apr_uint32_t dropped_count;
+	apt_log_ring_t *ring = async->ring_list;
+	apt_log_ring_t *prev = NULL;
+	apt_log_ring_t *next;
+
+	while(ring) {
+		next = ring->next;
+		apt_log_ring_drain(async,ring);
+		if(apr_atomic_read32(&ring->closed) && apr_atomic_read32(&ring->write_pos) == ring->read_pos) {
+			/* the owning thread has exited and everything has been output */
+			apt_log_ring_unlink(async,ring,prev);
+			free(ring->data);
+			free(ring);
+		}
+		else {
+			prev = ring;
+		}
+		ring = next;
+	}
+
+	dropped_count = apr_atomic_read32(&async->dropped_count);
+	if(dropped_count != async->reported_drop_count) {
+		length = 0;
+		if(apt_logger->header & (APT_LOG_HEADER_DATE | APT_LOG_HEADER_TIME)) {
+			length = apt_log_time_header_make(log_entry,apt_logger->header,apr_time_now());
+		}
+		length += apr_snprintf(log_entry+length,sizeof(log_entry)-length,"%sLog Entries Dropped [%u]\n",
+					priority_snames[APT_PRIO_WARNING],
+					dropped_count - async->reported_drop_count);
+		apt_log_async_batch_add(async,log_entry,length,FALSE);
+		if(apt_logger->format == APT_LOG_FORMAT_BINARY) {
+			length = apr_snprintf(log_entry,sizeof(log_entry),"Log Entries Dropped [%u]",
+						dropped_count - async->reported_drop_count);
+			length = apt_log_bin_text_make((char*)bin_entry,APT_PRIO_WARNING,log_entry,length);
+			apt_log_async_batch_add(async,(const char*)bin_entry,length,TRUE);
+		}
+		async->reported_drop_count = dropped_count;
+	}
+
+	apt_log_async_batch_flush(async);
+}
+
+static void* APR_THREAD_FUNC apt_log_writer_run(apr_thread_t *thread, void *data)
+{
+	apt_log_async_t *async = data;
+	apr_uint32_t running;
+	do {
+		/* the last pass drains everything written before the stop */
+		running = apr_atomic_read32(&async->running);
+		apt_log_async_process(async);
+		if(running) {
+			apr_thread_mutex_lock(async->guard);
+			if(!apr_atomic_read32(&async->wakeup_pending) && apr_atomic_read32(&async->running)) {
+				apr_thread_cond_timedwait(async->wakeup,async->guard,async->max_latency);
+			}
+			apr_atomic_set32(&async->wakeup_pending,0);
+			apr_thread_mutex_unlock(async->guard);
+		}
+	}
+	while(running);
+
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_async_start(apr_size_t ring_size, apr_uint32_t max_latency)
+{
+	apt_log_async_t *async;
+	apr_pool_t *pool;
+	apr_size_t capacity = LOG_RING_MIN_SIZE;
+	if(!apt_logger || apt_logger->async) {
+		return FALSE;
+	}
+
+	pool = apt_logger->pool;
+	while(capacity < ring_size && capacity < 0x40000000) {
+		capacity <<= 1;
+	}
+
+	async = apr_palloc(pool,sizeof(apt_log_async_t));
+	async->thread = NULL;
+	async->ring_list = NULL;
+	async->ring_size = capacity;
+	async->max_latency = (apr_interval_time_t)(max_latency ? max_latency : DEFAULT_LOG_ASYNC_LATENCY) * 1000;
+	async->running = 1;
+	async->accepting = 1;
+	async->writer_count = 0;
+	async->wakeup_pending = 0;
+	async->batch = apr_palloc(pool,LOG_ASYNC_BATCH_SIZE);
+	async->batch_size = 0;
+	async->bin_batch = apr_palloc(pool,LOG_ASYNC_BATCH_SIZE);
+	async->bin_batch_size = 0;
+	async->written_count = 0;
+	async->dropped_count = 0;
+	async->overflow_count = 0;
+	async->reported_drop_count = 0;
+
+	if(apr_thread_mutex_create(&async->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	if(apr_thread_cond_create(&async->wakeup,pool) != APR_SUCCESS) {
+		apr_thread_mutex_destroy(async->guard);
+		return FALSE;
+	}
+	if(apr_threadkey_private_create(&async->key,apt_log_ring_close,pool) != APR_SUCCESS) {
+		apr_thread_cond_destroy(async->wakeup);
+		apr_thread_mutex_destroy(async->guard);
+		return FALSE;
+	}
+	if(apr_thread_create(&async->thread,NULL,apt_log_writer_run,async,pool) != APR_SUCCESS) {
+		apr_threadkey_private_delete(async->key);
+		apr_thread_cond_destroy(async->wakeup);
+		apr_thread_mutex_destroy(async->guard);
+		return FALSE;
+	}
+
+	apt_logger->async = async;
+	return TRUE;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_async_stop(void)
+{
+	apt_log_async_t *async;
+	apt_log_ring_t *ring;
+	apt_log_ring_t *next;
+	apr_status_t retval;
+	if(!apt_logger || !apt_logger->async) {
+		return FALSE;
+	}
+
+	/* subsequent entries are output synchronously */
+	async = apt_logger->async;
+	apt_logger->async = NULL;
+	apr_atomic_xchg32(&async->accepting,0);
+
+	/* wait for the writers which have already passed the check above,
+	the entries they put are drained by the final pass of the writer thread */
+	while(apr_atomic_read32(&async->writer_count) != 0) {
+		apr_thread_yield();
+	}
+
+	apr_thread_mutex_lock(async->guard);
+	apr_atomic_set32(&async->running,0);
+	apr_thread_cond_signal(async->wakeup);
+	apr_thread_mutex_unlock(async->guard);
+	apr_thread_join(&retval,async->thread);
+
+	apr_threadkey_private_delete(async->key);
+	for(ring = async->ring_list; ring; ring = next) {
+		next = ring->next;
+		free(ring->data);
+		free(ring);
+	}
+	async->ring_list = NULL;
+
+	apr_thread_cond_destroy(async->wakeup);
+	apr_thread_mutex_destroy(async->guard);
+	return TRUE;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_async_stat_get(apt_log_async_stat_t *stat)
+{
+	apt_log_async_t *async;
+	if(!apt_logger || !apt_logger->async || !stat) {
+		return FALSE;
+	}
+	async = apt_logger->async;
+	stat->written_count = apr_atomic_read32(&async->written_count);
+	stat->dropped_count = apr_atomic_read32(&async->dropped_count);
+	stat->overflow_count = apr_atomic_read32(&async->overflow_count);
+	return TRUE;
+}
+
 static apt_bool_t apt_log_file_create(apt_log_file_data_t *file_data)
 {
 	const char *log_file_path;
@@ -914,6 +1815,12 @@ static apt_bool_t apt_log_file_create(apt_log_file_data_t *file_data)
 	if (!file_data->file) {
 		return FALSE;
 	}
+
+	file_data->cur_size = 0;
+	if (apt_logger->format == APT_LOG_FORMAT_BINARY) {
+		/* binary log file starts with the header and the formats defined so far */
+		file_data->cur_size = apt_log_bin_file_init(file_data->file);
+	}
 	
 	/* link current log file */
 	apt_log_file_link_current(file_data, log_file_path);
@@ -1114,7 +2021,7 @@ static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *
 			return FALSE;
 		}
 
-		file_data->cur_size = size;
+		file_data->cur_size += size;
 	}
 	/* write to log file */
 	fwrite(log_entry,1,size,file_data->file);
@@ -0,0 +1,512 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_lib.h>
+#include "apt_log_bin.h"
+
+/*
+ * Integer, pointer and double arguments are encoded as 8 bytes each,
+ * strings as the 4-byte length followed by the characters (no null
+ * terminator). Width and precision passed by '*' are encoded as separate
+ * integer arguments preceding the one they apply to.
+ */
+
+/** Length of the encoded null string */
+#define APT_LOG_BIN_NULL_STRING 0xFFFFFFFF
+/** Max length of the conversion specification composed to render an argument */
+#define APT_LOG_BIN_SPEC_SIZE   64
+
+/** Length modifier of 64-bit integers (APR_INT64_T_FMT without the conversion) */
+static const char int64_modifier[] = APR_INT64_T_FMT;
+
+static APR_INLINE apt_bool_t apt_log_bin_flag_check(char ch)
+{
+	return (ch == '-' || ch == '+' || ch == ' ' || ch == '#' || ch == '0') ? TRUE : FALSE;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_bin_spec_next(const char **format, apt_log_bin_spec_t *spec)
+{
+	const char *pos = *format;
+	char modifier = 0;
+	while(*pos && *pos != '%') {
+		pos++;
+	}
+	if(!*pos) {
+		*format = pos;
+		return FALSE;
+	}
+
+	spec->begin = pos++;
+	spec->width_arg = FALSE;
+	spec->precision_arg = FALSE;
+	spec->precision = -1;
+
+	while(apt_log_bin_flag_check(*pos) == TRUE) {
+		pos++;
+	}
+
+	if(*pos == '*') {
+		spec->width_arg = TRUE;
+		pos++;
+	}
+	else {
+		while(apr_isdigit(*pos)) {
+			pos++;
+		}
+	}
+
+	if(*pos == '.') {
+		pos++;
+		if(*pos == '*') {
+			spec->precision_arg = TRUE;
+			pos++;
+		}
+		else {
+			spec->precision = 0;
+			while(apr_isdigit(*pos)) {
+				spec->precision = spec->precision * 10 + (*pos - '0');
+				pos++;
+			}
+		}
+	}
+
+	switch(*pos) {
+		case 'h':
+			pos++;
+			if(*pos == 'h') {
+				pos++;
+			}
+			break;
+		case 'l':
+			pos++;
+			modifier = 'l';
+			if(*pos == 'l') {
+				pos++;
+				modifier = 'q';
+			}
+			break;
+		case 'q':
+		case 'j':
+			pos++;
+			modifier = 'q';
+			break;
+		case 'z':
+		case 't':
+			pos++;
+			modifier = 'z';
+			break;
+		case 'L':
+			pos++;
+			modifier = 'L';
+			break;
+		case 'I':
+			pos++;
+			if(pos[0] == '6' && pos[1] == '4') {
+				pos += 2;
+				modifier = 'q';
+			}
+			else if(pos[0] == '3' && pos[1] == '2') {
+				pos += 2;
+			}
+			else {
+				modifier = 'z';
+			}
+			break;
+		default:
+			break;
+	}
+
+	spec->conversion = *pos;
+	switch(*pos) {
+		case 'd':
+		case 'i':
+			spec->type = modifier == 'l' ? APT_LOG_BIN_ARG_LONG :
+				(modifier == 'q' || modifier == 'L') ? APT_LOG_BIN_ARG_LLONG :
+				modifier == 'z' ? APT_LOG_BIN_ARG_SIZE : APT_LOG_BIN_ARG_INT;
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			spec->type = modifier == 'l' ? APT_LOG_BIN_ARG_ULONG :
+				(modifier == 'q' || modifier == 'L') ? APT_LOG_BIN_ARG_ULLONG :
+				modifier == 'z' ? APT_LOG_BIN_ARG_SIZE : APT_LOG_BIN_ARG_UINT;
+			break;
+		case 'c':
+			spec->type = APT_LOG_BIN_ARG_INT;
+			break;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+			spec->type = modifier == 'L' ? APT_LOG_BIN_ARG_INVALID : APT_LOG_BIN_ARG_DOUBLE;
+			break;
+		case 's':
+			spec->type = APT_LOG_BIN_ARG_STRING;
+			break;
+		case 'p':
+			spec->type = APT_LOG_BIN_ARG_POINTER;
+			break;
+		case '%':
+			spec->type = APT_LOG_BIN_ARG_NONE;
+			break;
+		default:
+			spec->type = APT_LOG_BIN_ARG_INVALID;
+			break;
+	}
+
+	if(*pos) {
+		pos++;
+	}
+	spec->length = pos - spec->begin;
+	*format = pos;
+	return TRUE;
+}
+
+APT_DECLARE(int) apt_log_bin_format_compile(const char *format, apt_log_bin_arg_t *args, int max_count)
+{
+	apt_log_bin_spec_t spec;
+	int count = 0;
+	while(apt_log_bin_spec_next(&format,&spec) == TRUE) {
+		if(spec.type == APT_LOG_BIN_ARG_INVALID) {
+			return -1;
+		}
+		if(spec.type == APT_LOG_BIN_ARG_NONE) {
+			continue;
+		}
+		if(count + 3 > max_count) {
+			return -1;
+		}
+
+		if(spec.width_arg == TRUE) {
+			args[count].type = APT_LOG_BIN_ARG_INT;
+			args[count].precision = -1;
+			count++;
+		}
+		if(spec.precision_arg == TRUE) {
+			args[count].type = APT_LOG_BIN_ARG_INT;
+			args[count].precision = -1;
+			count++;
+		}
+		args[count].type = spec.type;
+		args[count].precision = spec.precision_arg == TRUE ? -2 : spec.precision;
+		count++;
+	}
+	return count;
+}
+
+APT_DECLARE(apr_size_t) apt_log_bin_args_encode(const apt_log_bin_arg_t *args, int count, char *buf, apr_size_t max_size, va_list arg_ptr)
+{
+	apr_int64_t value = 0;
+	double dvalue;
+	const char *str;
+	apr_uint32_t length;
+	apr_size_t offset = 0;
+	int limit;
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(args[i].type == APT_LOG_BIN_ARG_STRING) {
+			str = va_arg(arg_ptr,const char*);
+			if(offset + sizeof(length) > max_size) {
+				break;
+			}
+
+			if(str) {
+				limit = args[i].precision == -2 ? (int)value : args[i].precision;
+				if(limit >= 0) {
+					for(length = 0; length < (apr_uint32_t)limit && str[length]; length++);
+				}
+				else {
+					length = (apr_uint32_t)strlen(str);
+				}
+				if(length > max_size - offset - sizeof(length)) {
+					length = (apr_uint32_t)(max_size - offset - sizeof(length));
+				}
+			}
+			else {
+				length = APT_LOG_BIN_NULL_STRING;
+			}
+
+			memcpy(buf + offset,&length,sizeof(length));
+			offset += sizeof(length);
+			if(str) {
+				memcpy(buf + offset,str,length);
+				offset += length;
+			}
+			continue;
+		}
+
+		switch(args[i].type) {
+			case APT_LOG_BIN_ARG_INT:
+				value = va_arg(arg_ptr,int);
+				break;
+			case APT_LOG_BIN_ARG_UINT:
+				value = va_arg(arg_ptr,unsigned int);
+				break;
+			case APT_LOG_BIN_ARG_LONG:
+				value = va_arg(arg_ptr,long);
+				break;
+			case APT_LOG_BIN_ARG_ULONG:
+				value = va_arg(arg_ptr,unsigned long);
+				break;
+			case APT_LOG_BIN_ARG_LLONG:
+				value = va_arg(arg_ptr,apr_int64_t);
+				break;
+			case APT_LOG_BIN_ARG_ULLONG:
+				value = (apr_int64_t)va_arg(arg_ptr,apr_uint64_t);
+				break;
+			case APT_LOG_BIN_ARG_SIZE:
+				value = (apr_int64_t)va_arg(arg_ptr,apr_size_t);
+				break;
+			case APT_LOG_BIN_ARG_POINTER:
+				value = (apr_int64_t)(apr_uintptr_t)va_arg(arg_ptr,void*);
+				break;
+			case APT_LOG_BIN_ARG_DOUBLE:
+				dvalue = va_arg(arg_ptr,double);
+				memcpy(&value,&dvalue,sizeof(value));
+				break;
+			default:
+				break;
+		}
+		if(offset + sizeof(value) > max_size) {
+			break;
+		}
+		memcpy(buf + offset,&value,sizeof(value));
+		offset += sizeof(value);
+	}
+	return offset;
+}
+
+/** Read encoded integer, pointer or double */
+static apt_bool_t apt_log_bin_value_read(const char **data, const char *end, apr_int64_t *value)
+{
+	if(end - *data < (long)sizeof(*value)) {
+		return FALSE;
+	}
+	memcpy(value,*data,sizeof(*value));
+	*data += sizeof(*value);
+	return TRUE;
+}
+
+/** Read encoded string */
+static apt_bool_t apt_log_bin_string_read(const char **data, const char *end, apt_str_t *str)
+{
+	apr_uint32_t length;
+	if(end - *data < (long)sizeof(length)) {
+		return FALSE;
+	}
+	memcpy(&length,*data,sizeof(length));
+	*data += sizeof(length);
+	if(length == APT_LOG_BIN_NULL_STRING) {
+		apt_string_set(str,"(null)");
+		return TRUE;
+	}
+
+	if(length > (apr_uint32_t)(end - *data)) {
+		length = (apr_uint32_t)(end - *data);
+	}
+	str->buf = (char*)*data;
+	str->length = length;
+	*data += length;
+	return TRUE;
+}
+
+/** Compose the conversion specification to render an argument by */
+static void apt_log_bin_spec_make(const apt_log_bin_spec_t *spec, apr_int64_t width, apr_int64_t precision, char *buf)
+{
+	const char *pos = spec->begin + 1;
+	apr_size_t offset = 0;
+
+	buf[offset++] = '%';
+	while(apt_log_bin_flag_check(*pos) == TRUE) {
+		if(offset < 8) {
+			buf[offset++] = *pos;
+		}
+		pos++;
+	}
+
+	if(spec->width_arg == TRUE) {
+		if(width < 0) {
+			buf[offset++] = '-';
+			width = -width;
+		}
+		offset += apr_snprintf(buf + offset,16,"%d",(int)width);
+	}
+	else {
+		while(apr_isdigit(*pos)) {
+			if(offset < 24) {
+				buf[offset++] = *pos;
+			}
+			pos++;
+		}
+	}
+
+	if(spec->type == APT_LOG_BIN_ARG_STRING) {
+		/* the string is truncated to the precision while encoded */
+		buf[offset++] = '.';
+		buf[offset++] = '*';
+	}
+	else if(precision >= 0) {
+		offset += apr_snprintf(buf + offset,16,".%d",(int)precision);
+	}
+
+	switch(spec->type) {
+		case APT_LOG_BIN_ARG_INT:
+		case APT_LOG_BIN_ARG_UINT:
+		case APT_LOG_BIN_ARG_LONG:
+		case APT_LOG_BIN_ARG_ULONG:
+		case APT_LOG_BIN_ARG_LLONG:
+		case APT_LOG_BIN_ARG_ULLONG:
+		case APT_LOG_BIN_ARG_SIZE:
+			if(spec->conversion != 'c') {
+				memcpy(buf + offset,int64_modifier,sizeof(int64_modifier) - 2);
+				offset += sizeof(int64_modifier) - 2;
+			}
+			buf[offset++] = spec->conversion;
+			break;
+		case APT_LOG_BIN_ARG_POINTER:
+			memcpy(buf + offset,int64_modifier,sizeof(int64_modifier) - 2);
+			offset += sizeof(int64_modifier) - 2;
+			buf[offset++] = 'x';
+			break;
+		default:
+			buf[offset++] = spec->conversion;
+			break;
+	}
+	buf[offset] = '\0';
+}
+
+APT_DECLARE(apr_size_t) apt_log_bin_args_render(const char *format, const char *data, apr_size_t size, char *buf, apr_size_t max_size)
+{
+	apt_log_bin_spec_t spec;
+	char spec_buf[APT_LOG_BIN_SPEC_SIZE];
+	const char *end = data + size;
+	const char *pos = format;
+	const char *literal;
+	apr_size_t offset = 0;
+	apr_size_t length;
+	apt_bool_t status;
+	apr_int64_t width;
+	apr_int64_t precision;
+	apr_int64_t value;
+	double dvalue;
+	apt_str_t str;
+
+	if(!max_size) {
+		return 0;
+	}
+	/* reserve space for the null terminator */
+	max_size--;
+
+	while(offset < max_size) {
+		literal = pos;
+		status = apt_log_bin_spec_next(&pos,&spec);
+		length = (status == TRUE ? spec.begin : pos) - literal;
+		if(length > max_size - offset) {
+			length = max_size - offset;
+		}
+		memcpy(buf + offset,literal,length);
+		offset += length;
+		if(status == FALSE || offset >= max_size) {
+			break;
+		}
+
+		if(spec.type == APT_LOG_BIN_ARG_NONE) {
+			buf[offset++] = '%';
+			continue;
+		}
+		if(spec.type == APT_LOG_BIN_ARG_INVALID) {
+			break;
+		}
+
+		width = 0;
+		precision = spec.precision;
+		if(spec.width_arg == TRUE && apt_log_bin_value_read(&data,end,&width) == FALSE) {
+			break;
+		}
+		if(spec.precision_arg == TRUE && apt_log_bin_value_read(&data,end,&precision) == FALSE) {
+			break;
+		}
+
+		apt_log_bin_spec_make(&spec,width,precision,spec_buf);
+		if(spec.type == APT_LOG_BIN_ARG_STRING) {
+			if(apt_log_bin_string_read(&data,end,&str) == FALSE) {
+				break;
+			}
+			offset += apr_snprintf(buf + offset,max_size - offset + 1,spec_buf,(int)str.length,str.buf);
+			continue;
+		}
+
+		if(apt_log_bin_value_read(&data,end,&value) == FALSE) {
+			break;
+		}
+		if(spec.type == APT_LOG_BIN_ARG_DOUBLE) {
+			memcpy(&dvalue,&value,sizeof(dvalue));
+			offset += apr_snprintf(buf + offset,max_size - offset + 1,spec_buf,dvalue);
+		}
+		else if(spec.conversion == 'c') {
+			offset += apr_snprintf(buf + offset,max_size - offset + 1,spec_buf,(int)value);
+		}
+		else {
+			offset += apr_snprintf(buf + offset,max_size - offset + 1,spec_buf,value);
+		}
+	}
+
+	buf[offset] = '\0';
+	return offset;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_bin_sid_get(const char *format, const char *data, apr_size_t size, apt_str_t *sid)
+{
+	apt_log_bin_spec_t spec;
+	const char *end = data + size;
+	const char *pos = format;
+	apr_int64_t value;
+	apt_str_t str;
+
+	while(apt_log_bin_spec_next(&pos,&spec) == TRUE) {
+		if(spec.type == APT_LOG_BIN_ARG_NONE) {
+			continue;
+		}
+		if(spec.type == APT_LOG_BIN_ARG_INVALID) {
+			break;
+		}
+		if(spec.width_arg == TRUE && apt_log_bin_value_read(&data,end,&value) == FALSE) {
+			break;
+		}
+		if(spec.precision_arg == TRUE && apt_log_bin_value_read(&data,end,&value) == FALSE) {
+			break;
+		}
+
+		if(spec.type == APT_LOG_BIN_ARG_STRING) {
+			if(apt_log_bin_string_read(&data,end,&str) == FALSE) {
+				break;
+			}
+			/* APT_SID_FMT and APT_SIDRES_FMT start with "<%s" */
+			if(spec.begin > format && *(spec.begin - 1) == '<') {
+				*sid = str;
+				return TRUE;
+			}
+		}
+		else if(apt_log_bin_value_read(&data,end,&value) == FALSE) {
+			break;
+		}
+	}
+	return FALSE;
+}
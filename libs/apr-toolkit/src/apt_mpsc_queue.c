@@ -0,0 +1,232 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifdef __linux__
+#define APT_MPSC_QUEUE_EVENTFD
+#endif
+
+#ifdef APT_MPSC_QUEUE_EVENTFD
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#else
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+#include <apr_atomic.h>
+#include "apt_mpsc_queue.h"
+#include "apt_log.h"
+
+/*
+ * The queue is the intrusive MPSC queue by D. Vyukov. Producers exchange the
+ * head and then link the previous head to the pushed message, the consumer
+ * follows the links from the tail. The stub message keeps the queue non-empty,
+ * so that neither side ever deals with a NULL head or tail.
+ *
+ * A producer, which has exchanged the head but hasn't linked the message yet,
+ * makes the queue look empty for the consumer. That's why the consumer raises
+ * the waiting flag and rechecks the queue before blocking, while the producer
+ * checks the flag after linking. Both the flag and the link are updated by
+ * atomic exchange (full memory barrier), thus either the consumer sees the
+ * message or the producer sees the flag.
+ */
+
+struct apt_mpsc_queue_t {
+	/** Most recently pushed message (producers) */
+	apt_task_msg_t * volatile head;
+	/** Oldest message (consumer) */
+	apt_task_msg_t           *tail;
+	/** Stub message */
+	apt_task_msg_t            stub;
+	/** Indicates the consumer is about to block */
+	volatile apr_uint32_t     waiting;
+#ifdef APT_MPSC_QUEUE_EVENTFD
+	/** Event file descriptor to wake up the consumer */
+	int                       event_fd;
+#else
+	/** Guard of the signaled flag */
+	apr_thread_mutex_t       *guard;
+	/** Condition to wake up the consumer */
+	apr_thread_cond_t        *wakeup;
+	/** Indicates the consumer has been signaled */
+	apt_bool_t                signaled;
+#endif
+};
+
+#ifdef APT_MPSC_QUEUE_EVENTFD
+static apr_status_t apt_mpsc_queue_event_fd_close(void *data)
+{
+	apt_mpsc_queue_t *queue = data;
+	if(queue->event_fd != -1) {
+		close(queue->event_fd);
+		queue->event_fd = -1;
+	}
+	return APR_SUCCESS;
+}
+#endif
+
+APT_DECLARE(apt_mpsc_queue_t*) apt_mpsc_queue_create(apr_pool_t *pool)
+{
+	apt_mpsc_queue_t *queue = apr_palloc(pool,sizeof(apt_mpsc_queue_t));
+	queue->stub.msg_pool = NULL;
+	queue->stub.type = TASK_MSG_CORE;
+	queue->stub.sub_type = CORE_TASK_MSG_NONE;
+	queue->stub.next = NULL;
+	queue->head = &queue->stub;
+	queue->tail = &queue->stub;
+	queue->waiting = 0;
+#ifdef APT_MPSC_QUEUE_EVENTFD
+	queue->event_fd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+	if(queue->event_fd == -1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Event FD [%d]",errno);
+		return NULL;
+	}
+	apr_pool_cleanup_register(pool,queue,apt_mpsc_queue_event_fd_close,apr_pool_cleanup_null);
+#else
+	queue->signaled = FALSE;
+	if(apr_thread_mutex_create(&queue->guard,APR_THREAD_MUTEX_UNNESTED,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_thread_cond_create(&queue->wakeup,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+#endif
+	return queue;
+}
+
+/** Link message to the head of the queue */
+static APR_INLINE void apt_mpsc_queue_link(apt_mpsc_queue_t *queue, apt_task_msg_t *msg)
+{
+	apt_task_msg_t *prev;
+	msg->next = NULL;
+	prev = apr_atomic_xchgptr((volatile void**)&queue->head,msg);
+	apr_atomic_xchgptr((volatile void**)&prev->next,msg);
+}
+
+/** Wake up the blocked consumer */
+static void apt_mpsc_queue_wakeup(apt_mpsc_queue_t *queue)
+{
+#ifdef APT_MPSC_QUEUE_EVENTFD
+	uint64_t value = 1;
+	if(write(queue->event_fd,&value,sizeof(value)) != sizeof(value)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Signal Event FD [%d]",errno);
+	}
+#else
+	apr_thread_mutex_lock(queue->guard);
+	queue->signaled = TRUE;
+	apr_thread_cond_signal(queue->wakeup);
+	apr_thread_mutex_unlock(queue->guard);
+#endif
+}
+
+/** Block the consumer till it's woken up or the timeout elapses */
+static void apt_mpsc_queue_wait(apt_mpsc_queue_t *queue, apr_interval_time_t timeout)
+{
+#ifdef APT_MPSC_QUEUE_EVENTFD
+	uint64_t value;
+	struct pollfd pfd;
+	pfd.fd = queue->event_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if(poll(&pfd,1,timeout < 0 ? -1 : (int)((timeout + 999) / 1000)) > 0) {
+		/* reset the counter, the descriptor is non-blocking */
+		if(read(queue->event_fd,&value,sizeof(value)) != sizeof(value)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Failed to Read Event FD [%d]",errno);
+		}
+	}
+#else
+	apr_thread_mutex_lock(queue->guard);
+	if(queue->signaled == FALSE) {
+		if(timeout < 0) {
+			apr_thread_cond_wait(queue->wakeup,queue->guard);
+		}
+		else {
+			apr_thread_cond_timedwait(queue->wakeup,queue->guard,timeout);
+		}
+	}
+	queue->signaled = FALSE;
+	apr_thread_mutex_unlock(queue->guard);
+#endif
+}
+
+APT_DECLARE(apt_bool_t) apt_mpsc_queue_push(apt_mpsc_queue_t *queue, apt_task_msg_t *msg)
+{
+	apt_mpsc_queue_link(queue,msg);
+	/* only the producer, which resets the flag, wakes the consumer up */
+	if(apr_atomic_read32(&queue->waiting) && apr_atomic_cas32(&queue->waiting,0,1) == 1) {
+		apt_mpsc_queue_wakeup(queue);
+	}
+	return TRUE;
+}
+
+APT_DECLARE(apt_task_msg_t*) apt_mpsc_queue_trypop(apt_mpsc_queue_t *queue)
+{
+	apt_task_msg_t *tail = queue->tail;
+	apt_task_msg_t *next = tail->next;
+	if(tail == &queue->stub) {
+		if(!next) {
+			return NULL;
+		}
+		queue->tail = next;
+		tail = next;
+		next = next->next;
+	}
+
+	if(next) {
+		queue->tail = next;
+		return tail;
+	}
+
+	if(tail != queue->head) {
+		/* a producer is in the middle of push */
+		return NULL;
+	}
+
+	/* the tail is the last message, push the stub behind it to pop the message */
+	apt_mpsc_queue_link(queue,&queue->stub);
+	next = tail->next;
+	if(next) {
+		queue->tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+APT_DECLARE(apr_status_t) apt_mpsc_queue_pop(apt_mpsc_queue_t *queue, apr_interval_time_t timeout, apt_task_msg_t **msg)
+{
+	do {
+		*msg = apt_mpsc_queue_trypop(queue);
+		if(*msg) {
+			return APR_SUCCESS;
+		}
+
+		apr_atomic_xchg32(&queue->waiting,1);
+		*msg = apt_mpsc_queue_trypop(queue);
+		if(!*msg) {
+			apt_mpsc_queue_wait(queue,timeout);
+			*msg = apt_mpsc_queue_trypop(queue);
+		}
+		apr_atomic_set32(&queue->waiting,0);
+		if(*msg) {
+			return APR_SUCCESS;
+		}
+	}
+	while(timeout < 0);
+
+	return APR_TIMEUP;
+}
@@ -28,6 +28,7 @@ struct apt_poller_task_t {
 	
 	void               *obj;
 	apt_poll_signal_f   signal_handler;
+	apt_poll_complete_f complete_handler;
 
 	apr_thread_mutex_t *guard;
 	apt_cyclic_queue_t *msg_queue;
@@ -65,6 +66,7 @@ APT_DECLARE(apt_poller_task_t*) apt_poller_task_create(
 	task->obj = obj;
 	task->pollset = NULL;
 	task->signal_handler = signal_handler;
+	task->complete_handler = NULL;
 
 	task->pollset = apt_pollset_create((apr_uint32_t)max_pollset_size,pool);
 	if(!task->pollset) {
@@ -158,6 +160,12 @@ APT_DECLARE(void*) apt_poller_task_object_get(const apt_poller_task_t *task)
 	return task->obj;
 }
 
+/** Set the handler of poll cycle completion */
+APT_DECLARE(void) apt_poller_task_complete_handler_set(apt_poller_task_t *task, apt_poll_complete_f complete_handler)
+{
+	task->complete_handler = complete_handler;
+}
+
 /** Add descriptor to pollset */
 APT_DECLARE(apt_bool_t) apt_poller_task_descriptor_add(const apt_poller_task_t *task, const apr_pollfd_t *descriptor)
 {
@@ -274,6 +282,10 @@ static apt_bool_t apt_poller_task_run(apt_task_t *base)
 				apt_timer_queue_advance(task->timer_queue,(apr_uint32_t)((time_now - time_last)/1000));
 			}
 		}
+
+		if(task->complete_handler && *running == TRUE) {
+			task->complete_handler(task->obj);
+		}
 	}
 
 	return TRUE;
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <apr_thread_mutex.h>
 #include "apt_pool.h"
 #include "apt_log.h"
 
@@ -53,3 +54,155 @@ APT_DECLARE(apr_pool_t*) apt_subpool_create(apr_pool_t *parent)
 	apr_pool_create(&pool,parent);
 	return pool;
 }
+
+
+struct apt_pool_cache_t {
+	/** Free list of pools */
+	apr_pool_t        **free_arr;
+	/** Max number of pools in the free list */
+	apr_size_t          max_count;
+	/** Size of memory to preallocate and retain per pool */
+	apr_size_t          pool_size;
+	/** Pool the cache is allocated from */
+	apr_pool_t         *pool;
+	/** Guard of the free list and statistics */
+	apr_thread_mutex_t *guard;
+	/** Statistics */
+	apt_pool_cache_stat_t stat;
+};
+
+/** Create pool of its own allocator, to be cleared and reused */
+static apr_pool_t* apt_pool_cache_entry_create(apt_pool_cache_t *cache)
+{
+	apr_pool_t *pool = NULL;
+	apr_pool_t *owner = apt_pool_create();
+	if(!owner) {
+		return NULL;
+	}
+
+#ifdef OWN_ALLOCATOR_PER_POOL
+	/* bound the memory the allocator retains once the pool is cleared,
+	otherwise each cached pool keeps the peak allocation of its sessions */
+	apr_allocator_max_free_set(apr_pool_allocator_get(owner),
+		cache->pool_size ? cache->pool_size : APT_POOL_CACHE_DEFAULT_MAX_FREE);
+#endif
+	/* the owner holds the allocator and the mutex, which survive clearing of the subpool */
+	if(apr_pool_create_ex(&pool,owner,apt_abort_fn,NULL) != APR_SUCCESS) {
+		apr_pool_destroy(owner);
+		return NULL;
+	}
+	if(cache->pool_size) {
+		/* fault the memory in once, the allocator keeps it for reuse */
+		apr_palloc(pool,cache->pool_size);
+		apr_pool_clear(pool);
+	}
+	return pool;
+}
+
+static void apt_pool_cache_entry_destroy(apr_pool_t *pool)
+{
+	apr_pool_destroy(apr_pool_parent_get(pool));
+}
+
+static apr_status_t apt_pool_cache_cleanup(void *data)
+{
+	apt_pool_cache_t *cache = data;
+	while(cache->stat.free_count) {
+		cache->stat.free_count--;
+		apt_pool_cache_entry_destroy(cache->free_arr[cache->stat.free_count]);
+	}
+	return APR_SUCCESS;
+}
+
+APT_DECLARE(apt_pool_cache_t*) apt_pool_cache_create(apr_size_t max_count, apr_size_t init_count, apr_size_t pool_size, apr_pool_t *pool)
+{
+	apr_pool_t *entry;
+	apt_pool_cache_t *cache = apr_palloc(pool,sizeof(apt_pool_cache_t));
+	cache->max_count = max_count;
+	cache->pool_size = pool_size;
+	cache->pool = pool;
+	cache->free_arr = apr_palloc(pool,sizeof(apr_pool_t*) * (max_count ? max_count : 1));
+	memset(&cache->stat,0,sizeof(apt_pool_cache_stat_t));
+	if(apr_thread_mutex_create(&cache->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	/* registered after the mutex, so that the cleanup runs before the mutex is destroyed */
+	apr_pool_cleanup_register(pool,cache,apt_pool_cache_cleanup,apr_pool_cleanup_null);
+
+	if(init_count > max_count) {
+		init_count = max_count;
+	}
+	while(cache->stat.free_count < init_count) {
+		entry = apt_pool_cache_entry_create(cache);
+		if(!entry) {
+			break;
+		}
+		cache->free_arr[cache->stat.free_count++] = entry;
+	}
+	return cache;
+}
+
+APT_DECLARE(void) apt_pool_cache_destroy(apt_pool_cache_t *cache)
+{
+	/* destroy the cached pools now rather than along with the pool of the cache */
+	apr_pool_cleanup_run(cache->pool,cache,apt_pool_cache_cleanup);
+	apr_thread_mutex_destroy(cache->guard);
+}
+
+APT_DECLARE(apr_pool_t*) apt_pool_cache_acquire(apt_pool_cache_t *cache)
+{
+	apr_pool_t *pool = NULL;
+	apr_thread_mutex_lock(cache->guard);
+	if(cache->stat.free_count) {
+		pool = cache->free_arr[--cache->stat.free_count];
+		cache->stat.hit_count++;
+	}
+	else {
+		cache->stat.miss_count++;
+	}
+	cache->stat.busy_count++;
+	if(cache->stat.busy_count > cache->stat.busy_high_water) {
+		cache->stat.busy_high_water = cache->stat.busy_count;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+
+	if(!pool) {
+		pool = apt_pool_cache_entry_create(cache);
+		if(!pool) {
+			apr_thread_mutex_lock(cache->guard);
+			cache->stat.busy_count--;
+			apr_thread_mutex_unlock(cache->guard);
+		}
+	}
+	return pool;
+}
+
+APT_DECLARE(void) apt_pool_cache_release(apt_pool_cache_t *cache, apr_pool_t *pool)
+{
+	apt_bool_t cached = FALSE;
+
+	/* run the cleanups and return the memory to the allocator outside the lock */
+	apr_pool_clear(pool);
+
+	apr_thread_mutex_lock(cache->guard);
+	cache->stat.busy_count--;
+	if(cache->stat.free_count < cache->max_count) {
+		cache->free_arr[cache->stat.free_count++] = pool;
+		cached = TRUE;
+	}
+	else {
+		cache->stat.discard_count++;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+
+	if(cached == FALSE) {
+		apt_pool_cache_entry_destroy(pool);
+	}
+}
+
+APT_DECLARE(void) apt_pool_cache_stat_get(apt_pool_cache_t *cache, apt_pool_cache_stat_t *stat)
+{
+	apr_thread_mutex_lock(cache->guard);
+	*stat = cache->stat;
+	apr_thread_mutex_unlock(cache->guard);
+}
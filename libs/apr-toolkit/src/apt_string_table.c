@@ -64,3 +64,21 @@ APT_DECLARE(apr_size_t) apt_string_table_id_find(const apt_str_table_item_t tabl
 	/* no match found, return invalid id */
 	return size;
 }
+
+/* Find the id associated with a given string by means of the perfect hash of the table */
+APT_DECLARE(apr_size_t) apt_string_table_hash_id_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_table_hash_t *hash, const apt_str_t *value)
+{
+	apr_size_t id;
+	if(!hash) {
+		return apt_string_table_id_find(table,size,value);
+	}
+
+	/* the slot may only hold the string searched for, a single compare confirms the match */
+	id = hash->slots[apt_string_table_hash(value->buf,value->length,hash->seed) & hash->mask];
+	if(id && --id < size && apt_string_compare(&table[id].value,value) == TRUE) {
+		return id;
+	}
+
+	/* no match found, return invalid id */
+	return size;
+}
@@ -15,6 +15,9 @@
  */
 
 #include <stdlib.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_ring.h>
 #include "apt_task_msg.h"
 
 /** Abstract pool of task messages to allocate task messages from */
@@ -73,6 +76,250 @@ APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_dynamic(apr_size_t ms
 }
 
 
+/** Cached allocation of messages (per-thread free lists backed by a shared free list) */
+typedef struct apt_msg_pool_cached_t apt_msg_pool_cached_t;
+typedef struct apt_msg_cache_t apt_msg_cache_t;
+
+/** Number of messages moved between the thread cache and the shared free list at once */
+#define MSG_CACHE_BATCH_SIZE 32
+/** Max number of messages kept in the thread cache */
+#define MSG_CACHE_MAX_SIZE   (MSG_CACHE_BATCH_SIZE * 2)
+
+/** Thread cache of messages */
+struct apt_msg_cache_t {
+	/** Ring entry */
+	APR_RING_ENTRY(apt_msg_cache_t) link;
+	/** Pool the cache belongs to */
+	apt_msg_pool_cached_t          *owner;
+	/** Free list of messages */
+	apt_task_msg_t                 *head;
+	/** Number of messages in the free list */
+	apr_size_t                      count;
+};
+
+struct apt_msg_pool_cached_t {
+	/** Size of the message */
+	apr_size_t          size;
+	/** Key of the thread cache */
+	apr_threadkey_t    *key;
+	/** Guard of the shared free list and the list of thread caches */
+	apr_thread_mutex_t *guard;
+	/** Shared free list of messages */
+	apt_task_msg_t     *head;
+	/** Number of messages in the shared free list */
+	apr_size_t          count;
+	/** List of thread caches */
+	APR_RING_HEAD(apt_msg_cache_list_t, apt_msg_cache_t) cache_list;
+};
+
+static void msg_list_free(apt_task_msg_t *task_msg)
+{
+	apt_task_msg_t *next;
+	while(task_msg) {
+		next = task_msg->next;
+		free(task_msg);
+		task_msg = next;
+	}
+}
+
+/** Move a batch of messages from the thread cache to the shared free list (guarded) */
+static void cached_pool_batch_put(apt_msg_pool_cached_t *cached_pool, apt_msg_cache_t *cache, apr_size_t count)
+{
+	apt_task_msg_t *first = cache->head;
+	apt_task_msg_t *last = first;
+	apr_size_t i;
+	if(!first) {
+		return;
+	}
+
+	for(i=1; i<count && last->next; i++) {
+		last = last->next;
+	}
+	cache->head = last->next;
+	cache->count -= i;
+
+	last->next = cached_pool->head;
+	cached_pool->head = first;
+	cached_pool->count += i;
+}
+
+/** Move a batch of messages from the shared free list to the thread cache (guarded) */
+static void cached_pool_batch_get(apt_msg_pool_cached_t *cached_pool, apt_msg_cache_t *cache, apr_size_t count)
+{
+	apt_task_msg_t *first = cached_pool->head;
+	apt_task_msg_t *last = first;
+	apr_size_t i;
+	if(!first) {
+		return;
+	}
+
+	for(i=1; i<count && last->next; i++) {
+		last = last->next;
+	}
+	cached_pool->head = last->next;
+	cached_pool->count -= i;
+
+	last->next = cache->head;
+	cache->head = first;
+	cache->count += i;
+}
+
+/** Invoked on thread exit to return the cached messages to the shared free list */
+static void cached_pool_cache_destroy(void *data)
+{
+	apt_msg_cache_t *cache = data;
+	apt_msg_pool_cached_t *cached_pool;
+	if(!cache) {
+		return;
+	}
+
+	cached_pool = cache->owner;
+	apr_thread_mutex_lock(cached_pool->guard);
+	cached_pool_batch_put(cached_pool,cache,cache->count);
+	APR_RING_REMOVE(cache,link);
+	apr_thread_mutex_unlock(cached_pool->guard);
+	free(cache);
+}
+
+static apt_msg_cache_t* cached_pool_cache_get(apt_msg_pool_cached_t *cached_pool)
+{
+	void *data = NULL;
+	apt_msg_cache_t *cache;
+	if(apr_threadkey_private_get(&data,cached_pool->key) == APR_SUCCESS && data) {
+		return data;
+	}
+
+	cache = malloc(sizeof(apt_msg_cache_t));
+	if(!cache) {
+		return NULL;
+	}
+	cache->owner = cached_pool;
+	cache->head = NULL;
+	cache->count = 0;
+	APR_RING_ELEM_INIT(cache,link);
+
+	apr_thread_mutex_lock(cached_pool->guard);
+	APR_RING_INSERT_TAIL(&cached_pool->cache_list,cache,apt_msg_cache_t,link);
+	apr_thread_mutex_unlock(cached_pool->guard);
+
+	if(apr_threadkey_private_set(cache,cached_pool->key) != APR_SUCCESS) {
+		cached_pool_cache_destroy(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+static apt_task_msg_t* cached_pool_acquire_msg(apt_task_msg_pool_t *task_msg_pool)
+{
+	apt_msg_pool_cached_t *cached_pool = task_msg_pool->obj;
+	apt_msg_cache_t *cache = cached_pool_cache_get(cached_pool);
+	apt_task_msg_t *task_msg = NULL;
+	if(cache) {
+		/* peek at the shared free list without locking, it's rechecked under the lock */
+		if(!cache->head && cached_pool->head) {
+			apr_thread_mutex_lock(cached_pool->guard);
+			cached_pool_batch_get(cached_pool,cache,MSG_CACHE_BATCH_SIZE);
+			apr_thread_mutex_unlock(cached_pool->guard);
+		}
+		task_msg = cache->head;
+		if(task_msg) {
+			cache->head = task_msg->next;
+			cache->count--;
+		}
+	}
+
+	if(!task_msg) {
+		task_msg = malloc(cached_pool->size);
+		if(!task_msg) {
+			return NULL;
+		}
+	}
+	task_msg->msg_pool = task_msg_pool;
+	task_msg->type = TASK_MSG_USER;
+	task_msg->sub_type = 0;
+	task_msg->next = NULL;
+	return task_msg;
+}
+
+static void cached_pool_release_msg(apt_task_msg_t *task_msg)
+{
+	apt_msg_pool_cached_t *cached_pool;
+	apt_msg_cache_t *cache;
+	if(!task_msg) {
+		return;
+	}
+
+	cached_pool = task_msg->msg_pool->obj;
+	cache = cached_pool_cache_get(cached_pool);
+	if(!cache) {
+		free(task_msg);
+		return;
+	}
+
+	task_msg->next = cache->head;
+	cache->head = task_msg;
+	cache->count++;
+	if(cache->count > MSG_CACHE_MAX_SIZE) {
+		/* typically messages are acquired by one thread and released by another one,
+		hand the surplus over to the producers */
+		apr_thread_mutex_lock(cached_pool->guard);
+		cached_pool_batch_put(cached_pool,cache,MSG_CACHE_BATCH_SIZE);
+		apr_thread_mutex_unlock(cached_pool->guard);
+	}
+}
+
+static apr_status_t cached_pool_cleanup(void *data)
+{
+	apt_msg_pool_cached_t *cached_pool = data;
+	apt_msg_cache_t *cache;
+
+	/* once the key is deleted, no thread exit handler is invoked anymore */
+	apr_threadkey_private_delete(cached_pool->key);
+
+	while(!APR_RING_EMPTY(&cached_pool->cache_list,apt_msg_cache_t,link)) {
+		cache = APR_RING_FIRST(&cached_pool->cache_list);
+		APR_RING_REMOVE(cache,link);
+		msg_list_free(cache->head);
+		free(cache);
+	}
+	msg_list_free(cached_pool->head);
+	cached_pool->head = NULL;
+	cached_pool->count = 0;
+	return APR_SUCCESS;
+}
+
+static void cached_pool_destroy(apt_task_msg_pool_t *task_msg_pool)
+{
+	apr_pool_cleanup_run(task_msg_pool->pool,task_msg_pool->obj,cached_pool_cleanup);
+}
+
+APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_cached(apr_size_t msg_size, apr_pool_t *pool)
+{
+	apt_task_msg_pool_t *task_msg_pool;
+	apt_msg_pool_cached_t *cached_pool = apr_palloc(pool,sizeof(apt_msg_pool_cached_t));
+	cached_pool->size = msg_size + sizeof(apt_task_msg_t) - 1;
+	cached_pool->head = NULL;
+	cached_pool->count = 0;
+	APR_RING_INIT(&cached_pool->cache_list,apt_msg_cache_t,link);
+	if(apr_thread_mutex_create(&cached_pool->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_threadkey_private_create(&cached_pool->key,cached_pool_cache_destroy,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	/* registered after the mutex, so that the cleanup runs before the mutex is destroyed */
+	apr_pool_cleanup_register(pool,cached_pool,cached_pool_cleanup,apr_pool_cleanup_null);
+
+	task_msg_pool = apr_palloc(pool,sizeof(apt_task_msg_pool_t));
+	task_msg_pool->pool = pool;
+	task_msg_pool->obj = cached_pool;
+	task_msg_pool->acquire_msg = cached_pool_acquire_msg;
+	task_msg_pool->release_msg = cached_pool_release_msg;
+	task_msg_pool->destroy = cached_pool_destroy;
+	return task_msg_pool;
+}
+
+
 /** Static allocation of messages from message pool (not implemented yet) */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_static(apr_size_t msg_size, apr_size_t pool_size, apr_pool_t *pool)
 {
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+#include <apr_atomic.h>
 #include "apt_text_message.h"
 #include "apt_log.h"
 
@@ -24,6 +26,20 @@ typedef enum {
 	APT_MESSAGE_STAGE_BODY
 } apt_message_stage_e;
 
+/** Min space left in the rx buffer to keep receiving to it in zero-copy mode (fraction of the buffer size) */
+#define APT_MESSAGE_BUFFER_MIN_SPACE(size) ((size) / 4)
+
+/** Reference counted rx buffer parsed messages refer to in zero-copy mode */
+typedef struct apt_message_buffer_t apt_message_buffer_t;
+
+struct apt_message_buffer_t {
+	/** Reference count */
+	volatile apr_uint32_t ref_count;
+	/** Size of the buffer */
+	apr_size_t            size;
+	/** Data of the buffer (one more byte to null-terminate received data) */
+	char                 *data;
+};
 
 /** Text message parser */
 struct apt_message_parser_t {
@@ -35,6 +51,10 @@ struct apt_message_parser_t {
 	apt_message_stage_e                stage;
 	apt_bool_t                         skip_lf;
 	apt_bool_t                         verbose;
+	/** Rx buffer (zero-copy mode only) */
+	apt_message_buffer_t              *buffer;
+	/** Whether parsed messages refer to the rx buffer */
+	apt_bool_t                         buffer_referred;
 };
 
 /** Text message generator */
@@ -48,8 +68,8 @@ struct apt_message_generator_t {
 	apt_bool_t                            verbose;
 };
 
-/** Parse individual header field (name-value pair) */
-APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *stream, apr_pool_t *pool)
+/** Read individual header field, referring to the stream in zero-copy mode */
+static apt_header_field_t* apt_header_field_read(apt_text_stream_t *stream, apt_bool_t zero_copy, apr_pool_t *pool)
 {
 	apr_size_t folding_length = 0;
 	apr_array_header_t *folded_lines = NULL;
@@ -86,6 +106,23 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *strea
 	}
 
 	header_field = apt_header_field_alloc(pool);
+	if(zero_copy == TRUE && pair.name.length && !folding_length &&
+		(!pair.value.buf || pair.value.buf + pair.value.length + 1 < stream->end)) {
+		/* refer to the stream, null-terminating the name and value in place of the separator and
+		the end of line, unless the end of line is the last char checked for <CRLF> segmentation */
+		header_field->name = pair.name;
+		header_field->name.buf[header_field->name.length] = '\0';
+		if(pair.value.buf) {
+			header_field->value = pair.value;
+			header_field->value.buf[header_field->value.length] = '\0';
+		}
+		else {
+			header_field->value.buf = header_field->name.buf + header_field->name.length;
+			header_field->value.length = 0;
+		}
+		return header_field;
+	}
+
 	/* copy parsed name of the header field */
 	header_field->name.length = pair.name.length;
 	header_field->name.buf = apr_palloc(pool, pair.name.length + 1);
@@ -117,20 +154,26 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *strea
 	return header_field;
 }
 
+/** Parse individual header field (name-value pair) */
+APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *stream, apr_pool_t *pool)
+{
+	return apt_header_field_read(stream,FALSE,pool);
+}
+
 /** Generate individual header field (name-value pair) */
 APT_DECLARE(apt_bool_t) apt_header_field_generate(const apt_header_field_t *header_field, apt_text_stream_t *stream)
 {
 	return apt_text_name_value_insert(stream,&header_field->name,&header_field->value);
 }
 
-/** Parse header section */
-APT_DECLARE(apt_bool_t) apt_header_section_parse(apt_header_section_t *header, apt_text_stream_t *stream, apr_pool_t *pool)
+/** Read header section, referring to the stream in zero-copy mode */
+static apt_bool_t apt_header_section_read(apt_header_section_t *header, apt_text_stream_t *stream, apt_bool_t zero_copy, apr_pool_t *pool)
 {
 	apt_header_field_t *header_field;
 	apt_bool_t result = FALSE;
 
 	do {
-		header_field = apt_header_field_parse(stream,pool);
+		header_field = apt_header_field_read(stream,zero_copy,pool);
 		if(header_field) {
 			if(apt_string_is_empty(&header_field->name) == FALSE) {
 				/* normal header */
@@ -151,6 +194,12 @@ APT_DECLARE(apt_bool_t) apt_header_section_parse(apt_header_section_t *header, a
 	return result;
 }
 
+/** Parse header section */
+APT_DECLARE(apt_bool_t) apt_header_section_parse(apt_header_section_t *header, apt_text_stream_t *stream, apr_pool_t *pool)
+{
+	return apt_header_section_read(header,stream,FALSE,pool);
+}
+
 /** Generate header section */
 APT_DECLARE(apt_bool_t) apt_header_section_generate(const apt_header_section_t *header, apt_text_stream_t *stream)
 {
@@ -158,7 +207,10 @@ APT_DECLARE(apt_bool_t) apt_header_section_generate(const apt_header_section_t *
 	for(header_field = APR_RING_FIRST(&header->ring);
 			header_field != APR_RING_SENTINEL(&header->ring, apt_header_field_t, link);
 				header_field = APR_RING_NEXT(header_field, link)) {
-		apt_header_field_generate(header_field,stream);
+		/* fail rather than silently omit the fields which don't fit the stream */
+		if(apt_header_field_generate(header_field,stream) == FALSE) {
+			return FALSE;
+		}
 	}
 
 	return apt_text_eol_insert(stream);
@@ -238,9 +290,119 @@ APT_DECLARE(apt_message_parser_t*) apt_message_parser_create(void *obj, const ap
 	parser->stage = APT_MESSAGE_STAGE_START_LINE;
 	parser->skip_lf = FALSE;
 	parser->verbose = FALSE;
+	parser->buffer = NULL;
+	parser->buffer_referred = FALSE;
 	return parser;
 }
 
+static apt_message_buffer_t* apt_message_buffer_create(apr_size_t size)
+{
+	apt_message_buffer_t *buffer = malloc(sizeof(apt_message_buffer_t) + size + 1);
+	if(!buffer) {
+		return NULL;
+	}
+	buffer->ref_count = 1;
+	buffer->size = size;
+	buffer->data = (char*)(buffer + 1);
+	return buffer;
+}
+
+static apr_status_t apt_message_buffer_release(void *data)
+{
+	apt_message_buffer_t *buffer = data;
+	if(apr_atomic_dec32(&buffer->ref_count) == 0) {
+		free(buffer);
+	}
+	return APR_SUCCESS;
+}
+
+static apr_status_t apt_message_parser_cleanup(void *data)
+{
+	apt_message_parser_t *parser = data;
+	if(parser->buffer) {
+		apt_message_buffer_release(parser->buffer);
+		parser->buffer = NULL;
+	}
+	return APR_SUCCESS;
+}
+
+/** Make the messages (the pool of the parser) refer to the rx buffer in zero-copy mode */
+static void apt_message_buffer_refer(apt_message_parser_t *parser)
+{
+	if(parser->buffer_referred == FALSE) {
+		apr_atomic_inc32(&parser->buffer->ref_count);
+		apr_pool_cleanup_register(parser->pool,parser->buffer,apt_message_buffer_release,apr_pool_cleanup_null);
+		parser->buffer_referred = TRUE;
+	}
+}
+
+/** Enable zero-copy parsing */
+APT_DECLARE(apt_bool_t) apt_message_parser_zero_copy_enable(apt_message_parser_t *parser, apt_text_stream_t *stream, apr_size_t size)
+{
+	if(parser->buffer) {
+		return FALSE;
+	}
+
+	parser->buffer = apt_message_buffer_create(size);
+	if(!parser->buffer) {
+		return FALSE;
+	}
+	parser->buffer_referred = FALSE;
+	apr_pool_cleanup_register(parser->pool,parser,apt_message_parser_cleanup,apr_pool_cleanup_null);
+
+	apt_text_stream_init(stream,parser->buffer->data,0);
+	stream->end = parser->buffer->data + size;
+	return TRUE;
+}
+
+/** Scroll remaining (not parsed yet) data of the stream */
+APT_DECLARE(apt_bool_t) apt_message_parser_stream_scroll(apt_message_parser_t *parser, apt_text_stream_t *stream)
+{
+	apt_message_buffer_t *buffer = parser->buffer;
+	apr_size_t remaining_length;
+	if(!buffer) {
+		return apt_text_stream_scroll(stream);
+	}
+
+	remaining_length = stream->text.buf + stream->text.length - stream->pos;
+	if(parser->buffer_referred == FALSE) {
+		/* nothing refers to the buffer, move the remaining data to the beginning */
+		if(remaining_length && stream->pos != buffer->data) {
+			memmove(buffer->data,stream->pos,remaining_length);
+		}
+		stream->text.buf = buffer->data;
+	}
+	else if((apr_size_t)(buffer->data + buffer->size - stream->pos) - remaining_length > APT_MESSAGE_BUFFER_MIN_SPACE(buffer->size)) {
+		/* keep the data parsed messages refer to, receive next to the remaining data */
+		stream->text.buf = stream->pos;
+		if(!remaining_length) {
+			/* a referred body may end at the end of the received data, skip its
+			terminating null character, so that the next data doesn't overwrite it */
+			stream->text.buf++;
+		}
+	}
+	else {
+		/* buffer is exhausted, move the remaining data to a new buffer */
+		apt_message_buffer_t *new_buffer = apt_message_buffer_create(buffer->size);
+		if(!new_buffer) {
+			return FALSE;
+		}
+		if(remaining_length) {
+			memcpy(new_buffer->data,stream->pos,remaining_length);
+		}
+		apt_message_buffer_release(buffer);
+		parser->buffer = buffer = new_buffer;
+		parser->buffer_referred = FALSE;
+		stream->text.buf = buffer->data;
+	}
+
+	stream->text.length = remaining_length;
+	stream->pos = stream->text.buf + remaining_length;
+	stream->end = buffer->data + buffer->size;
+	stream->is_eos = FALSE;
+	return TRUE;
+}
+
 static APR_INLINE void apt_crlf_segmentation_test(apt_message_parser_t *parser, apt_text_stream_t *stream)
 {
 	/* in the worst case message segmentation may occur between <CR> and <LF> */
@@ -280,8 +442,13 @@ APT_DECLARE(apt_message_status_e) apt_message_parser_run(apt_message_parser_t *p
 		}
 
 		if(parser->stage == APT_MESSAGE_STAGE_HEADER) {
-			/* read header section */
-			apt_bool_t res = apt_header_section_parse(parser->context.header,stream,parser->pool);
+			/* read header section, referring to the rx buffer in zero-copy mode unless logged */
+			apt_bool_t zero_copy = parser->buffer && parser->verbose == FALSE;
+			apt_bool_t res;
+			if(zero_copy == TRUE) {
+				apt_message_buffer_refer(parser);
+			}
+			res = apt_header_section_read(parser->context.header,stream,zero_copy,parser->pool);
 			if(parser->verbose == TRUE) {
 				apr_size_t length = stream->pos - pos;
 				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Parsed Message Header [%"APR_SIZE_T_FMT" bytes]\n%.*s",
@@ -304,6 +471,20 @@ APT_DECLARE(apt_message_status_e) apt_message_parser_run(apt_message_parser_t *p
 			if(parser->context.body && parser->context.body->length) {
 				apt_str_t *body = parser->context.body;
 				parser->content_length = body->length;
+				if(zero_copy == TRUE && (apr_size_t)(stream->end - stream->pos) == parser->content_length) {
+					/* the body completes the received data, which is null-terminated, refer to it */
+					body->buf = stream->pos;
+					stream->pos += parser->content_length;
+					if(parser->vtable->on_body_complete) {
+						parser->vtable->on_body_complete(parser,&parser->context);
+					}
+					status = APT_MESSAGE_STATUS_COMPLETE;
+					if(message) {
+						*message = parser->context.message;
+					}
+					parser->stage = APT_MESSAGE_STAGE_START_LINE;
+					break;
+				}
 				body->buf = apr_palloc(parser->pool,parser->content_length+1);
 				body->buf[parser->content_length] = '\0';
 				body->length = 0;
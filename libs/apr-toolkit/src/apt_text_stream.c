@@ -24,46 +24,92 @@
 #define TOKEN_TRUE_LENGTH  (sizeof(TOKEN_TRUE)-1)
 #define TOKEN_FALSE_LENGTH (sizeof(TOKEN_FALSE)-1)
 
+#if defined(__AVX2__)
+#define ENABLE_AVX2_SCANNER
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENABLE_SSE2_SCANNER
+#include <emmintrin.h>
+#endif
+
+#if defined(ENABLE_AVX2_SCANNER) || defined(ENABLE_SSE2_SCANNER)
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+#endif
+
+/** Get the index of the lowest bit set in the (non-zero) mask */
+static APR_INLINE apr_size_t apt_mask_first_get(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index,mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
 
-/** Navigate through the lines of the text stream (message) */
-APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t *line)
+/** Find the end of line (<CR> or <LF>), return the end of stream if not found */
+static APR_INLINE char* apt_text_eol_find(char *pos, const char *end)
 {
-	char *pos = stream->pos;
-	apt_bool_t status = FALSE;
-	line->length = 0;
-	line->buf = pos;
-	/* while not end of stream */
-	while(pos < stream->end) {
-		if(*pos == APT_TOKEN_CR) {
-			/* end of line detected */
-			line->length = pos - line->buf;
-			pos++;
-			if(pos < stream->end && *pos == APT_TOKEN_LF) {
-				pos++;
-			}
-			status = TRUE;
-			break;
+#if defined(ENABLE_AVX2_SCANNER)
+	const __m256i cr = _mm256_set1_epi8(APT_TOKEN_CR);
+	const __m256i lf = _mm256_set1_epi8(APT_TOKEN_LF);
+	for(; pos + 32 <= end; pos += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)pos);
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+								_mm256_or_si256(_mm256_cmpeq_epi8(x,cr),_mm256_cmpeq_epi8(x,lf)));
+		if(mask) {
+			return pos + apt_mask_first_get(mask);
 		}
-		else if(*pos == APT_TOKEN_LF) {
-			/* end of line detected */
-			line->length = pos - line->buf;
-			pos++;
-			status = TRUE;
+	}
+#elif defined(ENABLE_SSE2_SCANNER)
+	const __m128i cr = _mm_set1_epi8(APT_TOKEN_CR);
+	const __m128i lf = _mm_set1_epi8(APT_TOKEN_LF);
+	for(; pos + 16 <= end; pos += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)pos);
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(
+								_mm_or_si128(_mm_cmpeq_epi8(x,cr),_mm_cmpeq_epi8(x,lf)));
+		if(mask) {
+			return pos + apt_mask_first_get(mask);
+		}
+	}
+#endif
+	for(; pos < end; pos++) {
+		if(*pos == APT_TOKEN_CR || *pos == APT_TOKEN_LF) {
 			break;
 		}
-		pos++;
 	}
+	return pos;
+}
 
-	if(status == TRUE) {
-		/* advance stream pos */
-		stream->pos = pos;
+/** Skip the end of line (<CR>, <LF> or <CRLF>) */
+static APR_INLINE char* apt_text_eol_skip(char *eol, const char *end)
+{
+	if(*eol++ == APT_TOKEN_CR && eol < end && *eol == APT_TOKEN_LF) {
+		eol++;
 	}
-	else {
+	return eol;
+}
+
+
+/** Navigate through the lines of the text stream (message) */
+APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t *line)
+{
+	char *eol = apt_text_eol_find(stream->pos,stream->end);
+	line->buf = stream->pos;
+	line->length = eol - stream->pos;
+	if(eol == stream->end) {
 		/* end of stream is reached, do not advance stream pos, but set is_eos flag */
 		stream->is_eos = TRUE;
-		line->length = pos - line->buf;
+		return FALSE;
 	}
-	return status;
+
+	/* advance stream pos */
+	stream->pos = apt_text_eol_skip(eol,stream->end);
+	return TRUE;
 }
 
 /** To be used to navigate through the header fields (name:value pairs) of the text stream (message) 
@@ -81,68 +127,47 @@ APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t
 APT_DECLARE(apt_bool_t) apt_text_header_read(apt_text_stream_t *stream, apt_pair_t *pair)
 {
 	char *pos = stream->pos;
-	apt_bool_t status = FALSE;
+	char *separator;
+	char *eol = apt_text_eol_find(pos,stream->end);
 	apt_string_reset(&pair->name);
 	apt_string_reset(&pair->value);
-	/* while not end of stream */
-	while(pos < stream->end) {
-		if(*pos == APT_TOKEN_CR) {
-			/* end of line detected */
-			if(pair->value.buf) {
-				/* set length of the value */
-				pair->value.length = pos - pair->value.buf;
-			}
-			pos++;
-			if(pos < stream->end && *pos == APT_TOKEN_LF) {
-				pos++;
-			}
-			status = TRUE;
-			break;
-		}
-		else if(*pos == APT_TOKEN_LF) {
-			/* end of line detected */
-			if(pair->value.buf) {
-				/* set length of the value */
-				pair->value.length = pos - pair->value.buf;
-			}
-			pos++;
-			status = TRUE;
-			break;
-		}
-		else if(!pair->name.length) {
-			/* skip preceding white spaces (SHOULD NOT be any WSP, though) and read name */
-			if(!pair->name.buf && apt_text_is_wsp(*pos) == FALSE) {
-				pair->name.buf = pos;
-			}
-			if(*pos == ':') {
-				/* set length of the name */
-				pair->name.length = pos - pair->name.buf;
-			}
+	if(eol == stream->end) {
+		/* end of stream is reached, do not advance stream pos, but set is_eos flag */
+		stream->is_eos = TRUE;
+		return FALSE;
+	}
+
+	/* skip preceding white spaces (SHOULD NOT be any WSP, though) and read name */
+	while(pos < eol && apt_text_is_wsp(*pos) == TRUE) pos++;
+	if(pos < eol) {
+		pair->name.buf = pos;
+		separator = memchr(pos,':',eol - pos);
+		if(separator == pos) {
+			/* leading ':' doesn't terminate the name */
+			separator = memchr(pos + 1,':',eol - pos - 1);
 		}
-		else if(!pair->value.length) {
+		if(separator) {
+			/* set length of the name */
+			pair->name.length = separator - pos;
+
 			/* skip preceding white spaces and read value */
-			if(!pair->value.buf && apt_text_is_wsp(*pos) == FALSE) {
+			pos = separator + 1;
+			while(pos < eol && apt_text_is_wsp(*pos) == TRUE) pos++;
+			if(pos < eol) {
 				pair->value.buf = pos;
+				pair->value.length = eol - pos;
 			}
 		}
-		pos++;
 	}
 
-	if(status == TRUE) {
-		/* advance stream pos regardless it's a valid header or not */
-		stream->pos = pos;
-		
-		/* if length == 0 && buf => header is malformed */
-		if(!pair->name.length && pair->name.buf) {
-			status = FALSE;
-		}
-	}
-	else {
-		/* end of stream is reached, do not advance stream pos, but set is_eos flag */
-		stream->is_eos = TRUE;
-	}
+	/* advance stream pos regardless it's a valid header or not */
+	stream->pos = apt_text_eol_skip(eol,stream->end);
 
-	return status;
+	/* if length == 0 && buf => header is malformed */
+	if(!pair->name.length && pair->name.buf) {
+		return FALSE;
+	}
+	return TRUE;
 }
 
 
@@ -155,8 +180,10 @@ APT_DECLARE(apt_bool_t) apt_text_field_read(apt_text_stream_t *stream, char sepa
 	}
 
 	field->buf = pos;
-	field->length = 0;
-	while(pos < stream->end && *pos != separator) pos++;
+	pos = memchr(pos,separator,stream->end - pos);
+	if(!pos) {
+		pos = (char*)stream->end;
+	}
 
 	field->length = pos - field->buf;
 	if(pos < stream->end) {
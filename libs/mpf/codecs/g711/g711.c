@@ -70,4 +70,89 @@ apr_byte_t ulaw_to_alaw(apr_byte_t ulaw)
     return ulaw_to_alaw_table[ulaw];
 }
 /*- End of function --------------------------------------------------------*/
+/*
+ * The u-law encoder takes all the 16 bits of a sample into account (the bias
+ * carries into the quantization bits), so its table is indexed by the whole
+ * sample. The A-law encoder ignores the 4 least significant bits (for negative
+ * samples too, since ~x >> 4 == ~(x >> 4)), so its table is indexed by the 12
+ * most significant bits.
+ */
+static apr_byte_t ulaw_encode_table[65536];
+static apr_byte_t alaw_encode_table[4096];
+static apr_int16_t ulaw_decode_table[256];
+static apr_int16_t alaw_decode_table[256];
+static int g711_tables_initialised = 0;
+
+void g711_tables_init(void)
+{
+    int i;
+
+    if (g711_tables_initialised)
+        return;
+    for (i = 0;  i < 65536;  i++)
+        ulaw_encode_table[i] = linear_to_ulaw((apr_int16_t) i);
+    for (i = 0;  i < 4096;  i++)
+        alaw_encode_table[i] = linear_to_alaw((apr_int16_t) (i << 4));
+    for (i = 0;  i < 256;  i++)
+    {
+        ulaw_decode_table[i] = ulaw_to_linear((apr_byte_t) i);
+        alaw_decode_table[i] = alaw_to_linear((apr_byte_t) i);
+    }
+    g711_tables_initialised = 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+void ulaw_encode_block(apr_byte_t *ulaw, const apr_int16_t *linear, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        ulaw[i] = ulaw_encode_table[(apr_uint16_t) linear[i]];
+}
+/*- End of function --------------------------------------------------------*/
+
+void ulaw_decode_block(apr_int16_t *linear, const apr_byte_t *ulaw, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        linear[i] = ulaw_decode_table[ulaw[i]];
+}
+/*- End of function --------------------------------------------------------*/
+
+void alaw_encode_block(apr_byte_t *alaw, const apr_int16_t *linear, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        alaw[i] = alaw_encode_table[((apr_uint16_t) linear[i]) >> 4];
+}
+/*- End of function --------------------------------------------------------*/
+
+void alaw_decode_block(apr_int16_t *linear, const apr_byte_t *alaw, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        linear[i] = alaw_decode_table[alaw[i]];
+}
+/*- End of function --------------------------------------------------------*/
+
+void ulaw_to_alaw_block(apr_byte_t *alaw, const apr_byte_t *ulaw, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        alaw[i] = ulaw_to_alaw_table[ulaw[i]];
+}
+/*- End of function --------------------------------------------------------*/
+
+void alaw_to_ulaw_block(apr_byte_t *ulaw, const apr_byte_t *alaw, apr_size_t count)
+{
+    apr_size_t i;
+
+    for (i = 0;  i < count;  i++)
+        ulaw[i] = alaw_to_ulaw_table[alaw[i]];
+}
+/*- End of function --------------------------------------------------------*/
 /*- End of file ------------------------------------------------------------*/
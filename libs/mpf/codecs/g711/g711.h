@@ -368,6 +368,54 @@ apr_byte_t alaw_to_ulaw(apr_byte_t alaw);
 */
 apr_byte_t ulaw_to_alaw(apr_byte_t ulaw);
 
+/*! \brief Initialise the lookup tables used by the block routines. It is safe to
+           call it more than once, but the first call should not race with the use
+           of the block routines (call it on startup).
+*/
+void g711_tables_init(void);
+
+/*! \brief Encode a block of linear samples to u-law, using a 64K entry lookup table.
+    \param ulaw The buffer for the u-law values.
+    \param linear The samples to encode.
+    \param count The number of samples.
+*/
+void ulaw_encode_block(apr_byte_t *ulaw, const apr_int16_t *linear, apr_size_t count);
+
+/*! \brief Decode a block of u-law samples to linear, using a 256 entry lookup table.
+    \param linear The buffer for the linear values.
+    \param ulaw The u-law samples to decode.
+    \param count The number of samples.
+*/
+void ulaw_decode_block(apr_int16_t *linear, const apr_byte_t *ulaw, apr_size_t count);
+
+/*! \brief Encode a block of linear samples to A-law, using a 4K entry lookup table.
+    \param alaw The buffer for the A-law values.
+    \param linear The samples to encode.
+    \param count The number of samples.
+*/
+void alaw_encode_block(apr_byte_t *alaw, const apr_int16_t *linear, apr_size_t count);
+
+/*! \brief Decode a block of A-law samples to linear, using a 256 entry lookup table.
+    \param linear The buffer for the linear values.
+    \param alaw The A-law samples to decode.
+    \param count The number of samples.
+*/
+void alaw_decode_block(apr_int16_t *linear, const apr_byte_t *alaw, apr_size_t count);
+
+/*! \brief Transcode a block of u-law samples to A-law, using the 256 entry table.
+    \param alaw The buffer for the A-law values (may be the same as ulaw).
+    \param ulaw The u-law samples to transcode.
+    \param count The number of samples.
+*/
+void ulaw_to_alaw_block(apr_byte_t *alaw, const apr_byte_t *ulaw, apr_size_t count);
+
+/*! \brief Transcode a block of A-law samples to u-law, using the 256 entry table.
+    \param ulaw The buffer for the u-law values (may be the same as alaw).
+    \param alaw The A-law samples to transcode.
+    \param count The number of samples.
+*/
+void alaw_to_ulaw_block(apr_byte_t *ulaw, const apr_byte_t *alaw, apr_size_t count);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_G711_H */
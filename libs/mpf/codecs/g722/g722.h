@@ -0,0 +1,115 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * g722.h - The ITU G.722 codec.
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2005 Steve Underwood
+ *
+ *  Despite my general liking of the GPL, I place my own contributions
+ *  to this code in the public domain for the benefit of all mankind -
+ *  even the slimy ones who might try to proprietize my work and use it
+ *  to my detriment.
+ *
+ * Based on a single channel G.722 codec which is:
+ *
+ *****    Copyright (c) CMU    1993      *****
+ * Computer Science, Speech Group
+ * Chengxiang Lu and Alex Hauptmann
+ *
+ */
+
+/*! \page g722_page G.722 encoding and decoding
+\section g722_page_sec_1 What does it do?
+The G.722 module is a bit exact implementation of the ITU G.722 specification
+for the 64 kbit/s mode. The 56 and 48 kbit/s modes, which are used by the
+G.722 data insertion schemes only, are not supported.
+
+\section g722_page_sec_2 How does it work?
+The 16 kHz input signal is split by a QMF into a low and a high sub-band,
+sampled at 8 kHz each. The low band is coded with a 6 bit ADPCM quantizer,
+the high band with a 2 bit one, so each pair of input samples yields one
+octet, with the high band bits in the two most significant bits.
+*/
+
+#ifndef MPF_G722_H
+#define MPF_G722_H
+
+/**
+ * @file g722.h
+ * @brief ITU G.722 codec (64 kbit/s)
+ */
+
+#include "mpf.h"
+
+APT_BEGIN_EXTERN_C
+
+/*! State of a G.722 sub-band ADPCM predictor. */
+typedef struct
+{
+    int s;
+    int sp;
+    int sz;
+    int r[3];
+    int a[3];
+    int ap[3];
+    int p[3];
+    int d[7];
+    int b[7];
+    int bp[7];
+    int sg[7];
+    int nb;
+    int det;
+} g722_band_t;
+
+/*! G.722 encoder state. */
+typedef struct
+{
+    /*! Signal history for the QMF */
+    int x[24];
+    /*! Low and high band predictors */
+    g722_band_t band[2];
+} g722_encode_state_t;
+
+/*! G.722 decoder state. */
+typedef struct
+{
+    /*! Signal history for the QMF */
+    int x[24];
+    /*! Low and high band predictors */
+    g722_band_t band[2];
+} g722_decode_state_t;
+
+/*! \brief Initialise a G.722 encoder context.
+    \param s The G.722 encoder context.
+*/
+void g722_encode_init(g722_encode_state_t *s);
+
+/*! \brief Encode a buffer of linear PCM data to G.722.
+    \param s The G.722 encoder context.
+    \param g722_data The G.722 data produced.
+    \param amp The audio sample buffer (16 kHz).
+    \param len The number of samples in the buffer.
+    \return The number of bytes of G.722 data produced.
+*/
+apr_size_t g722_encode(g722_encode_state_t *s, apr_byte_t g722_data[], const apr_int16_t amp[], apr_size_t len);
+
+/*! \brief Initialise a G.722 decoder context.
+    \param s The G.722 decoder context.
+*/
+void g722_decode_init(g722_decode_state_t *s);
+
+/*! \brief Decode a G.722 data stream to linear PCM.
+    \param s The G.722 decoder context.
+    \param amp The audio sample buffer (16 kHz).
+    \param g722_data The G.722 data.
+    \param len The number of bytes of G.722 data.
+    \return The number of samples produced.
+*/
+apr_size_t g722_decode(g722_decode_state_t *s, apr_int16_t amp[], const apr_byte_t g722_data[], apr_size_t len);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_G722_H */
+/*- End of file ------------------------------------------------------------*/
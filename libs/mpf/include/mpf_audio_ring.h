@@ -0,0 +1,86 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_AUDIO_RING_H
+#define MPF_AUDIO_RING_H
+
+/**
+ * @file mpf_audio_ring.h
+ * @brief Lock-free Single-Producer/Single-Consumer Audio Ring
+ *
+ * The ring has a fixed capacity allocated once on creation. Audio and
+ * event markers are written by a single producer thread (e.g. TTS SDK
+ * callback) and read by a single consumer thread (MPF engine) without
+ * locking. A marker is delivered in the frame which reads the audio
+ * written right before the marker.
+ */
+
+#include "mpf_frame.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque audio ring declaration */
+typedef struct mpf_audio_ring_t mpf_audio_ring_t;
+
+/**
+ * Create audio ring.
+ * @param capacity the capacity in bytes (rounded up to the power of 2)
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(mpf_audio_ring_t*) mpf_audio_ring_create(apr_size_t capacity, apr_pool_t *pool);
+
+/**
+ * Write audio to the ring (producer).
+ * @param ring the ring to write to
+ * @param data the audio data to write
+ * @param size the size of data in bytes
+ * @return the number of bytes written, less than size if the ring is full
+ */
+MPF_DECLARE(apr_size_t) mpf_audio_ring_audio_write(mpf_audio_ring_t *ring, const void *data, apr_size_t size);
+
+/**
+ * Write event marker to the ring (producer).
+ * @param ring the ring to write to
+ * @param event_type the type of the event to raise (mpf_frame_type_e)
+ * @return FALSE if there are too many pending markers
+ */
+MPF_DECLARE(apt_bool_t) mpf_audio_ring_event_write(mpf_audio_ring_t *ring, mpf_frame_type_e event_type);
+
+/**
+ * Read media frame from the ring (consumer).
+ * @param ring the ring to read from
+ * @param frame the frame to fill, the rest of which is filled with silence on underrun
+ */
+MPF_DECLARE(apt_bool_t) mpf_audio_ring_frame_read(mpf_audio_ring_t *ring, mpf_frame_t *frame);
+
+/**
+ * Discard all the pending audio and markers (consumer).
+ * @param ring the ring to flush
+ */
+MPF_DECLARE(void) mpf_audio_ring_flush(mpf_audio_ring_t *ring);
+
+/** Get the number of bytes available to read */
+MPF_DECLARE(apr_size_t) mpf_audio_ring_size_get(const mpf_audio_ring_t *ring);
+
+/** Get the number of bytes available to write */
+MPF_DECLARE(apr_size_t) mpf_audio_ring_space_get(const mpf_audio_ring_t *ring);
+
+/** Get the total number of bytes rejected by the ring being full (back-pressure) */
+MPF_DECLARE(apr_size_t) mpf_audio_ring_overrun_get(const mpf_audio_ring_t *ring);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_AUDIO_RING_H */
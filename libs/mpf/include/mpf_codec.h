@@ -39,8 +39,18 @@ struct mpf_codec_t {
 	const mpf_codec_attribs_t    *attribs;
 	/** Optional static codec descriptor (pt < 96) */
 	const mpf_codec_descriptor_t *static_descriptor;
+	/** Codec specific (per instance) state, allocated on demand from the pool */
+	void                         *obj;
+	/** Pool the codec instance is allocated from */
+	apr_pool_t                   *pool;
 };
 
+/**
+ * Codec-to-codec transcoder (converts a frame of one codec directly into a frame of another one,
+ * preserving the sampling rate and channel count).
+ */
+typedef apt_bool_t (*mpf_codec_transcode_f)(const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out);
+
 /** Table of codec virtual methods */
 struct mpf_codec_vtable_t {
 	/** Virtual open method */
@@ -77,6 +87,8 @@ static APR_INLINE mpf_codec_t* mpf_codec_create(
 	codec->vtable = vtable;
 	codec->attribs = attribs;
 	codec->static_descriptor = descriptor;
+	codec->obj = NULL;
+	codec->pool = pool;
 	return codec;
 }
 
@@ -91,6 +103,8 @@ static APR_INLINE mpf_codec_t* mpf_codec_clone(mpf_codec_t *src_codec, apr_pool_
 	codec->vtable = src_codec->vtable;
 	codec->attribs = src_codec->attribs;
 	codec->static_descriptor = src_codec->static_descriptor;
+	codec->obj = NULL;
+	codec->pool = pool;
 	return codec;
 }
 
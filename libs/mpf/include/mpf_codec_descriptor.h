@@ -212,6 +212,15 @@ MPF_DECLARE(apt_bool_t) mpf_codec_lpcm_descriptor_match(const mpf_codec_descript
 /** Match codec descriptor by attribs specified */
 MPF_DECLARE(apt_bool_t) mpf_codec_descriptor_match_by_attribs(mpf_codec_descriptor_t *descriptor, const mpf_codec_descriptor_t *static_descriptor, const mpf_codec_attribs_t *attribs);
 
+/** Get RTP clock rate of the codec (may differ from the sampling rate, e.g. G.722) */
+MPF_DECLARE(apr_uint32_t) mpf_codec_rtp_clock_rate_get(const mpf_codec_descriptor_t *descriptor);
+
+/** Set sampling rate of the codec by RTP clock rate (as advertised in SDP rtpmap) */
+MPF_DECLARE(void) mpf_codec_rtp_clock_rate_set(mpf_codec_descriptor_t *descriptor, apr_uint32_t clock_rate);
+
+/** Calculate RTP timestamp units of the frame */
+MPF_DECLARE(apr_size_t) mpf_codec_frame_ts_calculate(const mpf_codec_descriptor_t *descriptor);
+
 
 
 /** Initialize codec capabilities */
@@ -48,6 +48,12 @@ MPF_DECLARE(apt_bool_t) mpf_codec_manager_codec_list_load(const mpf_codec_manage
 /** Find codec by name  */
 MPF_DECLARE(const mpf_codec_t*) mpf_codec_manager_codec_find(const mpf_codec_manager_t *codec_manager, const apt_str_t *codec_name);
 
+/** Register codec-to-codec transcoder in codec manager */
+MPF_DECLARE(apt_bool_t) mpf_codec_manager_transcoder_register(mpf_codec_manager_t *codec_manager, const char *src_codec_name, const char *dst_codec_name, mpf_codec_transcode_f transcode);
+
+/** Get codec-to-codec transcoder by source and destination codec descriptors */
+MPF_DECLARE(mpf_codec_transcode_f) mpf_codec_manager_transcoder_get(const mpf_codec_manager_t *codec_manager, const mpf_codec_descriptor_t *src_descriptor, const mpf_codec_descriptor_t *dst_descriptor);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_CODEC_MANAGER_H */
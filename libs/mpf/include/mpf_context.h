@@ -44,6 +44,13 @@ MPF_DECLARE(void) mpf_context_factory_destroy(mpf_context_factory_t *factory);
  */
 MPF_DECLARE(apt_bool_t) mpf_context_factory_process(mpf_context_factory_t *factory);
 
+/**
+ * Get the number of contexts created and not destroyed yet.
+ * @param factory the factory to get the number of contexts for
+ * @remark This function is thread-safe and can be used to estimate the load of the factory.
+ */
+MPF_DECLARE(apr_size_t) mpf_context_factory_context_count_get(const mpf_context_factory_t *factory);
+
 /**
  * Create MPF context.
  * @param factory the factory context belongs to
@@ -119,6 +126,27 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_apply(mpf_context_t *context);
  */
 MPF_DECLARE(apt_bool_t) mpf_context_topology_destroy(mpf_context_t *context);
 
+/**
+ * Defer topology application till mpf_context_topology_commit() is called.
+ * @param context the context to defer topology application for
+ * @return TRUE if the context had no deferred topology so far
+ */
+MPF_DECLARE(apt_bool_t) mpf_context_topology_defer(mpf_context_t *context);
+
+/**
+ * Apply deferred topology, if any.
+ * @param context the context to apply deferred topology for
+ * @return TRUE if deferred topology has been applied
+ */
+MPF_DECLARE(apt_bool_t) mpf_context_topology_commit(mpf_context_t *context);
+
+/**
+ * Cancel deferred topology, if any.
+ * @param context the context to cancel deferred topology for
+ * @return TRUE if deferred topology has been canceled
+ */
+MPF_DECLARE(apt_bool_t) mpf_context_topology_cancel(mpf_context_t *context);
+
 /**
  * Process context.
  * @param context the context to process
@@ -24,12 +24,30 @@
 
 #include "apt_task.h"
 #include "mpf_message.h"
+#include "mpf_scheduler.h"
 
 APT_BEGIN_EXTERN_C
 
 /** MPF task message definition */
 typedef apt_task_msg_t mpf_task_msg_t;
 
+/** Request processing statistics declaration */
+typedef struct mpf_engine_request_stat_t mpf_engine_request_stat_t;
+
+/** Request processing statistics */
+struct mpf_engine_request_stat_t {
+	/** Number of processed requests */
+	apr_uint32_t request_count;
+	/** Number of requests processed in the last tick, which had any */
+	apr_uint32_t last_tick_request_count;
+	/** Max number of requests processed in a tick */
+	apr_uint32_t max_tick_request_count;
+	/** Number of applied topologies */
+	apr_uint32_t topology_apply_count;
+	/** Number of topologies not applied, since superseded by a subsequent request in the same tick */
+	apr_uint32_t topology_coalesced_count;
+};
+
 /**
  * Create MPF engine.
  * @param id the identifier of the engine
@@ -151,6 +169,59 @@ MPF_DECLARE(apt_bool_t) mpf_engine_message_send(mpf_engine_t *engine, mpf_task_m
  */
 MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_rate_set(mpf_engine_t *engine, unsigned long rate);
 
+/**
+ * Set real-time priority of the scheduler thread.
+ * @param engine the engine to set priority for
+ * @param priority the SCHED_FIFO priority (0 - disabled)
+ * @remark Must be called before the engine is started.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_priority_set(mpf_engine_t *engine, int priority);
+
+/**
+ * Bind the scheduler thread to the specified CPU core.
+ * @param engine the engine to bind scheduler thread of
+ * @param cpu the CPU core index (-1 - not bound)
+ * @remark Must be called before the engine is started.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_cpu_affinity_set(mpf_engine_t *engine, int cpu);
+
+/**
+ * Get scheduler statistics.
+ * @param engine the engine to get statistics of
+ * @param stat the statistics to fill
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_stat_get(const mpf_engine_t *engine, mpf_scheduler_stat_t *stat);
+
+/**
+ * Get request processing statistics.
+ * @param engine the engine to get statistics of
+ * @param stat the statistics to fill
+ * @remark The statistics is updated by the scheduler thread without any synchronization.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_request_stat_get(const mpf_engine_t *engine, mpf_engine_request_stat_t *stat);
+
+/**
+ * Enable batched RTP I/O of the engine.
+ * @param engine the engine to enable batched RTP I/O for
+ * @return the RTP I/O, or NULL if not supported on the platform
+ * @remark Must be called before the engine is started.
+ */
+MPF_DECLARE(mpf_rtp_io_t*) mpf_engine_rtp_io_enable(mpf_engine_t *engine);
+
+/**
+ * Get batched RTP I/O of the engine.
+ * @param engine the engine to get RTP I/O of
+ * @return the RTP I/O, or NULL if not enabled
+ */
+MPF_DECLARE(mpf_rtp_io_t*) mpf_engine_rtp_io_get(const mpf_engine_t *engine);
+
+/**
+ * Get the number of media contexts created and not destroyed yet.
+ * @param engine the engine to get the number of contexts for
+ * @remark The number of contexts is used to estimate the load of the engine.
+ */
+MPF_DECLARE(apr_size_t) mpf_engine_context_count_get(const mpf_engine_t *engine);
+
 /**
  * Get the identifier of the engine .
  * @param engine the engine to get name of
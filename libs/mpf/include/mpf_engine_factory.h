@@ -35,7 +35,7 @@ MPF_DECLARE(apt_bool_t) mpf_engine_factory_engine_add(mpf_engine_factory_t *mpf_
 /** Determine whether factory is empty. */
 MPF_DECLARE(apt_bool_t) mpf_engine_factory_is_empty(const mpf_engine_factory_t *mpf_factory);
 
-/** Select next available media engine. */
+/** Select the least loaded media engine (engines loaded equally are selected in round-robin order). */
 MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_select(mpf_engine_factory_t *mpf_factory);
 
 /** Associate media engines with RTP termination factory. */
@@ -19,7 +19,7 @@
 
 /**
  * @file mpf_mixer.h
- * @brief MPF Stream Mixer (n-sources, 1-sink)
+ * @brief MPF Stream Mixer (n-sources, 1-sink) and Mix-Minus (n-sources, n-sinks)
  */ 
 
 #include "mpf_object.h"
@@ -43,6 +43,47 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 								const char *name,
 								apr_pool_t *pool);
 
+/**
+ * Create audio stream mix-minus (conference), which sends to each stream
+ * the mix of all the other streams.
+ * @param stream_arr the array of bidirectional audio streams
+ * @param stream_count the number of audio streams
+ * @param codec_manager the codec manager
+ * @param name the informative name used for debugging
+ * @param pool the pool to allocate memory from
+ * @remark All the streams must be sent at the same sampling rate
+ */
+MPF_DECLARE(mpf_object_t*) mpf_mix_minus_create(
+								mpf_audio_stream_t **stream_arr,
+								apr_size_t stream_count,
+								const mpf_codec_manager_t *codec_manager,
+								const char *name,
+								apr_pool_t *pool);
+
+/**
+ * Add linear samples to the 32-bit mix accumulator.
+ * @param acc the accumulator to add to
+ * @param samples the samples to add
+ * @param count the number of samples
+ */
+MPF_DECLARE(void) mpf_mix_accumulate(apr_int32_t *acc, const apr_int16_t *samples, apr_size_t count);
+
+/**
+ * Convert the mix accumulator to linear samples with saturation.
+ * @param mix the output samples
+ * @param acc the accumulator
+ * @param count the number of samples
+ */
+MPF_DECLARE(void) mpf_mix_saturate(apr_int16_t *mix, const apr_int32_t *acc, apr_size_t count);
+
+/**
+ * Convert the mix accumulator excluding the specified samples to linear samples with saturation.
+ * @param mix the output samples
+ * @param acc the accumulator
+ * @param samples the samples to exclude from the mix (previously accumulated)
+ * @param count the number of samples
+ */
+MPF_DECLARE(void) mpf_mix_minus_saturate(apr_int16_t *mix, const apr_int32_t *acc, const apr_int16_t *samples, apr_size_t count);
 
 APT_END_EXTERN_C
 
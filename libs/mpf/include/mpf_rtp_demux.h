@@ -0,0 +1,103 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_RTP_DEMUX_H
+#define MPF_RTP_DEMUX_H
+
+/**
+ * @file mpf_rtp_demux.h
+ * @brief MPF RTP Demultiplexer (RTP Sessions Sharing a Pair of Sockets)
+ */ 
+
+#include "mpf_rtp_io.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque RTP demultiplexer declaration */
+typedef struct mpf_rtp_demux_t mpf_rtp_demux_t;
+
+/** Opaque RTP demultiplexer entry (session) declaration */
+typedef struct mpf_rtp_demux_entry_t mpf_rtp_demux_entry_t;
+
+/**
+ * Create RTP demultiplexer bound to the specified RTP port and the next RTCP port.
+ * @param io the RTP I/O to receive packets by
+ * @param ip the local IP address to bind to
+ * @param port the local RTP port to bind to
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(mpf_rtp_demux_t*) mpf_rtp_demux_create(mpf_rtp_io_t *io, const char *ip, apr_port_t port, apr_pool_t *pool);
+
+/**
+ * Get the shared RTP socket.
+ * @param demux the demultiplexer to get socket of
+ */
+MPF_DECLARE(apr_socket_t*) mpf_rtp_demux_rtp_socket_get(const mpf_rtp_demux_t *demux);
+
+/**
+ * Get the shared RTCP socket.
+ * @param demux the demultiplexer to get socket of
+ */
+MPF_DECLARE(apr_socket_t*) mpf_rtp_demux_rtcp_socket_get(const mpf_rtp_demux_t *demux);
+
+/**
+ * Get the local address of the shared RTP socket.
+ * @param demux the demultiplexer to get address of
+ */
+MPF_DECLARE(apr_sockaddr_t*) mpf_rtp_demux_rtp_sockaddr_get(const mpf_rtp_demux_t *demux);
+
+/**
+ * Get the local address of the shared RTCP socket.
+ * @param demux the demultiplexer to get address of
+ */
+MPF_DECLARE(apr_sockaddr_t*) mpf_rtp_demux_rtcp_sockaddr_get(const mpf_rtp_demux_t *demux);
+
+/**
+ * Add RTP session to be demultiplexed.
+ * @param demux the demultiplexer to add session to
+ * @param rtp_r_sockaddr the remote RTP address of the session
+ * @param rtcp_r_sockaddr the remote RTCP address of the session (optional)
+ * @param rtp_handler the handler of received RTP packets
+ * @param rtcp_handler the handler of received RTCP packets (optional)
+ * @param obj the external object to pass to the handlers
+ * @param pool the pool to allocate memory from
+ * @remark Packets are matched by the remote address, or by the SSRC learnt from
+ * previously matched packets, if the remote port changes. The remote port
+ * is latched by the first packet from the signaled IP address, so that the
+ * session of a peer behind NAPT is matched as well. Packets from other IP
+ * addresses are never matched. Latching applies to the receive direction only,
+ * RTP and RTCP are still sent to the signaled remote addresses.
+ * Only IPv4 remote addresses are supported.
+ */
+MPF_DECLARE(mpf_rtp_demux_entry_t*) mpf_rtp_demux_session_add(
+										mpf_rtp_demux_t *demux,
+										const apr_sockaddr_t *rtp_r_sockaddr,
+										const apr_sockaddr_t *rtcp_r_sockaddr,
+										mpf_rtp_io_rx_handler_f rtp_handler,
+										mpf_rtp_io_rx_handler_f rtcp_handler,
+										void *obj,
+										apr_pool_t *pool);
+
+/**
+ * Remove RTP session previously added.
+ * @param demux the demultiplexer to remove session from
+ * @param entry the session to remove
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_demux_session_remove(mpf_rtp_demux_t *demux, mpf_rtp_demux_entry_t *entry);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_RTP_DEMUX_H */
@@ -110,6 +110,13 @@ typedef enum {
 	RTCP_BYE_PER_TALKSPURT  /**< transmit RTCP BYE at the end of each talkspurt (input) */
 } rtcp_bye_policy_e;
 
+/** RTP I/O mode */
+typedef enum {
+	RTP_IO_MODE_SOCKET,     /**< non-blocking receive/send calls per socket (default) */
+	RTP_IO_MODE_BATCHED,    /**< readiness polling and batched receive/send calls per media engine */
+	RTP_IO_MODE_SHARED      /**< batched I/O over a pair of sockets shared by all the streams of a media engine */
+} rtp_io_mode_e;
+
 /** RTP factory config */
 struct mpf_rtp_config_t {
 	/** Local IP address to bind to */
@@ -122,6 +129,8 @@ struct mpf_rtp_config_t {
 	apr_port_t        rtp_port_max;
 	/** Current RTP port */
 	apr_port_t        rtp_port_cur;
+	/** RTP I/O mode */
+	rtp_io_mode_e     io_mode;
 };
 
 /** RTP settings */
@@ -193,6 +202,7 @@ static APR_INLINE mpf_rtp_config_t* mpf_rtp_config_alloc(apr_pool_t *pool)
 	rtp_config->rtp_port_cur = 0;
 	rtp_config->rtp_port_min = 0;
 	rtp_config->rtp_port_max = 0;
+	rtp_config->io_mode = RTP_IO_MODE_SOCKET;
 	return rtp_config;
 }
 
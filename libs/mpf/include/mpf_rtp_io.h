@@ -0,0 +1,133 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_RTP_IO_H
+#define MPF_RTP_IO_H
+
+/**
+ * @file mpf_rtp_io.h
+ * @brief MPF RTP I/O (Batched Receive/Send of RTP Packets)
+ */ 
+
+#include <apr_network_io.h>
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque RTP I/O socket declaration */
+typedef struct mpf_rtp_io_socket_t mpf_rtp_io_socket_t;
+
+/**
+ * Prototype of the handler of received packets.
+ * @param obj the external object
+ * @param buffer the packet data
+ * @param size the size of the packet
+ * @param remote_ip the IPv4 address the packet is received from (network byte order)
+ * @param remote_port the port the packet is received from
+ */
+typedef void (*mpf_rtp_io_rx_handler_f)(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port);
+
+/** RTP I/O statistics declaration */
+typedef struct mpf_rtp_io_stat_t mpf_rtp_io_stat_t;
+
+/** RTP I/O statistics */
+struct mpf_rtp_io_stat_t {
+	/** Number of readiness polls */
+	apr_uint32_t poll_count;
+	/** Number of receive system calls */
+	apr_uint32_t rx_syscalls;
+	/** Number of received packets */
+	apr_uint32_t rx_packets;
+	/** Number of send system calls */
+	apr_uint32_t tx_syscalls;
+	/** Number of sent packets */
+	apr_uint32_t tx_packets;
+	/** Number of packets failed to be sent */
+	apr_uint32_t tx_failures;
+};
+
+/**
+ * Create RTP I/O.
+ * @param pool the pool to allocate memory from
+ * @remark Return NULL, if batched I/O is not supported on the platform.
+ */
+MPF_DECLARE(mpf_rtp_io_t*) mpf_rtp_io_create(apr_pool_t *pool);
+
+/**
+ * Destroy RTP I/O.
+ * @param io the RTP I/O to destroy
+ */
+MPF_DECLARE(void) mpf_rtp_io_destroy(mpf_rtp_io_t *io);
+
+/**
+ * Add socket to be polled for incoming packets.
+ * @param io the RTP I/O to add socket to
+ * @param socket the socket to add
+ * @param handler the handler to call on each received packet
+ * @param obj the external object to pass to the handler
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(mpf_rtp_io_socket_t*) mpf_rtp_io_socket_add(
+									mpf_rtp_io_t *io,
+									apr_socket_t *socket,
+									mpf_rtp_io_rx_handler_f handler,
+									void *obj,
+									apr_pool_t *pool);
+
+/**
+ * Remove socket previously added.
+ * @param io the RTP I/O to remove socket from
+ * @param io_socket the socket to remove
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_socket_remove(mpf_rtp_io_t *io, mpf_rtp_io_socket_t *io_socket);
+
+/**
+ * Queue packet to be sent on the next flush.
+ * @param io the RTP I/O to queue packet to
+ * @param socket the socket to send packet from
+ * @param sockaddr the destination address
+ * @param data the packet data (copied)
+ * @param size the size of the packet
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_send(
+							mpf_rtp_io_t *io,
+							apr_socket_t *socket,
+							apr_sockaddr_t *sockaddr,
+							const void *data,
+							apr_size_t size);
+
+/**
+ * Poll added sockets and dispatch received packets to their handlers.
+ * @param io the RTP I/O to process
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_receive(mpf_rtp_io_t *io);
+
+/**
+ * Send all the queued packets.
+ * @param io the RTP I/O to flush
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_flush(mpf_rtp_io_t *io);
+
+/**
+ * Get RTP I/O statistics.
+ * @param io the RTP I/O to get statistics of
+ * @param stat the statistics to fill
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_stat_get(const mpf_rtp_io_t *io, mpf_rtp_io_stat_t *stat);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_RTP_IO_H */
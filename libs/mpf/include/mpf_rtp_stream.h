@@ -24,6 +24,7 @@
 
 #include "mpf_stream.h"
 #include "mpf_rtp_descriptor.h"
+#include "mpf_rtp_demux.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -55,6 +56,14 @@ MPF_DECLARE(apt_bool_t) mpf_rtp_stream_remove(mpf_audio_stream_t *stream);
  */
 MPF_DECLARE(apt_bool_t) mpf_rtp_stream_modify(mpf_audio_stream_t *stream, mpf_rtp_stream_descriptor_t *descriptor);
 
+/**
+ * Set RTP demultiplexer to share the sockets of.
+ * @param stream RTP stream to set demultiplexer for
+ * @param demux the demultiplexer to use
+ * @remark Must be set before the stream is modified for the first time.
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_stream_demux_set(mpf_audio_stream_t *stream, mpf_rtp_demux_t *demux);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_RTP_STREAM_H */
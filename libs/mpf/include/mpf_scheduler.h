@@ -29,6 +29,27 @@ APT_BEGIN_EXTERN_C
 /** Prototype of scheduler callback */
 typedef void (*mpf_scheduler_proc_f)(mpf_scheduler_t *scheduler, void *obj);
 
+/** Scheduler statistics declaration */
+typedef struct mpf_scheduler_stat_t mpf_scheduler_stat_t;
+
+/** Scheduler statistics */
+struct mpf_scheduler_stat_t {
+	/** Number of processed ticks */
+	apr_uint32_t        tick_count;
+	/** Number of ticks, processing of which took longer than the resolution */
+	apr_uint32_t        overrun_count;
+	/** Number of ticks skipped in order to catch up with the clock */
+	apr_uint32_t        skipped_count;
+	/** Processing time of the last tick (usec) */
+	apr_interval_time_t last_processing_time;
+	/** Max processing time of a tick (usec) */
+	apr_interval_time_t max_processing_time;
+	/** Total processing time of all the ticks (usec) */
+	apr_interval_time_t total_processing_time;
+	/** Max lateness of a tick against its deadline (usec) */
+	apr_interval_time_t max_lateness;
+};
+
 /** Create scheduler */
 MPF_DECLARE(mpf_scheduler_t*) mpf_scheduler_create(apr_pool_t *pool);
 
@@ -54,6 +75,25 @@ MPF_DECLARE(apt_bool_t) mpf_scheduler_rate_set(
 								mpf_scheduler_t *scheduler,
 								unsigned long rate);
 
+/** Set real-time (SCHED_FIFO) priority of the scheduler thread, 0 - disabled (default) */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_priority_set(
+								mpf_scheduler_t *scheduler,
+								int priority);
+
+/** Bind the scheduler thread to the specified CPU core, -1 - not bound (default) */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_cpu_affinity_set(
+								mpf_scheduler_t *scheduler,
+								int cpu);
+
+/** 
+ * Get scheduler statistics.
+ * @remark The statistics is updated by the scheduler thread without any synchronization,
+ *         the returned values should be considered an approximate snapshot.
+ */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_stat_get(
+								const mpf_scheduler_t *scheduler,
+								mpf_scheduler_stat_t *stat);
+
 /** Start scheduler */
 MPF_DECLARE(apt_bool_t) mpf_scheduler_start(mpf_scheduler_t *scheduler);
 
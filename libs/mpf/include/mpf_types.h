@@ -35,6 +35,9 @@ typedef struct mpf_engine_factory_t mpf_engine_factory_t;
 /** Opaque MPF scheduler declaration */
 typedef struct mpf_scheduler_t mpf_scheduler_t;
 
+/** Opaque MPF RTP I/O declaration */
+typedef struct mpf_rtp_io_t mpf_rtp_io_t;
+
 /** Opaque codec manager declaration */
 typedef struct mpf_codec_manager_t mpf_codec_manager_t;
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "mpf_audio_ring.h"
+
+/** Max number of pending event markers (power of 2) */
+#define MPF_AUDIO_RING_MARKER_COUNT 16
+
+/*
+ * Positions are free running 32-bit byte (marker) counters, the index in
+ * the ring is the position masked by the capacity. Each position is advanced
+ * only by its owner (write_pos and marker_write by the producer, read_pos and
+ * marker_read by the consumer) by means of an atomic add, which also acts as
+ * a memory barrier publishing the data copied before.
+ */
+
+typedef struct mpf_audio_marker_t mpf_audio_marker_t;
+
+/** Event marker */
+struct mpf_audio_marker_t {
+	/** Audio position the event is raised at */
+	apr_uint32_t     pos;
+	/** Event type (mpf_frame_type_e) */
+	mpf_frame_type_e type;
+};
+
+struct mpf_audio_ring_t {
+	/** Audio data */
+	apr_byte_t            *data;
+	/** Capacity in bytes (power of 2) */
+	apr_uint32_t           capacity;
+
+	/** Write position (producer) */
+	volatile apr_uint32_t  write_pos;
+	/** Read position (consumer) */
+	volatile apr_uint32_t  read_pos;
+
+	/** Event markers */
+	mpf_audio_marker_t     markers[MPF_AUDIO_RING_MARKER_COUNT];
+	/** Marker write position (producer) */
+	volatile apr_uint32_t  marker_write;
+	/** Marker read position (consumer) */
+	volatile apr_uint32_t  marker_read;
+
+	/** Number of bytes rejected since creation (producer) */
+	volatile apr_uint32_t  overrun;
+};
+
+MPF_DECLARE(mpf_audio_ring_t*) mpf_audio_ring_create(apr_size_t capacity, apr_pool_t *pool)
+{
+	mpf_audio_ring_t *ring;
+	apr_uint32_t size = 1;
+	if(!capacity || capacity > 0x40000000) {
+		return NULL;
+	}
+	while(size < capacity) {
+		size <<= 1;
+	}
+
+	ring = apr_palloc(pool,sizeof(mpf_audio_ring_t));
+	ring->data = apr_palloc(pool,size);
+	ring->capacity = size;
+	ring->write_pos = 0;
+	ring->read_pos = 0;
+	ring->marker_write = 0;
+	ring->marker_read = 0;
+	ring->overrun = 0;
+	return ring;
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_ring_audio_write(mpf_audio_ring_t *ring, const void *data, apr_size_t size)
+{
+	apr_uint32_t write_pos = ring->write_pos;
+	apr_uint32_t read_pos = apr_atomic_read32(&ring->read_pos);
+	apr_uint32_t space = ring->capacity - (write_pos - read_pos);
+	apr_uint32_t offset = write_pos & (ring->capacity - 1);
+	apr_uint32_t count;
+	apr_uint32_t chunk;
+
+	count = size < space ? (apr_uint32_t)size : space;
+	if(count) {
+		chunk = ring->capacity - offset;
+		if(chunk > count) {
+			chunk = count;
+		}
+		memcpy(ring->data + offset,data,chunk);
+		if(count > chunk) {
+			memcpy(ring->data,(const apr_byte_t*)data + chunk,count - chunk);
+		}
+		apr_atomic_add32(&ring->write_pos,count);
+	}
+
+	if(count < size) {
+		apr_atomic_add32(&ring->overrun,(apr_uint32_t)(size - count));
+	}
+	return count;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_audio_ring_event_write(mpf_audio_ring_t *ring, mpf_frame_type_e event_type)
+{
+	mpf_audio_marker_t *marker;
+	apr_uint32_t marker_write = ring->marker_write;
+	if(marker_write - apr_atomic_read32(&ring->marker_read) >= MPF_AUDIO_RING_MARKER_COUNT) {
+		return FALSE;
+	}
+
+	marker = &ring->markers[marker_write & (MPF_AUDIO_RING_MARKER_COUNT - 1)];
+	marker->pos = ring->write_pos;
+	marker->type = event_type;
+	apr_atomic_add32(&ring->marker_write,1);
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_audio_ring_frame_read(mpf_audio_ring_t *ring, mpf_frame_t *frame)
+{
+	const mpf_audio_marker_t *marker;
+	apr_byte_t *buffer = frame->codec_frame.buffer;
+	apr_uint32_t frame_size = (apr_uint32_t)frame->codec_frame.size;
+	apr_uint32_t read_pos = ring->read_pos;
+	apr_uint32_t marker_read = ring->marker_read;
+	apr_uint32_t marker_write = apr_atomic_read32(&ring->marker_write);
+	apr_uint32_t available = apr_atomic_read32(&ring->write_pos) - read_pos;
+	apr_uint32_t offset = read_pos & (ring->capacity - 1);
+	apr_uint32_t count;
+	apr_uint32_t chunk;
+	apr_uint32_t marker_offset;
+
+	count = available < frame_size ? available : frame_size;
+	if(count) {
+		chunk = ring->capacity - offset;
+		if(chunk > count) {
+			chunk = count;
+		}
+		memcpy(buffer,ring->data + offset,chunk);
+		if(count > chunk) {
+			memcpy(buffer + chunk,ring->data,count - chunk);
+		}
+		frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+	}
+	if(count < frame_size) {
+		/* underrun, fill the rest of the frame with silence */
+		memset(buffer + count,0,frame_size - count);
+	}
+
+	/* raise the events the audio read so far has reached, an event right at
+	the end of a full frame is raised with the next frame */
+	for(; marker_read != marker_write; marker_read++) {
+		marker = &ring->markers[marker_read & (MPF_AUDIO_RING_MARKER_COUNT - 1)];
+		marker_offset = marker->pos - read_pos;
+		if(marker_offset > count || (marker_offset == count && count == frame_size)) {
+			break;
+		}
+		frame->type |= marker->type;
+	}
+
+	if(count) {
+		apr_atomic_add32(&ring->read_pos,count);
+	}
+	if(marker_read != ring->marker_read) {
+		apr_atomic_add32(&ring->marker_read,marker_read - ring->marker_read);
+	}
+	return TRUE;
+}
+
+MPF_DECLARE(void) mpf_audio_ring_flush(mpf_audio_ring_t *ring)
+{
+	apr_uint32_t marker_write = apr_atomic_read32(&ring->marker_write);
+	apr_uint32_t write_pos = apr_atomic_read32(&ring->write_pos);
+	apr_atomic_add32(&ring->read_pos,write_pos - ring->read_pos);
+	apr_atomic_add32(&ring->marker_read,marker_write - ring->marker_read);
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_ring_size_get(const mpf_audio_ring_t *ring)
+{
+	mpf_audio_ring_t *r = (mpf_audio_ring_t*)ring;
+	return apr_atomic_read32(&r->write_pos) - apr_atomic_read32(&r->read_pos);
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_ring_space_get(const mpf_audio_ring_t *ring)
+{
+	return ring->capacity - mpf_audio_ring_size_get(ring);
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_ring_overrun_get(const mpf_audio_ring_t *ring)
+{
+	mpf_audio_ring_t *r = (mpf_audio_ring_t*)ring;
+	return apr_atomic_read32(&r->overrun);
+}
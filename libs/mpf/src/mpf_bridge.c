@@ -31,10 +31,14 @@ struct mpf_bridge_t {
 	mpf_audio_stream_t *source;
 	/** Audio stream sink */
 	mpf_audio_stream_t *sink;
-	/** Codec used in case of null bridge */
+	/** Codec used in case of null bridge (sink codec in case of transcoding bridge) */
 	mpf_codec_t        *codec;
 	/** Media frame used to read data from source and write it to sink */
 	mpf_frame_t         frame;
+	/** Codec-to-codec transcoder used in case of transcoding bridge */
+	mpf_codec_transcode_f transcode;
+	/** Media frame used to write transcoded data to sink */
+	mpf_frame_t         out_frame;
 };
 
 static apt_bool_t mpf_bridge_process(mpf_object_t *object)
@@ -70,6 +74,28 @@ static apt_bool_t mpf_null_bridge_process(mpf_object_t *object)
 	return TRUE;
 }
 
+static apt_bool_t mpf_transcoding_bridge_process(mpf_object_t *object)
+{
+	mpf_bridge_t *bridge = (mpf_bridge_t*) object;
+	bridge->frame.type = MEDIA_FRAME_TYPE_NONE;
+	bridge->frame.marker = MPF_MARKER_NONE;
+	bridge->source->vtable->read_frame(bridge->source,&bridge->frame);
+
+	bridge->out_frame.type = bridge->frame.type;
+	bridge->out_frame.marker = bridge->frame.marker;
+	bridge->out_frame.event_frame = bridge->frame.event_frame;
+	if((bridge->frame.type & MEDIA_FRAME_TYPE_AUDIO) == 0) {
+		/* generate silence frame */
+		mpf_codec_initialize(bridge->codec,&bridge->out_frame.codec_frame);
+	}
+	else {
+		bridge->transcode(&bridge->frame.codec_frame,&bridge->out_frame.codec_frame);
+	}
+
+	bridge->sink->vtable->write_frame(bridge->sink,&bridge->out_frame);
+	return TRUE;
+}
+
 static void mpf_bridge_trace(mpf_object_t *object)
 {
 	mpf_bridge_t *bridge = (mpf_bridge_t*) object;
@@ -112,6 +138,7 @@ static mpf_bridge_t* mpf_bridge_base_create(mpf_audio_stream_t *source, mpf_audi
 	bridge->source = source;
 	bridge->sink = sink;
 	bridge->codec = NULL;
+	bridge->transcode = NULL;
 	mpf_object_init(&bridge->base,name);
 	bridge->base.destroy = mpf_bridge_destroy;
 	bridge->base.process = mpf_bridge_process;
@@ -177,6 +204,44 @@ static mpf_object_t* mpf_null_bridge_create(mpf_audio_stream_t *source, mpf_audi
 	return &bridge->base;
 }
 
+static mpf_object_t* mpf_transcoding_bridge_create(mpf_audio_stream_t *source, mpf_audio_stream_t *sink, mpf_codec_transcode_f transcode, const mpf_codec_manager_t *codec_manager, const char *name, apr_pool_t *pool)
+{
+	mpf_codec_t *source_codec;
+	mpf_codec_t *sink_codec;
+	apr_size_t frame_size;
+	mpf_bridge_t *bridge;
+	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Create Transcoding Audio Bridge %s",name);
+	bridge = mpf_bridge_base_create(source,sink,name,pool);
+	if(!bridge) {
+		return NULL;
+	}
+	bridge->base.process = mpf_transcoding_bridge_process;
+	bridge->transcode = transcode;
+
+	source_codec = mpf_codec_manager_codec_get(codec_manager,source->rx_descriptor,pool);
+	sink_codec = mpf_codec_manager_codec_get(codec_manager,sink->tx_descriptor,pool);
+	if(!source_codec || !sink_codec) {
+		return NULL;
+	}
+
+	bridge->codec = sink_codec;
+	frame_size = mpf_codec_frame_size_calculate(source->rx_descriptor,source_codec->attribs);
+	bridge->frame.codec_frame.size = frame_size;
+	bridge->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	frame_size = mpf_codec_frame_size_calculate(sink->tx_descriptor,sink_codec->attribs);
+	bridge->out_frame.codec_frame.size = frame_size;
+	bridge->out_frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+
+	if(mpf_audio_stream_rx_open(source,source_codec) == FALSE) {
+		return NULL;
+	}
+	if(mpf_audio_stream_tx_open(sink,sink_codec) == FALSE) {
+		mpf_audio_stream_rx_close(source);
+		return NULL;
+	}
+	return &bridge->base;
+}
+
 MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 						mpf_audio_stream_t *source, 
 						mpf_audio_stream_t *sink, 
@@ -184,6 +249,7 @@ MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 						const char *name,
 						apr_pool_t *pool)
 {
+	mpf_codec_transcode_f transcode;
 	if(!source || !sink) {
 		return NULL;
 	}
@@ -197,6 +263,12 @@ MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 		return mpf_null_bridge_create(source,sink,codec_manager,name,pool);
 	}
 
+	transcode = mpf_codec_manager_transcoder_get(codec_manager,source->rx_descriptor,sink->tx_descriptor);
+	if(transcode) {
+		/* convert codec frames directly, bypassing decoder and encoder */
+		return mpf_transcoding_bridge_create(source,sink,transcode,codec_manager,name,pool);
+	}
+
 	if(mpf_codec_lpcm_descriptor_match(source->rx_descriptor) == FALSE) {
 		mpf_codec_t *codec = mpf_codec_manager_codec_get(codec_manager,source->rx_descriptor,pool);
 		if(codec) {
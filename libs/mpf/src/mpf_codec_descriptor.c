@@ -22,6 +22,12 @@
 #define LPCM_CODEC_NAME        "LPCM"
 #define LPCM_CODEC_NAME_LENGTH (sizeof(LPCM_CODEC_NAME)-1)
 
+/* G.722 (RTP clock rate is 8kHz for historical reasons, see RFC3551) */
+#define G722_CODEC_NAME        "G722"
+#define G722_CODEC_NAME_LENGTH (sizeof(G722_CODEC_NAME)-1)
+#define G722_RTP_CLOCK_RATE    8000
+#define G722_SAMPLING_RATE     16000
+
 /* linear PCM atrributes */
 static const mpf_codec_attribs_t lpcm_attribs = {
 	{LPCM_CODEC_NAME, LPCM_CODEC_NAME_LENGTH},    /* codec name */
@@ -317,3 +323,40 @@ MPF_DECLARE(apt_bool_t) mpf_codec_lists_compare(const mpf_codec_list_t *codec_li
 
 	return TRUE;
 }
+
+static APR_INLINE apt_bool_t mpf_codec_g722_check(const mpf_codec_descriptor_t *descriptor)
+{
+	if(descriptor->payload_type == RTP_PT_G722) {
+		return TRUE;
+	}
+	if(descriptor->name.length == G722_CODEC_NAME_LENGTH &&
+		strncasecmp(descriptor->name.buf,G722_CODEC_NAME,G722_CODEC_NAME_LENGTH) == 0) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/** Get RTP clock rate of the codec */
+MPF_DECLARE(apr_uint32_t) mpf_codec_rtp_clock_rate_get(const mpf_codec_descriptor_t *descriptor)
+{
+	if(mpf_codec_g722_check(descriptor) == TRUE) {
+		return G722_RTP_CLOCK_RATE;
+	}
+	return descriptor->sampling_rate;
+}
+
+/** Set sampling rate of the codec by RTP clock rate */
+MPF_DECLARE(void) mpf_codec_rtp_clock_rate_set(mpf_codec_descriptor_t *descriptor, apr_uint32_t clock_rate)
+{
+	if(clock_rate == G722_RTP_CLOCK_RATE && mpf_codec_g722_check(descriptor) == TRUE) {
+		descriptor->sampling_rate = G722_SAMPLING_RATE;
+		return;
+	}
+	descriptor->sampling_rate = (apr_uint16_t)clock_rate;
+}
+
+/** Calculate RTP timestamp units of the frame */
+MPF_DECLARE(apr_size_t) mpf_codec_frame_ts_calculate(const mpf_codec_descriptor_t *descriptor)
+{
+	return (apr_size_t) descriptor->channel_count * CODEC_FRAME_TIME_BASE * mpf_codec_rtp_clock_rate_get(descriptor) / 1000;
+}
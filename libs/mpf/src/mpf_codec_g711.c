@@ -15,6 +15,7 @@
  */
 
 #include "mpf_codec.h"
+#include "mpf_codec_manager.h"
 #include "mpf_rtp_pt.h"
 #include "g711/g711.h"
 
@@ -38,16 +39,13 @@ static apt_bool_t g711u_encode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 {
 	const apr_int16_t *decode_buf;
 	unsigned char *encode_buf;
-	apr_size_t i;
 
 	decode_buf = frame_in->buffer;
 	encode_buf = frame_out->buffer;
 
 	frame_out->size = frame_in->size / sizeof(apr_int16_t);
 
-	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_ulaw(decode_buf[i]);
-	}
+	ulaw_encode_block(encode_buf,decode_buf,frame_out->size);
 
 	return TRUE;
 }
@@ -56,16 +54,13 @@ static apt_bool_t g711u_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 {
 	apr_int16_t *decode_buf;
 	const unsigned char *encode_buf;
-	apr_size_t i;
 
 	decode_buf = frame_out->buffer;
 	encode_buf = frame_in->buffer;
 
 	frame_out->size = frame_in->size * sizeof(apr_int16_t);
 
-	for(i=0; i<frame_in->size; i++) {
-		decode_buf[i] = ulaw_to_linear(encode_buf[i]);
-	}
+	ulaw_decode_block(decode_buf,encode_buf,frame_in->size);
 
 	return TRUE;
 }
@@ -85,16 +80,13 @@ static apt_bool_t g711a_encode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 {
 	const apr_int16_t *decode_buf;
 	unsigned char *encode_buf;
-	apr_size_t i;
 
 	decode_buf = frame_in->buffer;
 	encode_buf = frame_out->buffer;
 
 	frame_out->size = frame_in->size / sizeof(apr_int16_t);
 
-	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_alaw(decode_buf[i]);
-	}
+	alaw_encode_block(encode_buf,decode_buf,frame_out->size);
 
 	return TRUE;
 }
@@ -103,16 +95,13 @@ static apt_bool_t g711a_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 {
 	apr_int16_t *decode_buf;
 	const unsigned char *encode_buf;
-	apr_size_t i;
 
 	decode_buf = frame_out->buffer;
 	encode_buf = frame_in->buffer;
 
 	frame_out->size = frame_in->size * sizeof(apr_int16_t);
 
-	for(i=0; i<frame_in->size; i++) {
-		decode_buf[i] = alaw_to_linear(encode_buf[i]);
-	}
+	alaw_decode_block(decode_buf,encode_buf,frame_in->size);
 
 	return TRUE;
 }
@@ -128,6 +117,20 @@ static apt_bool_t g711a_init(mpf_codec_t *codec, mpf_codec_frame_t *frame_out)
 	return TRUE;
 }
 
+static apt_bool_t g711u_to_g711a_transcode(const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	frame_out->size = frame_in->size;
+	ulaw_to_alaw_block(frame_out->buffer,frame_in->buffer,frame_in->size);
+	return TRUE;
+}
+
+static apt_bool_t g711a_to_g711u_transcode(const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	frame_out->size = frame_in->size;
+	alaw_to_ulaw_block(frame_out->buffer,frame_in->buffer,frame_in->size);
+	return TRUE;
+}
+
 static const mpf_codec_vtable_t g711u_vtable = {
 	g711_open,
 	g711_close,
@@ -180,10 +183,19 @@ static const mpf_codec_attribs_t g711a_attribs = {
 
 mpf_codec_t* mpf_codec_g711u_create(apr_pool_t *pool)
 {
+	g711_tables_init();
 	return mpf_codec_create(&g711u_vtable,&g711u_attribs,&g711u_descriptor,pool);
 }
 
 mpf_codec_t* mpf_codec_g711a_create(apr_pool_t *pool)
 {
+	g711_tables_init();
 	return mpf_codec_create(&g711a_vtable,&g711a_attribs,&g711a_descriptor,pool);
 }
+
+apt_bool_t mpf_codec_g711_transcoders_register(mpf_codec_manager_t *codec_manager)
+{
+	mpf_codec_manager_transcoder_register(codec_manager,G711u_CODEC_NAME,G711a_CODEC_NAME,g711u_to_g711a_transcode);
+	mpf_codec_manager_transcoder_register(codec_manager,G711a_CODEC_NAME,G711u_CODEC_NAME,g711a_to_g711u_transcode);
+	return TRUE;
+}
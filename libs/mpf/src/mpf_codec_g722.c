@@ -0,0 +1,130 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mpf_codec.h"
+#include "mpf_rtp_pt.h"
+#include "g722/g722.h"
+
+#define G722_CODEC_NAME        "G722"
+#define G722_CODEC_NAME_LENGTH (sizeof(G722_CODEC_NAME)-1)
+
+/** Number of linear samples encoded to a silence frame at once */
+#define G722_SILENCE_SAMPLES   160
+
+/** G.722 codec state (per codec instance) */
+typedef struct mpf_g722_state_t mpf_g722_state_t;
+
+struct mpf_g722_state_t {
+	/** Encoder state */
+	g722_encode_state_t encoder;
+	/** Decoder state */
+	g722_decode_state_t decoder;
+};
+
+static apt_bool_t g722_open(mpf_codec_t *codec)
+{
+	mpf_g722_state_t *state = codec->obj;
+	if(!state) {
+		state = apr_palloc(codec->pool,sizeof(mpf_g722_state_t));
+		codec->obj = state;
+	}
+	g722_encode_init(&state->encoder);
+	g722_decode_init(&state->decoder);
+	return TRUE;
+}
+
+static apt_bool_t g722_close(mpf_codec_t *codec)
+{
+	return TRUE;
+}
+
+static apt_bool_t g722_encode_frame(mpf_codec_t *codec, const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	mpf_g722_state_t *state = codec->obj;
+	if(!state) {
+		return FALSE;
+	}
+
+	frame_out->size = g722_encode(
+						&state->encoder,
+						frame_out->buffer,
+						frame_in->buffer,
+						frame_in->size / sizeof(apr_int16_t));
+	return TRUE;
+}
+
+static apt_bool_t g722_decode_frame(mpf_codec_t *codec, const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	mpf_g722_state_t *state = codec->obj;
+	if(!state) {
+		return FALSE;
+	}
+
+	frame_out->size = sizeof(apr_int16_t) * g722_decode(
+						&state->decoder,
+						frame_out->buffer,
+						frame_in->buffer,
+						frame_in->size);
+	return TRUE;
+}
+
+static apt_bool_t g722_init(mpf_codec_t *codec, mpf_codec_frame_t *frame_out)
+{
+	static const apr_int16_t silence[G722_SILENCE_SAMPLES] = {0};
+	g722_encode_state_t encoder;
+	apr_byte_t *encode_buf = frame_out->buffer;
+	apr_size_t size = frame_out->size;
+	apr_size_t chunk;
+
+	/* encode silence with a separate encoder, so that the state of the codec instance is not disturbed */
+	g722_encode_init(&encoder);
+	while(size) {
+		chunk = size > G722_SILENCE_SAMPLES / 2 ? G722_SILENCE_SAMPLES / 2 : size;
+		g722_encode(&encoder,encode_buf,silence,chunk * 2);
+		encode_buf += chunk;
+		size -= chunk;
+	}
+	return TRUE;
+}
+
+static const mpf_codec_vtable_t g722_vtable = {
+	g722_open,
+	g722_close,
+	g722_encode_frame,
+	g722_decode_frame,
+	NULL,
+	g722_init
+};
+
+static const mpf_codec_descriptor_t g722_descriptor = {
+	RTP_PT_G722,
+	{G722_CODEC_NAME, G722_CODEC_NAME_LENGTH},
+	16000,
+	1,
+	{NULL, 0},
+	TRUE
+};
+
+static const mpf_codec_attribs_t g722_attribs = {
+	{G722_CODEC_NAME, G722_CODEC_NAME_LENGTH},    /* codec name */
+	4,                                            /* bits per sample */
+	MPF_SAMPLE_RATE_16000                         /* supported sampling rates */
+};
+
+mpf_codec_t* mpf_codec_g722_create(apr_pool_t *pool)
+{
+	return mpf_codec_create(&g722_vtable,&g722_attribs,&g722_descriptor,pool);
+}
@@ -20,6 +20,17 @@
 #include "mpf_named_event.h"
 #include "apt_log.h"
 
+/** Codec-to-codec transcoder entry */
+typedef struct mpf_codec_transcoder_t mpf_codec_transcoder_t;
+
+struct mpf_codec_transcoder_t {
+	/** Source codec name */
+	apt_str_t             src_codec_name;
+	/** Destination codec name */
+	apt_str_t             dst_codec_name;
+	/** Transcode handler */
+	mpf_codec_transcode_f transcode;
+};
 
 struct mpf_codec_manager_t {
 	/** Memory pool */
@@ -27,6 +38,8 @@ struct mpf_codec_manager_t {
 
 	/** Dynamic (resizable) array of codecs (mpf_codec_t*) */
 	apr_array_header_t     *codec_arr;
+	/** Dynamic (resizable) array of transcoders (mpf_codec_transcoder_t) */
+	apr_array_header_t     *transcoder_arr;
 	/** Default named event descriptor */
 	mpf_codec_descriptor_t *event_descriptor;
 };
@@ -37,6 +50,7 @@ MPF_DECLARE(mpf_codec_manager_t*) mpf_codec_manager_create(apr_size_t codec_coun
 	mpf_codec_manager_t *codec_manager = apr_palloc(pool,sizeof(mpf_codec_manager_t));
 	codec_manager->pool = pool;
 	codec_manager->codec_arr = apr_array_make(pool,(int)codec_count,sizeof(mpf_codec_t*));
+	codec_manager->transcoder_arr = apr_array_make(pool,2,sizeof(mpf_codec_transcoder_t));
 	codec_manager->event_descriptor = mpf_event_descriptor_create(8000,pool);
 	return codec_manager;
 }
@@ -195,3 +209,43 @@ MPF_DECLARE(const mpf_codec_t*) mpf_codec_manager_codec_find(const mpf_codec_man
 	}
 	return NULL;
 }
+
+MPF_DECLARE(apt_bool_t) mpf_codec_manager_transcoder_register(mpf_codec_manager_t *codec_manager, const char *src_codec_name, const char *dst_codec_name, mpf_codec_transcode_f transcode)
+{
+	mpf_codec_transcoder_t *transcoder;
+	if(!src_codec_name || !dst_codec_name || !transcode) {
+		return FALSE;
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Register Transcoder [%s->%s]",src_codec_name,dst_codec_name);
+
+	transcoder = apr_array_push(codec_manager->transcoder_arr);
+	apt_string_assign(&transcoder->src_codec_name,src_codec_name,codec_manager->pool);
+	apt_string_assign(&transcoder->dst_codec_name,dst_codec_name,codec_manager->pool);
+	transcoder->transcode = transcode;
+	return TRUE;
+}
+
+MPF_DECLARE(mpf_codec_transcode_f) mpf_codec_manager_transcoder_get(const mpf_codec_manager_t *codec_manager, const mpf_codec_descriptor_t *src_descriptor, const mpf_codec_descriptor_t *dst_descriptor)
+{
+	int i;
+	const mpf_codec_transcoder_t *transcoder;
+	if(!src_descriptor || !dst_descriptor) {
+		return NULL;
+	}
+
+	/* transcoders neither resample nor remix, the rest is up to the decoder/encoder path */
+	if(src_descriptor->sampling_rate != dst_descriptor->sampling_rate ||
+		src_descriptor->channel_count != dst_descriptor->channel_count) {
+		return NULL;
+	}
+
+	for(i=0; i<codec_manager->transcoder_arr->nelts; i++) {
+		transcoder = &APR_ARRAY_IDX(codec_manager->transcoder_arr,i,mpf_codec_transcoder_t);
+		if(apt_string_compare(&transcoder->src_codec_name,&src_descriptor->name) == TRUE &&
+			apt_string_compare(&transcoder->dst_codec_name,&dst_descriptor->name) == TRUE) {
+			return transcoder->transcode;
+		}
+	}
+	return NULL;
+}
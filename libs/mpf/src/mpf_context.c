@@ -18,6 +18,7 @@
 #pragma warning(disable: 4127)
 #endif
 #include <apr_ring.h> 
+#include <apr_atomic.h>
 #include "mpf_context.h"
 #include "mpf_termination.h"
 #include "mpf_stream.h"
@@ -59,16 +60,22 @@ struct mpf_context_t {
 	header_item_t                *header;
 	/** Association matrix, which represents the topology */
 	matrix_item_t                **matrix;
+	/** Streams of the conference collected while applying topology (capacity items) */
+	mpf_audio_stream_t           **stream_arr;
 
 	/** Array of media processing objects constructed while 
 	applying topology based on association matrix */
 	apr_array_header_t           *mpf_objects;
+	/** Topology application is deferred */
+	apt_bool_t                    topology_pending;
 };
 
 /** Factory of media contexts */
 struct mpf_context_factory_t {
 	/** Ring head */
 	APR_RING_HEAD(mpf_context_head_t, mpf_context_t) head;
+	/** Number of contexts created and not destroyed yet */
+	volatile apr_uint32_t context_count;
 };
 
 
@@ -76,12 +83,14 @@ static APR_INLINE apt_bool_t stream_direction_compatibility_check(mpf_terminatio
 static mpf_object_t* mpf_context_bridge_create(mpf_context_t *context, apr_size_t i);
 static mpf_object_t* mpf_context_multiplier_create(mpf_context_t *context, apr_size_t i);
 static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t j);
+static mpf_object_t* mpf_context_mix_minus_create(mpf_context_t *context);
 
 
 MPF_DECLARE(mpf_context_factory_t*) mpf_context_factory_create(apr_pool_t *pool)
 {
 	mpf_context_factory_t *factory = apr_palloc(pool, sizeof(mpf_context_factory_t));
 	APR_RING_INIT(&factory->head, mpf_context_t, link);
+	factory->context_count = 0;
 	return factory;
 }
 
@@ -108,6 +117,10 @@ MPF_DECLARE(apt_bool_t) mpf_context_factory_process(mpf_context_factory_t *facto
 	return TRUE;
 }
 
+MPF_DECLARE(apr_size_t) mpf_context_factory_context_count_get(const mpf_context_factory_t *factory)
+{
+	return apr_atomic_read32((volatile apr_uint32_t*)&factory->context_count);
+}
  
 MPF_DECLARE(mpf_context_t*) mpf_context_create(
 								mpf_context_factory_t *factory,
@@ -131,8 +144,10 @@ MPF_DECLARE(mpf_context_t*) mpf_context_create(
 	context->capacity = max_termination_count;
 	context->count = 0;
 	context->mpf_objects = apr_array_make(pool,1,sizeof(mpf_object_t*));
+	context->topology_pending = FALSE;
 	context->header = apr_palloc(pool,context->capacity * sizeof(header_item_t));
 	context->matrix = apr_palloc(pool,context->capacity * sizeof(matrix_item_t*));
+	context->stream_arr = apr_palloc(pool,context->capacity * sizeof(mpf_audio_stream_t*));
 	for(i=0; i<context->capacity; i++) {
 		header_item = &context->header[i];
 		header_item->termination = NULL;
@@ -145,6 +160,7 @@ MPF_DECLARE(mpf_context_t*) mpf_context_create(
 		}
 	}
 
+	apr_atomic_inc32(&factory->context_count);
 	return context;
 }
 
@@ -159,6 +175,7 @@ MPF_DECLARE(apt_bool_t) mpf_context_destroy(mpf_context_t *context)
 			mpf_termination_subtract(termination);
 		}
 	}
+	apr_atomic_dec32(&context->factory->context_count);
 	return TRUE;
 }
 
@@ -386,6 +403,14 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_apply(mpf_context_t *context)
 	
 	/* first destroy existing topology / if any */
 	mpf_context_topology_destroy(context);
+	context->topology_pending = FALSE;
+
+	/* conference (full mesh of 3+ terminations) is mixed in one pass */
+	object = mpf_context_mix_minus_create(context);
+	if(object) {
+		mpf_context_object_add(context,object);
+		return TRUE;
+	}
 
 	for(i=0,k=0; i<context->capacity && k<context->count; i++) {
 		header_item = &context->header[i];
@@ -428,6 +453,32 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_destroy(mpf_context_t *context)
 	return TRUE;
 }
 
+MPF_DECLARE(apt_bool_t) mpf_context_topology_defer(mpf_context_t *context)
+{
+	if(context->topology_pending == TRUE) {
+		return FALSE;
+	}
+	context->topology_pending = TRUE;
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_context_topology_commit(mpf_context_t *context)
+{
+	if(context->topology_pending == FALSE) {
+		return FALSE;
+	}
+	return mpf_context_topology_apply(context);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_context_topology_cancel(mpf_context_t *context)
+{
+	if(context->topology_pending == FALSE) {
+		return FALSE;
+	}
+	context->topology_pending = FALSE;
+	return TRUE;
+}
+
 MPF_DECLARE(apt_bool_t) mpf_context_process(mpf_context_t *context)
 {
 	int i;
@@ -534,6 +585,38 @@ static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t
 				context->pool);
 }
 
+static mpf_object_t* mpf_context_mix_minus_create(mpf_context_t *context)
+{
+	mpf_audio_stream_t **stream_arr = context->stream_arr;
+	const mpf_codec_manager_t *codec_manager = NULL;
+	header_item_t *header_item;
+	apr_size_t i,k;
+	if(context->count < 3) {
+		return NULL;
+	}
+
+	/* the array is reused on every apply, the mix-minus copies the streams */
+	for(i=0,k=0; i<context->capacity && k<context->count; i++) {
+		header_item = &context->header[i];
+		if(!header_item->termination) {
+			continue;
+		}
+		/* each termination must send to and receive from all the others */
+		if(header_item->tx_count != context->count - 1 || header_item->rx_count != context->count - 1) {
+			return NULL;
+		}
+		stream_arr[k] = header_item->termination->audio_stream;
+		codec_manager = header_item->termination->codec_manager;
+		k++;
+	}
+	return mpf_mix_minus_create(
+				stream_arr,
+				context->count,
+				codec_manager,
+				context->name,
+				context->pool);
+}
+
 static APR_INLINE apt_bool_t stream_direction_compatibility_check(mpf_termination_t *termination1, mpf_termination_t *termination2)
 {
 	mpf_audio_stream_t *source = termination1->audio_stream;
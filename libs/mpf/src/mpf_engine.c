@@ -19,10 +19,11 @@
 #include "mpf_termination.h"
 #include "mpf_stream.h"
 #include "mpf_scheduler.h"
+#include "mpf_rtp_io.h"
 #include "mpf_codec_descriptor.h"
 #include "mpf_codec_manager.h"
 #include "apt_obj_list.h"
-#include "apt_cyclic_queue.h"
+#include "apt_mpsc_queue.h"
 #include "apt_log.h"
 
 #define MPF_TIMER_RESOLUTION 100 /* 100 ms */
@@ -31,12 +32,16 @@ struct mpf_engine_t {
 	apr_pool_t                *pool;
 	apt_task_t                *task;
 	apt_task_msg_type_e        task_msg_type;
-	apr_thread_mutex_t        *request_queue_guard;
-	apt_cyclic_queue_t        *request_queue;
+	apt_mpsc_queue_t          *request_queue;
+	apr_array_header_t        *pending_contexts;
+	apt_task_msg_t            *response_head;
+	apt_task_msg_t            *response_tail;
+	mpf_engine_request_stat_t  request_stat;
 	mpf_context_factory_t     *context_factory;
 	mpf_scheduler_t           *scheduler;
 	apt_timer_queue_t         *timer_queue;
 	const mpf_codec_manager_t *codec_manager;
+	mpf_rtp_io_t              *rtp_io;
 };
 
 static void mpf_engine_main(mpf_scheduler_t *scheduler, void *obj);
@@ -50,6 +55,8 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 mpf_codec_t* mpf_codec_l16_create(apr_pool_t *pool);
 mpf_codec_t* mpf_codec_g711u_create(apr_pool_t *pool);
 mpf_codec_t* mpf_codec_g711a_create(apr_pool_t *pool);
+mpf_codec_t* mpf_codec_g722_create(apr_pool_t *pool);
+apt_bool_t mpf_codec_g711_transcoders_register(mpf_codec_manager_t *codec_manager);
 
 APT_LOG_SOURCE_IMPLEMENT(MPF,mpf_log_source,"MPF")
 
@@ -60,10 +67,15 @@ MPF_DECLARE(mpf_engine_t*) mpf_engine_create(const char *id, apr_pool_t *pool)
 	mpf_engine_t *engine = apr_palloc(pool,sizeof(mpf_engine_t));
 	engine->pool = pool;
 	engine->request_queue = NULL;
+	engine->pending_contexts = NULL;
+	engine->response_head = NULL;
+	engine->response_tail = NULL;
+	memset(&engine->request_stat,0,sizeof(mpf_engine_request_stat_t));
 	engine->context_factory = NULL;
 	engine->codec_manager = NULL;
+	engine->rtp_io = NULL;
 
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mpf_message_container_t),pool);
+	msg_pool = apt_task_msg_pool_create_cached(sizeof(mpf_message_container_t),pool);
 
 	apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Create Media Engine [%s]",id);
 	engine->task = apt_task_create(engine,msg_pool,pool);
@@ -85,8 +97,11 @@ MPF_DECLARE(mpf_engine_t*) mpf_engine_create(const char *id, apr_pool_t *pool)
 	engine->task_msg_type = TASK_MSG_USER;
 
 	engine->context_factory = mpf_context_factory_create(engine->pool);
-	engine->request_queue = apt_cyclic_queue_create(CYCLIC_QUEUE_DEFAULT_SIZE);
-	apr_thread_mutex_create(&engine->request_queue_guard,APR_THREAD_MUTEX_UNNESTED,engine->pool);
+	engine->request_queue = apt_mpsc_queue_create(engine->pool);
+	if(!engine->request_queue) {
+		return NULL;
+	}
+	engine->pending_contexts = apr_array_make(engine->pool,5,sizeof(mpf_context_t*));
 
 	engine->scheduler = mpf_scheduler_create(engine->pool);
 	mpf_scheduler_media_clock_set(engine->scheduler,CODEC_FRAME_TIME_BASE,mpf_engine_main,engine);
@@ -228,9 +243,11 @@ static apt_bool_t mpf_engine_destroy(apt_task_t *task)
 
 	apt_timer_queue_destroy(engine->timer_queue);
 	mpf_scheduler_destroy(engine->scheduler);
+	if(engine->rtp_io) {
+		mpf_rtp_io_destroy(engine->rtp_io);
+		engine->rtp_io = NULL;
+	}
 	mpf_context_factory_destroy(engine->context_factory);
-	apt_cyclic_queue_destroy(engine->request_queue);
-	apr_thread_mutex_destroy(engine->request_queue_guard);
 	return TRUE;
 }
 
@@ -246,8 +263,29 @@ static apt_bool_t mpf_engine_start(apt_task_t *task)
 static apt_bool_t mpf_engine_terminate(apt_task_t *task)
 {
 	mpf_engine_t *engine = apt_task_object_get(task);
+	mpf_scheduler_stat_t stat;
 
 	mpf_scheduler_stop(engine->scheduler);
+	if(mpf_scheduler_stat_get(engine->scheduler,&stat) == TRUE && stat.tick_count) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Media Engine Scheduler Stats [%s] ticks [%u] overruns [%u] skipped [%u] "
+			"processing time avg [%"APR_TIME_T_FMT"] max [%"APR_TIME_T_FMT"] max lateness [%"APR_TIME_T_FMT"] usec",
+			apt_task_name_get(task),
+			stat.tick_count,
+			stat.overrun_count,
+			stat.skipped_count,
+			stat.total_processing_time / stat.tick_count,
+			stat.max_processing_time,
+			stat.max_lateness);
+	}
+	if(engine->request_stat.request_count) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Media Engine Request Stats [%s] requests [%u] max per tick [%u] "
+			"topologies applied [%u] coalesced [%u]",
+			apt_task_name_get(task),
+			engine->request_stat.request_count,
+			engine->request_stat.max_tick_request_count,
+			engine->request_stat.topology_apply_count,
+			engine->request_stat.topology_coalesced_count);
+	}
 	apt_task_terminate_request_process(task);
 	return TRUE;
 }
@@ -285,13 +323,28 @@ static apt_bool_t mpf_engine_event_raise(mpf_termination_t *termination, int eve
 static apt_bool_t mpf_engine_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
 {
 	mpf_engine_t *engine = apt_task_object_get(task);
-	
-	apr_thread_mutex_lock(engine->request_queue_guard);
-	if(apt_cyclic_queue_push(engine->request_queue,msg) == FALSE) {
-		apt_log(MPF_LOG_MARK,APT_PRIO_ERROR,"MPF Request Queue is Full [%s]",apt_task_name_get(task));
+	/* never blocks neither the signaling thread nor the media thread */
+	return apt_mpsc_queue_push(engine->request_queue,msg);
+}
+
+/** Resolve topology deferred earlier in the tick, before the context is modified by the request */
+static void mpf_engine_topology_resolve(mpf_engine_t *engine, mpf_context_t *context, mpf_command_type_e command_id)
+{
+	switch(command_id) {
+		case MPF_APPLY_TOPOLOGY:
+		case MPF_RESET_ASSOCIATIONS:
+		case MPF_DESTROY_TOPOLOGY:
+			/* the deferred topology would be destroyed right away */
+			if(mpf_context_topology_cancel(context) == TRUE) {
+				engine->request_stat.topology_coalesced_count++;
+			}
+			break;
+		default:
+			if(mpf_context_topology_commit(context) == TRUE) {
+				engine->request_stat.topology_apply_count++;
+			}
+			break;
 	}
-	apr_thread_mutex_unlock(engine->request_queue_guard);
-	return TRUE;
 }
 
 static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
@@ -313,6 +366,7 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	response_msg->type = engine->task_msg_type;
 	response = (mpf_message_container_t*) response_msg->data;
 	*response = *request;
+	engine->request_stat.request_count += (apr_uint32_t)request->count;
 	for(i=0; i<request->count; i++) {
 		mpf_request = &request->messages[i];
 		mpf_response = &response->messages[i];
@@ -326,6 +380,9 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 		mpf_response->status_code = MPF_STATUS_CODE_SUCCESS;
 		context = mpf_request->context;
 		termination = mpf_request->termination;
+		if(context) {
+			mpf_engine_topology_resolve(engine,context,mpf_request->command_id);
+		}
 		switch(mpf_request->command_id) {
 			case MPF_ADD_TERMINATION:
 			{
@@ -373,7 +430,10 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 			}
 			case MPF_APPLY_TOPOLOGY:
 			{
-				mpf_context_topology_apply(context);
+				/* applied once at the end of the tick, unless superseded by a subsequent request */
+				if(mpf_context_topology_defer(context) == TRUE) {
+					APR_ARRAY_PUSH(engine->pending_contexts,mpf_context_t*) = context;
+				}
 				break;
 			}
 			case MPF_DESTROY_TOPOLOGY:
@@ -388,27 +448,80 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 		}
 	}
 
-	return apt_task_msg_parent_signal(engine->task,response_msg);
+	/* responses are sent once all the requests of the tick are applied */
+	response_msg->next = NULL;
+	if(engine->response_tail) {
+		engine->response_tail->next = response_msg;
+	}
+	else {
+		engine->response_head = response_msg;
+	}
+	engine->response_tail = response_msg;
+	return TRUE;
+}
+
+/** Apply the topologies deferred during the tick and send the responses */
+static void mpf_engine_requests_complete(mpf_engine_t *engine)
+{
+	int i;
+	mpf_context_t *context;
+	apt_task_msg_t *response_msg;
+	apt_task_msg_t *next;
+
+	for(i=0; i<engine->pending_contexts->nelts; i++) {
+		context = APR_ARRAY_IDX(engine->pending_contexts,i,mpf_context_t*);
+		if(mpf_context_topology_commit(context) == TRUE) {
+			engine->request_stat.topology_apply_count++;
+		}
+	}
+	apr_array_clear(engine->pending_contexts);
+
+	response_msg = engine->response_head;
+	engine->response_head = NULL;
+	engine->response_tail = NULL;
+	while(response_msg) {
+		next = response_msg->next;
+		apt_task_msg_parent_signal(engine->task,response_msg);
+		response_msg = next;
+	}
 }
 
 static void mpf_engine_main(mpf_scheduler_t *scheduler, void *obj)
 {
 	mpf_engine_t *engine = obj;
 	apt_task_msg_t *msg;
+	apr_uint32_t request_count = engine->request_stat.request_count;
 
 	/* process request queue */
-	apr_thread_mutex_lock(engine->request_queue_guard);
-	msg = apt_cyclic_queue_pop(engine->request_queue);
-	while(msg) {
-		apr_thread_mutex_unlock(engine->request_queue_guard);
-		apt_task_msg_process(engine->task,msg);
-		apr_thread_mutex_lock(engine->request_queue_guard);
-		msg = apt_cyclic_queue_pop(engine->request_queue);
+	msg = apt_mpsc_queue_trypop(engine->request_queue);
+	if(msg) {
+		do {
+			apt_task_msg_process(engine->task,msg);
+			msg = apt_mpsc_queue_trypop(engine->request_queue);
+		}
+		while(msg);
+
+		mpf_engine_requests_complete(engine);
+
+		request_count = engine->request_stat.request_count - request_count;
+		engine->request_stat.last_tick_request_count = request_count;
+		if(request_count > engine->request_stat.max_tick_request_count) {
+			engine->request_stat.max_tick_request_count = request_count;
+		}
+	}
+
+	if(engine->rtp_io) {
+		/* receive packets of all the RTP streams at once */
+		mpf_rtp_io_receive(engine->rtp_io);
 	}
-	apr_thread_mutex_unlock(engine->request_queue_guard);
 
 	/* process factory of media contexts */
 	mpf_context_factory_process(engine->context_factory);
+
+	if(engine->rtp_io) {
+		/* send packets queued by the RTP streams during the tick */
+		mpf_rtp_io_flush(engine->rtp_io);
+	}
 }
 
 static void mpf_engine_timer_proc(mpf_scheduler_t *scheduler, void *obj)
@@ -419,7 +532,7 @@ static void mpf_engine_timer_proc(mpf_scheduler_t *scheduler, void *obj)
 
 MPF_DECLARE(mpf_codec_manager_t*) mpf_engine_codec_manager_create(apr_pool_t *pool)
 {
-	mpf_codec_manager_t *codec_manager = mpf_codec_manager_create(4,pool);
+	mpf_codec_manager_t *codec_manager = mpf_codec_manager_create(5,pool);
 	if(codec_manager) {
 		mpf_codec_t *codec;
 
@@ -429,8 +542,13 @@ MPF_DECLARE(mpf_codec_manager_t*) mpf_engine_codec_manager_create(apr_pool_t *po
 		codec = mpf_codec_g711a_create(pool);
 		mpf_codec_manager_codec_register(codec_manager,codec);
 
+		codec = mpf_codec_g722_create(pool);
+		mpf_codec_manager_codec_register(codec_manager,codec);
+
 		codec = mpf_codec_l16_create(pool);
 		mpf_codec_manager_codec_register(codec_manager,codec);
+
+		mpf_codec_g711_transcoders_register(codec_manager);
 	}
 	return codec_manager;
 }
@@ -446,6 +564,51 @@ MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_rate_set(mpf_engine_t *engine, unsi
 	return mpf_scheduler_rate_set(engine->scheduler,rate);
 }
 
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_priority_set(mpf_engine_t *engine, int priority)
+{
+	return mpf_scheduler_priority_set(engine->scheduler,priority);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_cpu_affinity_set(mpf_engine_t *engine, int cpu)
+{
+	return mpf_scheduler_cpu_affinity_set(engine->scheduler,cpu);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_stat_get(const mpf_engine_t *engine, mpf_scheduler_stat_t *stat)
+{
+	return mpf_scheduler_stat_get(engine->scheduler,stat);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_request_stat_get(const mpf_engine_t *engine, mpf_engine_request_stat_t *stat)
+{
+	if(!engine || !stat) {
+		return FALSE;
+	}
+	*stat = engine->request_stat;
+	return TRUE;
+}
+
+MPF_DECLARE(mpf_rtp_io_t*) mpf_engine_rtp_io_enable(mpf_engine_t *engine)
+{
+	if(!engine->rtp_io) {
+		engine->rtp_io = mpf_rtp_io_create(engine->pool);
+		if(engine->rtp_io) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Enable Batched RTP I/O [%s]",apt_task_name_get(engine->task));
+		}
+	}
+	return engine->rtp_io;
+}
+
+MPF_DECLARE(mpf_rtp_io_t*) mpf_engine_rtp_io_get(const mpf_engine_t *engine)
+{
+	return engine->rtp_io;
+}
+
+MPF_DECLARE(apr_size_t) mpf_engine_context_count_get(const mpf_engine_t *engine)
+{
+	return mpf_context_factory_context_count_get(engine->context_factory);
+}
+
 MPF_DECLARE(const char*) mpf_engine_id_get(const mpf_engine_t *engine)
 {
 	return apt_task_name_get(engine->task);
@@ -15,15 +15,17 @@
  */
 
 #include <apr_tables.h>
+#include <apr_atomic.h>
 #include "mpf_engine_factory.h"
+#include "mpf_engine.h"
 #include "mpf_termination_factory.h"
 
 /** Factory of media engines */
 struct mpf_engine_factory_t {
 	/** Array of pointers to media engines */
 	apr_array_header_t   *engines_arr;
-	/** Index of the current engine */
-	int                   index;
+	/** Index of the current engine (advanced by concurrent selections) */
+	volatile apr_uint32_t index;
 };
 
 /** Create factory of media engines. */
@@ -53,12 +55,36 @@ MPF_DECLARE(apt_bool_t) mpf_engine_factory_is_empty(const mpf_engine_factory_t *
 	return apr_is_empty_array(mpf_factory->engines_arr);
 }
 
-/** Select next available media engine. */
+/** Select the least loaded media engine. */
 MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_select(mpf_engine_factory_t *mpf_factory)
 {
-	mpf_engine_t *media_engine = APR_ARRAY_IDX(mpf_factory->engines_arr, mpf_factory->index, mpf_engine_t*);
-	if(++mpf_factory->index == mpf_factory->engines_arr->nelts) {
-		mpf_factory->index = 0;
+	int i;
+	int index;
+	apr_size_t count;
+	apr_size_t min_count;
+	mpf_engine_t *candidate;
+	mpf_engine_t *media_engine;
+	if(apr_is_empty_array(mpf_factory->engines_arr)) {
+		return NULL;
+	}
+
+	/* engines are selected from concurrent session workers, take the current index once */
+	index = (int)(apr_atomic_inc32(&mpf_factory->index) % mpf_factory->engines_arr->nelts);
+	media_engine = APR_ARRAY_IDX(mpf_factory->engines_arr, index, mpf_engine_t*);
+	min_count = mpf_engine_context_count_get(media_engine);
+
+	/* select the least loaded engine, starting from the current index, 
+	so that equally loaded engines are still selected in round-robin order */
+	for(i=1; i<mpf_factory->engines_arr->nelts && min_count; i++) {
+		if(++index == mpf_factory->engines_arr->nelts) {
+			index = 0;
+		}
+		candidate = APR_ARRAY_IDX(mpf_factory->engines_arr, index, mpf_engine_t*);
+		count = mpf_engine_context_count_get(candidate);
+		if(count < min_count) {
+			min_count = count;
+			media_engine = candidate;
+		}
 	}
 	return media_engine;
 }
@@ -21,6 +21,17 @@
 #include "mpf_codec_manager.h"
 #include "apt_log.h"
 
+#if defined(__AVX2__)
+#define ENABLE_AVX2_MIXER
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENABLE_SSE2_MIXER
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ENABLE_NEON_MIXER
+#include <arm_neon.h>
+#endif
+
 typedef struct mpf_mixer_t mpf_mixer_t;
 
 /** MPF mixer derived from MPF object */
@@ -38,28 +49,136 @@ struct mpf_mixer_t {
 	mpf_frame_t          frame;
 	/** Mixed frame to write to audio sink */
 	mpf_frame_t          mix_frame;
+	/** Mix accumulator (32-bit samples) */
+	apr_int32_t         *acc;
 };
 
-static apt_bool_t mpf_frames_mix(mpf_frame_t *mix_frame, const mpf_frame_t *frame)
+typedef struct mpf_mix_minus_t mpf_mix_minus_t;
+
+/** MPF mix-minus derived from MPF object */
+struct mpf_mix_minus_t {
+	/** MPF mix-minus base */
+	mpf_object_t         base;
+	/** Array of audio sources */
+	mpf_audio_stream_t **source_arr;
+	/** Array of audio sinks */
+	mpf_audio_stream_t **sink_arr;
+	/** Number of audio sources and sinks */
+	apr_size_t           count;
+
+	/** Array of frames to read from audio sources */
+	mpf_frame_t         *frame_arr;
+	/** Mixed frame to write to audio sink */
+	mpf_frame_t          mix_frame;
+	/** Mix accumulator (32-bit samples) */
+	apr_int32_t         *acc;
+};
+
+/** Saturate 32-bit sample to 16-bit one */
+static APR_INLINE apr_int16_t mpf_sample_saturate(apr_int32_t sample)
 {
-	apr_size_t i;
-	apr_int16_t *mix_buf = mix_frame->codec_frame.buffer;
-	const apr_int16_t *buf = frame->codec_frame.buffer;
-	apr_size_t samples = frame->codec_frame.size / sizeof(apr_int16_t);
+	if(sample > 32767) {
+		return 32767;
+	}
+	if(sample < -32768) {
+		return -32768;
+	}
+	return (apr_int16_t)sample;
+}
 
-	if(mix_frame->codec_frame.size != frame->codec_frame.size) {
-		return FALSE;
+MPF_DECLARE(void) mpf_mix_accumulate(apr_int32_t *acc, const apr_int16_t *samples, apr_size_t count)
+{
+	apr_size_t i = 0;
+#if defined(ENABLE_AVX2_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i)));
+		__m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+		_mm256_storeu_si256((__m256i*)(acc + i),_mm256_add_epi32(a,x));
+	}
+#elif defined(ENABLE_SSE2_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+		/* sign extend 16-bit samples to 32-bit ones */
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x,x),16);
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(acc + i));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+		_mm_storeu_si128((__m128i*)(acc + i),_mm_add_epi32(a0,lo));
+		_mm_storeu_si128((__m128i*)(acc + i + 4),_mm_add_epi32(a1,hi));
+	}
+#elif defined(ENABLE_NEON_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		int16x8_t x = vld1q_s16(samples + i);
+		vst1q_s32(acc + i,vaddq_s32(vld1q_s32(acc + i),vmovl_s16(vget_low_s16(x))));
+		vst1q_s32(acc + i + 4,vaddq_s32(vld1q_s32(acc + i + 4),vmovl_s16(vget_high_s16(x))));
 	}
+#endif
+	for(; i < count; i++) {
+		acc[i] += samples[i];
+	}
+}
 
-	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
-		for(i=0; i<samples; i++) {
-			/* overflow MUST be considered */
-			mix_buf[i] = mix_buf[i] + buf[i];
-		}
-		mix_frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+MPF_DECLARE(void) mpf_mix_saturate(apr_int16_t *mix, const apr_int32_t *acc, apr_size_t count)
+{
+	apr_size_t i = 0;
+#if defined(ENABLE_AVX2_MIXER)
+	for(; i + 16 <= count; i += 16) {
+		__m256i a0 = _mm256_loadu_si256((const __m256i*)(acc + i));
+		__m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + i + 8));
+		/* pack works per 128-bit lane, restore the order of 64-bit quarters */
+		__m256i x = _mm256_permute4x64_epi64(_mm256_packs_epi32(a0,a1),0xD8);
+		_mm256_storeu_si256((__m256i*)(mix + i),x);
 	}
+#elif defined(ENABLE_SSE2_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(acc + i));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+		_mm_storeu_si128((__m128i*)(mix + i),_mm_packs_epi32(a0,a1));
+	}
+#elif defined(ENABLE_NEON_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		int16x4_t lo = vqmovn_s32(vld1q_s32(acc + i));
+		int16x4_t hi = vqmovn_s32(vld1q_s32(acc + i + 4));
+		vst1q_s16(mix + i,vcombine_s16(lo,hi));
+	}
+#endif
+	for(; i < count; i++) {
+		mix[i] = mpf_sample_saturate(acc[i]);
+	}
+}
 
-	return TRUE;
+MPF_DECLARE(void) mpf_mix_minus_saturate(apr_int16_t *mix, const apr_int32_t *acc, const apr_int16_t *samples, apr_size_t count)
+{
+	apr_size_t i = 0;
+#if defined(ENABLE_AVX2_MIXER)
+	for(; i + 16 <= count; i += 16) {
+		__m256i x0 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i)));
+		__m256i x1 = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i + 8)));
+		__m256i a0 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(acc + i)),x0);
+		__m256i a1 = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(acc + i + 8)),x1);
+		__m256i x = _mm256_permute4x64_epi64(_mm256_packs_epi32(a0,a1),0xD8);
+		_mm256_storeu_si256((__m256i*)(mix + i),x);
+	}
+#elif defined(ENABLE_SSE2_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x,x),16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x,x),16);
+		__m128i a0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(acc + i)),lo);
+		__m128i a1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(acc + i + 4)),hi);
+		_mm_storeu_si128((__m128i*)(mix + i),_mm_packs_epi32(a0,a1));
+	}
+#elif defined(ENABLE_NEON_MIXER)
+	for(; i + 8 <= count; i += 8) {
+		int16x8_t x = vld1q_s16(samples + i);
+		int32x4_t a0 = vsubq_s32(vld1q_s32(acc + i),vmovl_s16(vget_low_s16(x)));
+		int32x4_t a1 = vsubq_s32(vld1q_s32(acc + i + 4),vmovl_s16(vget_high_s16(x)));
+		vst1q_s16(mix + i,vcombine_s16(vqmovn_s32(a0),vqmovn_s32(a1)));
+	}
+#endif
+	for(; i < count; i++) {
+		mix[i] = mpf_sample_saturate(acc[i] - samples[i]);
+	}
 }
 
 static apt_bool_t mpf_mixer_process(mpf_object_t *object)
@@ -67,19 +186,25 @@ static apt_bool_t mpf_mixer_process(mpf_object_t *object)
 	apr_size_t i;
 	mpf_audio_stream_t *source;
 	mpf_mixer_t *mixer = (mpf_mixer_t*) object;
+	apr_size_t samples = mixer->mix_frame.codec_frame.size / sizeof(apr_int16_t);
 
 	mixer->mix_frame.type = MEDIA_FRAME_TYPE_NONE;
 	mixer->mix_frame.marker = MPF_MARKER_NONE;
-	memset(mixer->mix_frame.codec_frame.buffer,0,mixer->mix_frame.codec_frame.size);
+	memset(mixer->acc,0,samples * sizeof(apr_int32_t));
 	for(i=0; i<mixer->source_count; i++) {
 		source = mixer->source_arr[i];
 		if(source) {
 			mixer->frame.type = MEDIA_FRAME_TYPE_NONE;
 			mixer->frame.marker = MPF_MARKER_NONE;
 			source->vtable->read_frame(source,&mixer->frame);
-			mpf_frames_mix(&mixer->mix_frame,&mixer->frame);
+			if((mixer->frame.type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO &&
+				mixer->frame.codec_frame.size == mixer->mix_frame.codec_frame.size) {
+				mpf_mix_accumulate(mixer->acc,mixer->frame.codec_frame.buffer,samples);
+				mixer->mix_frame.type |= MEDIA_FRAME_TYPE_AUDIO;
+			}
 		}
 	}
+	mpf_mix_saturate(mixer->mix_frame.codec_frame.buffer,mixer->acc,samples);
 	mixer->sink->vtable->write_frame(mixer->sink,&mixer->mix_frame);
 	return TRUE;
 }
@@ -192,6 +317,16 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 				source = decoder;
 			}
 		}
+		if(source->rx_descriptor && sink->tx_descriptor &&
+			source->rx_descriptor->sampling_rate != sink->tx_descriptor->sampling_rate) {
+			/* set resampler before mixer */
+			mpf_audio_stream_t *resampler = mpf_resampler_create(source,sink,pool);
+			if(!resampler) {
+				source_arr[i] = NULL;
+				continue;
+			}
+			source = resampler;
+		}
 		source_arr[i] = source;
 		mpf_audio_stream_rx_open(source,NULL);
 	}
@@ -204,5 +339,216 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 	mixer->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
 	mixer->mix_frame.codec_frame.size = frame_size;
 	mixer->mix_frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	mixer->acc = apr_palloc(pool,frame_size / sizeof(apr_int16_t) * sizeof(apr_int32_t));
 	return &mixer->base;
 }
+
+static apt_bool_t mpf_mix_minus_process(mpf_object_t *object)
+{
+	apr_size_t i;
+	apr_size_t audio_count = 0;
+	mpf_audio_stream_t *source;
+	mpf_audio_stream_t *sink;
+	mpf_frame_t *frame;
+	mpf_mix_minus_t *mix_minus = (mpf_mix_minus_t*) object;
+	apr_size_t frame_size = mix_minus->mix_frame.codec_frame.size;
+	apr_size_t samples = frame_size / sizeof(apr_int16_t);
+
+	/* read all the sources and accumulate them in one pass */
+	memset(mix_minus->acc,0,samples * sizeof(apr_int32_t));
+	for(i=0; i<mix_minus->count; i++) {
+		frame = &mix_minus->frame_arr[i];
+		frame->type = MEDIA_FRAME_TYPE_NONE;
+		frame->marker = MPF_MARKER_NONE;
+		source = mix_minus->source_arr[i];
+		if(!source) continue;
+
+		source->vtable->read_frame(source,frame);
+		if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO &&
+			frame->codec_frame.size == frame_size) {
+			mpf_mix_accumulate(mix_minus->acc,frame->codec_frame.buffer,samples);
+			audio_count++;
+		}
+		else {
+			frame->type &= ~MEDIA_FRAME_TYPE_AUDIO;
+		}
+	}
+
+	/* send to each sink the mix of the other sources */
+	for(i=0; i<mix_minus->count; i++) {
+		sink = mix_minus->sink_arr[i];
+		if(!sink) continue;
+
+		frame = &mix_minus->frame_arr[i];
+		mix_minus->mix_frame.type = MEDIA_FRAME_TYPE_NONE;
+		mix_minus->mix_frame.marker = MPF_MARKER_NONE;
+		if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
+			if(audio_count > 1) {
+				mpf_mix_minus_saturate(mix_minus->mix_frame.codec_frame.buffer,mix_minus->acc,frame->codec_frame.buffer,samples);
+				mix_minus->mix_frame.type |= MEDIA_FRAME_TYPE_AUDIO;
+			}
+			else {
+				memset(mix_minus->mix_frame.codec_frame.buffer,0,frame_size);
+			}
+		}
+		else {
+			mpf_mix_saturate(mix_minus->mix_frame.codec_frame.buffer,mix_minus->acc,samples);
+			if(audio_count) {
+				mix_minus->mix_frame.type |= MEDIA_FRAME_TYPE_AUDIO;
+			}
+		}
+		sink->vtable->write_frame(sink,&mix_minus->mix_frame);
+	}
+	return TRUE;
+}
+
+static apt_bool_t mpf_mix_minus_destroy(mpf_object_t *object)
+{
+	apr_size_t i;
+	mpf_mix_minus_t *mix_minus = (mpf_mix_minus_t*) object;
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Destroy Mix-Minus %s",object->name);
+	for(i=0; i<mix_minus->count; i++)	{
+		if(mix_minus->source_arr[i]) {
+			mpf_audio_stream_rx_close(mix_minus->source_arr[i]);
+		}
+		if(mix_minus->sink_arr[i]) {
+			mpf_audio_stream_tx_close(mix_minus->sink_arr[i]);
+		}
+	}
+	return TRUE;
+}
+
+static void mpf_mix_minus_trace(mpf_object_t *object)
+{
+	mpf_mix_minus_t *mix_minus = (mpf_mix_minus_t*) object;
+	apr_size_t i;
+	char buf[2048];
+	apr_size_t offset;
+
+	apt_text_stream_t output;
+	apt_text_stream_init(&output,buf,sizeof(buf)-1);
+
+	for(i=0; i<mix_minus->count; i++)	{
+		if(mix_minus->source_arr[i]) {
+			mpf_audio_stream_trace(mix_minus->source_arr[i],STREAM_DIRECTION_RECEIVE,&output);
+			apt_text_char_insert(&output,';');
+		}
+	}
+
+	offset = output.pos - output.text.buf;
+	output.pos += apr_snprintf(output.pos, output.text.length - offset,
+		"->Mix-Minus->");
+
+	for(i=0; i<mix_minus->count; i++)	{
+		if(mix_minus->sink_arr[i]) {
+			mpf_audio_stream_trace(mix_minus->sink_arr[i],STREAM_DIRECTION_SEND,&output);
+			apt_text_char_insert(&output,';');
+		}
+	}
+
+	*output.pos = '\0';
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Media Path %s %s",
+		object->name,
+		output.text.buf);
+}
+
+MPF_DECLARE(mpf_object_t*) mpf_mix_minus_create(
+								mpf_audio_stream_t **stream_arr,
+								apr_size_t stream_count,
+								const mpf_codec_manager_t *codec_manager,
+								const char *name,
+								apr_pool_t *pool)
+{
+	apr_size_t i;
+	apr_size_t frame_size;
+	apr_uint16_t sampling_rate = 0;
+	mpf_codec_descriptor_t *descriptor;
+	mpf_audio_stream_t *stream;
+	mpf_audio_stream_t *source;
+	mpf_audio_stream_t *sink;
+	mpf_mix_minus_t *mix_minus;
+	if(!stream_arr || stream_count < 2) {
+		return NULL;
+	}
+
+	/* all the sinks are fed from the same accumulator, check their rates match */
+	for(i=0; i<stream_count; i++) {
+		stream = stream_arr[i];
+		if(!stream || mpf_audio_stream_tx_validate(stream,NULL,NULL,pool) == FALSE || !stream->tx_descriptor) {
+			return NULL;
+		}
+		if(!sampling_rate) {
+			sampling_rate = stream->tx_descriptor->sampling_rate;
+		}
+		else if(stream->tx_descriptor->sampling_rate != sampling_rate) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Cannot Create Mix-Minus %s: Sampling Rate Mismatch",name);
+			return NULL;
+		}
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Create Mix-Minus %s",name);
+	mix_minus = apr_palloc(pool,sizeof(mpf_mix_minus_t));
+	mix_minus->source_arr = apr_palloc(pool,stream_count * sizeof(mpf_audio_stream_t*));
+	mix_minus->sink_arr = apr_palloc(pool,stream_count * sizeof(mpf_audio_stream_t*));
+	mix_minus->frame_arr = apr_palloc(pool,stream_count * sizeof(mpf_frame_t));
+	mix_minus->count = stream_count;
+	mpf_object_init(&mix_minus->base,name);
+	mix_minus->base.process = mpf_mix_minus_process;
+	mix_minus->base.destroy = mpf_mix_minus_destroy;
+	mix_minus->base.trace = mpf_mix_minus_trace;
+
+	frame_size = 0;
+	for(i=0; i<stream_count; i++)	{
+		stream = stream_arr[i];
+
+		sink = stream;
+		descriptor = sink->tx_descriptor;
+		if(mpf_codec_lpcm_descriptor_match(descriptor) == FALSE) {
+			mpf_codec_t *codec = mpf_codec_manager_codec_get(codec_manager,descriptor,pool);
+			if(codec) {
+				/* set encoder after mix-minus */
+				sink = mpf_encoder_create(sink,codec,pool);
+			}
+		}
+		mix_minus->sink_arr[i] = sink;
+		mpf_audio_stream_tx_open(sink,NULL);
+		if(!frame_size) {
+			frame_size = mpf_codec_linear_frame_size_calculate(sink->tx_descriptor->sampling_rate,sink->tx_descriptor->channel_count);
+		}
+
+		source = stream;
+		mix_minus->source_arr[i] = NULL;
+		if(mpf_audio_stream_rx_validate(source,NULL,NULL,pool) == FALSE) {
+			continue;
+		}
+
+		descriptor = source->rx_descriptor;
+		if(descriptor && mpf_codec_lpcm_descriptor_match(descriptor) == FALSE) {
+			mpf_codec_t *codec = mpf_codec_manager_codec_get(codec_manager,descriptor,pool);
+			if(codec) {
+				/* set decoder before mix-minus */
+				source = mpf_decoder_create(source,codec,pool);
+			}
+		}
+		if(source->rx_descriptor && source->rx_descriptor->sampling_rate != sink->tx_descriptor->sampling_rate) {
+			/* set resampler before mix-minus */
+			mpf_audio_stream_t *resampler = mpf_resampler_create(source,sink,pool);
+			if(!resampler) {
+				continue;
+			}
+			source = resampler;
+		}
+		mix_minus->source_arr[i] = source;
+		mpf_audio_stream_rx_open(source,NULL);
+	}
+
+	for(i=0; i<stream_count; i++)	{
+		mix_minus->frame_arr[i].codec_frame.size = frame_size;
+		mix_minus->frame_arr[i].codec_frame.buffer = apr_palloc(pool,frame_size);
+	}
+	mix_minus->mix_frame.codec_frame.size = frame_size;
+	mix_minus->mix_frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	mix_minus->acc = apr_palloc(pool,frame_size / sizeof(apr_int16_t) * sizeof(apr_int32_t));
+	return &mix_minus->base;
+}
@@ -14,13 +14,312 @@
  * limitations under the License.
  */
 
+#include <math.h>
 #include "mpf_resampler.h"
+#include "mpf_codec_descriptor.h"
 #include "apt_log.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define ENABLE_SSE_RESAMPLER
+#include <xmmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Number of filter taps per phase at the lowest of the input and output rates (multiple of 4) */
+#define RESAMPLER_TAPS_PER_PHASE  16
+/** Passband edge relative to the lower Nyquist frequency */
+#define RESAMPLER_PASSBAND        0.9
+/** Kaiser window beta (stopband attenuation of about 80 dB) */
+#define RESAMPLER_KAISER_BETA     8.0
+
+typedef struct mpf_resampler_t mpf_resampler_t;
+
+/** Polyphase resampler of linear PCM (mono) */
+struct mpf_resampler_t {
+	mpf_audio_stream_t *base;
+	mpf_audio_stream_t *source;
+	mpf_frame_t         frame_in;
+
+	/** Upsampling factor */
+	apr_size_t          up;
+	/** Downsampling factor */
+	apr_size_t          down;
+	/** Number of filter taps per phase */
+	apr_size_t          taps;
+	/** Filter coefficients [up][taps], reversed within a phase */
+	float              *coefs;
+
+	/** Number of input samples per frame */
+	apr_size_t          samples_in;
+	/** Number of output samples per frame */
+	apr_size_t          samples_out;
+	/** History (taps-1 samples) followed by the current input frame */
+	float              *buffer;
+};
+
+static apr_size_t gcd_calculate(apr_size_t a, apr_size_t b)
+{
+	apr_size_t t;
+	while(b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/** Zero-order modified Bessel function of the first kind */
+static double bessel_i0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	double k;
+	for(k = 1.0; k < 50.0; k += 1.0) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if(term < sum * 1e-12) {
+			break;
+		}
+	}
+	return sum;
+}
+
+/** Design Kaiser windowed sinc lowpass filter and split it into polyphase components */
+static void mpf_resampler_filter_design(mpf_resampler_t *resampler)
+{
+	apr_size_t phase;
+	apr_size_t tap;
+	apr_size_t length = resampler->up * resampler->taps;
+	double center = (length - 1) / 2.0;
+	double cutoff = RESAMPLER_PASSBAND * 0.5 / (resampler->up > resampler->down ? resampler->up : resampler->down);
+	double norm = bessel_i0(RESAMPLER_KAISER_BETA);
+	double x;
+	double r;
+	double h;
+	apr_size_t n;
+
+	for(phase = 0; phase < resampler->up; phase++) {
+		for(tap = 0; tap < resampler->taps; tap++) {
+			n = phase + tap * resampler->up;
+			x = n - center;
+			if(fabs(x) < 1e-9) {
+				h = 2.0 * cutoff;
+			}
+			else {
+				h = sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+			}
+			r = x / center;
+			h *= bessel_i0(RESAMPLER_KAISER_BETA * sqrt(1.0 - r * r)) / norm;
+			/* compensate for the zeros inserted by upsampling */
+			h *= resampler->up;
+			resampler->coefs[phase * resampler->taps + (resampler->taps - 1 - tap)] = (float)h;
+		}
+	}
+}
+
+/** Calculate dot product of the coefficients of a phase and the input samples */
+static APR_INLINE float mpf_resampler_dot_product(const float *coefs, const float *samples, apr_size_t taps)
+{
+#ifdef ENABLE_SSE_RESAMPLER
+	apr_size_t i;
+	float result[4];
+	__m128 sum = _mm_setzero_ps();
+	for(i = 0; i < taps; i += 4) {
+		sum = _mm_add_ps(sum,_mm_mul_ps(_mm_loadu_ps(coefs + i),_mm_loadu_ps(samples + i)));
+	}
+	_mm_storeu_ps(result,sum);
+	return result[0] + result[1] + result[2] + result[3];
+#else
+	apr_size_t i;
+	float sum0 = 0;
+	float sum1 = 0;
+	float sum2 = 0;
+	float sum3 = 0;
+	for(i = 0; i < taps; i += 4) {
+		sum0 += coefs[i] * samples[i];
+		sum1 += coefs[i+1] * samples[i+1];
+		sum2 += coefs[i+2] * samples[i+2];
+		sum3 += coefs[i+3] * samples[i+3];
+	}
+	return sum0 + sum1 + sum2 + sum3;
+#endif
+}
+
+/** Resample a frame of linear samples */
+static void mpf_resampler_frame_process(mpf_resampler_t *resampler, const apr_int16_t *in, apr_int16_t *out)
+{
+	apr_size_t i;
+	apr_size_t k;
+	apr_size_t t;
+	apr_size_t history = resampler->taps - 1;
+	float *samples = resampler->buffer + history;
+	float y;
+
+	for(i = 0; i < resampler->samples_in; i++) {
+		samples[i] = in[i];
+	}
+
+	/* output sample k is located at input position k*down/up, the remainder selects the phase */
+	for(k = 0, t = 0; k < resampler->samples_out; k++, t += resampler->down) {
+		y = mpf_resampler_dot_product(
+				resampler->coefs + (t % resampler->up) * resampler->taps,
+				resampler->buffer + t / resampler->up,
+				resampler->taps);
+		if(y > 32767.0f) {
+			out[k] = 32767;
+		}
+		else if(y < -32768.0f) {
+			out[k] = -32768;
+		}
+		else {
+			out[k] = (apr_int16_t)(y >= 0 ? y + 0.5f : y - 0.5f);
+		}
+	}
+
+	/* keep the tail of the input as history for the next frame */
+	memmove(resampler->buffer,resampler->buffer + resampler->samples_in,history * sizeof(float));
+}
+
+static apt_bool_t mpf_resampler_destroy(mpf_audio_stream_t *stream)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	return mpf_audio_stream_destroy(resampler->source);
+}
+
+static apt_bool_t mpf_resampler_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	memset(resampler->buffer,0,(resampler->taps - 1 + resampler->samples_in) * sizeof(float));
+	return mpf_audio_stream_rx_open(resampler->source,NULL);
+}
+
+static apt_bool_t mpf_resampler_close(mpf_audio_stream_t *stream)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	return mpf_audio_stream_rx_close(resampler->source);
+}
+
+static apt_bool_t mpf_resampler_process(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	resampler->frame_in.type = MEDIA_FRAME_TYPE_NONE;
+	resampler->frame_in.marker = MPF_MARKER_NONE;
+	if(mpf_audio_stream_frame_read(resampler->source,&resampler->frame_in) != TRUE) {
+		return FALSE;
+	}
+
+	frame->type = resampler->frame_in.type;
+	frame->marker = resampler->frame_in.marker;
+	if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
+		frame->event_frame = resampler->frame_in.event_frame;
+	}
+	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
+		mpf_resampler_frame_process(resampler,resampler->frame_in.codec_frame.buffer,frame->codec_frame.buffer);
+		frame->codec_frame.size = resampler->samples_out * sizeof(apr_int16_t);
+	}
+	else {
+		/* restart from silence after a gap */
+		memset(resampler->buffer,0,(resampler->taps - 1) * sizeof(float));
+	}
+	return TRUE;
+}
+
+static void mpf_resampler_trace(mpf_audio_stream_t *stream, mpf_stream_direction_e direction, apt_text_stream_t *output)
+{
+	apr_size_t offset;
+	mpf_codec_descriptor_t *descriptor;
+	mpf_resampler_t *resampler = stream->obj;
+
+	mpf_audio_stream_trace(resampler->source,direction,output);
+
+	descriptor = resampler->base->rx_descriptor;
+	if(descriptor) {
+		offset = output->pos - output->text.buf;
+		output->pos += apr_snprintf(output->pos, output->text.length - offset,
+			"->Resampler->[%s/%d/%d]",
+			descriptor->name.buf,
+			descriptor->sampling_rate,
+			descriptor->channel_count);
+	}
+}
+
+static const mpf_audio_stream_vtable_t vtable = {
+	mpf_resampler_destroy,
+	mpf_resampler_open,
+	mpf_resampler_close,
+	mpf_resampler_process,
+	NULL,
+	NULL,
+	NULL,
+	mpf_resampler_trace
+};
+
 MPF_DECLARE(mpf_audio_stream_t*) mpf_resampler_create(mpf_audio_stream_t *source, mpf_audio_stream_t *sink, apr_pool_t *pool)
 {
-	apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,
-		"Currently resampling is not supported. "
-		"Try to configure and use the same sampling rate on both ends");
-	return NULL;
+	apr_size_t rate_in;
+	apr_size_t rate_out;
+	apr_size_t gcd;
+	apr_size_t frame_size;
+	mpf_resampler_t *resampler;
+	mpf_stream_capabilities_t *capabilities;
+	if(!source || !sink || !source->rx_descriptor || !sink->tx_descriptor) {
+		return NULL;
+	}
+
+	if(mpf_codec_lpcm_descriptor_match(source->rx_descriptor) == FALSE) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: Linear PCM Input Required");
+		return NULL;
+	}
+	if(source->rx_descriptor->channel_count != 1) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: Only Mono Supported [%d channels]",
+			source->rx_descriptor->channel_count);
+		return NULL;
+	}
+
+	rate_in = source->rx_descriptor->sampling_rate;
+	rate_out = sink->tx_descriptor->sampling_rate;
+	if(!rate_in || !rate_out ||
+		rate_in * CODEC_FRAME_TIME_BASE % 1000 != 0 || rate_out * CODEC_FRAME_TIME_BASE % 1000 != 0) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: Unsupported Sampling Rate [%"APR_SIZE_T_FMT" -> %"APR_SIZE_T_FMT"]",
+			rate_in,rate_out);
+		return NULL;
+	}
+
+	resampler = apr_palloc(pool,sizeof(mpf_resampler_t));
+	capabilities = mpf_stream_capabilities_create(STREAM_DIRECTION_RECEIVE,pool);
+	resampler->base = mpf_audio_stream_create(resampler,&vtable,capabilities,pool);
+	if(!resampler->base) {
+		return NULL;
+	}
+	resampler->base->rx_descriptor = mpf_codec_lpcm_descriptor_create(
+		(apr_uint16_t)rate_out,
+		source->rx_descriptor->channel_count,
+		pool);
+	resampler->base->rx_event_descriptor = source->rx_event_descriptor;
+	resampler->source = source;
+
+	gcd = gcd_calculate(rate_in,rate_out);
+	resampler->up = rate_out / gcd;
+	resampler->down = rate_in / gcd;
+	/* the filter is as long in time as RESAMPLER_TAPS_PER_PHASE samples at the lower rate */
+	resampler->taps = RESAMPLER_TAPS_PER_PHASE * ((resampler->down + resampler->up - 1) / resampler->up);
+	resampler->coefs = apr_palloc(pool,resampler->up * resampler->taps * sizeof(float));
+	mpf_resampler_filter_design(resampler);
+
+	resampler->samples_in = rate_in * CODEC_FRAME_TIME_BASE / 1000;
+	resampler->samples_out = rate_out * CODEC_FRAME_TIME_BASE / 1000;
+	resampler->buffer = apr_pcalloc(pool,(resampler->taps - 1 + resampler->samples_in) * sizeof(float));
+
+	frame_size = mpf_codec_linear_frame_size_calculate(
+		source->rx_descriptor->sampling_rate,
+		source->rx_descriptor->channel_count);
+	resampler->frame_in.codec_frame.size = frame_size;
+	resampler->frame_in.codec_frame.buffer = apr_palloc(pool,frame_size);
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Create Resampler [%"APR_SIZE_T_FMT" -> %"APR_SIZE_T_FMT"] up [%"APR_SIZE_T_FMT"] down [%"APR_SIZE_T_FMT"] taps [%"APR_SIZE_T_FMT"]",
+		rate_in,rate_out,resampler->up,resampler->down,resampler->taps);
+	return resampler->base;
 }
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_hash.h>
+#include <apr_ring.h>
+#include "mpf_rtp_demux.h"
+#include "apt_log.h"
+
+/** Size of RTP fixed header */
+#define RTP_FIXED_HEADER_SIZE  12
+/** Offset of SSRC in RTP header */
+#define RTP_SSRC_OFFSET        8
+/** Offset of sender SSRC in RTCP header */
+#define RTCP_SSRC_OFFSET       4
+
+/** RTP demultiplexer entry */
+struct mpf_rtp_demux_entry_t {
+	/** Ring entry (sessions waiting for the first packet) */
+	APR_RING_ENTRY(mpf_rtp_demux_entry_t) link;
+
+	/** Remote RTP address key (signaled, then latched) */
+	apr_uint64_t            rtp_key;
+	/** Remote RTCP address key */
+	apr_uint64_t            rtcp_key;
+	/** Remote IP address (signaled, then latched) */
+	apr_uint32_t            remote_ip;
+	/** Whether the remote address has been latched by the first packet */
+	apt_bool_t              latched;
+	/** Learnt remote SSRC (network byte order) */
+	apr_uint32_t            ssrc;
+	/** Whether SSRC has been learnt */
+	apt_bool_t              ssrc_learnt;
+
+	mpf_rtp_io_rx_handler_f rtp_handler;
+	mpf_rtp_io_rx_handler_f rtcp_handler;
+	void                   *obj;
+};
+
+/** RTP demultiplexer */
+struct mpf_rtp_demux_t {
+	apr_pool_t          *pool;
+
+	apr_socket_t        *rtp_socket;
+	apr_socket_t        *rtcp_socket;
+	apr_sockaddr_t      *rtp_l_sockaddr;
+	apr_sockaddr_t      *rtcp_l_sockaddr;
+
+	/** Table of sessions by remote RTP address */
+	apr_hash_t          *rtp_table;
+	/** Table of sessions by remote RTCP address */
+	apr_hash_t          *rtcp_table;
+	/** Table of sessions by remote SSRC */
+	apr_hash_t          *ssrc_table;
+	/** Sessions waiting for the first packet to latch the remote address */
+	APR_RING_HEAD(mpf_rtp_demux_entry_head_t, mpf_rtp_demux_entry_t) unlatched;
+};
+
+static void mpf_rtp_demux_rtp_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port);
+static void mpf_rtp_demux_rtcp_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port);
+
+static APR_INLINE apr_uint64_t mpf_rtp_demux_key_make(apr_uint32_t ip, apr_port_t port)
+{
+	return ((apr_uint64_t)ip << 16) | port;
+}
+
+static APR_INLINE apr_uint32_t mpf_rtp_demux_ssrc_read(const void *buffer, apr_size_t offset)
+{
+	apr_uint32_t ssrc;
+	memcpy(&ssrc,(const char*)buffer + offset,sizeof(ssrc));
+	return ssrc;
+}
+
+/** Map the key to the entry, the key must be stored in the entry */
+static APR_INLINE void mpf_rtp_demux_table_set(apr_hash_t *table, const void *key, apr_ssize_t klen, mpf_rtp_demux_entry_t *entry)
+{
+	/* remove the existing mapping first, so that the table never refers to the key stored in another entry */
+	apr_hash_set(table,key,klen,NULL);
+	apr_hash_set(table,key,klen,entry);
+}
+
+/** Unmap the key, if it's still mapped to the entry */
+static APR_INLINE void mpf_rtp_demux_table_unset(apr_hash_t *table, const void *key, apr_ssize_t klen, mpf_rtp_demux_entry_t *entry)
+{
+	if(apr_hash_get(table,key,klen) == entry) {
+		apr_hash_set(table,key,klen,NULL);
+	}
+}
+
+static apt_bool_t mpf_rtp_demux_socket_create(apr_socket_t **socket, apr_sockaddr_t **l_sockaddr, const char *ip, apr_port_t port, apr_pool_t *pool)
+{
+	*socket = NULL;
+	*l_sockaddr = NULL;
+	apr_sockaddr_info_get(l_sockaddr,ip,APR_INET,port,0,pool);
+	if(!*l_sockaddr) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Sockaddr %s:%hu",ip,port);
+		return FALSE;
+	}
+
+	if(apr_socket_create(socket,APR_INET,SOCK_DGRAM,0,pool) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Socket");
+		*socket = NULL;
+		return FALSE;
+	}
+	apr_socket_opt_set(*socket,APR_SO_NONBLOCK,1);
+	apr_socket_timeout_set(*socket,0);
+
+	if(apr_socket_bind(*socket,*l_sockaddr) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind Socket to %s:%hu",ip,port);
+		apr_socket_close(*socket);
+		*socket = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+MPF_DECLARE(mpf_rtp_demux_t*) mpf_rtp_demux_create(mpf_rtp_io_t *io, const char *ip, apr_port_t port, apr_pool_t *pool)
+{
+	mpf_rtp_demux_t *demux;
+	if(!io || !ip) {
+		return NULL;
+	}
+
+	demux = apr_palloc(pool,sizeof(mpf_rtp_demux_t));
+	/* the tables are updated from the thread of the media engine only, use a dedicated pool */
+	if(apr_pool_create(&demux->pool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	demux->rtp_table = apr_hash_make(demux->pool);
+	demux->rtcp_table = apr_hash_make(demux->pool);
+	demux->ssrc_table = apr_hash_make(demux->pool);
+	APR_RING_INIT(&demux->unlatched, mpf_rtp_demux_entry_t, link);
+
+	if(mpf_rtp_demux_socket_create(&demux->rtp_socket,&demux->rtp_l_sockaddr,ip,port,pool) == FALSE) {
+		return NULL;
+	}
+	if(mpf_rtp_demux_socket_create(&demux->rtcp_socket,&demux->rtcp_l_sockaddr,ip,port+1,pool) == FALSE) {
+		apr_socket_close(demux->rtp_socket);
+		return NULL;
+	}
+
+	if(!mpf_rtp_io_socket_add(io,demux->rtp_socket,mpf_rtp_demux_rtp_handler,demux,pool) ||
+		!mpf_rtp_io_socket_add(io,demux->rtcp_socket,mpf_rtp_demux_rtcp_handler,demux,pool)) {
+		apr_socket_close(demux->rtp_socket);
+		apr_socket_close(demux->rtcp_socket);
+		return NULL;
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Create RTP Demultiplexer %s:%hu",ip,port);
+	return demux;
+}
+
+MPF_DECLARE(apr_socket_t*) mpf_rtp_demux_rtp_socket_get(const mpf_rtp_demux_t *demux)
+{
+	return demux->rtp_socket;
+}
+
+MPF_DECLARE(apr_socket_t*) mpf_rtp_demux_rtcp_socket_get(const mpf_rtp_demux_t *demux)
+{
+	return demux->rtcp_socket;
+}
+
+MPF_DECLARE(apr_sockaddr_t*) mpf_rtp_demux_rtp_sockaddr_get(const mpf_rtp_demux_t *demux)
+{
+	return demux->rtp_l_sockaddr;
+}
+
+MPF_DECLARE(apr_sockaddr_t*) mpf_rtp_demux_rtcp_sockaddr_get(const mpf_rtp_demux_t *demux)
+{
+	return demux->rtcp_l_sockaddr;
+}
+
+MPF_DECLARE(mpf_rtp_demux_entry_t*) mpf_rtp_demux_session_add(
+										mpf_rtp_demux_t *demux,
+										const apr_sockaddr_t *rtp_r_sockaddr,
+										const apr_sockaddr_t *rtcp_r_sockaddr,
+										mpf_rtp_io_rx_handler_f rtp_handler,
+										mpf_rtp_io_rx_handler_f rtcp_handler,
+										void *obj,
+										apr_pool_t *pool)
+{
+	mpf_rtp_demux_entry_t *entry;
+	if(!rtp_r_sockaddr || !rtp_handler) {
+		return NULL;
+	}
+	if(rtp_r_sockaddr->family != APR_INET) {
+		/* the shared sockets are IPv4 ones */
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Add RTP Session %s:%hu: not IPv4 address",
+			rtp_r_sockaddr->hostname,
+			rtp_r_sockaddr->port);
+		return NULL;
+	}
+
+	entry = apr_palloc(pool,sizeof(mpf_rtp_demux_entry_t));
+	entry->rtp_key = mpf_rtp_demux_key_make(rtp_r_sockaddr->sa.sin.sin_addr.s_addr,rtp_r_sockaddr->port);
+	entry->remote_ip = rtp_r_sockaddr->sa.sin.sin_addr.s_addr;
+	entry->latched = FALSE;
+	entry->rtcp_key = 0;
+	entry->ssrc = 0;
+	entry->ssrc_learnt = FALSE;
+	entry->rtp_handler = rtp_handler;
+	entry->rtcp_handler = rtcp_handler;
+	entry->obj = obj;
+
+	mpf_rtp_demux_table_set(demux->rtp_table,&entry->rtp_key,sizeof(entry->rtp_key),entry);
+	APR_RING_INSERT_TAIL(&demux->unlatched,entry,mpf_rtp_demux_entry_t,link);
+	if(rtcp_r_sockaddr && rtcp_r_sockaddr->family == APR_INET && rtcp_handler) {
+		entry->rtcp_key = mpf_rtp_demux_key_make(rtcp_r_sockaddr->sa.sin.sin_addr.s_addr,rtcp_r_sockaddr->port);
+		mpf_rtp_demux_table_set(demux->rtcp_table,&entry->rtcp_key,sizeof(entry->rtcp_key),entry);
+	}
+	return entry;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_demux_session_remove(mpf_rtp_demux_t *demux, mpf_rtp_demux_entry_t *entry)
+{
+	if(!entry) {
+		return FALSE;
+	}
+
+	mpf_rtp_demux_table_unset(demux->rtp_table,&entry->rtp_key,sizeof(entry->rtp_key),entry);
+	if(entry->latched == FALSE) {
+		APR_RING_REMOVE(entry,link);
+	}
+	if(entry->rtcp_key) {
+		mpf_rtp_demux_table_unset(demux->rtcp_table,&entry->rtcp_key,sizeof(entry->rtcp_key),entry);
+	}
+	if(entry->ssrc_learnt == TRUE) {
+		mpf_rtp_demux_table_unset(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),entry);
+	}
+	return TRUE;
+}
+
+/** Latch the remote RTP address of the session to the source of a received packet */
+static void mpf_rtp_demux_latch(mpf_rtp_demux_t *demux, mpf_rtp_demux_entry_t *entry, apr_uint64_t key, apr_uint32_t remote_ip)
+{
+	if(entry->rtp_key != key) {
+		mpf_rtp_demux_table_unset(demux->rtp_table,&entry->rtp_key,sizeof(entry->rtp_key),entry);
+		entry->rtp_key = key;
+		mpf_rtp_demux_table_set(demux->rtp_table,&entry->rtp_key,sizeof(entry->rtp_key),entry);
+	}
+	if(entry->latched == FALSE) {
+		APR_RING_REMOVE(entry,link);
+		entry->latched = TRUE;
+	}
+	entry->remote_ip = remote_ip;
+}
+
+/** Find the session to latch by the packet from an unclaimed port (symmetric RTP) */
+static mpf_rtp_demux_entry_t* mpf_rtp_demux_unlatched_find(mpf_rtp_demux_t *demux, apr_uint32_t remote_ip)
+{
+	mpf_rtp_demux_entry_t *entry;
+	/* only a session signaled with the same IP address is latched (behind NAT, the port differs),
+	so that a packet from any other source never takes over a session */
+	for(entry = APR_RING_FIRST(&demux->unlatched);
+			entry != APR_RING_SENTINEL(&demux->unlatched, mpf_rtp_demux_entry_t, link);
+				entry = APR_RING_NEXT(entry, link)) {
+		if(entry->remote_ip == remote_ip) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void mpf_rtp_demux_rtp_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port)
+{
+	mpf_rtp_demux_t *demux = obj;
+	mpf_rtp_demux_entry_t *entry;
+	apr_uint64_t key;
+	apr_uint32_t ssrc;
+	if(size < RTP_FIXED_HEADER_SIZE) {
+		return;
+	}
+
+	ssrc = mpf_rtp_demux_ssrc_read(buffer,RTP_SSRC_OFFSET);
+	key = mpf_rtp_demux_key_make(remote_ip,remote_port);
+	entry = apr_hash_get(demux->rtp_table,&key,sizeof(key));
+	if(!entry) {
+		entry = apr_hash_get(demux->ssrc_table,&ssrc,sizeof(ssrc));
+		if(entry) {
+			/* the remote port changes (NAT rebinding), the known SSRC is accepted from the latched IP address only */
+			if(entry->remote_ip != remote_ip) {
+				return;
+			}
+		}
+		else {
+			/* the first packet of unknown SSRC from an unclaimed port of the signaled IP address latches a session */
+			entry = mpf_rtp_demux_unlatched_find(demux,remote_ip);
+			if(!entry) {
+				/* packet of unknown session */
+				return;
+			}
+		}
+	}
+	if(entry->latched == FALSE || entry->rtp_key != key) {
+		mpf_rtp_demux_latch(demux,entry,key,remote_ip);
+	}
+
+	if(entry->ssrc_learnt == FALSE || entry->ssrc != ssrc) {
+		/* learn SSRC to match the session, if the remote port changes */
+		if(entry->ssrc_learnt == TRUE) {
+			mpf_rtp_demux_table_unset(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),entry);
+		}
+		entry->ssrc = ssrc;
+		entry->ssrc_learnt = TRUE;
+		mpf_rtp_demux_table_set(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),entry);
+	}
+
+	entry->rtp_handler(entry->obj,buffer,size,remote_ip,remote_port);
+}
+
+static void mpf_rtp_demux_rtcp_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port)
+{
+	mpf_rtp_demux_t *demux = obj;
+	mpf_rtp_demux_entry_t *entry;
+	apr_uint64_t key = mpf_rtp_demux_key_make(remote_ip,remote_port);
+	apr_uint32_t ssrc;
+
+	entry = apr_hash_get(demux->rtcp_table,&key,sizeof(key));
+	if(!entry) {
+		if(size < RTCP_SSRC_OFFSET + sizeof(ssrc)) {
+			return;
+		}
+		ssrc = mpf_rtp_demux_ssrc_read(buffer,RTCP_SSRC_OFFSET);
+		entry = apr_hash_get(demux->ssrc_table,&ssrc,sizeof(ssrc));
+		/* the known SSRC is accepted from the latched IP address only */
+		if(!entry || !entry->rtcp_handler || entry->remote_ip != remote_ip) {
+			return;
+		}
+		/* latch the remote RTCP address */
+		if(entry->rtcp_key) {
+			mpf_rtp_demux_table_unset(demux->rtcp_table,&entry->rtcp_key,sizeof(entry->rtcp_key),entry);
+		}
+		entry->rtcp_key = key;
+		mpf_rtp_demux_table_set(demux->rtcp_table,&entry->rtcp_key,sizeof(entry->rtcp_key),entry);
+	}
+	if(!entry->rtcp_handler) {
+		return;
+	}
+
+	entry->rtcp_handler(entry->obj,buffer,size,remote_ip,remote_port);
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#define ENABLE_BATCHED_IO
+#endif
+
+#include "mpf_rtp_io.h"
+#include "apt_log.h"
+
+#ifdef ENABLE_BATCHED_IO
+#include <apr_portable.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <unistd.h>
+
+/** Max number of ready sockets processed per poll */
+#define RTP_IO_MAX_EVENTS     1024
+/** Max number of packets received from a socket by one system call */
+#define RTP_IO_RX_BATCH_SIZE  8
+/** Max number of packets queued for sending */
+#define RTP_IO_TX_QUEUE_SIZE  256
+/** Max size of RTP packet */
+#define RTP_IO_MAX_PACKET_SIZE 1500
+
+/** RTP I/O socket */
+struct mpf_rtp_io_socket_t {
+	int                     fd;
+	mpf_rtp_io_rx_handler_f handler;
+	void                   *obj;
+};
+
+/** RTP I/O */
+struct mpf_rtp_io_t {
+	int                 epoll_fd;
+	struct epoll_event *events;
+
+	struct mmsghdr     *rx_msgs;
+	struct iovec       *rx_iovs;
+	struct sockaddr_in *rx_addrs;
+	char               *rx_buffer;
+
+	struct mmsghdr     *tx_msgs;
+	struct iovec       *tx_iovs;
+	int                *tx_fds;
+	char               *tx_buffer;
+	apr_size_t          tx_count;
+
+	mpf_rtp_io_stat_t   stat;
+};
+
+MPF_DECLARE(mpf_rtp_io_t*) mpf_rtp_io_create(apr_pool_t *pool)
+{
+	apr_size_t i;
+	mpf_rtp_io_t *io = apr_palloc(pool,sizeof(mpf_rtp_io_t));
+	io->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(io->epoll_fd < 0) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Epoll Instance [%d]",errno);
+		return NULL;
+	}
+	io->events = apr_palloc(pool,sizeof(struct epoll_event) * RTP_IO_MAX_EVENTS);
+
+	io->rx_msgs = apr_pcalloc(pool,sizeof(struct mmsghdr) * RTP_IO_RX_BATCH_SIZE);
+	io->rx_iovs = apr_palloc(pool,sizeof(struct iovec) * RTP_IO_RX_BATCH_SIZE);
+	io->rx_addrs = apr_palloc(pool,sizeof(struct sockaddr_in) * RTP_IO_RX_BATCH_SIZE);
+	io->rx_buffer = apr_palloc(pool,RTP_IO_MAX_PACKET_SIZE * RTP_IO_RX_BATCH_SIZE);
+	for(i=0; i<RTP_IO_RX_BATCH_SIZE; i++) {
+		io->rx_iovs[i].iov_base = io->rx_buffer + i * RTP_IO_MAX_PACKET_SIZE;
+		io->rx_iovs[i].iov_len = RTP_IO_MAX_PACKET_SIZE;
+		io->rx_msgs[i].msg_hdr.msg_iov = &io->rx_iovs[i];
+		io->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	io->tx_msgs = apr_pcalloc(pool,sizeof(struct mmsghdr) * RTP_IO_TX_QUEUE_SIZE);
+	io->tx_iovs = apr_palloc(pool,sizeof(struct iovec) * RTP_IO_TX_QUEUE_SIZE);
+	io->tx_fds = apr_palloc(pool,sizeof(int) * RTP_IO_TX_QUEUE_SIZE);
+	io->tx_buffer = apr_palloc(pool,RTP_IO_MAX_PACKET_SIZE * RTP_IO_TX_QUEUE_SIZE);
+	for(i=0; i<RTP_IO_TX_QUEUE_SIZE; i++) {
+		io->tx_iovs[i].iov_base = io->tx_buffer + i * RTP_IO_MAX_PACKET_SIZE;
+		io->tx_iovs[i].iov_len = 0;
+		io->tx_msgs[i].msg_hdr.msg_iov = &io->tx_iovs[i];
+		io->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	io->tx_count = 0;
+
+	memset(&io->stat,0,sizeof(mpf_rtp_io_stat_t));
+	return io;
+}
+
+MPF_DECLARE(void) mpf_rtp_io_destroy(mpf_rtp_io_t *io)
+{
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"RTP I/O Stats polls [%u] rx [%u packets %u syscalls] tx [%u packets %u syscalls %u failures]",
+		io->stat.poll_count,
+		io->stat.rx_packets,
+		io->stat.rx_syscalls,
+		io->stat.tx_packets,
+		io->stat.tx_syscalls,
+		io->stat.tx_failures);
+	if(io->epoll_fd >= 0) {
+		close(io->epoll_fd);
+		io->epoll_fd = -1;
+	}
+}
+
+MPF_DECLARE(mpf_rtp_io_socket_t*) mpf_rtp_io_socket_add(
+									mpf_rtp_io_t *io,
+									apr_socket_t *socket,
+									mpf_rtp_io_rx_handler_f handler,
+									void *obj,
+									apr_pool_t *pool)
+{
+	struct epoll_event event;
+	apr_os_sock_t fd;
+	mpf_rtp_io_socket_t *io_socket;
+	if(!socket || apr_os_sock_get(&fd,socket) != APR_SUCCESS) {
+		return NULL;
+	}
+
+	io_socket = apr_palloc(pool,sizeof(mpf_rtp_io_socket_t));
+	io_socket->fd = fd;
+	io_socket->handler = handler;
+	io_socket->obj = obj;
+
+	event.events = EPOLLIN;
+	event.data.ptr = io_socket;
+	if(epoll_ctl(io->epoll_fd,EPOLL_CTL_ADD,fd,&event) != 0) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Socket to Epoll [%d]",errno);
+		return NULL;
+	}
+	return io_socket;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_socket_remove(mpf_rtp_io_t *io, mpf_rtp_io_socket_t *io_socket)
+{
+	struct epoll_event event;
+	if(!io_socket) {
+		return FALSE;
+	}
+	/* non-NULL event is required by kernels prior to 2.6.9 */
+	if(epoll_ctl(io->epoll_fd,EPOLL_CTL_DEL,io_socket->fd,&event) != 0) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_send(
+							mpf_rtp_io_t *io,
+							apr_socket_t *socket,
+							apr_sockaddr_t *sockaddr,
+							const void *data,
+							apr_size_t size)
+{
+	apr_os_sock_t fd;
+	struct msghdr *hdr;
+	if(!socket || !sockaddr || size > RTP_IO_MAX_PACKET_SIZE) {
+		return FALSE;
+	}
+	if(apr_os_sock_get(&fd,socket) != APR_SUCCESS) {
+		return FALSE;
+	}
+
+	if(io->tx_count == RTP_IO_TX_QUEUE_SIZE) {
+		mpf_rtp_io_flush(io);
+	}
+
+	hdr = &io->tx_msgs[io->tx_count].msg_hdr;
+	hdr->msg_name = &sockaddr->sa;
+	hdr->msg_namelen = sockaddr->salen;
+	memcpy(io->tx_iovs[io->tx_count].iov_base,data,size);
+	io->tx_iovs[io->tx_count].iov_len = size;
+	io->tx_fds[io->tx_count] = fd;
+	io->tx_count++;
+	return TRUE;
+}
+
+/** Drain the ready socket by batches of packets */
+static APR_INLINE void mpf_rtp_io_socket_drain(mpf_rtp_io_t *io, mpf_rtp_io_socket_t *io_socket)
+{
+	int i;
+	int count;
+	apr_size_t j;
+	for(j=0; j<RTP_IO_RX_BATCH_SIZE; j++) {
+		io->rx_msgs[j].msg_hdr.msg_name = &io->rx_addrs[j];
+		io->rx_msgs[j].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+
+	io->stat.rx_syscalls++;
+	count = recvmmsg(io_socket->fd,io->rx_msgs,RTP_IO_RX_BATCH_SIZE,MSG_DONTWAIT,NULL);
+	if(count <= 0) {
+		return;
+	}
+
+	io->stat.rx_packets += count;
+	for(i=0; i<count; i++) {
+		io_socket->handler(
+					io_socket->obj,
+					io->rx_iovs[i].iov_base,
+					io->rx_msgs[i].msg_len,
+					io->rx_addrs[i].sin_addr.s_addr,
+					ntohs(io->rx_addrs[i].sin_port));
+	}
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_receive(mpf_rtp_io_t *io)
+{
+	int i;
+	int count;
+
+	io->stat.poll_count++;
+	count = epoll_wait(io->epoll_fd,io->events,RTP_IO_MAX_EVENTS,0);
+	if(count < 0) {
+		return FALSE;
+	}
+
+	for(i=0; i<count; i++) {
+		mpf_rtp_io_socket_drain(io,io->events[i].data.ptr);
+	}
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_flush(mpf_rtp_io_t *io)
+{
+	apr_size_t offset = 0;
+	apr_size_t run;
+	int sent;
+	while(offset < io->tx_count) {
+		/* packets queued from the same socket are sent by a single system call */
+		run = 1;
+		while(offset + run < io->tx_count && io->tx_fds[offset + run] == io->tx_fds[offset]) {
+			run++;
+		}
+
+		io->stat.tx_syscalls++;
+		sent = sendmmsg(io->tx_fds[offset],&io->tx_msgs[offset],(unsigned int)run,MSG_DONTWAIT);
+		if(sent < 0) {
+			sent = 0;
+		}
+		io->stat.tx_packets += sent;
+		if((apr_size_t)sent < run) {
+			/* the rest of the run is dropped, as would be on a failed sendto */
+			io->stat.tx_failures += (apr_uint32_t)(run - sent);
+		}
+		offset += run;
+	}
+	io->tx_count = 0;
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_stat_get(const mpf_rtp_io_t *io, mpf_rtp_io_stat_t *stat)
+{
+	if(!io || !stat) {
+		return FALSE;
+	}
+	*stat = io->stat;
+	return TRUE;
+}
+
+#else
+
+MPF_DECLARE(mpf_rtp_io_t*) mpf_rtp_io_create(apr_pool_t *pool)
+{
+	apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Batched RTP I/O is not Supported on this Platform");
+	return NULL;
+}
+
+MPF_DECLARE(void) mpf_rtp_io_destroy(mpf_rtp_io_t *io)
+{
+}
+
+MPF_DECLARE(mpf_rtp_io_socket_t*) mpf_rtp_io_socket_add(
+									mpf_rtp_io_t *io,
+									apr_socket_t *socket,
+									mpf_rtp_io_rx_handler_f handler,
+									void *obj,
+									apr_pool_t *pool)
+{
+	return NULL;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_socket_remove(mpf_rtp_io_t *io, mpf_rtp_io_socket_t *io_socket)
+{
+	return FALSE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_send(
+							mpf_rtp_io_t *io,
+							apr_socket_t *socket,
+							apr_sockaddr_t *sockaddr,
+							const void *data,
+							apr_size_t size)
+{
+	return FALSE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_receive(mpf_rtp_io_t *io)
+{
+	return FALSE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_flush(mpf_rtp_io_t *io)
+{
+	return FALSE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_io_stat_get(const mpf_rtp_io_t *io, mpf_rtp_io_stat_t *stat)
+{
+	return FALSE;
+}
+
+#endif /* ENABLE_BATCHED_IO */
@@ -18,6 +18,9 @@
 #include "apt_net.h"
 #include "apt_timer_queue.h"
 #include "mpf_rtp_stream.h"
+#include "mpf_rtp_io.h"
+#include "mpf_rtp_demux.h"
+#include "mpf_engine.h"
 #include "mpf_termination.h"
 #include "mpf_codec_manager.h"
 #include "mpf_rtp_header.h"
@@ -66,6 +69,11 @@ struct mpf_rtp_stream_t {
 	apr_sockaddr_t             *rtcp_l_sockaddr;
 	apr_sockaddr_t             *rtcp_r_sockaddr;
 
+	mpf_rtp_io_t               *rtp_io;
+	mpf_rtp_io_socket_t        *rtp_io_socket;
+	mpf_rtp_demux_t            *demux;
+	mpf_rtp_demux_entry_t      *demux_entry;
+
 	apt_timer_t                *rtcp_tx_timer;
 	apt_timer_t                *rtcp_rx_timer;
 	
@@ -94,6 +102,9 @@ static const mpf_audio_stream_vtable_t vtable = {
 static apt_bool_t mpf_rtp_socket_pair_create(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media, apt_bool_t bind);
 static apt_bool_t mpf_rtp_socket_pair_bind(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media);
 static void mpf_rtp_socket_pair_close(mpf_rtp_stream_t *stream);
+static void mpf_rtp_shared_socket_pair_attach(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media);
+static void rtp_rx_packet_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port);
+static void rtcp_rx_packet_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port);
 
 static apt_bool_t mpf_rtcp_report_send(mpf_rtp_stream_t *stream);
 static apt_bool_t mpf_rtcp_bye_send(mpf_rtp_stream_t *stream, apt_str_t *reason);
@@ -125,6 +136,10 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_rtp_stream_create(mpf_termination_t *termin
 	rtp_stream->rtp_r_sockaddr = NULL;
 	rtp_stream->rtcp_l_sockaddr = NULL;
 	rtp_stream->rtcp_r_sockaddr = NULL;
+	rtp_stream->rtp_io = NULL;
+	rtp_stream->rtp_io_socket = NULL;
+	rtp_stream->demux = NULL;
+	rtp_stream->demux_entry = NULL;
 	rtp_stream->rtcp_tx_timer = NULL;
 	rtp_stream->rtcp_rx_timer = NULL;
 	rtp_stream->state = MPF_MEDIA_DISABLED;
@@ -132,6 +147,10 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_rtp_stream_create(mpf_termination_t *termin
 	rtp_transmitter_init(&rtp_stream->transmitter);
 	rtp_stream->transmitter.sr_stat.ssrc = (apr_uint32_t)apr_time_now();
 
+	if(config->io_mode != RTP_IO_MODE_SOCKET && termination->media_engine) {
+		rtp_stream->rtp_io = mpf_engine_rtp_io_get(termination->media_engine);
+	}
+
 	if(settings->rtcp == TRUE) {
 		if(settings->rtcp_tx_interval) {
 			rtp_stream->rtcp_tx_timer = apt_timer_create(
@@ -166,7 +185,11 @@ static apt_bool_t mpf_rtp_stream_local_media_create(mpf_rtp_stream_t *rtp_stream
 		local_media->ip = rtp_stream->config->ip;
 		local_media->ext_ip = rtp_stream->config->ext_ip;
 	}
-	if(local_media->port == 0) {
+	if(rtp_stream->demux) {
+		/* all the streams of the engine share the same pair of sockets */
+		mpf_rtp_shared_socket_pair_attach(rtp_stream,local_media);
+	}
+	else if(local_media->port == 0) {
 		if(mpf_rtp_socket_pair_create(rtp_stream,local_media,FALSE) == TRUE) {
 			/* RTP port management */
 			mpf_rtp_config_t *rtp_config = rtp_stream->config;
@@ -241,7 +264,11 @@ static apt_bool_t mpf_rtp_stream_local_media_create(mpf_rtp_stream_t *rtp_stream
 static apt_bool_t mpf_rtp_stream_local_media_update(mpf_rtp_stream_t *rtp_stream, mpf_rtp_media_descriptor_t *media, mpf_stream_capabilities_t *capabilities)
 {
 	apt_bool_t status = TRUE;
-	if(apt_string_compare(&rtp_stream->local_media->ip,&media->ip) == FALSE ||
+	if(rtp_stream->demux) {
+		media->ip = rtp_stream->local_media->ip;
+		media->port = rtp_stream->local_media->port;
+	}
+	else if(apt_string_compare(&rtp_stream->local_media->ip,&media->ip) == FALSE ||
 		rtp_stream->local_media->port != media->port) {
 
 		mpf_rtp_socket_pair_close(rtp_stream);
@@ -463,7 +490,7 @@ MPF_DECLARE(apt_bool_t) mpf_rtp_stream_modify(mpf_audio_stream_t *stream, mpf_rt
 		rtp_stream->base->tx_descriptor = codec_list->primary_descriptor;
 		if(rtp_stream->base->tx_descriptor) {
 			rtp_stream->transmitter.samples_per_frame = 
-				(apr_uint32_t)mpf_codec_frame_samples_calculate(rtp_stream->base->tx_descriptor);
+				(apr_uint32_t)mpf_codec_frame_ts_calculate(rtp_stream->base->tx_descriptor);
 		}
 		if(codec_list->event_descriptor) {
 			rtp_stream->base->tx_event_descriptor = codec_list->event_descriptor;
@@ -503,6 +530,29 @@ static apt_bool_t mpf_rtp_rx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t
 						codec,
 						rtp_stream->pool);
 
+	if(rtp_stream->demux) {
+		rtp_stream->demux_entry = mpf_rtp_demux_session_add(
+										rtp_stream->demux,
+										rtp_stream->rtp_r_sockaddr,
+										rtp_stream->rtcp_r_sockaddr,
+										rtp_rx_packet_handler,
+										rtp_stream->settings->rtcp == TRUE ? rtcp_rx_packet_handler : NULL,
+										rtp_stream,
+										rtp_stream->pool);
+		if(!rtp_stream->demux_entry) {
+			/* the session can't be received by the shared sockets */
+			return FALSE;
+		}
+	}
+	else if(rtp_stream->rtp_io) {
+		rtp_stream->rtp_io_socket = mpf_rtp_io_socket_add(
+										rtp_stream->rtp_io,
+										rtp_stream->rtp_socket,
+										rtp_rx_packet_handler,
+										rtp_stream,
+										rtp_stream->pool);
+	}
+
 	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,
 			"Open RTP Receiver %s:%hu <- %s:%hu playout [%u ms] bounds [%u - %u ms] adaptive [%d] skew detection [%d]",
 			rtp_stream->rtp_l_sockaddr->hostname,
@@ -522,6 +572,15 @@ static apt_bool_t mpf_rtp_rx_stream_close(mpf_audio_stream_t *stream)
 	mpf_rtp_stream_t *rtp_stream = stream->obj;
 	rtp_receiver_t *receiver = &rtp_stream->receiver;
 
+	if(rtp_stream->rtp_io_socket) {
+		mpf_rtp_io_socket_remove(rtp_stream->rtp_io,rtp_stream->rtp_io_socket);
+		rtp_stream->rtp_io_socket = NULL;
+	}
+	if(rtp_stream->demux_entry) {
+		mpf_rtp_demux_session_remove(rtp_stream->demux,rtp_stream->demux_entry);
+		rtp_stream->demux_entry = NULL;
+	}
+
 	if(!rtp_stream->rtp_l_sockaddr || !rtp_stream->rtp_r_sockaddr) {
 		return FALSE;
 	}
@@ -746,7 +805,7 @@ static APR_INLINE rtp_ts_result_e rtp_rx_ts_update(rtp_receiver_t *receiver, mpf
 	}
 
 	/* arrival time diff in samples */
-	deviation = time_diff * descriptor->channel_count * descriptor->sampling_rate / 1000;
+	deviation = time_diff * descriptor->channel_count * (apr_int32_t)mpf_codec_rtp_clock_rate_get(descriptor) / 1000;
 	/* arrival timestamp diff */
 	deviation -= ts - receiver->history.ts_last;
 
@@ -859,6 +918,11 @@ static apt_bool_t rtp_rx_packet_receive(mpf_rtp_stream_t *rtp_stream, void *buff
 	return TRUE;
 }
 
+static void rtp_rx_packet_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port)
+{
+	rtp_rx_packet_receive(obj,buffer,size);
+}
+
 static apt_bool_t rtp_rx_process(mpf_rtp_stream_t *rtp_stream)
 {
 	char buffer[MAX_RTP_PACKET_SIZE];
@@ -876,7 +940,10 @@ static apt_bool_t rtp_rx_process(mpf_rtp_stream_t *rtp_stream)
 static apt_bool_t mpf_rtp_stream_receive(mpf_audio_stream_t *stream, mpf_frame_t *frame)
 {
 	mpf_rtp_stream_t *rtp_stream = stream->obj;
-	rtp_rx_process(rtp_stream);
+	if(!rtp_stream->rtp_io_socket && !rtp_stream->demux) {
+		/* otherwise, packets have already been received by the RTP I/O of the engine */
+		rtp_rx_process(rtp_stream);
+	}
 
 	return mpf_jitter_buffer_read(rtp_stream->receiver.jb,frame);
 }
@@ -957,6 +1024,25 @@ static APR_INLINE void rtp_header_prepare(
 	header->ssrc = htonl(transmitter->sr_stat.ssrc);
 }
 
+static APR_INLINE apt_bool_t mpf_rtp_packet_send(mpf_rtp_stream_t *rtp_stream, void *packet_data, apr_size_t *packet_size)
+{
+	if(rtp_stream->rtp_io) {
+		return mpf_rtp_io_send(
+					rtp_stream->rtp_io,
+					rtp_stream->rtp_socket,
+					rtp_stream->rtp_r_sockaddr,
+					packet_data,
+					*packet_size);
+	}
+
+	return apr_socket_sendto(
+				rtp_stream->rtp_socket,
+				rtp_stream->rtp_r_sockaddr,
+				0,
+				packet_data,
+				packet_size) == APR_SUCCESS ? TRUE : FALSE;
+}
+
 static APR_INLINE apt_bool_t mpf_rtp_data_send(mpf_rtp_stream_t *rtp_stream, rtp_transmitter_t *transmitter, const mpf_frame_t *frame)
 {
 	apt_bool_t status = TRUE;
@@ -975,12 +1061,7 @@ static APR_INLINE apt_bool_t mpf_rtp_data_send(mpf_rtp_stream_t *rtp_stream, rtp
 			(header->marker == 1) ? '*' : ' ',
 			header->timestamp, transmitter->last_seq_num);
 		header->timestamp = htonl(header->timestamp);
-		if(apr_socket_sendto(
-					rtp_stream->rtp_socket,
-					rtp_stream->rtp_r_sockaddr,
-					0,
-					transmitter->packet_data,
-					&transmitter->packet_size) == APR_SUCCESS) {
+		if(mpf_rtp_packet_send(rtp_stream,transmitter->packet_data,&transmitter->packet_size) == TRUE) {
 			transmitter->sr_stat.sent_packets++;
 			transmitter->sr_stat.sent_octets += (apr_uint32_t)transmitter->packet_size - sizeof(rtp_header_t);
 		}
@@ -1018,12 +1099,7 @@ static APR_INLINE apt_bool_t mpf_rtp_event_send(mpf_rtp_stream_t *rtp_stream, rt
 		(named_event->edge == 1) ? '*' : ' ');
 	header->timestamp = htonl(header->timestamp);
 	named_event->duration = htons((apr_uint16_t)named_event->duration);
-	if(apr_socket_sendto(
-				rtp_stream->rtp_socket,
-				rtp_stream->rtp_r_sockaddr,
-				0,
-				packet_data,
-				&packet_size) != APR_SUCCESS) {
+	if(mpf_rtp_packet_send(rtp_stream,packet_data,&packet_size) == FALSE) {
 		return FALSE;
 	}
 	transmitter->sr_stat.sent_packets++;
@@ -1172,9 +1248,33 @@ static apt_bool_t mpf_rtp_socket_pair_bind(mpf_rtp_stream_t *stream, mpf_rtp_med
 	return TRUE;
 }
 
+/* Attach shared RTP/RTCP sockets */
+static void mpf_rtp_shared_socket_pair_attach(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media)
+{
+	stream->rtp_socket = mpf_rtp_demux_rtp_socket_get(stream->demux);
+	stream->rtcp_socket = mpf_rtp_demux_rtcp_socket_get(stream->demux);
+	stream->rtp_l_sockaddr = mpf_rtp_demux_rtp_sockaddr_get(stream->demux);
+	stream->rtcp_l_sockaddr = mpf_rtp_demux_rtcp_sockaddr_get(stream->demux);
+	local_media->port = stream->rtp_l_sockaddr->port;
+}
+
 /* Close RTP/RTCP sockets */
 static void mpf_rtp_socket_pair_close(mpf_rtp_stream_t *stream)
 {
+	if(stream->rtp_io_socket) {
+		mpf_rtp_io_socket_remove(stream->rtp_io,stream->rtp_io_socket);
+		stream->rtp_io_socket = NULL;
+	}
+	if(stream->demux) {
+		/* shared sockets are owned by the demultiplexer */
+		if(stream->demux_entry) {
+			mpf_rtp_demux_session_remove(stream->demux,stream->demux_entry);
+			stream->demux_entry = NULL;
+		}
+		stream->rtp_socket = NULL;
+		stream->rtcp_socket = NULL;
+		return;
+	}
 	if(stream->rtp_socket) {
 		apr_socket_close(stream->rtp_socket);
 		stream->rtp_socket = NULL;
@@ -1484,7 +1584,8 @@ static void mpf_rtcp_tx_timer_proc(apt_timer_t *timer, void *obj)
 static void mpf_rtcp_rx_timer_proc(apt_timer_t *timer, void *obj)
 {
 	mpf_rtp_stream_t *rtp_stream = obj;
-	if(rtp_stream->rtcp_socket && rtp_stream->rtcp_l_sockaddr && rtp_stream->rtcp_r_sockaddr) {
+	/* RTCP packets received on the shared socket are dispatched by the demultiplexer */
+	if(!rtp_stream->demux && rtp_stream->rtcp_socket && rtp_stream->rtcp_l_sockaddr && rtp_stream->rtcp_r_sockaddr) {
 		char buffer[MAX_RTCP_PACKET_SIZE];
 		apr_size_t length = sizeof(buffer);
 		
@@ -1502,3 +1603,26 @@ static void mpf_rtcp_rx_timer_proc(apt_timer_t *timer, void *obj)
 	/* re-schedule timer */
 	apt_timer_set(timer,rtp_stream->settings->rtcp_rx_resolution);
 }
+
+static void rtcp_rx_packet_handler(void *obj, void *buffer, apr_size_t size, apr_uint32_t remote_ip, apr_port_t remote_port)
+{
+	mpf_rtp_stream_t *rtp_stream = obj;
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Receive Compound RTCP Packet [%"APR_SIZE_T_FMT" bytes] %s:%hu <- %s:%hu",
+			size,
+			rtp_stream->rtcp_l_sockaddr->hostname,
+			rtp_stream->rtcp_l_sockaddr->port,
+			rtp_stream->rtcp_r_sockaddr->hostname,
+			rtp_stream->rtcp_r_sockaddr->port);
+	mpf_rtcp_compound_packet_receive(rtp_stream,buffer,size);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_stream_demux_set(mpf_audio_stream_t *stream, mpf_rtp_demux_t *demux)
+{
+	mpf_rtp_stream_t *rtp_stream = stream->obj;
+	if(rtp_stream->local_media) {
+		/* must be set before the local media is created */
+		return FALSE;
+	}
+	rtp_stream->demux = demux;
+	return TRUE;
+}
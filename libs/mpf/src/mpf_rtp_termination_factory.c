@@ -18,6 +18,8 @@
 #include "mpf_termination.h"
 #include "mpf_rtp_termination_factory.h"
 #include "mpf_rtp_stream.h"
+#include "mpf_rtp_demux.h"
+#include "mpf_engine.h"
 #include "apt_log.h"
 
 typedef struct media_engine_slot_t media_engine_slot_t;
@@ -26,6 +28,7 @@ typedef struct rtp_termination_factory_t rtp_termination_factory_t;
 struct media_engine_slot_t {
 	mpf_engine_t     *media_engine;
 	mpf_rtp_config_t *rtp_config;
+	mpf_rtp_demux_t  *demux;
 };
 
 struct rtp_termination_factory_t {
@@ -51,10 +54,12 @@ static apt_bool_t mpf_rtp_termination_add(mpf_termination_t *termination, void *
 		media_engine_slot_t *slot;
 		rtp_termination_factory_t *rtp_termination_factory = (rtp_termination_factory_t*)termination->termination_factory;
 		mpf_rtp_config_t *rtp_config = rtp_termination_factory->config;
+		mpf_rtp_demux_t *demux = NULL;
 		for(i=0; i<rtp_termination_factory->media_engine_slots->nelts; i++) {
 			slot = &APR_ARRAY_IDX(rtp_termination_factory->media_engine_slots,i,media_engine_slot_t);
 			if(slot->media_engine == termination->media_engine) {
 				rtp_config = slot->rtp_config;
+				demux = slot->demux;
 				break;
 			}
 		}
@@ -66,6 +71,9 @@ static apt_bool_t mpf_rtp_termination_add(mpf_termination_t *termination, void *
 		if(!audio_stream) {
 			return FALSE;
 		}
+		if(demux) {
+			mpf_rtp_stream_demux_set(audio_stream,demux);
+		}
 		termination->audio_stream = audio_stream;
 	}
 
@@ -136,11 +144,44 @@ static apt_bool_t mpf_rtp_factory_engine_assign(mpf_termination_factory_t *termi
 		}
 	}
 
+	if(rtp_termination_factory->config->io_mode != RTP_IO_MODE_SOCKET) {
+		if(!mpf_engine_rtp_io_enable(media_engine)) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Enable Batched RTP I/O, Fall Back to Socket I/O");
+			rtp_termination_factory->config->io_mode = RTP_IO_MODE_SOCKET;
+		}
+	}
+
 	slot = apr_array_push(rtp_termination_factory->media_engine_slots);
 	slot->media_engine = media_engine;
 	rtp_config = mpf_rtp_config_alloc(rtp_termination_factory->pool);
 	*rtp_config = *rtp_termination_factory->config;
 	slot->rtp_config = rtp_config;
+	slot->demux = NULL;
+
+	if(rtp_config->io_mode == RTP_IO_MODE_SHARED) {
+		/* each media engine binds a single pair of ports, taken from the beginning of the range */
+		apr_port_t port = (apr_port_t)(rtp_termination_factory->config->rtp_port_min + 
+			2 * (rtp_termination_factory->media_engine_slots->nelts - 1));
+		if(port + 1 > rtp_termination_factory->config->rtp_port_max) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"No RTP Port Left for Shared Sockets %s:[%hu,%hu]",
+				rtp_config->ip.buf,
+				rtp_termination_factory->config->rtp_port_min,
+				rtp_termination_factory->config->rtp_port_max);
+			apr_array_pop(rtp_termination_factory->media_engine_slots);
+			return FALSE;
+		}
+		slot->demux = mpf_rtp_demux_create(
+							mpf_engine_rtp_io_get(media_engine),
+							rtp_config->ip.buf,
+							port,
+							rtp_termination_factory->pool);
+		if(!slot->demux) {
+			apr_array_pop(rtp_termination_factory->media_engine_slots);
+			return FALSE;
+		}
+		/* the port range is not split, since no other ports are used */
+		return TRUE;
+	}
 
 	if(rtp_termination_factory->media_engine_slots->nelts > 1) {
 		mpf_rtp_config_t *rtp_config_prev;
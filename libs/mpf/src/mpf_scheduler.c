@@ -14,10 +14,18 @@
  * limitations under the License.
  */
 
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
 #include "mpf_scheduler.h"
 
 #ifdef WIN32
 #define ENABLE_MULTIMEDIA_TIMERS
+#elif defined(__linux__)
+#define ENABLE_MONOTONIC_CLOCK
 #endif
 
 #ifdef ENABLE_MULTIMEDIA_TIMERS
@@ -32,8 +40,15 @@
 
 #else
 #include <apr_thread_proc.h>
+#ifdef ENABLE_MONOTONIC_CLOCK
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#endif
 #endif
 
+#include "apt_log.h"
 
 struct mpf_scheduler_t {
 	apr_pool_t          *pool;
@@ -48,6 +63,10 @@ struct mpf_scheduler_t {
 	mpf_scheduler_proc_f timer_proc;
 	void                *timer_obj;
 
+	int                  priority;
+	int                  cpu;
+	mpf_scheduler_stat_t stat;
+
 #ifdef ENABLE_MULTIMEDIA_TIMERS
 	unsigned int         timer_id;
 #else
@@ -74,6 +93,10 @@ MPF_DECLARE(mpf_scheduler_t*) mpf_scheduler_create(apr_pool_t *pool)
 	scheduler->timer_elapsed_time = 0;
 	scheduler->timer_obj = NULL;
 	scheduler->timer_proc = NULL;
+
+	scheduler->priority = 0;
+	scheduler->cpu = -1;
+	memset(&scheduler->stat,0,sizeof(mpf_scheduler_stat_t));
 	return scheduler;
 }
 
@@ -127,6 +150,42 @@ MPF_DECLARE(apt_bool_t) mpf_scheduler_rate_set(
 	return TRUE;
 }
 
+/** Set real-time (SCHED_FIFO) priority of the scheduler thread, 0 - disabled (default) */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_priority_set(
+								mpf_scheduler_t *scheduler,
+								int priority)
+{
+	if(priority < 0) {
+		return FALSE;
+	}
+	scheduler->priority = priority;
+	return TRUE;
+}
+
+/** Bind the scheduler thread to the specified CPU core, -1 - not bound (default) */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_cpu_affinity_set(
+								mpf_scheduler_t *scheduler,
+								int cpu)
+{
+	if(cpu < -1) {
+		return FALSE;
+	}
+	scheduler->cpu = cpu;
+	return TRUE;
+}
+
+/** Get scheduler statistics */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_stat_get(
+								const mpf_scheduler_t *scheduler,
+								mpf_scheduler_stat_t *stat)
+{
+	if(!scheduler || !stat) {
+		return FALSE;
+	}
+	*stat = scheduler->stat;
+	return TRUE;
+}
+
 static APR_INLINE void mpf_scheduler_resolution_set(mpf_scheduler_t *scheduler)
 {
 	if(scheduler->media_resolution) {
@@ -137,6 +196,33 @@ static APR_INLINE void mpf_scheduler_resolution_set(mpf_scheduler_t *scheduler)
 	}
 }
 
+/** Update statistics based on the processing time of the current tick */
+static APR_INLINE void mpf_scheduler_stat_update(mpf_scheduler_t *scheduler, apr_interval_time_t processing_time)
+{
+	mpf_scheduler_stat_t *stat = &scheduler->stat;
+	stat->tick_count++;
+	stat->last_processing_time = processing_time;
+	stat->total_processing_time += processing_time;
+	if(processing_time > stat->max_processing_time) {
+		stat->max_processing_time = processing_time;
+	}
+	if(processing_time > (apr_interval_time_t)scheduler->resolution * 1000) {
+		stat->overrun_count++;
+	}
+}
+
+/** Process the timer clock, elapsed time is the time passed since the previous tick (msec) */
+static APR_INLINE void mpf_scheduler_timer_process(mpf_scheduler_t *scheduler, unsigned long elapsed_time)
+{
+	if(scheduler->timer_proc) {
+		scheduler->timer_elapsed_time += elapsed_time;
+		if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
+			scheduler->timer_elapsed_time = 0;
+			scheduler->timer_proc(scheduler,scheduler->timer_obj);
+		}
+	}
+}
+
 
 
 #ifdef ENABLE_MULTIMEDIA_TIMERS
@@ -153,13 +239,7 @@ static void CALLBACK mm_timer_proc(UINT uID, UINT uMsg, DWORD_PTR dwUser, DWORD_
 		scheduler->media_proc(scheduler,scheduler->media_obj);
 	}
 
-	if(scheduler->timer_proc) {
-		scheduler->timer_elapsed_time += scheduler->resolution;
-		if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
-			scheduler->timer_elapsed_time = 0;
-			scheduler->timer_proc(scheduler,scheduler->timer_obj);
-		}
-	}
+	mpf_scheduler_timer_process(scheduler,scheduler->resolution);
 }
 
 /** Start scheduler */
@@ -194,6 +274,124 @@ static APR_INLINE void mpf_scheduler_init(mpf_scheduler_t *scheduler)
 	scheduler->running = FALSE;
 }
 
+#ifdef ENABLE_MONOTONIC_CLOCK
+
+/** Get the current time of the monotonic clock */
+static APR_INLINE void monotonic_time_get(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC,ts);
+}
+
+/** Advance the specified time by the specified interval (usec) */
+static APR_INLINE void monotonic_time_advance(struct timespec *ts, apr_interval_time_t interval)
+{
+	ts->tv_sec += (time_t)(interval / APR_USEC_PER_SEC);
+	ts->tv_nsec += (long)(interval % APR_USEC_PER_SEC) * 1000;
+	if(ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/** Get the difference between the specified times (usec) */
+static APR_INLINE apr_interval_time_t monotonic_time_diff(const struct timespec *ts1, const struct timespec *ts2)
+{
+	return (apr_interval_time_t)(ts1->tv_sec - ts2->tv_sec) * APR_USEC_PER_SEC + 
+		(ts1->tv_nsec - ts2->tv_nsec) / 1000;
+}
+
+/** Apply CPU affinity and real-time priority to the calling thread */
+static void mpf_scheduler_thread_setup(mpf_scheduler_t *scheduler)
+{
+	if(scheduler->cpu >= 0) {
+		cpu_set_t cpuset;
+		CPU_ZERO(&cpuset);
+		CPU_SET(scheduler->cpu,&cpuset);
+		if(pthread_setaffinity_np(pthread_self(),sizeof(cpu_set_t),&cpuset) != 0) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind Scheduler Thread to CPU [%d]",scheduler->cpu);
+		}
+		else {
+			apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Bind Scheduler Thread to CPU [%d]",scheduler->cpu);
+		}
+	}
+
+	if(scheduler->priority > 0) {
+		struct sched_param param;
+		int min_priority = sched_get_priority_min(SCHED_FIFO);
+		int max_priority = sched_get_priority_max(SCHED_FIFO);
+		param.sched_priority = scheduler->priority;
+		if(param.sched_priority < min_priority) {
+			param.sched_priority = min_priority;
+		}
+		else if(param.sched_priority > max_priority) {
+			param.sched_priority = max_priority;
+		}
+		if(pthread_setschedparam(pthread_self(),SCHED_FIFO,&param) != 0) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Real-Time Priority of Scheduler Thread [%d]",param.sched_priority);
+		}
+		else {
+			apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Set Real-Time Priority of Scheduler Thread [%d]",param.sched_priority);
+		}
+	}
+}
+
+static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
+{
+	mpf_scheduler_t *scheduler = data;
+	apr_interval_time_t timeout = scheduler->resolution * 1000;
+	apr_interval_time_t lateness;
+	apr_interval_time_t processing_time;
+	unsigned long elapsed_time;
+	apr_uint32_t skipped;
+	struct timespec deadline;
+	struct timespec time_start;
+	struct timespec time_now;
+	
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set("MPF Scheduler");
+#endif
+	mpf_scheduler_thread_setup(scheduler);
+
+	monotonic_time_get(&deadline);
+	while(scheduler->running == TRUE) {
+		/* wake up at the absolute deadline, so that the processing time doesn't accumulate as a drift */
+		while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&deadline,NULL) == EINTR);
+
+		monotonic_time_get(&time_start);
+		lateness = monotonic_time_diff(&time_start,&deadline);
+		if(lateness > scheduler->stat.max_lateness) {
+			scheduler->stat.max_lateness = lateness;
+		}
+
+		elapsed_time = scheduler->resolution;
+		if(lateness >= timeout) {
+			/* one or more deadlines have been missed, rather than processing the missed ticks
+			back-to-back, skip them and re-align the schedule with the clock */
+			skipped = (apr_uint32_t)(lateness / timeout);
+			scheduler->stat.skipped_count += skipped;
+			monotonic_time_advance(&deadline,skipped * timeout);
+			elapsed_time += skipped * scheduler->resolution;
+		}
+
+		if(scheduler->media_proc) {
+			scheduler->media_proc(scheduler,scheduler->media_obj);
+		}
+
+		mpf_scheduler_timer_process(scheduler,elapsed_time);
+
+		monotonic_time_get(&time_now);
+		processing_time = monotonic_time_diff(&time_now,&time_start);
+		mpf_scheduler_stat_update(scheduler,processing_time);
+
+		monotonic_time_advance(&deadline,timeout);
+	}
+	
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+#else
+
 static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 {
 	mpf_scheduler_t *scheduler = data;
@@ -212,13 +410,9 @@ static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 			scheduler->media_proc(scheduler,scheduler->media_obj);
 		}
 
-		if(scheduler->timer_proc) {
-			scheduler->timer_elapsed_time += scheduler->resolution;
-			if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
-				scheduler->timer_elapsed_time = 0;
-				scheduler->timer_proc(scheduler,scheduler->timer_obj);
-			}
-		}
+		mpf_scheduler_timer_process(scheduler,scheduler->resolution);
+
+		mpf_scheduler_stat_update(scheduler,apr_time_now() - time_last);
 
 		if(timeout > time_drift) {
 			apr_sleep(timeout - time_drift);
@@ -235,6 +429,8 @@ static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 	return NULL;
 }
 
+#endif /* ENABLE_MONOTONIC_CLOCK */
+
 MPF_DECLARE(apt_bool_t) mpf_scheduler_start(mpf_scheduler_t *scheduler)
 {
 	mpf_scheduler_resolution_set(scheduler);
@@ -403,7 +403,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_client_signaling_agent_register(mrcp_client_t *cli
 		return FALSE;
 	}
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Register Signaling Agent [%s]",signaling_agent->id);
-	signaling_agent->msg_pool = apt_task_msg_pool_create_dynamic(sizeof(sig_agent_task_msg_data_t),client->pool);
+	signaling_agent->msg_pool = apt_task_msg_pool_create_cached(sizeof(sig_agent_task_msg_data_t),client->pool);
 	signaling_agent->parent = client;
 	signaling_agent->resource_factory = client->resource_factory;
 	apr_hash_set(client->sig_agent_table,signaling_agent->id,APR_HASH_KEY_STRING,signaling_agent);
@@ -452,7 +452,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_client_connection_agent_register(mrcp_client_t *cl
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Register Connection Agent [%s]",id);
 	mrcp_client_connection_resource_factory_set(connection_agent,client->resource_factory);
 	mrcp_client_connection_agent_handler_set(connection_agent,client,&connection_method_vtable);
-	client->cnt_msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_agent_task_msg_data_t),client->pool);
+	client->cnt_msg_pool = apt_task_msg_pool_create_cached(sizeof(connection_agent_task_msg_data_t),client->pool);
 	apr_hash_set(client->cnt_agent_table,id,APR_HASH_KEY_STRING,connection_agent);
 	if(client->task) {
 		apt_task_t *task = apt_consumer_task_base_get(client->task);
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_ENGINE_FEEDER_H
+#define MRCP_ENGINE_FEEDER_H
+
+/**
+ * @file mrcp_engine_feeder.h
+ * @brief Asynchronous Audio Feeder of Engine Channels
+ *
+ * A feeder takes the network I/O of a cloud recognizer out of the MPF engine
+ * thread. The stream write callback only copies the audio of the channel to
+ * a lock-free single-producer/single-consumer ring, which is drained by a
+ * worker of the feeder pool of the engine. The worker passes the audio to the
+ * vendor SDK and may block as long as needed without delaying the media of
+ * other channels.
+ *
+ * Each feeder is pinned to a worker, so the audio and the commands of the
+ * channel are processed in the order they are written and posted: a command
+ * is processed once all the audio written before the command is processed.
+ *
+ * A handler which has to wait for the vendor SDK, for example to poll for the
+ * final result, should defer a command instead of sleeping, since the worker
+ * is shared with the feeders of other channels.
+ */
+
+#include "mrcp_engine_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default number of workers of the feeder pool */
+#define MRCP_FEEDER_DEFAULT_WORKER_COUNT 2
+/** Default capacity of the ring of a feeder (2 sec of 16 kHz L16) */
+#define MRCP_FEEDER_DEFAULT_CAPACITY     64000
+/** Max size of audio passed to the audio handler at once (100 msec of 16 kHz L16) */
+#define MRCP_FEEDER_CHUNK_SIZE           3200
+
+/** Opaque feeder pool declaration */
+typedef struct mrcp_feeder_pool_t mrcp_feeder_pool_t;
+/** Opaque feeder declaration */
+typedef struct mrcp_feeder_t mrcp_feeder_t;
+/** Feeder vtable declaration */
+typedef struct mrcp_feeder_vtable_t mrcp_feeder_vtable_t;
+
+/** Feeder vtable, the handlers are invoked from the worker the feeder is pinned to */
+struct mrcp_feeder_vtable_t {
+	/** Process audio read from the ring */
+	apt_bool_t (*on_audio)(mrcp_feeder_t *feeder, const void *data, apr_size_t size);
+	/** Process command posted by means of mrcp_feeder_command_post() */
+	apt_bool_t (*on_command)(mrcp_feeder_t *feeder, int command, void *arg);
+	/** Process close request, no handler is invoked for the feeder afterwards */
+	void (*on_close)(mrcp_feeder_t *feeder);
+};
+
+/**
+ * Create feeder pool.
+ * @param worker_count the number of workers
+ * @param name the name of the pool (workers are named after it)
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_feeder_pool_t*) mrcp_feeder_pool_create(apr_size_t worker_count, const char *name, apr_pool_t *pool);
+
+/**
+ * Create feeder pool of the engine.
+ * @param engine the engine to create feeder pool for
+ * @remark The number of workers is set by the "feeder-worker-count" param of the engine.
+ */
+MRCP_DECLARE(mrcp_feeder_pool_t*) mrcp_engine_feeder_pool_create(mrcp_engine_t *engine);
+
+/** Start the workers of the feeder pool */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_pool_start(mrcp_feeder_pool_t *feeder_pool);
+
+/**
+ * Terminate and destroy the workers of the feeder pool.
+ * @remark All the feeders are expected to be closed.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_pool_terminate(mrcp_feeder_pool_t *feeder_pool);
+
+/**
+ * Create feeder.
+ * @param feeder_pool the pool of workers to pin the feeder to
+ * @param vtable the handlers of the feeder
+ * @param obj the external object to associate with the feeder
+ * @param capacity the capacity of the ring in bytes
+ * @remark The feeder has its own memory, which is released once the feeder
+ * is destroyed and all the pending audio and commands are processed.
+ */
+MRCP_DECLARE(mrcp_feeder_t*) mrcp_feeder_create(
+								mrcp_feeder_pool_t *feeder_pool,
+								const mrcp_feeder_vtable_t *vtable,
+								void *obj,
+								apr_size_t capacity);
+
+/**
+ * Destroy feeder.
+ * @param feeder the feeder to destroy
+ * @remark No audio may be written afterwards, typically called on channel destroy.
+ */
+MRCP_DECLARE(void) mrcp_feeder_destroy(mrcp_feeder_t *feeder);
+
+/** Get external object associated with the feeder */
+MRCP_DECLARE(void*) mrcp_feeder_object_get(const mrcp_feeder_t *feeder);
+
+/**
+ * Write audio to the feeder (single producer, typically MPF engine thread).
+ * @param feeder the feeder to write to
+ * @param data the audio data to write
+ * @param size the size of data in bytes
+ * @return FALSE, if the audio is rejected (the feeder is closed or the ring is full)
+ * @remark Never blocks, the audio which doesn't fit the ring is discarded and counted.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_audio_write(mrcp_feeder_t *feeder, const void *data, apr_size_t size);
+
+/**
+ * Post command to the feeder (any thread).
+ * @param feeder the feeder to post command to
+ * @param command the command identifier
+ * @param arg the argument of the command
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_command_post(mrcp_feeder_t *feeder, int command, void *arg);
+
+/**
+ * Defer command to the feeder (worker the feeder is pinned to only).
+ * @param feeder the feeder to defer command to
+ * @param command the command identifier
+ * @param arg the argument of the command
+ * @param timeout the timeout in msec to process the command after
+ * @remark A feeder has up to one deferred command, which is replaced by a subsequent one
+ * and discarded once the feeder is closed.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_command_defer(mrcp_feeder_t *feeder, int command, void *arg, apr_uint32_t timeout);
+
+/**
+ * Close the feeder (any thread).
+ * @param feeder the feeder to close
+ * @remark The pending audio is discarded and the close handler is invoked
+ * after the commands posted before.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_close(mrcp_feeder_t *feeder);
+
+/** Get the total number of bytes discarded by the ring being full */
+MRCP_DECLARE(apr_size_t) mrcp_feeder_overrun_get(const mrcp_feeder_t *feeder);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_ENGINE_FEEDER_H */
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_ENGINE_PLAYOUT_H
+#define MRCP_ENGINE_PLAYOUT_H
+
+/**
+ * @file mrcp_engine_playout.h
+ * @brief Playout of Synthesized Audio
+ *
+ * A playout stage sits between a streaming TTS SDK and the source stream
+ * of a synthesizer channel. The audio written by the SDK (producer) is
+ * buffered in a lock-free ring and read by the MPF engine (consumer).
+ * Playback of a SPEAK request starts once the configured amount of audio
+ * is prebuffered (or the whole audio is received), which absorbs the jitter
+ * of the cloud service. A frame the audio isn't available for in time is
+ * filled with comfort silence instead of leaving a gap in the stream, and
+ * counted as an underrun. The latency of the first byte and of the start
+ * of playback, as well as underruns, are reported per SPEAK request.
+ *
+ * A cloud service delivers audio faster than real time, so the producer is
+ * throttled by the ring rather than the ring being sized for the longest
+ * SPEAK request: a write waits for the consumer to drain the ring.
+ *
+ * Optionally, a SPEAK request is served from the cache of synthesized audio,
+ * in which case the cached audio is played right away with no synthesis.
+ * Otherwise, the audio written by the producer is recorded and inserted into
+ * the cache on completion.
+ *
+ * Only linear PCM streams are supported.
+ */
+
+#include "mrcp_engine_types.h"
+#include "mrcp_synth_cache.h"
+#include "mpf_frame.h"
+#include "mpf_codec_descriptor.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default prebuffer in msec */
+#define MRCP_PLAYOUT_DEFAULT_PREBUFFER 100
+/** Default capacity of the ring in msec */
+#define MRCP_PLAYOUT_DEFAULT_CAPACITY 4000
+/** Default max time a write waits for the ring to drain with no progress, msec */
+#define MRCP_PLAYOUT_DEFAULT_WRITE_TIMEOUT 5000
+/** Size of a msec of audio the capacity of the ring is calculated for (16 kHz L16) */
+#define MRCP_PLAYOUT_MSEC_SIZE (16000 * 2 / 1000)
+
+/** Opaque playout declaration */
+typedef struct mrcp_playout_t mrcp_playout_t;
+/** Playout statistics declaration */
+typedef struct mrcp_playout_stats_t mrcp_playout_stats_t;
+
+/** Playout statistics of a SPEAK request */
+struct mrcp_playout_stats_t {
+	/** Time from the start of the request to the first byte of audio received, msec */
+	apr_size_t first_byte_latency;
+	/** Time from the start of the request to the start of playback, msec */
+	apr_size_t playback_latency;
+	/** Number of underruns (playback starving for audio) */
+	apr_size_t underrun_count;
+	/** Total duration of comfort silence inserted on underruns, msec */
+	apr_size_t underrun_duration;
+	/** Total number of bytes rejected by the ring being full */
+	apr_size_t overrun_size;
+	/** Whether any audio has been received */
+	apt_bool_t audio_received;
+};
+
+/**
+ * Create playout.
+ * @param capacity the capacity of the ring in bytes
+ * @param prebuffer the audio to buffer before playback starts, msec
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_playout_t*) mrcp_playout_create(apr_size_t capacity, apr_size_t prebuffer, apr_pool_t *pool);
+
+/**
+ * Create playout of the engine.
+ * @param engine the engine to create playout for
+ * @param pool the pool to allocate memory from
+ * @remark The prebuffer and the capacity of the ring are set by the "playout-prebuffer"
+ * and "playout-capacity" params of the engine (msec).
+ */
+MRCP_DECLARE(mrcp_playout_t*) mrcp_engine_playout_create(mrcp_engine_t *engine, apr_pool_t *pool);
+
+/**
+ * Start playout of a SPEAK request.
+ * @param playout the playout to start
+ * @param descriptor the codec descriptor of the source stream
+ * @remark Called before the request is made active, i.e. neither the producer
+ * nor the consumer access the playout.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_start(mrcp_playout_t *playout, const mpf_codec_descriptor_t *descriptor);
+
+/**
+ * Look up the audio of the SPEAK request in the cache.
+ * @param playout the started playout
+ * @param cache the cache to look up in (NULL if not used)
+ * @param request the SPEAK request
+ * @return TRUE if the audio is played from the cache (no synthesis needed), otherwise
+ * the audio written afterwards is inserted into the cache on completion
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_cache_lookup(mrcp_playout_t *playout, mrcp_synth_cache_t *cache, const mrcp_message_t *request);
+
+/**
+ * Discard the audio recorded for the cache (producer).
+ * @param playout the playout to discard the record of
+ * @remark Called on failure of synthesis, before the playout is completed.
+ */
+MRCP_DECLARE(void) mrcp_playout_cache_discard(mrcp_playout_t *playout);
+
+/**
+ * Write synthesized audio (producer).
+ * @param playout the playout to write to
+ * @param data the audio data to write
+ * @param size the size of data in bytes
+ * @return the number of bytes written, less than size if the ring is full
+ */
+MRCP_DECLARE(apr_size_t) mrcp_playout_audio_write(mrcp_playout_t *playout, const void *data, apr_size_t size);
+
+/**
+ * Write synthesized audio, waiting for the consumer to drain the ring (producer).
+ * @param playout the playout to write to
+ * @param data the audio data to write
+ * @param size the size of data in bytes
+ * @param timeout the max time to wait with no progress, msec
+ * @return the number of bytes written, less than size on timeout or once the playout is flushed
+ * @remark Blocks the calling thread, which must not be the MPF engine (consumer).
+ */
+MRCP_DECLARE(apr_size_t) mrcp_playout_audio_write_wait(mrcp_playout_t *playout, const void *data, apr_size_t size, apr_size_t timeout);
+
+/**
+ * Complete the audio of the request (producer).
+ * @param playout the playout to complete
+ * @remark MEDIA_FRAME_TYPE_EVENT is raised in the frame which reads the end of the audio.
+ * The recorded audio is inserted into the cache, unless some of it is dropped by
+ * overrun or the playout is flushed.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_complete(mrcp_playout_t *playout);
+
+/**
+ * Read media frame (consumer).
+ * @param playout the playout to read from
+ * @param frame the frame to fill
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_frame_read(mrcp_playout_t *playout, mpf_frame_t *frame);
+
+/**
+ * Discard all the pending audio (consumer).
+ * @param playout the playout to flush
+ * @remark The rest of the audio of the request is discarded by the producer.
+ */
+MRCP_DECLARE(void) mrcp_playout_flush(mrcp_playout_t *playout);
+
+/**
+ * Get the statistics of the current request (consumer).
+ * @param playout the playout to get statistics of
+ * @param stats the statistics to fill
+ */
+MRCP_DECLARE(void) mrcp_playout_stats_get(const mrcp_playout_t *playout, mrcp_playout_stats_t *stats);
+
+/**
+ * Log the statistics of the current request (consumer).
+ * @param playout the playout to log statistics of
+ * @param request the SPEAK request (nothing is logged if NULL)
+ */
+MRCP_DECLARE(void) mrcp_playout_stats_log(const mrcp_playout_t *playout, const mrcp_message_t *request);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_ENGINE_PLAYOUT_H */
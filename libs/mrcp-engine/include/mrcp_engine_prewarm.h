@@ -0,0 +1,160 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_ENGINE_PREWARM_H
+#define MRCP_ENGINE_PREWARM_H
+
+/**
+ * @file mrcp_engine_prewarm.h
+ * @brief Pool of Pre-warmed SDK Sessions
+ *
+ * A prewarm pool keeps a number of vendor SDK sessions (requests) created and,
+ * as far as the SDK allows, connected and authenticated ahead of use, so that
+ * a channel borrows a ready session on RECOGNIZE or SPEAK instead of waiting
+ * for the connection to be set up. The pool is replenished by a thread of its
+ * own, which also recycles the sessions kept idle for too long (before the
+ * service drops them) and gives the plugin a chance to refresh the shared
+ * credentials ahead of expiry. A borrowed session is owned by the channel
+ * and never returned to the pool.
+ *
+ * Warming up a session may be billed by the service (e.g. a recognition is
+ * started), and so is every idle session recycled. Therefore the pool is
+ * replenished on demand only: it starts empty, each borrow (hit or miss)
+ * calls for a session to be warmed up for the next one, and the demand lapses
+ * once no session has been borrowed for the linger time, which lets the pool
+ * drain as the idle sessions age out.
+ *
+ * The hits and misses of the pool and the latency of the handshakes with the
+ * service are counted and logged on termination.
+ */
+
+#include "mrcp_engine_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max time a session is kept idle in the pool, msec */
+#define MRCP_PREWARM_DEFAULT_MAX_IDLE 5000
+/** Default time the pool is replenished for after a borrow, msec */
+#define MRCP_PREWARM_DEFAULT_LINGER 10000
+
+/** Opaque prewarm pool declaration */
+typedef struct mrcp_prewarm_pool_t mrcp_prewarm_pool_t;
+/** Prewarm pool vtable declaration */
+typedef struct mrcp_prewarm_vtable_t mrcp_prewarm_vtable_t;
+/** Prewarm pool statistics declaration */
+typedef struct mrcp_prewarm_stats_t mrcp_prewarm_stats_t;
+
+/** Prewarm pool vtable */
+struct mrcp_prewarm_vtable_t {
+	/** Create and warm up a session (may block, called from the thread of the pool) */
+	void* (*create)(mrcp_prewarm_pool_t *prewarm_pool);
+	/** Check whether an idle session is still usable (must not block, NULL if always usable) */
+	apt_bool_t (*check)(mrcp_prewarm_pool_t *prewarm_pool, void *session);
+	/** Destroy a session not borrowed (may block, called from the thread of the pool) */
+	void (*destroy)(mrcp_prewarm_pool_t *prewarm_pool, void *session);
+	/** Maintain the state shared by the sessions, e.g. credentials (optional, called from the thread of the pool) */
+	void (*maintain)(mrcp_prewarm_pool_t *prewarm_pool);
+};
+
+/** Prewarm pool statistics */
+struct mrcp_prewarm_stats_t {
+	/** Number of sessions borrowed from the pool */
+	apr_size_t hits;
+	/** Number of borrows the pool had no session for */
+	apr_size_t misses;
+	/** Number of sessions warmed up */
+	apr_size_t warmups;
+	/** Number of sessions failed to warm up */
+	apr_size_t failures;
+	/** Number of idle sessions recycled (aged out or no longer usable) */
+	apr_size_t recycles;
+	/** Number of idle sessions in the pool */
+	apr_size_t idle_count;
+	/** Number of handshakes recorded */
+	apr_size_t handshake_count;
+	/** Average handshake latency, msec */
+	apr_size_t handshake_avg;
+	/** Max handshake latency, msec */
+	apr_size_t handshake_max;
+};
+
+/**
+ * Create prewarm pool.
+ * @param size the max number of sessions to keep warmed up
+ * @param max_idle the max time a session is kept idle, msec
+ * @param linger the time the pool is replenished for after a borrow, msec
+ * @param name the name of the pool
+ * @param vtable the vtable of the sessions
+ * @param obj the external object to associate with the pool
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_prewarm_pool_t*) mrcp_prewarm_pool_create(
+									apr_size_t size,
+									apr_size_t max_idle,
+									apr_size_t linger,
+									const char *name,
+									const mrcp_prewarm_vtable_t *vtable,
+									void *obj,
+									apr_pool_t *pool);
+
+/**
+ * Create prewarm pool of the engine.
+ * @param engine the engine to create prewarm pool for
+ * @param vtable the vtable of the sessions
+ * @param obj the external object to associate with the pool
+ * @return the pool, or NULL if the pool isn't configured
+ * @remark The pool is configured by the params of the engine:
+ * "prewarm-pool-size" the max number of sessions to keep warmed up,
+ * "prewarm-max-idle" the max time a session is kept idle (msec),
+ * "prewarm-linger" the time the pool is replenished for after a borrow (msec).
+ */
+MRCP_DECLARE(mrcp_prewarm_pool_t*) mrcp_engine_prewarm_pool_create(
+									mrcp_engine_t *engine,
+									const mrcp_prewarm_vtable_t *vtable,
+									void *obj);
+
+/** Start the thread warming up the sessions */
+MRCP_DECLARE(apt_bool_t) mrcp_prewarm_pool_start(mrcp_prewarm_pool_t *prewarm_pool);
+
+/**
+ * Terminate (wait till complete) the thread and destroy the idle sessions.
+ * @param prewarm_pool the pool to terminate
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_prewarm_pool_terminate(mrcp_prewarm_pool_t *prewarm_pool);
+
+/**
+ * Borrow a warmed up session.
+ * @param prewarm_pool the pool to borrow from (NULL if not used)
+ * @return the session, or NULL on a miss (the session is to be created on demand)
+ */
+MRCP_DECLARE(void*) mrcp_prewarm_pool_borrow(mrcp_prewarm_pool_t *prewarm_pool);
+
+/**
+ * Record the latency of a handshake with the service.
+ * @param prewarm_pool the pool to record in (NULL if not used)
+ * @param latency the time the handshake took, usec
+ */
+MRCP_DECLARE(void) mrcp_prewarm_pool_handshake_record(mrcp_prewarm_pool_t *prewarm_pool, apr_interval_time_t latency);
+
+/** Get the external object associated with the pool */
+MRCP_DECLARE(void*) mrcp_prewarm_pool_object_get(const mrcp_prewarm_pool_t *prewarm_pool);
+
+/** Get the statistics of the pool */
+MRCP_DECLARE(void) mrcp_prewarm_pool_stats_get(mrcp_prewarm_pool_t *prewarm_pool, mrcp_prewarm_stats_t *stats);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_ENGINE_PREWARM_H */
@@ -131,7 +131,7 @@ struct mrcp_engine_t {
 	/** Config of engine */
 	mrcp_engine_config_t              *config;
 	/** Number of simultaneous channels currently in use */
-	apr_size_t                         cur_channel_count;
+	volatile apr_uint32_t              cur_channel_count;
 	/** Is engine successfully opened */
 	apt_bool_t                         is_open;
 	/** Pool to allocate memory from */
@@ -145,6 +145,8 @@ struct mrcp_engine_t {
 struct mrcp_engine_config_t {
 	/** Max number of simultaneous channels */
 	apr_size_t   max_channel_count;
+	/** Number of worker threads of the engine (0 - default) */
+	apr_size_t   worker_count;
 	/** Table of name/value string params */
 	apr_table_t *params;
 };
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_ENGINE_WORKER_H
+#define MRCP_ENGINE_WORKER_H
+
+/**
+ * @file mrcp_engine_worker.h
+ * @brief Worker Pool of Engine Channels
+ *
+ * A worker pool replaces the single consumer task of a plugin, so that the
+ * requests of different channels (e.g. concurrent SPEAK requests doing
+ * blocking SDK calls) are processed in parallel. Each channel is assigned
+ * a worker on creation and signals all its messages to that worker, so the
+ * messages of a channel are still processed one at a time in order.
+ */
+
+#include "mrcp_engine_types.h"
+#include "apt_task.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default number of workers of an engine */
+#define MRCP_ENGINE_DEFAULT_WORKER_COUNT 4
+
+/** Opaque worker pool declaration */
+typedef struct mrcp_worker_pool_t mrcp_worker_pool_t;
+
+/** Prototype of message handler of a worker */
+typedef apt_bool_t (*mrcp_worker_msg_process_f)(apt_task_t *task, apt_task_msg_t *msg);
+
+/**
+ * Create worker pool.
+ * @param worker_count the number of workers
+ * @param name the name of the pool (workers are named after it)
+ * @param obj the external object to associate with the workers
+ * @param msg_size the size of context specific data of task messages
+ * @param process_msg the message handler of the workers
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_worker_pool_t*) mrcp_worker_pool_create(
+									apr_size_t worker_count,
+									const char *name,
+									void *obj,
+									apr_size_t msg_size,
+									mrcp_worker_msg_process_f process_msg,
+									apr_pool_t *pool);
+
+/**
+ * Create worker pool of the engine.
+ * @param engine the engine to create worker pool for
+ * @param msg_size the size of context specific data of task messages
+ * @param process_msg the message handler of the workers
+ * @remark The number of workers is set by the <worker-count> element of the engine
+ * in the configuration, the engine object is associated with the workers.
+ */
+MRCP_DECLARE(mrcp_worker_pool_t*) mrcp_engine_worker_pool_create(
+									mrcp_engine_t *engine,
+									apr_size_t msg_size,
+									mrcp_worker_msg_process_f process_msg);
+
+/** Start the workers */
+MRCP_DECLARE(apt_bool_t) mrcp_worker_pool_start(mrcp_worker_pool_t *worker_pool);
+
+/** Terminate (wait till complete) and destroy the workers */
+MRCP_DECLARE(apt_bool_t) mrcp_worker_pool_terminate(mrcp_worker_pool_t *worker_pool);
+
+/**
+ * Assign a worker (round-robin).
+ * @param worker_pool the pool to assign worker from
+ * @return the task to signal all the messages of a channel to
+ */
+MRCP_DECLARE(apt_task_t*) mrcp_worker_pool_task_assign(mrcp_worker_pool_t *worker_pool);
+
+/** Get the number of workers */
+MRCP_DECLARE(apr_size_t) mrcp_worker_pool_count_get(const mrcp_worker_pool_t *worker_pool);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_ENGINE_WORKER_H */
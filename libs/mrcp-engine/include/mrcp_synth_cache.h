@@ -0,0 +1,161 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_SYNTH_CACHE_H
+#define MRCP_SYNTH_CACHE_H
+
+/**
+ * @file mrcp_synth_cache.h
+ * @brief Cache of Synthesized Audio
+ *
+ * The cache is shared by the channels of a synthesizer engine and maps a SPEAK
+ * request to the audio synthesized for it earlier. The key is composed of the
+ * normalized body (runs of white space collapsed) and the headers affecting the
+ * synthesis (content type, speech language, voice and prosody params), as well
+ * as the codec of the source stream.
+ *
+ * Entries are kept in memory, the least recently used ones are evicted once the
+ * configured size is exceeded. Optionally, entries are also stored in a directory,
+ * which is looked up (the files are memory-mapped) on a miss of the memory tier
+ * and survives restarts. Entries are reference counted, so an entry being played
+ * is never invalidated by eviction.
+ */
+
+#include "mrcp_engine_types.h"
+#include "mpf_codec_descriptor.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max size of audio of an entry in bytes */
+#define MRCP_SYNTH_CACHE_DEFAULT_MAX_ENTRY_SIZE (1024 * 1024)
+
+/** Opaque cache declaration */
+typedef struct mrcp_synth_cache_t mrcp_synth_cache_t;
+/** Opaque cache entry declaration */
+typedef struct mrcp_synth_cache_entry_t mrcp_synth_cache_entry_t;
+/** Opaque cache record declaration */
+typedef struct mrcp_synth_cache_record_t mrcp_synth_cache_record_t;
+/** Cache statistics declaration */
+typedef struct mrcp_synth_cache_stats_t mrcp_synth_cache_stats_t;
+
+/** Cache statistics */
+struct mrcp_synth_cache_stats_t {
+	/** Number of lookups served from memory */
+	apr_size_t memory_hits;
+	/** Number of lookups served from the directory */
+	apr_size_t disk_hits;
+	/** Number of lookups missed */
+	apr_size_t misses;
+	/** Number of entries inserted */
+	apr_size_t insertions;
+	/** Number of entries evicted from memory */
+	apr_size_t evictions;
+	/** Number of entries in memory */
+	apr_size_t entry_count;
+	/** Size of audio in memory in bytes */
+	apr_size_t size;
+};
+
+/**
+ * Create cache.
+ * @param capacity the max size of audio kept in memory in bytes
+ * @param max_entry_size the max size of audio of an entry in bytes (larger audio isn't cached)
+ * @param dir_path the directory to store entries in (NULL if not used)
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_synth_cache_t*) mrcp_synth_cache_create(
+									apr_size_t capacity,
+									apr_size_t max_entry_size,
+									const char *dir_path,
+									apr_pool_t *pool);
+
+/**
+ * Create cache of the engine.
+ * @param engine the engine to create cache for
+ * @return the cache, or NULL if the cache isn't configured
+ * @remark The cache is configured by the params of the engine:
+ * "tts-cache-size" the max size of audio kept in memory (KB),
+ * "tts-cache-entry-size" the max size of audio of an entry (KB),
+ * "tts-cache-dir" the directory to store entries in.
+ */
+MRCP_DECLARE(mrcp_synth_cache_t*) mrcp_engine_synth_cache_create(mrcp_engine_t *engine);
+
+/**
+ * Destroy cache.
+ * @param cache the cache to destroy
+ * @remark The entries still referenced are destroyed on release.
+ */
+MRCP_DECLARE(void) mrcp_synth_cache_destroy(mrcp_synth_cache_t *cache);
+
+/**
+ * Generate the key of a SPEAK request.
+ * @param request the SPEAK request
+ * @param descriptor the codec descriptor of the source stream
+ * @param pool the pool to allocate the key from
+ */
+MRCP_DECLARE(const char*) mrcp_synth_cache_key_generate(
+									const mrcp_message_t *request,
+									const mpf_codec_descriptor_t *descriptor,
+									apr_pool_t *pool);
+
+/**
+ * Look up an entry.
+ * @param cache the cache to look up in
+ * @param key the key to look up
+ * @return the referenced entry (to release once done), or NULL on a miss
+ */
+MRCP_DECLARE(mrcp_synth_cache_entry_t*) mrcp_synth_cache_lookup(mrcp_synth_cache_t *cache, const char *key);
+
+/** Get the audio of the entry */
+MRCP_DECLARE(const apr_byte_t*) mrcp_synth_cache_entry_data_get(const mrcp_synth_cache_entry_t *entry, apr_size_t *size);
+
+/** Release a reference to the entry */
+MRCP_DECLARE(void) mrcp_synth_cache_entry_release(mrcp_synth_cache_entry_t *entry);
+
+/**
+ * Begin recording of the audio synthesized for a key.
+ * @param cache the cache to insert the entry into
+ * @param key the key of the entry
+ */
+MRCP_DECLARE(mrcp_synth_cache_record_t*) mrcp_synth_cache_record_begin(mrcp_synth_cache_t *cache, const char *key);
+
+/**
+ * Write synthesized audio to the record.
+ * @param record the record to write to
+ * @param data the audio data to write
+ * @param size the size of data in bytes
+ * @return FALSE if the audio doesn't fit in an entry (the record is going to be discarded)
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_cache_record_write(mrcp_synth_cache_record_t *record, const void *data, apr_size_t size);
+
+/**
+ * Insert the recorded audio into the cache and destroy the record.
+ * @param record the record to commit
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_cache_record_commit(mrcp_synth_cache_record_t *record);
+
+/**
+ * Discard the recorded audio and destroy the record.
+ * @param record the record to discard
+ */
+MRCP_DECLARE(void) mrcp_synth_cache_record_discard(mrcp_synth_cache_record_t *record);
+
+/** Get the statistics of the cache */
+MRCP_DECLARE(void) mrcp_synth_cache_stats_get(mrcp_synth_cache_t *cache, mrcp_synth_cache_stats_t *stats);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_SYNTH_CACHE_H */
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <apr_atomic.h>
+#include "mrcp_engine_feeder.h"
+#include "mrcp_engine_worker.h"
+#include "mrcp_engine_impl.h"
+#include "mpf_audio_ring.h"
+#include "apt_consumer_task.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+#define FEEDER_WORKER_COUNT_PARAM "feeder-worker-count"
+
+/** Feeder pool */
+struct mrcp_feeder_pool_t {
+	/** Workers the feeders are pinned to */
+	mrcp_worker_pool_t *worker_pool;
+};
+
+/** Feeder */
+struct mrcp_feeder_t {
+	/** Memory pool of the feeder */
+	apr_pool_t                 *pool;
+	/** External object */
+	void                       *obj;
+	/** Feeder vtable */
+	const mrcp_feeder_vtable_t *vtable;
+	/** Worker the feeder is pinned to */
+	apt_task_t                 *worker;
+	/** Audio ring (MPF engine thread to worker) */
+	mpf_audio_ring_t           *ring;
+	/** Buffer the audio is read from the ring to */
+	apr_byte_t                 *chunk;
+
+	/** Total number of bytes written to the ring (producer) */
+	volatile apr_uint32_t       write_count;
+	/** Total number of bytes read from the ring (worker) */
+	apr_uint32_t                read_count;
+	/** Whether the feeder is closed (no audio accepted) */
+	volatile apr_uint32_t       closed;
+	/** Whether the close request is processed (worker) */
+	apt_bool_t                  close_processed;
+	/** Number of references (owner plus pending messages) */
+	volatile apr_uint32_t       ref_count;
+	/** Overrun reported so far (worker) */
+	apr_size_t                  overrun_reported;
+
+	/** Timer the deferred command is processed by (worker) */
+	apt_timer_t                *timer;
+	/** Whether the deferred command is pending (worker) */
+	apt_bool_t                  deferred;
+	/** Deferred command (worker) */
+	int                         deferred_command;
+	/** Argument of the deferred command (worker) */
+	void                       *deferred_arg;
+};
+
+/** Feeder message types */
+typedef enum {
+	FEEDER_MSG_DRAIN,
+	FEEDER_MSG_COMMAND,
+	FEEDER_MSG_CLOSE
+} feeder_msg_type_e;
+
+/** Feeder message data */
+typedef struct {
+	mrcp_feeder_t *feeder;
+	int            command;
+	void          *arg;
+	/** Total number of bytes written to the ring by the time the message is posted */
+	apr_uint32_t   mark;
+} feeder_msg_data_t;
+
+static apt_bool_t mrcp_feeder_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+
+
+/** Create feeder pool */
+MRCP_DECLARE(mrcp_feeder_pool_t*) mrcp_feeder_pool_create(apr_size_t worker_count, const char *name, apr_pool_t *pool)
+{
+	mrcp_feeder_pool_t *feeder_pool = apr_palloc(pool,sizeof(mrcp_feeder_pool_t));
+	if(!name) {
+		name = "Feeder";
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Feeder Pool [%s]",name);
+	feeder_pool->worker_pool = mrcp_worker_pool_create(
+								worker_count,
+								apr_psprintf(pool,"%s Feeder",name),
+								feeder_pool,
+								sizeof(feeder_msg_data_t),
+								mrcp_feeder_msg_process,
+								pool);
+	if(!feeder_pool->worker_pool) {
+		return NULL;
+	}
+	return feeder_pool;
+}
+
+/** Create feeder pool of the engine */
+MRCP_DECLARE(mrcp_feeder_pool_t*) mrcp_engine_feeder_pool_create(mrcp_engine_t *engine)
+{
+	apr_size_t worker_count = MRCP_FEEDER_DEFAULT_WORKER_COUNT;
+	const char *value = mrcp_engine_param_get(engine,FEEDER_WORKER_COUNT_PARAM);
+	if(value) {
+		worker_count = atol(value);
+	}
+	return mrcp_feeder_pool_create(worker_count,engine->id,engine->pool);
+}
+
+/** Start the workers of the feeder pool */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_pool_start(mrcp_feeder_pool_t *feeder_pool)
+{
+	return mrcp_worker_pool_start(feeder_pool->worker_pool);
+}
+
+/** Terminate and destroy the workers of the feeder pool */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_pool_terminate(mrcp_feeder_pool_t *feeder_pool)
+{
+	return mrcp_worker_pool_terminate(feeder_pool->worker_pool);
+}
+
+/** Create feeder */
+MRCP_DECLARE(mrcp_feeder_t*) mrcp_feeder_create(
+								mrcp_feeder_pool_t *feeder_pool,
+								const mrcp_feeder_vtable_t *vtable,
+								void *obj,
+								apr_size_t capacity)
+{
+	mrcp_feeder_t *feeder;
+	apt_task_t *worker;
+	apr_pool_t *pool;
+	if(!feeder_pool || !vtable) {
+		return NULL;
+	}
+	worker = mrcp_worker_pool_task_assign(feeder_pool->worker_pool);
+	if(!worker) {
+		return NULL;
+	}
+	pool = apt_pool_create();
+	if(!pool) {
+		return NULL;
+	}
+	if(!capacity) {
+		capacity = MRCP_FEEDER_DEFAULT_CAPACITY;
+	}
+
+	feeder = apr_palloc(pool,sizeof(mrcp_feeder_t));
+	feeder->pool = pool;
+	feeder->obj = obj;
+	feeder->vtable = vtable;
+	feeder->worker = worker;
+	feeder->ring = mpf_audio_ring_create(capacity,pool);
+	feeder->chunk = apr_palloc(pool,MRCP_FEEDER_CHUNK_SIZE);
+	feeder->write_count = 0;
+	feeder->read_count = 0;
+	feeder->closed = 0;
+	feeder->close_processed = FALSE;
+	feeder->ref_count = 1;
+	feeder->overrun_reported = 0;
+	feeder->timer = NULL;
+	feeder->deferred = FALSE;
+	feeder->deferred_command = 0;
+	feeder->deferred_arg = NULL;
+	return feeder;
+}
+
+/** Release a reference to the feeder, the last one destroys the feeder */
+static void mrcp_feeder_release(mrcp_feeder_t *feeder)
+{
+	if(apr_atomic_dec32(&feeder->ref_count) == 0) {
+		apr_pool_destroy(feeder->pool);
+	}
+}
+
+/** Destroy feeder */
+MRCP_DECLARE(void) mrcp_feeder_destroy(mrcp_feeder_t *feeder)
+{
+	apr_atomic_set32(&feeder->closed,1);
+	mrcp_feeder_release(feeder);
+}
+
+/** Get external object associated with the feeder */
+MRCP_DECLARE(void*) mrcp_feeder_object_get(const mrcp_feeder_t *feeder)
+{
+	return feeder->obj;
+}
+
+/** Post message to the worker the feeder is pinned to */
+static apt_bool_t mrcp_feeder_msg_signal(mrcp_feeder_t *feeder, feeder_msg_type_e type, int command, void *arg)
+{
+	feeder_msg_data_t *data;
+	apt_task_msg_t *msg = apt_task_msg_get(feeder->worker);
+	if(!msg) {
+		return FALSE;
+	}
+	msg->type = TASK_MSG_USER;
+	msg->sub_type = type;
+	data = (feeder_msg_data_t*) msg->data;
+	data->feeder = feeder;
+	data->command = command;
+	data->arg = arg;
+	data->mark = apr_atomic_read32(&feeder->write_count);
+
+	apr_atomic_inc32(&feeder->ref_count);
+	if(apt_task_msg_signal(feeder->worker,msg) == FALSE) {
+		mrcp_feeder_release(feeder);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Write audio to the feeder */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_audio_write(mrcp_feeder_t *feeder, const void *data, apr_size_t size)
+{
+	apr_size_t written;
+	if(apr_atomic_read32(&feeder->closed)) {
+		return FALSE;
+	}
+
+	written = mpf_audio_ring_audio_write(feeder->ring,data,size);
+	if(written) {
+		apr_atomic_add32(&feeder->write_count,(apr_uint32_t)written);
+		/* the drain request is marked with the audio written so far, so that
+		the audio is never passed ahead of a command posted earlier */
+		mrcp_feeder_msg_signal(feeder,FEEDER_MSG_DRAIN,0,NULL);
+	}
+	return written == size ? TRUE : FALSE;
+}
+
+/** Post command to the feeder */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_command_post(mrcp_feeder_t *feeder, int command, void *arg)
+{
+	return mrcp_feeder_msg_signal(feeder,FEEDER_MSG_COMMAND,command,arg);
+}
+
+/** Process the deferred command once the timer elapses (worker) */
+static void mrcp_feeder_timer_proc(apt_timer_t *timer, void *obj)
+{
+	mrcp_feeder_t *feeder = obj;
+	feeder->deferred = FALSE;
+	if(feeder->close_processed == FALSE && feeder->vtable->on_command) {
+		feeder->vtable->on_command(feeder,feeder->deferred_command,feeder->deferred_arg);
+	}
+	/* release the reference held by the timer */
+	mrcp_feeder_release(feeder);
+}
+
+/** Defer command to the feeder */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_command_defer(mrcp_feeder_t *feeder, int command, void *arg, apr_uint32_t timeout)
+{
+	if(feeder->close_processed == TRUE) {
+		return FALSE;
+	}
+	if(!feeder->timer) {
+		apt_consumer_task_t *consumer_task = apt_task_object_get(feeder->worker);
+		feeder->timer = apt_consumer_task_timer_create(consumer_task,mrcp_feeder_timer_proc,feeder,feeder->pool);
+		if(!feeder->timer) {
+			return FALSE;
+		}
+	}
+
+	if(apt_timer_set(feeder->timer,timeout) == FALSE) {
+		return FALSE;
+	}
+	if(feeder->deferred == FALSE) {
+		/* the timer holds a reference while set */
+		apr_atomic_inc32(&feeder->ref_count);
+		feeder->deferred = TRUE;
+	}
+	feeder->deferred_command = command;
+	feeder->deferred_arg = arg;
+	return TRUE;
+}
+
+/** Close the feeder */
+MRCP_DECLARE(apt_bool_t) mrcp_feeder_close(mrcp_feeder_t *feeder)
+{
+	if(apr_atomic_xchg32(&feeder->closed,1)) {
+		/* already closed */
+		return FALSE;
+	}
+	return mrcp_feeder_msg_signal(feeder,FEEDER_MSG_CLOSE,0,NULL);
+}
+
+/** Get the total number of bytes discarded by the ring being full */
+MRCP_DECLARE(apr_size_t) mrcp_feeder_overrun_get(const mrcp_feeder_t *feeder)
+{
+	return mpf_audio_ring_overrun_get(feeder->ring);
+}
+
+/** Pass the audio written up to the mark to the audio handler (worker) */
+static void mrcp_feeder_drain(mrcp_feeder_t *feeder, apr_uint32_t mark)
+{
+	mpf_frame_t frame;
+	apr_uint32_t size;
+	apr_size_t overrun;
+	if((apr_int32_t)(mark - feeder->read_count) <= 0) {
+		/* already passed by an earlier request */
+		return;
+	}
+	while(feeder->read_count != mark) {
+		size = mark - feeder->read_count;
+		if(size > MRCP_FEEDER_CHUNK_SIZE) {
+			size = MRCP_FEEDER_CHUNK_SIZE;
+		}
+		frame.type = MEDIA_FRAME_TYPE_NONE;
+		frame.marker = MPF_MARKER_NONE;
+		frame.codec_frame.buffer = feeder->chunk;
+		frame.codec_frame.size = size;
+		mpf_audio_ring_frame_read(feeder->ring,&frame);
+		feeder->read_count += size;
+
+		if(feeder->vtable->on_audio) {
+			feeder->vtable->on_audio(feeder,feeder->chunk,size);
+		}
+	}
+
+	overrun = mpf_audio_ring_overrun_get(feeder->ring);
+	if(overrun != feeder->overrun_reported) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Feeder Overrun: %"APR_SIZE_T_FMT" bytes discarded",
+			overrun - feeder->overrun_reported);
+		feeder->overrun_reported = overrun;
+	}
+}
+
+/** Process feeder message (worker) */
+static apt_bool_t mrcp_feeder_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	feeder_msg_data_t *data = (feeder_msg_data_t*) msg->data;
+	mrcp_feeder_t *feeder = data->feeder;
+	if(feeder->close_processed == TRUE) {
+		/* late request, the handlers are no longer invoked */
+		mrcp_feeder_release(feeder);
+		return TRUE;
+	}
+
+	switch(msg->sub_type) {
+		case FEEDER_MSG_DRAIN:
+			mrcp_feeder_drain(feeder,data->mark);
+			break;
+		case FEEDER_MSG_COMMAND:
+			mrcp_feeder_drain(feeder,data->mark);
+			if(feeder->vtable->on_command) {
+				feeder->vtable->on_command(feeder,data->command,data->arg);
+			}
+			break;
+		case FEEDER_MSG_CLOSE:
+			mpf_audio_ring_flush(feeder->ring);
+			feeder->read_count = apr_atomic_read32(&feeder->write_count);
+			feeder->close_processed = TRUE;
+			if(feeder->deferred == TRUE) {
+				/* discard the deferred command */
+				apt_timer_kill(feeder->timer);
+				feeder->deferred = FALSE;
+				mrcp_feeder_release(feeder);
+			}
+			if(feeder->vtable->on_close) {
+				feeder->vtable->on_close(feeder);
+			}
+			break;
+		default:
+			break;
+	}
+	mrcp_feeder_release(feeder);
+	return TRUE;
+}
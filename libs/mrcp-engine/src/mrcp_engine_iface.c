@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_engine_iface.h"
 #include "apt_log.h"
 
@@ -64,18 +65,27 @@ void mrcp_engine_on_close(mrcp_engine_t *engine)
 mrcp_engine_channel_t* mrcp_engine_channel_virtual_create(mrcp_engine_t *engine, mrcp_version_e mrcp_version, apr_pool_t *pool)
 {
 	mrcp_engine_channel_t *channel;
+	apr_uint32_t count;
 	if(engine->is_open != TRUE) {
 		return NULL;
 	}
-	if(engine->config->max_channel_count && engine->cur_channel_count >= engine->config->max_channel_count) {
-		apt_log(APT_LOG_MARK, APT_PRIO_NOTICE, "Maximum channel count %"APR_SIZE_T_FMT" exceeded for engine [%s]",
-			engine->config->max_channel_count, engine->id);
-		return NULL;
+	/* reserve the channel first, sessions may be processed concurrently */
+	do {
+		count = apr_atomic_read32(&engine->cur_channel_count);
+		if(engine->config->max_channel_count && count >= engine->config->max_channel_count) {
+			apt_log(APT_LOG_MARK, APT_PRIO_NOTICE, "Maximum channel count %"APR_SIZE_T_FMT" exceeded for engine [%s]",
+				engine->config->max_channel_count, engine->id);
+			return NULL;
+		}
 	}
+	while(apr_atomic_cas32(&engine->cur_channel_count,count + 1,count) != count);
+
 	channel = engine->method_vtable->create_channel(engine,pool);
 	if(channel) {
 		channel->mrcp_version = mrcp_version;
-		engine->cur_channel_count++;
+	}
+	else {
+		apr_atomic_dec32(&engine->cur_channel_count);
 	}
 	return channel;
 }
@@ -84,8 +94,8 @@ mrcp_engine_channel_t* mrcp_engine_channel_virtual_create(mrcp_engine_t *engine,
 apt_bool_t mrcp_engine_channel_virtual_destroy(mrcp_engine_channel_t *channel)
 {
 	mrcp_engine_t *engine = channel->engine;
-	if(engine->cur_channel_count) {
-		engine->cur_channel_count--;
+	if(apr_atomic_read32(&engine->cur_channel_count)) {
+		apr_atomic_dec32(&engine->cur_channel_count);
 	}
 	return channel->method_vtable->destroy(channel);
 }
@@ -95,6 +105,7 @@ mrcp_engine_config_t* mrcp_engine_config_alloc(apr_pool_t *pool)
 {
 	mrcp_engine_config_t *config = apr_palloc(pool,sizeof(mrcp_engine_config_t));
 	config->max_channel_count = 0;
+	config->worker_count = 0;
 	config->params = NULL;
 	return config;
 }
@@ -0,0 +1,418 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_atomic.h>
+#include <apr_thread_mutex.h>
+#include "mrcp_engine_playout.h"
+#include "mrcp_engine_impl.h"
+#include "mrcp_message.h"
+#include "mpf_audio_ring.h"
+
+#define PLAYOUT_PREBUFFER_PARAM "playout-prebuffer"
+#define PLAYOUT_CAPACITY_PARAM  "playout-capacity"
+
+/** Interval to check the ring for space at, usec */
+#define PLAYOUT_WRITE_WAIT_INTERVAL 10000
+
+/** Playout */
+struct mrcp_playout_t {
+	/** Audio ring (producer to MPF engine) */
+	mpf_audio_ring_t     *ring;
+	/** Prebuffer in msec */
+	apr_size_t            prebuffer;
+	/** Prebuffer in bytes */
+	apr_size_t            prebuffer_size;
+	/** Size of CODEC_FRAME_TIME_BASE of audio in bytes */
+	apr_size_t            frame_size;
+	/** Overrun of the ring by the time the request is started */
+	apr_size_t            overrun_base;
+	/** Time the request is started */
+	apr_time_t            start_time;
+
+	/** Time the first byte of audio is received (producer) */
+	apr_time_t            first_byte_time;
+	/** Whether the whole audio is received (producer) */
+	volatile apr_uint32_t complete;
+	/** Whether the audio is flushed, the rest of it is discarded (consumer to producer) */
+	volatile apr_uint32_t flushed;
+
+	/** Whether playback is started (consumer) */
+	apt_bool_t            playing;
+	/** Whether playback is starving for audio (consumer) */
+	apt_bool_t            starving;
+	/** Time playback is started (consumer) */
+	apr_time_t            playback_time;
+	/** Number of underruns (consumer) */
+	apr_size_t            underrun_count;
+	/** Size of comfort silence inserted on underruns in bytes (consumer) */
+	apr_size_t            underrun_size;
+
+	/** Codec descriptor of the source stream */
+	const mpf_codec_descriptor_t *descriptor;
+	/** Record of the audio to insert into the cache on completion */
+	mrcp_synth_cache_record_t    *record;
+	/** Guard of the record, handed over between the request processing and producer threads */
+	apr_thread_mutex_t           *record_guard;
+	/** Cache entry played instead of the ring */
+	mrcp_synth_cache_entry_t     *entry;
+	/** Audio of the cache entry */
+	const apr_byte_t             *source;
+	/** Size of audio of the cache entry in bytes */
+	apr_size_t                    source_size;
+	/** Position in audio of the cache entry (consumer) */
+	apr_size_t                    source_pos;
+	/** Whether the cache entry is played */
+	volatile apr_uint32_t         cached;
+};
+
+static APR_INLINE apr_size_t mrcp_playout_msec_get(const mrcp_playout_t *playout, apr_size_t size)
+{
+	if(!playout->frame_size) {
+		return 0;
+	}
+	return size * CODEC_FRAME_TIME_BASE / playout->frame_size;
+}
+
+static APR_INLINE void mrcp_playout_silence_fill(mpf_frame_t *frame)
+{
+	memset(frame->codec_frame.buffer,0,frame->codec_frame.size);
+	frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+}
+
+/** Discard the audio recorded for the cache */
+MRCP_DECLARE(void) mrcp_playout_cache_discard(mrcp_playout_t *playout)
+{
+	apr_thread_mutex_lock(playout->record_guard);
+	if(playout->record) {
+		mrcp_synth_cache_record_discard(playout->record);
+		playout->record = NULL;
+	}
+	apr_thread_mutex_unlock(playout->record_guard);
+}
+
+/** Release the cache entry and discard the record */
+static void mrcp_playout_cache_reset(mrcp_playout_t *playout)
+{
+	apr_atomic_set32(&playout->cached,0);
+	if(playout->entry) {
+		mrcp_synth_cache_entry_release(playout->entry);
+		playout->entry = NULL;
+	}
+	playout->source = NULL;
+	playout->source_size = 0;
+	playout->source_pos = 0;
+	mrcp_playout_cache_discard(playout);
+}
+
+static apr_status_t mrcp_playout_cleanup(void *data)
+{
+	mrcp_playout_cache_reset(data);
+	return APR_SUCCESS;
+}
+
+/** Create playout */
+MRCP_DECLARE(mrcp_playout_t*) mrcp_playout_create(apr_size_t capacity, apr_size_t prebuffer, apr_pool_t *pool)
+{
+	mrcp_playout_t *playout = apr_palloc(pool,sizeof(mrcp_playout_t));
+	playout->ring = mpf_audio_ring_create(capacity,pool);
+	playout->prebuffer = prebuffer;
+	playout->prebuffer_size = 0;
+	playout->frame_size = 0;
+	playout->overrun_base = 0;
+	playout->start_time = 0;
+	playout->first_byte_time = 0;
+	playout->complete = 0;
+	playout->flushed = 0;
+	playout->playing = FALSE;
+	playout->starving = FALSE;
+	playout->playback_time = 0;
+	playout->underrun_count = 0;
+	playout->underrun_size = 0;
+	playout->descriptor = NULL;
+	playout->record = NULL;
+	playout->entry = NULL;
+	playout->source = NULL;
+	playout->source_size = 0;
+	playout->source_pos = 0;
+	playout->cached = 0;
+	playout->record_guard = NULL;
+	if(apr_thread_mutex_create(&playout->record_guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	apr_pool_cleanup_register(pool,playout,mrcp_playout_cleanup,apr_pool_cleanup_null);
+	return playout;
+}
+
+/** Create playout of the engine */
+MRCP_DECLARE(mrcp_playout_t*) mrcp_engine_playout_create(mrcp_engine_t *engine, apr_pool_t *pool)
+{
+	apr_size_t prebuffer = MRCP_PLAYOUT_DEFAULT_PREBUFFER;
+	apr_size_t capacity = MRCP_PLAYOUT_DEFAULT_CAPACITY;
+	const char *value = mrcp_engine_param_get(engine,PLAYOUT_PREBUFFER_PARAM);
+	if(value) {
+		prebuffer = atol(value);
+	}
+	value = mrcp_engine_param_get(engine,PLAYOUT_CAPACITY_PARAM);
+	if(value && atol(value) > 0) {
+		capacity = atol(value);
+	}
+	/* the ring must hold the prebuffer, otherwise playback starts on completion only */
+	if(capacity < prebuffer * 2) {
+		capacity = prebuffer * 2;
+	}
+	return mrcp_playout_create(capacity * MRCP_PLAYOUT_MSEC_SIZE,prebuffer,pool);
+}
+
+/** Start playout of a SPEAK request */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_start(mrcp_playout_t *playout, const mpf_codec_descriptor_t *descriptor)
+{
+	mrcp_playout_cache_reset(playout);
+	playout->descriptor = descriptor;
+	playout->frame_size = 0;
+	if(descriptor) {
+		playout->frame_size = mpf_codec_linear_frame_size_calculate(
+								(apr_uint16_t)descriptor->sampling_rate,
+								descriptor->channel_count);
+	}
+	playout->prebuffer_size = playout->prebuffer * playout->frame_size / CODEC_FRAME_TIME_BASE;
+	/* discard the audio written after the previous request is flushed */
+	mpf_audio_ring_flush(playout->ring);
+	playout->overrun_base = mpf_audio_ring_overrun_get(playout->ring);
+	playout->start_time = apr_time_now();
+	playout->first_byte_time = 0;
+	playout->playing = FALSE;
+	playout->starving = FALSE;
+	playout->playback_time = 0;
+	playout->underrun_count = 0;
+	playout->underrun_size = 0;
+	apr_atomic_set32(&playout->complete,0);
+	apr_atomic_set32(&playout->flushed,0);
+	return TRUE;
+}
+
+/** Look up the audio of the SPEAK request in the cache */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_cache_lookup(mrcp_playout_t *playout, mrcp_synth_cache_t *cache, const mrcp_message_t *request)
+{
+	const char *key;
+	mrcp_synth_cache_entry_t *entry;
+	if(!cache) {
+		return FALSE;
+	}
+
+	key = mrcp_synth_cache_key_generate(request,playout->descriptor,request->pool);
+	entry = mrcp_synth_cache_lookup(cache,key);
+	if(!entry) {
+		/* record the audio to be synthesized */
+		mrcp_synth_cache_record_t *record = mrcp_synth_cache_record_begin(cache,key);
+		apr_thread_mutex_lock(playout->record_guard);
+		if(playout->record) {
+			mrcp_synth_cache_record_discard(playout->record);
+		}
+		playout->record = record;
+		apr_thread_mutex_unlock(playout->record_guard);
+		return FALSE;
+	}
+
+	playout->entry = entry;
+	playout->source = mrcp_synth_cache_entry_data_get(entry,&playout->source_size);
+	playout->source_pos = 0;
+	playout->first_byte_time = apr_time_now();
+	/* publish the entry to the consumer */
+	apr_atomic_set32(&playout->cached,1);
+	return TRUE;
+}
+
+/** Write synthesized audio */
+MRCP_DECLARE(apr_size_t) mrcp_playout_audio_write(mrcp_playout_t *playout, const void *data, apr_size_t size)
+{
+	apr_size_t written;
+	if(!playout->first_byte_time && size) {
+		playout->first_byte_time = apr_time_now();
+	}
+	written = mpf_audio_ring_audio_write(playout->ring,data,size);
+	if(written) {
+		/* the record may be discarded by a request being started meanwhile */
+		apr_thread_mutex_lock(playout->record_guard);
+		if(playout->record) {
+			mrcp_synth_cache_record_write(playout->record,data,written);
+		}
+		apr_thread_mutex_unlock(playout->record_guard);
+	}
+	return written;
+}
+
+/** Write synthesized audio, waiting for the consumer to drain the ring */
+MRCP_DECLARE(apr_size_t) mrcp_playout_audio_write_wait(mrcp_playout_t *playout, const void *data, apr_size_t size, apr_size_t timeout)
+{
+	apr_size_t written = 0;
+	apr_size_t chunk;
+	apr_interval_time_t idle = 0;
+	while(written < size) {
+		if(apr_atomic_read32(&playout->flushed)) {
+			/* the rest of the audio is discarded on purpose, not counted as overrun */
+			return written;
+		}
+		/* write no more than fits, a partial write is counted as overrun by the ring */
+		chunk = mpf_audio_ring_space_get(playout->ring);
+		if(chunk > size - written) {
+			chunk = size - written;
+		}
+		if(chunk) {
+			written += mrcp_playout_audio_write(playout,(const apr_byte_t*)data + written,chunk);
+			idle = 0;
+			continue;
+		}
+		if(idle >= (apr_interval_time_t)timeout * 1000) {
+			/* the consumer doesn't drain the ring (paused or stalled), drop the rest */
+			written += mrcp_playout_audio_write(playout,(const apr_byte_t*)data + written,size - written);
+			break;
+		}
+		apr_sleep(PLAYOUT_WRITE_WAIT_INTERVAL);
+		idle += PLAYOUT_WRITE_WAIT_INTERVAL;
+	}
+	return written;
+}
+
+/** Complete the audio of the request */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_complete(mrcp_playout_t *playout)
+{
+	apt_bool_t status;
+	apr_thread_mutex_lock(playout->record_guard);
+	if(playout->record) {
+		/* audio dropped by the ring being full or discarded on STOP isn't cached */
+		if(apr_atomic_read32(&playout->flushed) == 0 &&
+			mpf_audio_ring_overrun_get(playout->ring) == playout->overrun_base) {
+			mrcp_synth_cache_record_commit(playout->record);
+		}
+		else {
+			mrcp_synth_cache_record_discard(playout->record);
+		}
+		playout->record = NULL;
+	}
+	apr_thread_mutex_unlock(playout->record_guard);
+	status = mpf_audio_ring_event_write(playout->ring,MEDIA_FRAME_TYPE_EVENT);
+	apr_atomic_set32(&playout->complete,1);
+	return status;
+}
+
+/** Read media frame from the cache entry */
+static apt_bool_t mrcp_playout_source_read(mrcp_playout_t *playout, mpf_frame_t *frame)
+{
+	apr_size_t size = playout->source_size - playout->source_pos;
+	if(playout->playing == FALSE) {
+		playout->playing = TRUE;
+		playout->playback_time = apr_time_now();
+	}
+
+	if(size > frame->codec_frame.size) {
+		size = frame->codec_frame.size;
+	}
+	memcpy(frame->codec_frame.buffer,playout->source + playout->source_pos,size);
+	if(size < frame->codec_frame.size) {
+		memset((apr_byte_t*)frame->codec_frame.buffer + size,0,frame->codec_frame.size - size);
+	}
+	playout->source_pos += size;
+	frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+	if(playout->source_pos == playout->source_size) {
+		frame->type |= MEDIA_FRAME_TYPE_EVENT;
+	}
+	return TRUE;
+}
+
+/** Read media frame */
+MRCP_DECLARE(apt_bool_t) mrcp_playout_frame_read(mrcp_playout_t *playout, mpf_frame_t *frame)
+{
+	apt_bool_t complete;
+	apr_size_t available;
+	if(apr_atomic_read32(&playout->cached)) {
+		return mrcp_playout_source_read(playout,frame);
+	}
+
+	/* the whole audio is in the ring once completion is observed */
+	complete = apr_atomic_read32(&playout->complete) ? TRUE : FALSE;
+	available = mpf_audio_ring_size_get(playout->ring);
+
+	if(playout->playing == FALSE) {
+		if(available < playout->prebuffer_size && complete == FALSE) {
+			/* prebuffering, play comfort silence */
+			mrcp_playout_silence_fill(frame);
+			return TRUE;
+		}
+		playout->playing = TRUE;
+		playout->playback_time = apr_time_now();
+	}
+
+	mpf_audio_ring_frame_read(playout->ring,frame);
+	if(available < frame->codec_frame.size && complete == FALSE) {
+		/* underrun, the rest of the frame is already filled with silence */
+		if(playout->starving == FALSE) {
+			playout->starving = TRUE;
+			playout->underrun_count++;
+		}
+		playout->underrun_size += frame->codec_frame.size - available;
+		frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+	}
+	else {
+		playout->starving = FALSE;
+	}
+	return TRUE;
+}
+
+/** Discard all the pending audio */
+MRCP_DECLARE(void) mrcp_playout_flush(mrcp_playout_t *playout)
+{
+	/* release the producer waiting for space first, so that it doesn't refill the ring */
+	apr_atomic_set32(&playout->flushed,1);
+	mpf_audio_ring_flush(playout->ring);
+	playout->source_pos = playout->source_size;
+}
+
+/** Get the statistics of the current request */
+MRCP_DECLARE(void) mrcp_playout_stats_get(const mrcp_playout_t *playout, mrcp_playout_stats_t *stats)
+{
+	stats->audio_received = playout->first_byte_time ? TRUE : FALSE;
+	stats->first_byte_latency = 0;
+	if(playout->first_byte_time > playout->start_time) {
+		stats->first_byte_latency = (apr_size_t)apr_time_as_msec(playout->first_byte_time - playout->start_time);
+	}
+	stats->playback_latency = 0;
+	if(playout->playback_time > playout->start_time) {
+		stats->playback_latency = (apr_size_t)apr_time_as_msec(playout->playback_time - playout->start_time);
+	}
+	stats->underrun_count = playout->underrun_count;
+	stats->underrun_duration = mrcp_playout_msec_get(playout,playout->underrun_size);
+	stats->overrun_size = mpf_audio_ring_overrun_get(playout->ring) - playout->overrun_base;
+}
+
+/** Log the statistics of the current request */
+MRCP_DECLARE(void) mrcp_playout_stats_log(const mrcp_playout_t *playout, const mrcp_message_t *request)
+{
+	mrcp_playout_stats_t stats;
+	if(!request) {
+		return;
+	}
+	mrcp_playout_stats_get(playout,&stats);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Playout Stats [first byte %"APR_SIZE_T_FMT" ms] [playback %"APR_SIZE_T_FMT" ms] "
+		"[underruns %"APR_SIZE_T_FMT", %"APR_SIZE_T_FMT" ms] [overruns %"APR_SIZE_T_FMT" bytes] "APT_SIDRES_FMT,
+		stats.first_byte_latency,
+		stats.playback_latency,
+		stats.underrun_count,
+		stats.underrun_duration,
+		stats.overrun_size,
+		MRCP_MESSAGE_SIDRES(request));
+}
@@ -0,0 +1,421 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include "mrcp_engine_prewarm.h"
+#include "mrcp_engine_impl.h"
+#include "apt_log.h"
+
+#define PREWARM_POOL_SIZE_PARAM     "prewarm-pool-size"
+#define PREWARM_MAX_IDLE_PARAM      "prewarm-max-idle"
+#define PREWARM_LINGER_PARAM        "prewarm-linger"
+
+/** Time to wait before warming up again once a warmup failed, usec */
+#define PREWARM_RETRY_INTERVAL      (1000 * 1000)
+/** Max time between the checks of the idle sessions, usec */
+#define PREWARM_CHECK_INTERVAL      (1000 * 1000)
+
+typedef struct mrcp_prewarm_slot_t mrcp_prewarm_slot_t;
+
+/** Idle session */
+struct mrcp_prewarm_slot_t {
+	/** The session */
+	void      *session;
+	/** The time the session was warmed up at */
+	apr_time_t warmup_time;
+};
+
+/** Prewarm pool */
+struct mrcp_prewarm_pool_t {
+	/** Vtable of the sessions */
+	const mrcp_prewarm_vtable_t *vtable;
+	/** External object */
+	void                        *obj;
+	/** Name of the pool */
+	const char                  *name;
+	/** Max number of sessions to keep warmed up */
+	apr_size_t                   size;
+	/** Max time a session is kept idle, usec */
+	apr_interval_time_t          max_idle;
+	/** Time the pool is replenished for after a borrow, usec */
+	apr_interval_time_t          linger;
+	/** Time between the checks of the idle sessions, usec */
+	apr_interval_time_t          check_interval;
+
+	/** Idle sessions, the oldest one first */
+	mrcp_prewarm_slot_t         *slots;
+	/** Number of idle sessions */
+	apr_size_t                   count;
+	/** Times of the last borrows (the demand), circular */
+	apr_time_t                  *borrow_times;
+	/** Index of the oldest borrow time */
+	apr_size_t                   borrow_index;
+	/** Indicates whether the thread is running */
+	apt_bool_t                   running;
+
+	/** Thread warming up the sessions */
+	apr_thread_t                *thread;
+	/** Guard of the idle sessions and statistics */
+	apr_thread_mutex_t          *mutex;
+	/** Wakes up the thread on a borrow or termination */
+	apr_thread_cond_t           *wakeup;
+
+	/** Statistics */
+	mrcp_prewarm_stats_t         stats;
+	/** Total handshake latency, usec */
+	apr_interval_time_t          handshake_total;
+	/** Max handshake latency, usec */
+	apr_interval_time_t          handshake_max;
+
+	/** Pool to allocate memory from */
+	apr_pool_t                  *pool;
+};
+
+/** Create prewarm pool */
+MRCP_DECLARE(mrcp_prewarm_pool_t*) mrcp_prewarm_pool_create(
+									apr_size_t size,
+									apr_size_t max_idle,
+									apr_size_t linger,
+									const char *name,
+									const mrcp_prewarm_vtable_t *vtable,
+									void *obj,
+									apr_pool_t *pool)
+{
+	mrcp_prewarm_pool_t *prewarm_pool;
+	if(!size || !vtable || !vtable->create || !vtable->destroy) {
+		return NULL;
+	}
+	if(!max_idle) {
+		max_idle = MRCP_PREWARM_DEFAULT_MAX_IDLE;
+	}
+	if(!linger) {
+		linger = MRCP_PREWARM_DEFAULT_LINGER;
+	}
+	if(!name) {
+		name = "Engine";
+	}
+
+	prewarm_pool = apr_palloc(pool,sizeof(mrcp_prewarm_pool_t));
+	prewarm_pool->vtable = vtable;
+	prewarm_pool->obj = obj;
+	prewarm_pool->name = name;
+	prewarm_pool->size = size;
+	prewarm_pool->max_idle = (apr_interval_time_t)max_idle * 1000;
+	prewarm_pool->linger = (apr_interval_time_t)linger * 1000;
+	/* check often enough to recycle a session before it's dropped by the service */
+	prewarm_pool->check_interval = prewarm_pool->max_idle / 4;
+	if(prewarm_pool->check_interval > PREWARM_CHECK_INTERVAL) {
+		prewarm_pool->check_interval = PREWARM_CHECK_INTERVAL;
+	}
+	prewarm_pool->slots = apr_palloc(pool,sizeof(mrcp_prewarm_slot_t) * size);
+	prewarm_pool->count = 0;
+	/* no demand until the first borrow */
+	prewarm_pool->borrow_times = apr_pcalloc(pool,sizeof(apr_time_t) * size);
+	prewarm_pool->borrow_index = 0;
+	prewarm_pool->running = FALSE;
+	prewarm_pool->thread = NULL;
+	prewarm_pool->wakeup = NULL;
+	memset(&prewarm_pool->stats,0,sizeof(mrcp_prewarm_stats_t));
+	prewarm_pool->handshake_total = 0;
+	prewarm_pool->handshake_max = 0;
+	prewarm_pool->pool = pool;
+
+	if(apr_thread_mutex_create(&prewarm_pool->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_thread_cond_create(&prewarm_pool->wakeup,pool) != APR_SUCCESS) {
+		apr_thread_mutex_destroy(prewarm_pool->mutex);
+		return NULL;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Prewarm Pool [%s] [%"APR_SIZE_T_FMT"] [max idle %"APR_SIZE_T_FMT" ms] [linger %"APR_SIZE_T_FMT" ms]",
+		name,size,max_idle,linger);
+	return prewarm_pool;
+}
+
+/** Create prewarm pool of the engine */
+MRCP_DECLARE(mrcp_prewarm_pool_t*) mrcp_engine_prewarm_pool_create(
+									mrcp_engine_t *engine,
+									const mrcp_prewarm_vtable_t *vtable,
+									void *obj)
+{
+	apr_size_t size = 0;
+	apr_size_t max_idle = MRCP_PREWARM_DEFAULT_MAX_IDLE;
+	apr_size_t linger = MRCP_PREWARM_DEFAULT_LINGER;
+	const char *value = mrcp_engine_param_get(engine,PREWARM_POOL_SIZE_PARAM);
+	if(value) {
+		size = atol(value);
+	}
+	value = mrcp_engine_param_get(engine,PREWARM_MAX_IDLE_PARAM);
+	if(value) {
+		max_idle = atol(value);
+	}
+	value = mrcp_engine_param_get(engine,PREWARM_LINGER_PARAM);
+	if(value) {
+		linger = atol(value);
+	}
+	if(!size) {
+		/* pool isn't configured */
+		return NULL;
+	}
+	return mrcp_prewarm_pool_create(size,max_idle,linger,engine->id,vtable,obj,engine->pool);
+}
+
+/** Check whether the idle session is to be recycled */
+static APR_INLINE apt_bool_t mrcp_prewarm_slot_expired(mrcp_prewarm_pool_t *prewarm_pool, mrcp_prewarm_slot_t *slot, apr_time_t now)
+{
+	if(now - slot->warmup_time >= prewarm_pool->max_idle) {
+		return TRUE;
+	}
+	if(prewarm_pool->vtable->check && prewarm_pool->vtable->check(prewarm_pool,slot->session) == FALSE) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/** Remove the idle session at the index */
+static void* mrcp_prewarm_slot_remove(mrcp_prewarm_pool_t *prewarm_pool, apr_size_t index)
+{
+	void *session = prewarm_pool->slots[index].session;
+	prewarm_pool->count--;
+	if(index < prewarm_pool->count) {
+		memmove(&prewarm_pool->slots[index],&prewarm_pool->slots[index+1],
+			sizeof(mrcp_prewarm_slot_t) * (prewarm_pool->count - index));
+	}
+	return session;
+}
+
+/** Remove the first idle session to be recycled (called with the pool locked) */
+static void* mrcp_prewarm_expired_remove(mrcp_prewarm_pool_t *prewarm_pool, apr_time_t now)
+{
+	apr_size_t i;
+	for(i=0; i<prewarm_pool->count; i++) {
+		if(mrcp_prewarm_slot_expired(prewarm_pool,&prewarm_pool->slots[i],now) == TRUE) {
+			return mrcp_prewarm_slot_remove(prewarm_pool,i);
+		}
+	}
+	return NULL;
+}
+
+/** Get the number of sessions borrowed within the linger time (called with the pool locked) */
+static apr_size_t mrcp_prewarm_demand_get(mrcp_prewarm_pool_t *prewarm_pool, apr_time_t now)
+{
+	apr_size_t i;
+	apr_size_t demand = 0;
+	for(i=0; i<prewarm_pool->size; i++) {
+		if(prewarm_pool->borrow_times[i] && now - prewarm_pool->borrow_times[i] < prewarm_pool->linger) {
+			demand++;
+		}
+	}
+	return demand;
+}
+
+static void* APR_THREAD_FUNC mrcp_prewarm_pool_run(apr_thread_t *thread, void *data)
+{
+	mrcp_prewarm_pool_t *prewarm_pool = data;
+	const mrcp_prewarm_vtable_t *vtable = prewarm_pool->vtable;
+	apr_time_t retry_time = 0;
+	apr_time_t now;
+	void *session;
+	void *recycled;
+
+	apr_thread_mutex_lock(prewarm_pool->mutex);
+	while(prewarm_pool->running == TRUE) {
+		now = apr_time_now();
+		/* recycle one session aged out or dropped by the service at a time and replace it
+		before the next one, the sessions warmed up together also age out together */
+		recycled = mrcp_prewarm_expired_remove(prewarm_pool,now);
+		if(recycled) {
+			prewarm_pool->stats.recycles++;
+			apr_thread_mutex_unlock(prewarm_pool->mutex);
+			vtable->destroy(prewarm_pool,recycled);
+			apr_thread_mutex_lock(prewarm_pool->mutex);
+		}
+
+		if(vtable->maintain) {
+			apr_thread_mutex_unlock(prewarm_pool->mutex);
+			vtable->maintain(prewarm_pool);
+			apr_thread_mutex_lock(prewarm_pool->mutex);
+		}
+		if(prewarm_pool->running == FALSE) {
+			break;
+		}
+
+		/* replace only as many sessions as borrowed lately, the idle ones beyond are let age out */
+		if(prewarm_pool->count < mrcp_prewarm_demand_get(prewarm_pool,now) && now >= retry_time) {
+			/* warm up a session with the pool unlocked, it takes a round trip to the service */
+			apr_thread_mutex_unlock(prewarm_pool->mutex);
+			session = vtable->create(prewarm_pool);
+			apr_thread_mutex_lock(prewarm_pool->mutex);
+			if(!session) {
+				prewarm_pool->stats.failures++;
+				retry_time = apr_time_now() + PREWARM_RETRY_INTERVAL;
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Warm up Session [%s]",prewarm_pool->name);
+			}
+			else if(prewarm_pool->running == FALSE) {
+				apr_thread_mutex_unlock(prewarm_pool->mutex);
+				vtable->destroy(prewarm_pool,session);
+				apr_thread_mutex_lock(prewarm_pool->mutex);
+				break;
+			}
+			else {
+				prewarm_pool->slots[prewarm_pool->count].session = session;
+				prewarm_pool->slots[prewarm_pool->count].warmup_time = apr_time_now();
+				prewarm_pool->count++;
+				prewarm_pool->stats.warmups++;
+				continue;
+			}
+		}
+
+		if(recycled) {
+			/* check for more sessions to recycle */
+			continue;
+		}
+		apr_thread_cond_timedwait(prewarm_pool->wakeup,prewarm_pool->mutex,prewarm_pool->check_interval);
+	}
+	apr_thread_mutex_unlock(prewarm_pool->mutex);
+
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+/** Start the thread warming up the sessions */
+MRCP_DECLARE(apt_bool_t) mrcp_prewarm_pool_start(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	prewarm_pool->running = TRUE;
+	if(apr_thread_create(&prewarm_pool->thread,NULL,mrcp_prewarm_pool_run,prewarm_pool,prewarm_pool->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Prewarm Pool [%s]",prewarm_pool->name);
+		prewarm_pool->running = FALSE;
+		prewarm_pool->thread = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Terminate the thread and destroy the idle sessions */
+MRCP_DECLARE(apt_bool_t) mrcp_prewarm_pool_terminate(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	apr_status_t retval;
+	mrcp_prewarm_stats_t stats;
+	if(prewarm_pool->thread) {
+		apr_thread_mutex_lock(prewarm_pool->mutex);
+		prewarm_pool->running = FALSE;
+		apr_thread_cond_signal(prewarm_pool->wakeup);
+		apr_thread_mutex_unlock(prewarm_pool->mutex);
+		apr_thread_join(&retval,prewarm_pool->thread);
+		prewarm_pool->thread = NULL;
+	}
+
+	/* the thread is gone, no need to lock */
+	while(prewarm_pool->count) {
+		prewarm_pool->vtable->destroy(prewarm_pool,mrcp_prewarm_slot_remove(prewarm_pool,prewarm_pool->count-1));
+	}
+
+	mrcp_prewarm_pool_stats_get(prewarm_pool,&stats);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Terminate Prewarm Pool [%s] [hits %"APR_SIZE_T_FMT"] [misses %"APR_SIZE_T_FMT"] "
+		"[warmups %"APR_SIZE_T_FMT", %"APR_SIZE_T_FMT" failed, %"APR_SIZE_T_FMT" recycled] "
+		"[handshakes %"APR_SIZE_T_FMT", avg %"APR_SIZE_T_FMT" ms, max %"APR_SIZE_T_FMT" ms]",
+		prewarm_pool->name,
+		stats.hits,
+		stats.misses,
+		stats.warmups,
+		stats.failures,
+		stats.recycles,
+		stats.handshake_count,
+		stats.handshake_avg,
+		stats.handshake_max);
+
+	apr_thread_cond_destroy(prewarm_pool->wakeup);
+	apr_thread_mutex_destroy(prewarm_pool->mutex);
+	return TRUE;
+}
+
+/** Borrow a warmed up session */
+MRCP_DECLARE(void*) mrcp_prewarm_pool_borrow(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	apr_size_t i;
+	apr_time_t now;
+	void *session = NULL;
+	if(!prewarm_pool) {
+		return NULL;
+	}
+
+	now = apr_time_now();
+	apr_thread_mutex_lock(prewarm_pool->mutex);
+	/* take the oldest usable session, the expired ones are left to the thread to destroy */
+	for(i=0; i<prewarm_pool->count; i++) {
+		if(mrcp_prewarm_slot_expired(prewarm_pool,&prewarm_pool->slots[i],now) == FALSE) {
+			session = mrcp_prewarm_slot_remove(prewarm_pool,i);
+			break;
+		}
+	}
+	if(session) {
+		prewarm_pool->stats.hits++;
+	}
+	else {
+		prewarm_pool->stats.misses++;
+	}
+	/* record the demand and wake up the thread to replenish the pool */
+	prewarm_pool->borrow_times[prewarm_pool->borrow_index] = now;
+	prewarm_pool->borrow_index = (prewarm_pool->borrow_index + 1) % prewarm_pool->size;
+	apr_thread_cond_signal(prewarm_pool->wakeup);
+	apr_thread_mutex_unlock(prewarm_pool->mutex);
+
+	if(!session) {
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"No Warmed up Session Available [%s]",prewarm_pool->name);
+	}
+	return session;
+}
+
+/** Record the latency of a handshake */
+MRCP_DECLARE(void) mrcp_prewarm_pool_handshake_record(mrcp_prewarm_pool_t *prewarm_pool, apr_interval_time_t latency)
+{
+	if(!prewarm_pool || latency < 0) {
+		return;
+	}
+
+	apr_thread_mutex_lock(prewarm_pool->mutex);
+	prewarm_pool->stats.handshake_count++;
+	prewarm_pool->handshake_total += latency;
+	if(latency > prewarm_pool->handshake_max) {
+		prewarm_pool->handshake_max = latency;
+	}
+	apr_thread_mutex_unlock(prewarm_pool->mutex);
+}
+
+/** Get the external object associated with the pool */
+MRCP_DECLARE(void*) mrcp_prewarm_pool_object_get(const mrcp_prewarm_pool_t *prewarm_pool)
+{
+	return prewarm_pool->obj;
+}
+
+/** Get the statistics of the pool */
+MRCP_DECLARE(void) mrcp_prewarm_pool_stats_get(mrcp_prewarm_pool_t *prewarm_pool, mrcp_prewarm_stats_t *stats)
+{
+	apr_thread_mutex_lock(prewarm_pool->mutex);
+	*stats = prewarm_pool->stats;
+	stats->idle_count = prewarm_pool->count;
+	stats->handshake_avg = 0;
+	if(stats->handshake_count) {
+		stats->handshake_avg = (apr_size_t)(prewarm_pool->handshake_total / stats->handshake_count / 1000);
+	}
+	stats->handshake_max = (apr_size_t)(prewarm_pool->handshake_max / 1000);
+	apr_thread_mutex_unlock(prewarm_pool->mutex);
+}
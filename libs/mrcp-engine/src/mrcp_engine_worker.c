@@ -0,0 +1,138 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "mrcp_engine_worker.h"
+#include "mrcp_engine_impl.h"
+#include "apt_consumer_task.h"
+#include "apt_log.h"
+
+/** Worker pool */
+struct mrcp_worker_pool_t {
+	/** Array of workers */
+	apt_consumer_task_t    **worker_arr;
+	/** Number of workers */
+	apr_size_t               worker_count;
+	/** Index of the worker to assign next */
+	volatile apr_uint32_t    worker_next;
+	/** Name of the pool */
+	const char              *name;
+};
+
+/** Create worker pool */
+MRCP_DECLARE(mrcp_worker_pool_t*) mrcp_worker_pool_create(
+									apr_size_t worker_count,
+									const char *name,
+									void *obj,
+									apr_size_t msg_size,
+									mrcp_worker_msg_process_f process_msg,
+									apr_pool_t *pool)
+{
+	apr_size_t i;
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	mrcp_worker_pool_t *worker_pool = apr_palloc(pool,sizeof(mrcp_worker_pool_t));
+	if(!worker_count) {
+		worker_count = 1;
+	}
+	if(!name) {
+		name = "Engine";
+	}
+	worker_pool->name = name;
+	worker_pool->worker_next = 0;
+	worker_pool->worker_arr = apr_palloc(pool,sizeof(apt_consumer_task_t*) * worker_count);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Workers [%s] [%"APR_SIZE_T_FMT"]",name,worker_count);
+	/* messages are signaled from and released by different threads */
+	msg_pool = apt_task_msg_pool_create_cached(msg_size,pool);
+	for(i=0; i<worker_count; i++) {
+		worker_pool->worker_arr[i] = apt_consumer_task_create(obj,msg_pool,pool);
+		if(!worker_pool->worker_arr[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Worker [%s]",name);
+			break;
+		}
+		task = apt_consumer_task_base_get(worker_pool->worker_arr[i]);
+		apt_task_name_set(task,apr_psprintf(pool,"%s Worker %"APR_SIZE_T_FMT,name,i+1));
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = process_msg;
+		}
+	}
+	worker_pool->worker_count = i;
+	if(!worker_pool->worker_count) {
+		return NULL;
+	}
+	return worker_pool;
+}
+
+/** Create worker pool of the engine */
+MRCP_DECLARE(mrcp_worker_pool_t*) mrcp_engine_worker_pool_create(
+									mrcp_engine_t *engine,
+									apr_size_t msg_size,
+									mrcp_worker_msg_process_f process_msg)
+{
+	apr_size_t worker_count = MRCP_ENGINE_DEFAULT_WORKER_COUNT;
+	if(engine->config && engine->config->worker_count) {
+		worker_count = engine->config->worker_count;
+	}
+	return mrcp_worker_pool_create(worker_count,engine->id,engine->obj,msg_size,process_msg,engine->pool);
+}
+
+/** Start the workers */
+MRCP_DECLARE(apt_bool_t) mrcp_worker_pool_start(mrcp_worker_pool_t *worker_pool)
+{
+	apr_size_t i;
+	apt_bool_t status = TRUE;
+	for(i=0; i<worker_pool->worker_count; i++) {
+		if(apt_task_start(apt_consumer_task_base_get(worker_pool->worker_arr[i])) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Worker [%s]",worker_pool->name);
+			status = FALSE;
+		}
+	}
+	return status;
+}
+
+/** Terminate and destroy the workers */
+MRCP_DECLARE(apt_bool_t) mrcp_worker_pool_terminate(mrcp_worker_pool_t *worker_pool)
+{
+	apr_size_t i;
+	apt_task_t *task;
+	for(i=0; i<worker_pool->worker_count; i++) {
+		task = apt_consumer_task_base_get(worker_pool->worker_arr[i]);
+		apt_task_terminate(task,TRUE);
+		apt_task_destroy(task);
+	}
+	worker_pool->worker_count = 0;
+	return TRUE;
+}
+
+/** Assign a worker */
+MRCP_DECLARE(apt_task_t*) mrcp_worker_pool_task_assign(mrcp_worker_pool_t *worker_pool)
+{
+	apr_uint32_t index;
+	if(!worker_pool || !worker_pool->worker_count) {
+		return NULL;
+	}
+	index = apr_atomic_inc32(&worker_pool->worker_next);
+	return apt_consumer_task_base_get(worker_pool->worker_arr[index % worker_pool->worker_count]);
+}
+
+/** Get the number of workers */
+MRCP_DECLARE(apr_size_t) mrcp_worker_pool_count_get(const mrcp_worker_pool_t *worker_pool)
+{
+	return worker_pool->worker_count;
+}
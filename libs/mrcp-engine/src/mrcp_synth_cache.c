@@ -0,0 +1,614 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_ring.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+#include <apr_file_io.h>
+#include <apr_mmap.h>
+#include "mrcp_synth_cache.h"
+#include "mrcp_engine_impl.h"
+#include "mrcp_synth_header.h"
+#include "mrcp_generic_header.h"
+#include "mrcp_message.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+#define SYNTH_CACHE_SIZE_PARAM       "tts-cache-size"
+#define SYNTH_CACHE_ENTRY_SIZE_PARAM "tts-cache-entry-size"
+#define SYNTH_CACHE_DIR_PARAM        "tts-cache-dir"
+
+/** Magic number of cache files ("TTSC") */
+#define SYNTH_CACHE_FILE_MAGIC       0x43535454
+/** Size of the header of cache files (magic, key length, audio size) */
+#define SYNTH_CACHE_FILE_HEADER_SIZE (3 * sizeof(apr_uint32_t))
+/** Initial size of the buffer of a record */
+#define SYNTH_CACHE_RECORD_INITIAL_SIZE (64 * 1024)
+
+/** Cache entry */
+struct mrcp_synth_cache_entry_t {
+	/** Ring entry (LRU list) */
+	APR_RING_ENTRY(mrcp_synth_cache_entry_t) link;
+	/** Key of the entry */
+	char                 *key;
+	/** Audio of the entry */
+	apr_byte_t           *data;
+	/** Size of audio in bytes */
+	apr_size_t            size;
+	/** Number of references (cache plus users) */
+	volatile apr_uint32_t ref_count;
+};
+
+/** LRU list of entries (the most recently used first) */
+APR_RING_HEAD(mrcp_synth_cache_lru_t, mrcp_synth_cache_entry_t);
+
+/** Cache */
+struct mrcp_synth_cache_t {
+	/** Memory pool */
+	apr_pool_t                   *pool;
+	/** Mutex guarding the table, the LRU list and statistics */
+	apr_thread_mutex_t           *mutex;
+	/** Table of entries in memory */
+	apr_hash_t                   *table;
+	/** LRU list of entries in memory */
+	struct mrcp_synth_cache_lru_t lru;
+	/** Max size of audio in memory */
+	apr_size_t                    capacity;
+	/** Max size of audio of an entry */
+	apr_size_t                    max_entry_size;
+	/** Directory to store entries in */
+	const char                   *dir_path;
+	/** Statistics */
+	mrcp_synth_cache_stats_t      stats;
+};
+
+/** Record of audio being synthesized */
+struct mrcp_synth_cache_record_t {
+	/** Cache to insert the entry into */
+	mrcp_synth_cache_t *cache;
+	/** Key of the entry */
+	char               *key;
+	/** Buffer of recorded audio */
+	apr_byte_t         *data;
+	/** Size of recorded audio in bytes */
+	apr_size_t          size;
+	/** Size of the buffer in bytes */
+	apr_size_t          capacity;
+	/** Whether the audio doesn't fit in an entry */
+	apt_bool_t          overflow;
+};
+
+
+/** Create cache */
+MRCP_DECLARE(mrcp_synth_cache_t*) mrcp_synth_cache_create(
+									apr_size_t capacity,
+									apr_size_t max_entry_size,
+									const char *dir_path,
+									apr_pool_t *pool)
+{
+	mrcp_synth_cache_t *cache = apr_palloc(pool,sizeof(mrcp_synth_cache_t));
+	cache->pool = pool;
+	cache->mutex = NULL;
+	if(apr_thread_mutex_create(&cache->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create TTS Cache Mutex");
+		return NULL;
+	}
+	cache->table = apr_hash_make(pool);
+	APR_RING_INIT(&cache->lru, mrcp_synth_cache_entry_t, link);
+	cache->capacity = capacity;
+	cache->max_entry_size = max_entry_size ? max_entry_size : MRCP_SYNTH_CACHE_DEFAULT_MAX_ENTRY_SIZE;
+	cache->dir_path = NULL;
+	memset(&cache->stats,0,sizeof(mrcp_synth_cache_stats_t));
+
+	if(dir_path && *dir_path != '\0') {
+		if(apr_dir_make_recursive(dir_path,APR_FPROT_OS_DEFAULT,pool) == APR_SUCCESS) {
+			cache->dir_path = apr_pstrdup(pool,dir_path);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create TTS Cache Dir [%s]",dir_path);
+		}
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create TTS Cache [%"APR_SIZE_T_FMT" bytes] [%s]",
+		cache->capacity,
+		cache->dir_path ? cache->dir_path : "no dir");
+	return cache;
+}
+
+/** Create cache of the engine */
+MRCP_DECLARE(mrcp_synth_cache_t*) mrcp_engine_synth_cache_create(mrcp_engine_t *engine)
+{
+	apr_size_t capacity = 0;
+	apr_size_t max_entry_size = MRCP_SYNTH_CACHE_DEFAULT_MAX_ENTRY_SIZE;
+	const char *dir_path = mrcp_engine_param_get(engine,SYNTH_CACHE_DIR_PARAM);
+	const char *value = mrcp_engine_param_get(engine,SYNTH_CACHE_SIZE_PARAM);
+	if(value) {
+		capacity = atol(value) * 1024;
+	}
+	value = mrcp_engine_param_get(engine,SYNTH_CACHE_ENTRY_SIZE_PARAM);
+	if(value) {
+		max_entry_size = atol(value) * 1024;
+	}
+	if(!capacity && (!dir_path || *dir_path == '\0')) {
+		/* cache isn't configured */
+		return NULL;
+	}
+	return mrcp_synth_cache_create(capacity,max_entry_size,dir_path,engine->pool);
+}
+
+/** Create entry taking over the audio buffer */
+static mrcp_synth_cache_entry_t* mrcp_synth_cache_entry_create(const char *key, apr_byte_t *data, apr_size_t size)
+{
+	apr_size_t key_length = strlen(key);
+	mrcp_synth_cache_entry_t *entry = malloc(sizeof(mrcp_synth_cache_entry_t) + key_length + 1);
+	if(!entry) {
+		free(data);
+		return NULL;
+	}
+	APR_RING_ELEM_INIT(entry,link);
+	entry->key = (char*)(entry + 1);
+	memcpy(entry->key,key,key_length + 1);
+	entry->data = data;
+	entry->size = size;
+	entry->ref_count = 1;
+	return entry;
+}
+
+/** Release a reference to the entry, the last one destroys the entry */
+MRCP_DECLARE(void) mrcp_synth_cache_entry_release(mrcp_synth_cache_entry_t *entry)
+{
+	if(apr_atomic_dec32(&entry->ref_count) == 0) {
+		free(entry->data);
+		free(entry);
+	}
+}
+
+/** Get the audio of the entry */
+MRCP_DECLARE(const apr_byte_t*) mrcp_synth_cache_entry_data_get(const mrcp_synth_cache_entry_t *entry, apr_size_t *size)
+{
+	if(size) {
+		*size = entry->size;
+	}
+	return entry->data;
+}
+
+/** Remove the least recently used entry from memory (mutex is locked) */
+static void mrcp_synth_cache_evict(mrcp_synth_cache_t *cache)
+{
+	mrcp_synth_cache_entry_t *entry = APR_RING_LAST(&cache->lru);
+	APR_RING_REMOVE(entry,link);
+	apr_hash_set(cache->table,entry->key,APR_HASH_KEY_STRING,NULL);
+	cache->stats.size -= entry->size;
+	cache->stats.entry_count--;
+	cache->stats.evictions++;
+	mrcp_synth_cache_entry_release(entry);
+}
+
+/**
+ * Insert the entry into memory (mutex is locked).
+ * @return the referenced entry stored for the key, which is either the entry
+ * passed or the one inserted for the key earlier (the entry passed is released)
+ */
+static mrcp_synth_cache_entry_t* mrcp_synth_cache_insert(mrcp_synth_cache_t *cache, mrcp_synth_cache_entry_t *entry)
+{
+	mrcp_synth_cache_entry_t *existing = apr_hash_get(cache->table,entry->key,APR_HASH_KEY_STRING);
+	if(existing) {
+		/* inserted by a concurrent request meanwhile */
+		apr_atomic_inc32(&existing->ref_count);
+		mrcp_synth_cache_entry_release(entry);
+		return existing;
+	}
+	if(entry->size > cache->capacity) {
+		/* too large to keep in memory */
+		return entry;
+	}
+
+	while(cache->stats.size + entry->size > cache->capacity) {
+		mrcp_synth_cache_evict(cache);
+	}
+	/* the cache holds its own reference */
+	apr_atomic_inc32(&entry->ref_count);
+	APR_RING_INSERT_HEAD(&cache->lru,entry,mrcp_synth_cache_entry_t,link);
+	apr_hash_set(cache->table,entry->key,APR_HASH_KEY_STRING,entry);
+	cache->stats.size += entry->size;
+	cache->stats.entry_count++;
+	cache->stats.insertions++;
+	return entry;
+}
+
+/** Destroy cache */
+MRCP_DECLARE(void) mrcp_synth_cache_destroy(mrcp_synth_cache_t *cache)
+{
+	apr_thread_mutex_lock(cache->mutex);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Destroy TTS Cache [hits %"APR_SIZE_T_FMT", %"APR_SIZE_T_FMT" from dir] [misses %"APR_SIZE_T_FMT"] [evictions %"APR_SIZE_T_FMT"]",
+		cache->stats.memory_hits + cache->stats.disk_hits,
+		cache->stats.disk_hits,
+		cache->stats.misses,
+		cache->stats.evictions);
+	while(!APR_RING_EMPTY(&cache->lru, mrcp_synth_cache_entry_t, link)) {
+		mrcp_synth_cache_evict(cache);
+	}
+	apr_thread_mutex_unlock(cache->mutex);
+	apr_thread_mutex_destroy(cache->mutex);
+	cache->mutex = NULL;
+}
+
+/** Generate the part of the key composed of the params affecting the synthesis */
+static const char* mrcp_synth_cache_params_generate(
+						const mrcp_message_t *request,
+						const mpf_codec_descriptor_t *descriptor,
+						apr_pool_t *pool)
+{
+	const char *params = "";
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	mrcp_synth_header_t *synth_header = mrcp_resource_header_get(request);
+
+	if(descriptor) {
+		params = apr_psprintf(pool,"codec=%.*s/%d/%d;",
+					(int)descriptor->name.length, descriptor->name.buf,
+					descriptor->sampling_rate,
+					descriptor->channel_count);
+	}
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_CONTENT_TYPE) == TRUE) {
+		params = apr_psprintf(pool,"%stype=%.*s;",params,
+					(int)generic_header->content_type.length, generic_header->content_type.buf);
+	}
+	if(!synth_header) {
+		return params;
+	}
+
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_SPEECH_LANGUAGE) == TRUE) {
+		params = apr_psprintf(pool,"%slang=%.*s;",params,
+					(int)synth_header->speech_language.length, synth_header->speech_language.buf);
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_VOICE_NAME) == TRUE) {
+		params = apr_psprintf(pool,"%svoice=%.*s;",params,
+					(int)synth_header->voice_param.name.length, synth_header->voice_param.name.buf);
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_VOICE_GENDER) == TRUE) {
+		params = apr_psprintf(pool,"%sgender=%d;",params,synth_header->voice_param.gender);
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_VOICE_AGE) == TRUE) {
+		params = apr_psprintf(pool,"%sage=%"APR_SIZE_T_FMT";",params,synth_header->voice_param.age);
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_VOICE_VARIANT) == TRUE) {
+		params = apr_psprintf(pool,"%svariant=%"APR_SIZE_T_FMT";",params,synth_header->voice_param.variant);
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_PROSODY_RATE) == TRUE) {
+		const mrcp_prosody_rate_t *rate = &synth_header->prosody_param.rate;
+		if(rate->type == PROSODY_RATE_TYPE_LABEL) {
+			params = apr_psprintf(pool,"%srate=%d;",params,rate->value.label);
+		}
+		else if(rate->type == PROSODY_RATE_TYPE_RELATIVE_CHANGE) {
+			params = apr_psprintf(pool,"%srate=%gx;",params,rate->value.relative);
+		}
+	}
+	if(mrcp_resource_header_property_check(request,SYNTHESIZER_HEADER_PROSODY_VOLUME) == TRUE) {
+		const mrcp_prosody_volume_t *volume = &synth_header->prosody_param.volume;
+		if(volume->type == PROSODY_VOLUME_TYPE_LABEL) {
+			params = apr_psprintf(pool,"%svolume=%d;",params,volume->value.label);
+		}
+		else if(volume->type == PROSODY_VOLUME_TYPE_NUMERIC) {
+			params = apr_psprintf(pool,"%svolume=%g;",params,volume->value.numeric);
+		}
+		else if(volume->type == PROSODY_VOLUME_TYPE_RELATIVE_CHANGE) {
+			params = apr_psprintf(pool,"%svolume=%gx;",params,volume->value.relative);
+		}
+	}
+	return params;
+}
+
+/** Generate the key of a SPEAK request */
+MRCP_DECLARE(const char*) mrcp_synth_cache_key_generate(
+									const mrcp_message_t *request,
+									const mpf_codec_descriptor_t *descriptor,
+									apr_pool_t *pool)
+{
+	char *key;
+	char *pos;
+	char *text;
+	char ch;
+	apr_size_t i;
+	apt_bool_t space = FALSE;
+	const apt_str_t *body = &request->body;
+	const char *params = mrcp_synth_cache_params_generate(request,descriptor,pool);
+	apr_size_t params_length = strlen(params);
+
+	key = apr_palloc(pool,params_length + body->length + 1);
+	memcpy(key,params,params_length);
+	text = pos = key + params_length;
+	/* collapse runs of white space and trim the body */
+	for(i=0; i<body->length; i++) {
+		ch = body->buf[i];
+		if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+			space = TRUE;
+			continue;
+		}
+		if(space == TRUE && pos != text) {
+			*pos++ = ' ';
+		}
+		space = FALSE;
+		*pos++ = ch;
+	}
+	*pos = '\0';
+	return key;
+}
+
+/** Hash the key (FNV-1a) to name the file of the entry */
+static apr_uint64_t mrcp_synth_cache_key_hash(const char *key)
+{
+	apr_uint64_t hash = APR_UINT64_C(14695981039346656037);
+	for(; *key != '\0'; key++) {
+		hash ^= (apr_byte_t)*key;
+		hash *= APR_UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+/** Get the path to the file of the entry */
+static char* mrcp_synth_cache_file_path_get(const mrcp_synth_cache_t *cache, const char *key, apr_pool_t *pool)
+{
+	char *file_path = NULL;
+	const char *file_name = apr_psprintf(pool,"%016"APR_UINT64_T_HEX_FMT".tts",mrcp_synth_cache_key_hash(key));
+	if(apr_filepath_merge(&file_path,cache->dir_path,file_name,APR_FILEPATH_NATIVE,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return file_path;
+}
+
+/** Create entry from the mapped file, verifying it's stored for the key */
+static mrcp_synth_cache_entry_t* mrcp_synth_cache_file_parse(const char *key, const apr_byte_t *buf, apr_size_t size)
+{
+	apr_byte_t *data;
+	apr_uint32_t header[3];
+	apr_size_t key_length = strlen(key);
+	if(size < SYNTH_CACHE_FILE_HEADER_SIZE) {
+		return NULL;
+	}
+	memcpy(header,buf,SYNTH_CACHE_FILE_HEADER_SIZE);
+	if(header[0] != SYNTH_CACHE_FILE_MAGIC || header[1] != key_length ||
+		SYNTH_CACHE_FILE_HEADER_SIZE + key_length + header[2] != size) {
+		return NULL;
+	}
+	buf += SYNTH_CACHE_FILE_HEADER_SIZE;
+	if(memcmp(buf,key,key_length) != 0) {
+		/* collision of the hash */
+		return NULL;
+	}
+	buf += key_length;
+
+	data = malloc(header[2] ? header[2] : 1);
+	if(!data) {
+		return NULL;
+	}
+	memcpy(data,buf,header[2]);
+	return mrcp_synth_cache_entry_create(key,data,header[2]);
+}
+
+/** Load the entry from the directory */
+static mrcp_synth_cache_entry_t* mrcp_synth_cache_file_load(mrcp_synth_cache_t *cache, const char *key)
+{
+	mrcp_synth_cache_entry_t *entry = NULL;
+	const char *file_path;
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apr_mmap_t *mmap;
+	apr_pool_t *pool = apt_pool_create();
+	if(!pool) {
+		return NULL;
+	}
+
+	file_path = mrcp_synth_cache_file_path_get(cache,key,pool);
+	if(file_path && apr_file_open(&file,file_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) == APR_SUCCESS) {
+		if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) == APR_SUCCESS && finfo.size > 0 &&
+			apr_mmap_create(&mmap,file,0,(apr_size_t)finfo.size,APR_MMAP_READ,pool) == APR_SUCCESS) {
+			entry = mrcp_synth_cache_file_parse(key,mmap->mm,mmap->size);
+			apr_mmap_delete(mmap);
+		}
+		apr_file_close(file);
+	}
+	apr_pool_destroy(pool);
+	return entry;
+}
+
+/** Store the entry in the directory */
+static apt_bool_t mrcp_synth_cache_file_store(mrcp_synth_cache_t *cache, const mrcp_synth_cache_entry_t *entry)
+{
+	apr_status_t status = APR_EGENERAL;
+	char *file_path;
+	char *tmp_path;
+	apr_file_t *file;
+	apr_uint32_t header[3];
+	apr_pool_t *pool = apt_pool_create();
+	if(!pool) {
+		return FALSE;
+	}
+
+	header[0] = SYNTH_CACHE_FILE_MAGIC;
+	header[1] = (apr_uint32_t)strlen(entry->key);
+	header[2] = (apr_uint32_t)entry->size;
+	file_path = mrcp_synth_cache_file_path_get(cache,entry->key,pool);
+	if(file_path) {
+		/* write a temporary file and rename it, so that a partial file is never loaded */
+		tmp_path = apr_pstrcat(pool,file_path,".XXXXXX",NULL);
+		status = apr_file_mktemp(&file,tmp_path,
+					APR_FOPEN_CREATE | APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_EXCL | APR_FOPEN_BINARY,
+					pool);
+		if(status == APR_SUCCESS) {
+			status = apr_file_write_full(file,header,SYNTH_CACHE_FILE_HEADER_SIZE,NULL);
+			if(status == APR_SUCCESS) {
+				status = apr_file_write_full(file,entry->key,header[1],NULL);
+			}
+			if(status == APR_SUCCESS) {
+				status = apr_file_write_full(file,entry->data,entry->size,NULL);
+			}
+			apr_file_close(file);
+			if(status == APR_SUCCESS) {
+				status = apr_file_rename(tmp_path,file_path,pool);
+			}
+			if(status != APR_SUCCESS) {
+				apr_file_remove(tmp_path,pool);
+			}
+		}
+		if(status != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Store TTS Cache File [%s]",file_path);
+		}
+	}
+	apr_pool_destroy(pool);
+	return status == APR_SUCCESS ? TRUE : FALSE;
+}
+
+/** Look up an entry */
+MRCP_DECLARE(mrcp_synth_cache_entry_t*) mrcp_synth_cache_lookup(mrcp_synth_cache_t *cache, const char *key)
+{
+	mrcp_synth_cache_entry_t *entry;
+	apr_thread_mutex_lock(cache->mutex);
+	entry = apr_hash_get(cache->table,key,APR_HASH_KEY_STRING);
+	if(entry) {
+		/* move to the head of the LRU list */
+		APR_RING_REMOVE(entry,link);
+		APR_RING_INSERT_HEAD(&cache->lru,entry,mrcp_synth_cache_entry_t,link);
+		apr_atomic_inc32(&entry->ref_count);
+		cache->stats.memory_hits++;
+		apr_thread_mutex_unlock(cache->mutex);
+		return entry;
+	}
+	apr_thread_mutex_unlock(cache->mutex);
+
+	if(cache->dir_path) {
+		/* the file is loaded without holding the mutex */
+		entry = mrcp_synth_cache_file_load(cache,key);
+	}
+
+	apr_thread_mutex_lock(cache->mutex);
+	if(entry) {
+		entry = mrcp_synth_cache_insert(cache,entry);
+		cache->stats.disk_hits++;
+	}
+	else {
+		cache->stats.misses++;
+	}
+	apr_thread_mutex_unlock(cache->mutex);
+	return entry;
+}
+
+/** Begin recording of the audio synthesized for a key */
+MRCP_DECLARE(mrcp_synth_cache_record_t*) mrcp_synth_cache_record_begin(mrcp_synth_cache_t *cache, const char *key)
+{
+	mrcp_synth_cache_record_t *record = malloc(sizeof(mrcp_synth_cache_record_t));
+	if(!record) {
+		return NULL;
+	}
+	record->cache = cache;
+	record->key = malloc(strlen(key) + 1);
+	if(!record->key) {
+		free(record);
+		return NULL;
+	}
+	strcpy(record->key,key);
+	record->data = NULL;
+	record->size = 0;
+	record->capacity = 0;
+	record->overflow = FALSE;
+	return record;
+}
+
+/** Write synthesized audio to the record */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_cache_record_write(mrcp_synth_cache_record_t *record, const void *data, apr_size_t size)
+{
+	apr_byte_t *buf;
+	apr_size_t capacity;
+	if(record->overflow == TRUE) {
+		return FALSE;
+	}
+	if(record->size + size > record->cache->max_entry_size) {
+		/* release the memory right away, the record is going to be discarded */
+		record->overflow = TRUE;
+		free(record->data);
+		record->data = NULL;
+		record->size = record->capacity = 0;
+		return FALSE;
+	}
+
+	if(record->size + size > record->capacity) {
+		capacity = record->capacity ? record->capacity : SYNTH_CACHE_RECORD_INITIAL_SIZE;
+		while(capacity < record->size + size) {
+			capacity *= 2;
+		}
+		if(capacity > record->cache->max_entry_size) {
+			capacity = record->cache->max_entry_size;
+		}
+		buf = realloc(record->data,capacity);
+		if(!buf) {
+			record->overflow = TRUE;
+			return FALSE;
+		}
+		record->data = buf;
+		record->capacity = capacity;
+	}
+	memcpy(record->data + record->size,data,size);
+	record->size += size;
+	return TRUE;
+}
+
+/** Discard the recorded audio and destroy the record */
+MRCP_DECLARE(void) mrcp_synth_cache_record_discard(mrcp_synth_cache_record_t *record)
+{
+	free(record->data);
+	free(record->key);
+	free(record);
+}
+
+/** Insert the recorded audio into the cache and destroy the record */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_cache_record_commit(mrcp_synth_cache_record_t *record)
+{
+	mrcp_synth_cache_t *cache = record->cache;
+	mrcp_synth_cache_entry_t *entry;
+	if(record->overflow == TRUE || !record->size) {
+		mrcp_synth_cache_record_discard(record);
+		return FALSE;
+	}
+
+	/* the entry takes over the buffer of the record */
+	entry = mrcp_synth_cache_entry_create(record->key,record->data,record->size);
+	record->data = NULL;
+	mrcp_synth_cache_record_discard(record);
+	if(!entry) {
+		return FALSE;
+	}
+
+	if(cache->dir_path) {
+		mrcp_synth_cache_file_store(cache,entry);
+	}
+
+	apr_thread_mutex_lock(cache->mutex);
+	entry = mrcp_synth_cache_insert(cache,entry);
+	apr_thread_mutex_unlock(cache->mutex);
+	mrcp_synth_cache_entry_release(entry);
+	return TRUE;
+}
+
+/** Get the statistics of the cache */
+MRCP_DECLARE(void) mrcp_synth_cache_stats_get(mrcp_synth_cache_t *cache, mrcp_synth_cache_stats_t *stats)
+{
+	apr_thread_mutex_lock(cache->mutex);
+	*stats = cache->stats;
+	apr_thread_mutex_unlock(cache->mutex);
+}
@@ -35,6 +35,24 @@ APT_BEGIN_EXTERN_C
  */
 MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout);
 
+/**
+ * Set the number of session processing workers.
+ * @param server the MRCP server to set the workers for
+ * @param count the number of workers (threads), sessions are processed by the server task itself if less than 2
+ * @remark Must be called before the server is started. Each session is pinned to one worker.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_worker_count_set(mrcp_server_t *server, apr_size_t count);
+
+/**
+ * Set the cache of session memory pools.
+ * @param server the MRCP server to set the cache for
+ * @param max_count the max number of pools kept for reuse, the cache is disabled if 0
+ * @param init_count the number of pools to create in advance
+ * @param pool_size the size of memory to preallocate and retain per pool
+ * @remark Must be called before the server is started. By default, up to 64 pools are kept.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_cache_set(mrcp_server_t *server, apr_size_t max_count, apr_size_t init_count, apr_size_t pool_size);
+
 /**
  * Start message processing loop.
  * @param server the MRCP server to start
@@ -159,6 +177,29 @@ MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create(
 										mpf_rtp_settings_t *rtp_settings,
 										apr_pool_t *pool);
 
+/**
+ * Create MRCP profile (extended version).
+ * @param id the identifier of the profile
+ * @param mrcp_version the MRCP version
+ * @param resource_factory the MRCP resource factory
+ * @param signaling_agent the signaling agent
+ * @param connection_agent the connection agent (MRCPv2 only)
+ * @param mpf_factory the factory of media engines sessions are distributed among
+ * @param rtp_factory the RTP termination factory
+ * @param rtp_settings the RTP settings
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create_ex(
+										const char *id,
+										mrcp_version_e mrcp_version,
+										mrcp_resource_factory_t *resource_factory,
+										mrcp_sig_agent_t *signaling_agent,
+										mrcp_connection_agent_t *connection_agent,
+										mpf_engine_factory_t *mpf_factory,
+										mpf_termination_factory_t *rtp_factory,
+										mpf_rtp_settings_t *rtp_settings,
+										apr_pool_t *pool);
+
 /**
  * Register MRCP profile.
  * @param server the MRCP server to set profile for
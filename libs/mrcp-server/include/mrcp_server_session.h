@@ -79,6 +79,8 @@ struct mrcp_server_session_t {
 	mrcp_server_t              *server;
 	/** MRCP profile */
 	mrcp_server_profile_t      *profile;
+	/** Task the session is processed in (pinned on creation) */
+	apt_task_t                 *task;
 
 	/** Media context */
 	mpf_context_t              *context;
@@ -122,8 +124,8 @@ struct mrcp_server_profile_t {
 	apr_hash_t                *engine_table;
 	/** MRCP resource factory */
 	mrcp_resource_factory_t   *resource_factory;
-	/** Media processing engine */
-	mpf_engine_t              *media_engine;
+	/** Factory of media processing engines */
+	mpf_engine_factory_t      *mpf_factory;
 	/** RTP termination factory */
 	mpf_termination_factory_t *rtp_termination_factory;
 	/** RTP settings */
@@ -134,8 +136,8 @@ struct mrcp_server_profile_t {
 	mrcp_connection_agent_t   *connection_agent;
 };
 
-/** Create server session */
-mrcp_server_session_t* mrcp_server_session_create(void);
+/** Create server session, acquiring the memory pool from the cache, if any */
+mrcp_server_session_t* mrcp_server_session_create(apt_pool_cache_t *pool_cache);
 
 /** Process signaling message */
 apt_bool_t mrcp_server_signaling_message_process(mrcp_signaling_message_t *signaling_message);
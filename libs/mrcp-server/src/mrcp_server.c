@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_server.h"
 #include "mrcp_server_session.h"
 #include "mrcp_message.h"
@@ -23,6 +24,7 @@
 #include "mrcp_engine_loader.h"
 #include "mrcp_sig_agent.h"
 #include "mrcp_server_connection.h"
+#include "mpf_engine_factory.h"
 #include "mpf_termination_factory.h"
 #include "apt_pool.h"
 #include "apt_consumer_task.h"
@@ -30,11 +32,24 @@
 #include "apt_log.h"
 
 #define SERVER_TASK_NAME "MRCP Server"
+#define SERVER_WORKER_TASK_NAME "MRCP Server Worker"
+
+/** Default max number of session pools kept for reuse */
+#define SERVER_SESSION_POOL_CACHE_SIZE 64
 
 /** MRCP server */
 struct mrcp_server_t {
 	/** Main message processing task */
 	apt_consumer_task_t     *task;
+	/** Original signal_msg method of the main task */
+	apt_bool_t             (*msg_signal)(apt_task_t *task, apt_task_msg_t *msg);
+
+	/** Array of session processing tasks (workers), sessions are processed by the main task, if empty */
+	apt_consumer_task_t    **worker_arr;
+	/** Number of session processing tasks */
+	apr_size_t               worker_count;
+	/** Index of the worker to pin the next session to */
+	volatile apr_uint32_t    worker_next;
 
 	/** MRCP resource factory */
 	mrcp_resource_factory_t *resource_factory;
@@ -60,6 +75,10 @@ struct mrcp_server_t {
 
 	/** Table of sessions */
 	apr_hash_t              *session_table;
+	/** Guard of the table of sessions, which is accessed from the workers */
+	apr_thread_mutex_t      *session_table_guard;
+	/** Cache of session memory pools, if any */
+	apt_pool_cache_t        *session_pool_cache;
 
 	/** Connection task message pool */
 	apt_task_msg_pool_t     *connection_msg_pool;
@@ -81,7 +100,8 @@ typedef enum {
 	MRCP_SERVER_SIGNALING_TASK_MSG = TASK_MSG_USER,
 	MRCP_SERVER_CONNECTION_TASK_MSG,
 	MRCP_SERVER_ENGINE_TASK_MSG,
-	MRCP_SERVER_MEDIA_TASK_MSG
+	MRCP_SERVER_MEDIA_TASK_MSG,
+	MRCP_SERVER_IDLE_TASK_MSG
 } mrcp_server_task_msg_type_e;
 
 
@@ -165,6 +185,7 @@ const mrcp_engine_channel_event_vtable_t engine_channel_vtable = {
 };
 
 /* Task interface */
+static apt_bool_t mrcp_server_msg_signal(apt_task_t *task, apt_task_msg_t *msg);
 static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 static apt_bool_t mrcp_server_start_request_process(apt_task_t *task);
 static apt_bool_t mrcp_server_terminate_request_process(apt_task_t *task);
@@ -206,6 +227,11 @@ MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout)
 	server->rtp_settings_table = NULL;
 	server->profile_table = NULL;
 	server->session_table = NULL;
+	server->session_table_guard = NULL;
+	server->session_pool_cache = NULL;
+	server->worker_arr = NULL;
+	server->worker_count = 0;
+	server->worker_next = 0;
 	server->connection_msg_pool = NULL;
 	server->engine_msg_pool = NULL;
 	server->shutdown_requested = FALSE;
@@ -221,6 +247,8 @@ MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout)
 	apt_task_name_set(task,SERVER_TASK_NAME);
 	vtable = apt_task_vtable_get(task);
 	if(vtable) {
+		server->msg_signal = vtable->signal_msg;
+		vtable->signal_msg = mrcp_server_msg_signal;
 		vtable->process_msg = mrcp_server_msg_process;
 		vtable->process_start = mrcp_server_start_request_process;
 		vtable->process_terminate = mrcp_server_terminate_request_process;
@@ -242,9 +270,75 @@ MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout)
 	server->profile_table = apr_hash_make(server->pool);
 	
 	server->session_table = apr_hash_make(server->pool);
+	if(apr_thread_mutex_create(&server->session_table_guard,APR_THREAD_MUTEX_DEFAULT,server->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Session Table Guard");
+		return NULL;
+	}
+	server->session_pool_cache = apt_pool_cache_create(SERVER_SESSION_POOL_CACHE_SIZE,0,0,server->pool);
 	return server;
 }
 
+/** Set the cache of session memory pools */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_cache_set(mrcp_server_t *server, apr_size_t max_count, apr_size_t init_count, apr_size_t pool_size)
+{
+	if(!server) {
+		return FALSE;
+	}
+	if(server->session_pool_cache) {
+		/* replace the default cache, no session has been created yet */
+		apt_pool_cache_destroy(server->session_pool_cache);
+		server->session_pool_cache = NULL;
+	}
+	if(!max_count) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Disable Session Pool Cache");
+		return TRUE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Session Pool Cache [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT" x %"APR_SIZE_T_FMT" bytes]",
+		init_count,max_count,pool_size);
+	server->session_pool_cache = apt_pool_cache_create(max_count,init_count,pool_size,server->pool);
+	return server->session_pool_cache ? TRUE : FALSE;
+}
+
+/** Set the number of session processing workers */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_worker_count_set(mrcp_server_t *server, apr_size_t count)
+{
+	apr_size_t i;
+	apt_task_t *task;
+	apt_task_t *worker_task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	if(!server || !server->task || server->worker_arr) {
+		return FALSE;
+	}
+	if(count < 2) {
+		/* sessions are processed by the main task */
+		return TRUE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Session Workers [%"APR_SIZE_T_FMT"]",count);
+	task = apt_consumer_task_base_get(server->task);
+	server->worker_arr = apr_palloc(server->pool,sizeof(apt_consumer_task_t*) * count);
+	for(i=0; i<count; i++) {
+		msg_pool = apt_task_msg_pool_create_dynamic(0,server->pool);
+		server->worker_arr[i] = apt_consumer_task_create(server,msg_pool,server->pool);
+		if(!server->worker_arr[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Session Worker");
+			break;
+		}
+		worker_task = apt_consumer_task_base_get(server->worker_arr[i]);
+		apt_task_name_set(worker_task,apr_psprintf(server->pool,SERVER_WORKER_TASK_NAME" %"APR_SIZE_T_FMT,i+1));
+		vtable = apt_task_vtable_get(worker_task);
+		if(vtable) {
+			vtable->process_msg = mrcp_server_msg_process;
+		}
+		/* workers are started and terminated along with the main task */
+		apt_task_add(task,worker_task);
+	}
+	server->worker_count = i;
+	return TRUE;
+}
+
 /** Start message processing loop */
 MRCP_DECLARE(apt_bool_t) mrcp_server_start(mrcp_server_t *server)
 {
@@ -303,6 +397,17 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_shutdown(mrcp_server_t *server)
 		return FALSE;
 	}
 	server->session_table = NULL;
+	if(server->session_pool_cache) {
+		apt_pool_cache_stat_t stat;
+		apt_pool_cache_stat_get(server->session_pool_cache,&stat);
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Session Pool Cache: free %"APR_SIZE_T_FMT" high-water %"APR_SIZE_T_FMT
+			" hits %"APR_SIZE_T_FMT" misses %"APR_SIZE_T_FMT" discards %"APR_SIZE_T_FMT,
+			stat.free_count,
+			stat.busy_high_water,
+			stat.hit_count,
+			stat.miss_count,
+			stat.discard_count);
+	}
 	uptime = apr_time_now() - server->start_time;
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Server Uptime [%"APR_TIME_T_FMT" sec]", apr_time_sec(uptime));
 	return TRUE;
@@ -346,7 +451,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_engine_register(mrcp_server_t *server, mrcp
 	}
 	
 	if(!server->engine_msg_pool) {
-		server->engine_msg_pool = apt_task_msg_pool_create_dynamic(sizeof(engine_task_msg_data_t),server->pool);
+		server->engine_msg_pool = apt_task_msg_pool_create_cached(sizeof(engine_task_msg_data_t),server->pool);
 	}
 	engine->codec_manager = server->codec_manager;
 	engine->dir_layout = server->dir_layout;
@@ -452,7 +557,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_signaling_agent_register(mrcp_server_t *ser
 	signaling_agent->parent = server;
 	signaling_agent->resource_factory = server->resource_factory;
 	signaling_agent->create_server_session = mrcp_server_sig_agent_session_create;
-	signaling_agent->msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mrcp_signaling_message_t*),server->pool);
+	signaling_agent->msg_pool = apt_task_msg_pool_create_cached(sizeof(mrcp_signaling_message_t*),server->pool);
 	apr_hash_set(server->sig_agent_table,signaling_agent->id,APR_HASH_KEY_STRING,signaling_agent);
 	if(server->task) {
 		apt_task_t *task = apt_consumer_task_base_get(server->task);
@@ -481,7 +586,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_register(mrcp_server_t *se
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Register Connection Agent [%s]",id);
 	mrcp_server_connection_resource_factory_set(connection_agent,server->resource_factory);
 	mrcp_server_connection_agent_handler_set(connection_agent,server,&connection_method_vtable);
-	server->connection_msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_agent_task_msg_data_t),server->pool);
+	server->connection_msg_pool = apt_task_msg_pool_create_cached(sizeof(connection_agent_task_msg_data_t),server->pool);
 	apr_hash_set(server->cnt_agent_table,id,APR_HASH_KEY_STRING,connection_agent);
 	if(server->task) {
 		apt_task_t *task = apt_consumer_task_base_get(server->task);
@@ -508,19 +613,50 @@ MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create(
 										mpf_termination_factory_t *rtp_factory,
 										mpf_rtp_settings_t *rtp_settings,
 										apr_pool_t *pool)
+{
+	mpf_engine_factory_t *mpf_factory = NULL;
+	if(media_engine) {
+		mpf_factory = mpf_engine_factory_create(pool);
+		mpf_engine_factory_engine_add(mpf_factory,media_engine);
+	}
+
+	return mrcp_server_profile_create_ex(
+				id,
+				mrcp_version,
+				resource_factory,
+				signaling_agent,
+				connection_agent,
+				mpf_factory,
+				rtp_factory,
+				rtp_settings,
+				pool);
+}
+
+/** Create MRCP profile (extended version) */
+MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create_ex(
+										const char *id,
+										mrcp_version_e mrcp_version,
+										mrcp_resource_factory_t *resource_factory,
+										mrcp_sig_agent_t *signaling_agent,
+										mrcp_connection_agent_t *connection_agent,
+										mpf_engine_factory_t *mpf_factory,
+										mpf_termination_factory_t *rtp_factory,
+										mpf_rtp_settings_t *rtp_settings,
+										apr_pool_t *pool)
 {
 	mrcp_server_profile_t *profile = apr_palloc(pool,sizeof(mrcp_server_profile_t));
 	profile->id = id;
 	profile->mrcp_version = mrcp_version;
 	profile->resource_factory = resource_factory;
 	profile->engine_table = NULL;
-	profile->media_engine = media_engine;
+	profile->mpf_factory = mpf_factory;
 	profile->rtp_termination_factory = rtp_factory;
 	profile->rtp_settings = rtp_settings;
 	profile->signaling_agent = signaling_agent;
 	profile->connection_agent = connection_agent;
 
-	mpf_termination_factory_engine_assign(rtp_factory,media_engine);
+	if(mpf_factory && rtp_factory)
+		mpf_engine_factory_rtp_factory_assign(mpf_factory,rtp_factory);
 	return profile;
 }
 
@@ -592,10 +728,14 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_profile_register(
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Register Profile [%s]: missing connection agent",profile->id);
 		return FALSE;
 	}
-	if(!profile->media_engine) {
+	if(!profile->mpf_factory) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Register Profile [%s]: missing media engine",profile->id);
 		return FALSE;
 	}
+	if(mpf_engine_factory_is_empty(profile->mpf_factory) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Register Profile [%s]: empty media engine factory",profile->id);
+		return FALSE;
+	}
 	if(!profile->rtp_termination_factory) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Register Profile [%s]: missing RTP factory",profile->id);
 		return FALSE;
@@ -643,7 +783,9 @@ void mrcp_server_session_add(mrcp_server_t *server, mrcp_server_session_t *sessi
 		return;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Add Session " APT_SID_FMT,MRCP_SESSION_SID(&session->base));
+	apr_thread_mutex_lock(server->session_table_guard);
 	apr_hash_set(server->session_table,session->base.id.buf,session->base.id.length,session);
+	apr_thread_mutex_unlock(server->session_table_guard);
 }
 
 void mrcp_server_session_remove(mrcp_server_t *server, mrcp_server_session_t *session)
@@ -652,23 +794,52 @@ void mrcp_server_session_remove(mrcp_server_t *server, mrcp_server_session_t *se
 		return;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Remove Session " APT_SID_FMT,MRCP_SESSION_SID(&session->base));
+	apr_thread_mutex_lock(server->session_table_guard);
 	apr_hash_set(server->session_table,session->base.id.buf,session->base.id.length,NULL);
+	apr_thread_mutex_unlock(server->session_table_guard);
+}
+
+static unsigned int mrcp_server_session_count_get(mrcp_server_t *server)
+{
+	unsigned int count;
+	apr_thread_mutex_lock(server->session_table_guard);
+	count = apr_hash_count(server->session_table);
+	apr_thread_mutex_unlock(server->session_table_guard);
+	return count;
 }
 
 void mrcp_server_session_idle_test(mrcp_server_t *server)
 {
 	if(server->shutdown_requested == TRUE) {
-		unsigned int count = apr_hash_count(server->session_table);
+		unsigned int count = mrcp_server_session_count_get(server);
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Shutdown Pending: remaining sessions [%d]", count);
 		if(!count) {
-			mrcp_server_do_terminate(server);
+			if(server->worker_count) {
+				/* called from a worker, complete the shutdown in the context of the main task */
+				apt_task_t *task = apt_consumer_task_base_get(server->task);
+				apt_task_msg_t *task_msg = apt_task_msg_get(task);
+				if(task_msg) {
+					task_msg->type = MRCP_SERVER_IDLE_TASK_MSG;
+					apt_task_msg_signal(task,task_msg);
+				}
+			}
+			else {
+				mrcp_server_do_terminate(server);
+			}
 		}
 	}
 }
 
-static APR_INLINE mrcp_server_session_t* mrcp_server_session_find(mrcp_server_t *server, const apt_str_t *session_id)
+/** Select the task to process a new session in */
+static apt_task_t* mrcp_server_session_task_select(mrcp_server_t *server)
 {
-	return apr_hash_get(server->session_table,session_id->buf,session_id->length);
+	apr_uint32_t index;
+	if(!server->worker_count) {
+		return apt_consumer_task_base_get(server->task);
+	}
+
+	index = apr_atomic_inc32(&server->worker_next);
+	return apt_consumer_task_base_get(server->worker_arr[index % server->worker_count]);
 }
 
 static apt_bool_t mrcp_server_start_request_process(apt_task_t *task)
@@ -719,6 +890,7 @@ static void mrcp_server_sessions_release(mrcp_server_t *server)
 	mrcp_server_session_t *session;
 	apr_hash_index_t *it;
 	void *val;
+	apr_thread_mutex_lock(server->session_table_guard);
 	it = apr_hash_first(NULL,server->session_table);
 	for(; it; it = apr_hash_next(it)) {
 		apr_hash_this(it,NULL,NULL,&val);
@@ -729,6 +901,7 @@ static void mrcp_server_sessions_release(mrcp_server_t *server)
 			mrcp_session_terminate_event(&session->base);
 		}
 	}
+	apr_thread_mutex_unlock(server->session_table_guard);
 }
 
 static apt_bool_t mrcp_server_terminate_request_process(apt_task_t *task)
@@ -759,7 +932,7 @@ static void mrcp_server_on_offline_complete(apt_task_t *task)
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,SERVER_TASK_NAME" Taken Offline");
 	
 	if(server->shutdown_requested == TRUE) {
-		unsigned int count = apr_hash_count(server->session_table);
+		unsigned int count = mrcp_server_session_count_get(server);
 		if(count) {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Shutdown Pending: release open sessions [%d]", count);
 			mrcp_server_sessions_release(server);
@@ -775,6 +948,26 @@ static void mrcp_server_on_online_complete(apt_task_t *task)
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,SERVER_TASK_NAME" Brought Online");
 }
 
+static apt_bool_t mrcp_server_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
+{
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
+
+	if(msg->type == MRCP_SERVER_MEDIA_TASK_MSG && server->worker_count) {
+		/* responses of media engines are sent to the parent task, route them to the owning worker */
+		const mpf_message_container_t *mpf_message_container = (const mpf_message_container_t*) msg->data;
+		mrcp_server_session_t *session = NULL;
+		if(mpf_message_container->count && mpf_message_container->messages[0].context) {
+			session = mpf_engine_context_object_get(mpf_message_container->messages[0].context);
+		}
+		if(session && session->task != task) {
+			apt_task_vtable_t *vtable = apt_task_vtable_get(session->task);
+			return vtable->signal_msg(session->task,msg);
+		}
+	}
+	return server->msg_signal(task,msg);
+}
+
 static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
 	switch(msg->type) {
@@ -850,6 +1043,16 @@ static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 			mrcp_server_mpf_message_process(mpf_message_container);
 			break;
 		}
+		case MRCP_SERVER_IDLE_TASK_MSG:
+		{
+			apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+			mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
+			/* the last session has been removed by a worker */
+			if(server->shutdown_requested == TRUE) {
+				mrcp_server_do_terminate(server);
+			}
+			break;
+		}
 		default:
 		{
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Task Message Received [%d;%d]", msg->type,msg->sub_type);
@@ -875,7 +1078,7 @@ static apt_bool_t mrcp_server_signaling_task_msg_signal(mrcp_signaling_message_t
 	signaling_message->message = message;
 	*slot = signaling_message;
 	
-	return apt_task_msg_parent_signal(session->signaling_agent->task,task_msg);
+	return apt_task_msg_signal(signaling_message->session->task,task_msg);
 }
 
 static apt_bool_t mrcp_server_connection_task_msg_signal(
@@ -894,6 +1097,13 @@ static apt_bool_t mrcp_server_connection_task_msg_signal(
 	task_msg->sub_type = type;
 	data = (connection_agent_task_msg_data_t*) task_msg->data;
 	data->channel = channel ? channel->obj : NULL;
+	if(data->channel) {
+		/* route to the task the session of the channel is processed in */
+		mrcp_server_session_t *session = (mrcp_server_session_t*)mrcp_server_channel_session_get(data->channel);
+		if(session && session->task) {
+			task = session->task;
+		}
+	}
 	data->descriptor = descriptor;
 	data->message = message;
 	data->status = status;
@@ -930,7 +1140,7 @@ static apt_bool_t mrcp_server_channel_task_msg_signal(
 	mrcp_channel_t *channel = engine_channel->event_obj;
 	mrcp_session_t *session = mrcp_server_channel_session_get(channel);
 	mrcp_server_t *server = session->signaling_agent->parent;
-	apt_task_t *task = apt_consumer_task_base_get(server->task);
+	apt_task_t *task = ((mrcp_server_session_t*)session)->task;
 	engine_task_msg_data_t *data;
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(server->engine_msg_pool);
 	task_msg->type = MRCP_SERVER_ENGINE_TASK_MSG;
@@ -963,7 +1173,11 @@ static mrcp_server_profile_t* mrcp_server_profile_get_by_agent(mrcp_server_t *se
 static mrcp_session_t* mrcp_server_sig_agent_session_create(mrcp_sig_agent_t *signaling_agent)
 {
 	mrcp_server_t *server = signaling_agent->parent;
-	mrcp_server_session_t *session = mrcp_server_session_create();
+	mrcp_server_session_t *session = mrcp_server_session_create(server->session_pool_cache);
+	if(!session) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Session");
+		return NULL;
+	}
 	session->server = server;
 	session->profile = mrcp_server_profile_get_by_agent(server,session,signaling_agent);
 	if(!session->profile) {
@@ -979,6 +1193,8 @@ static mrcp_session_t* mrcp_server_sig_agent_session_create(mrcp_sig_agent_t *si
 			session->profile->id);
 	session->base.signaling_agent = signaling_agent;
 	session->base.request_vtable = &session_request_vtable;
+	/* pin the session to a worker, so that its messages are processed in order */
+	session->task = mrcp_server_session_task_select(server);
 	return &session->base;
 }
 
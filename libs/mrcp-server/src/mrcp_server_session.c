@@ -25,6 +25,7 @@
 #include "mrcp_control_descriptor.h"
 #include "mrcp_state_machine.h"
 #include "mrcp_message.h"
+#include "mpf_engine_factory.h"
 #include "mpf_termination_factory.h"
 #include "mpf_stream.h"
 #include "apt_consumer_task.h"
@@ -99,9 +100,13 @@ static apt_bool_t state_machine_on_deactivate(mrcp_state_machine_t *state_machin
 
 static apt_bool_t mrcp_session_offers_compare(const mrcp_session_descriptor_t *offer1, const mrcp_session_descriptor_t *offer2);
 
-mrcp_server_session_t* mrcp_server_session_create()
+mrcp_server_session_t* mrcp_server_session_create(apt_pool_cache_t *pool_cache)
 {
-	mrcp_server_session_t *session = (mrcp_server_session_t*) mrcp_session_create(sizeof(mrcp_server_session_t)-sizeof(mrcp_session_t));
+	mrcp_server_session_t *session = (mrcp_server_session_t*) mrcp_session_create_cached(pool_cache,sizeof(mrcp_server_session_t)-sizeof(mrcp_session_t));
+	if(!session) {
+		return NULL;
+	}
+	session->task = NULL;
 	session->context = NULL;
 	session->terminations = apr_array_make(session->base.pool,2,sizeof(mrcp_termination_slot_t));
 	session->channels = apr_array_make(session->base.pool,2,sizeof(mrcp_channel_t*));
@@ -390,8 +395,13 @@ static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *sessi
 		}
 		mrcp_server_session_add(session->server,session);
 
+		/* select the least loaded media engine the session is bound to for its lifetime */
+		session->base.media_engine = mpf_engine_factory_engine_select(session->profile->mpf_factory);
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Select Media Engine [%s] " APT_NAMESID_FMT,
+			mpf_engine_id_get(session->base.media_engine),
+			MRCP_SESSION_NAMESID(session));
 		session->context = mpf_engine_context_create(
-			session->profile->media_engine,
+			session->base.media_engine,
 			session->base.name,
 			session,5,session->base.pool);
 	}
@@ -419,7 +429,7 @@ static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *sessi
 
 	/* first, reset/destroy existing associations and topology */
 	if(mpf_engine_topology_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_RESET_ASSOCIATIONS,session->context,
 				&session->mpf_task_msg) == TRUE){
 		mrcp_server_session_subrequest_add(session);
@@ -440,12 +450,12 @@ static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *sessi
 
 	/* apply topology based on assigned associations */
 	if(mpf_engine_topology_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_APPLY_TOPOLOGY,session->context,
 				&session->mpf_task_msg) == TRUE) {
 		mrcp_server_session_subrequest_add(session);
 	}
-	mpf_engine_message_send(session->profile->media_engine,&session->mpf_task_msg);
+	mpf_engine_message_send(session->base.media_engine,&session->mpf_task_msg);
 
 	if(!session->subrequest_count) {
 		/* send answer to client */
@@ -466,7 +476,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 	if(session->context) {
 		/* first, destroy existing topology */
 		if(mpf_engine_topology_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_RESET_ASSOCIATIONS,session->context,
 					&session->mpf_task_msg) == TRUE){
 			mrcp_server_session_subrequest_add(session);
@@ -497,7 +507,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 					MRCP_SESSION_NAMESID(session),
 					mpf_termination_name_get(termination));
 				if(mpf_engine_termination_message_add(
-							session->profile->media_engine,
+							session->base.media_engine,
 							MPF_SUBTRACT_TERMINATION,session->context,termination,NULL,
 							&session->mpf_task_msg) == TRUE) {
 					channel->waiting_for_termination = TRUE;
@@ -521,7 +531,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 			MRCP_SESSION_NAMESID(session),
 			mpf_termination_name_get(slot->termination));
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_SUBTRACT_TERMINATION,session->context,slot->termination,NULL,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -530,7 +540,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 	}
 
 	if(session->context) {
-		mpf_engine_message_send(session->profile->media_engine,&session->mpf_task_msg);
+		mpf_engine_message_send(session->base.media_engine,&session->mpf_task_msg);
 	}
 
 	if(!session->subrequest_count) {
@@ -681,7 +691,7 @@ static apt_bool_t mrcp_server_resource_offer_process(mrcp_server_session_t *sess
 			mpf_termination_t *termination = channel->engine_channel->termination;
 			/* send add termination request (add to media context) */
 			if(mpf_engine_termination_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_ADD_TERMINATION,session->context,termination,NULL,
 					&session->mpf_task_msg) == TRUE) {
 				channel->waiting_for_termination = TRUE;
@@ -773,7 +783,7 @@ static apt_bool_t mrcp_server_control_media_offer_process(mrcp_server_session_t
 			mpf_termination_t *termination = channel->engine_channel->termination;
 			/* send add termination request (add to media context) */
 			if(mpf_engine_termination_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_ADD_TERMINATION,session->context,termination,NULL,
 					&session->mpf_task_msg) == TRUE) {
 				channel->waiting_for_termination = TRUE;
@@ -868,7 +878,7 @@ static apt_bool_t mrcp_server_associations_set(mrcp_server_session_t *session, m
 		if(!channel || !channel->engine_channel) continue;
 
 		if(mpf_engine_assoc_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_ADD_ASSOCIATION,session->context,slot->termination,channel->engine_channel->termination,
 				&session->mpf_task_msg) == TRUE) {
 			mrcp_server_session_subrequest_add(session);
@@ -909,7 +919,7 @@ static apt_bool_t mrcp_server_av_media_offer_process(mrcp_server_session_t *sess
 				mpf_termination_name_get(slot->termination),
 				i);
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_MODIFY_TERMINATION,session->context,slot->termination,rtp_descriptor,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -943,7 +953,7 @@ static apt_bool_t mrcp_server_av_media_offer_process(mrcp_server_session_t *sess
 
 		/* send add termination request (add to media context) */
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_ADD_TERMINATION,session->context,termination,rtp_descriptor,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -998,6 +1008,12 @@ static apt_bool_t mrcp_server_session_terminate_send(mrcp_server_session_t *sess
 		}
 	}
 
+	if(session->context) {
+		/* all the terminations have already been subtracted, release the context */
+		mpf_engine_context_destroy(session->context);
+		session->context = NULL;
+	}
+
 	mrcp_server_session_remove(session->server,session);
 
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Session Terminated "APT_NAMESID_FMT,MRCP_SESSION_NAMESID(session));
@@ -25,6 +25,7 @@
 #include "mrcp_sig_types.h"
 #include "mpf_types.h"
 #include "apt_string.h"
+#include "apt_pool.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -51,6 +52,8 @@ struct mrcp_session_t {
 	apr_pool_t       *pool;
 	/** Whether the memory pool is self-owned or not */
 	apt_bool_t        self_owned;
+	/** Cache to release the self-owned memory pool to, if any */
+	apt_pool_cache_t *pool_cache;
 	/** External object associated with session */
 	void             *obj;
 	/** External logger object associated with session */
@@ -116,10 +119,13 @@ struct mrcp_session_event_vtable_t {
 /** Create new memory pool and allocate session object from the pool. */
 MRCP_DECLARE(mrcp_session_t*) mrcp_session_create(apr_size_t padding);
 
+/** Acquire memory pool from the cache and allocate session object from the pool. */
+MRCP_DECLARE(mrcp_session_t*) mrcp_session_create_cached(apt_pool_cache_t *pool_cache, apr_size_t padding);
+
 /** Allocate session object from the provided memory pool. Take over the ownership of the pool, if take_ownership is TRUE */
 MRCP_DECLARE(mrcp_session_t*) mrcp_session_create_ex(apr_pool_t *pool, apt_bool_t take_ownership, apr_size_t padding);
 
-/** Destroy session and assosiated memory pool. */
+/** Destroy session and assosiated memory pool (or release the pool to the cache). */
 MRCP_DECLARE(void) mrcp_session_destroy(mrcp_session_t *session);
 
 
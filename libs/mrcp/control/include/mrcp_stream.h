@@ -46,6 +46,12 @@ MRCP_DECLARE(void) mrcp_parser_verbose_set(mrcp_parser_t *parser, apt_bool_t ver
 /** Parse MRCP stream */
 MRCP_DECLARE(apt_message_status_e) mrcp_parser_run(mrcp_parser_t *parser, apt_text_stream_t *stream, mrcp_message_t **message);
 
+/** Enable zero-copy parsing of MRCP stream (see apt_message_parser_zero_copy_enable) */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_zero_copy_enable(mrcp_parser_t *parser, apt_text_stream_t *stream, apr_size_t size);
+
+/** Scroll remaining data of MRCP stream (see apt_message_parser_stream_scroll) */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_stream_scroll(mrcp_parser_t *parser, apt_text_stream_t *stream);
+
 
 
 /** Create MRCP stream generator */
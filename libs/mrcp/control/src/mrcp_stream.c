@@ -87,6 +87,18 @@ MRCP_DECLARE(apt_message_status_e) mrcp_parser_run(mrcp_parser_t *parser, apt_te
 	return apt_message_parser_run(parser->base,stream,(void**)message);
 }
 
+/** Enable zero-copy parsing of MRCP stream */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_zero_copy_enable(mrcp_parser_t *parser, apt_text_stream_t *stream, apr_size_t size)
+{
+	return apt_message_parser_zero_copy_enable(parser->base,stream,size);
+}
+
+/** Scroll remaining data of MRCP stream */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_stream_scroll(mrcp_parser_t *parser, apt_text_stream_t *stream)
+{
+	return apt_message_parser_stream_scroll(parser->base,stream);
+}
+
 /** Create message and read start line */
 static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message_context_t *context, apt_text_stream_t *stream, apr_pool_t *pool)
 {
@@ -196,7 +208,9 @@ apt_bool_t mrcp_generator_on_start(apt_message_generator_t *generator, apt_messa
 	}
 		
 	if(mrcp_message->start_line.version == MRCP_VERSION_2) {
-		mrcp_channel_id_generate(&mrcp_message->channel_id,stream);
+		if(mrcp_channel_id_generate(&mrcp_message->channel_id,stream) == FALSE) {
+			return FALSE;
+		}
 	}
 
 	context->header = &mrcp_message->header.header_section;
@@ -226,7 +240,9 @@ MRCP_DECLARE(apt_bool_t) mrcp_message_generate(const mrcp_resource_factory_t *re
 	}
 
 	if(message->start_line.version == MRCP_VERSION_2) {
-		mrcp_channel_id_generate(&message->channel_id,stream);
+		if(mrcp_channel_id_generate(&message->channel_id,stream) == FALSE) {
+			return FALSE;
+		}
 	}
 
 	/* generate header section */
@@ -37,6 +37,14 @@ static const apt_str_table_item_t generic_header_string_table[] = {
 	{{"Set-Cookie2",               11},10}
 };
 
+/** Perfect hash slots of generic_header string table */
+static const unsigned char generic_header_hash_slots[16] = {
+	4,8,14,9,7,10,11,1,6,5,16,2,3,12,15,13
+};
+
+/** Perfect hash of generic_header string table */
+static const apt_str_table_hash_t generic_header_string_hash = {89730,15,generic_header_hash_slots};
+
 /** Parse mrcp request-id list */
 static apt_bool_t mrcp_request_id_list_parse(mrcp_request_id_list_t *request_id_list, const apt_str_t *value)
 {
@@ -315,7 +323,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_generic_header_generate,
 	mrcp_generic_header_duplicate,
 	generic_header_string_table,
-	GENERIC_HEADER_COUNT
+	GENERIC_HEADER_COUNT,
+	&generic_header_string_hash
 };
 
 
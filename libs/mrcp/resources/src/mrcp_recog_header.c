@@ -65,6 +65,21 @@ static const apt_str_table_item_t v1_recog_header_string_table[] = {
 	{{"Abort-Phrase-Enrollment",          23},0}
 };
 
+/** Perfect hash slots of v1_recog_header string table */
+static const unsigned char v1_recog_header_hash_slots[128] = {
+	0,14,36,0,42,0,0,22,0,0,0,4,11,0,45,0,
+	0,0,31,1,0,0,15,0,38,0,33,0,0,0,0,0,
+	19,30,0,37,0,0,24,0,0,0,27,0,0,23,0,3,
+	10,0,0,18,0,0,21,0,0,0,0,0,0,0,0,16,
+	0,0,0,0,0,0,29,0,0,17,26,7,0,41,0,0,
+	40,0,44,0,0,34,0,0,0,0,13,0,0,9,0,12,
+	0,0,0,0,0,43,0,0,0,39,0,0,5,0,0,28,
+	0,25,0,2,0,6,0,8,0,20,0,0,35,0,32,0
+};
+
+/** Perfect hash of v1_recog_header string table */
+static const apt_str_table_hash_t v1_recog_header_string_hash = {4709,127,v1_recog_header_hash_slots};
+
 /** String table of MRCPv2 recognizer header fields (mrcp_recog_header_id) */
 static const apt_str_table_item_t v2_recog_header_string_table[] = {
 	{{"Confidence-Threshold",             20},16},
@@ -115,6 +130,21 @@ static const apt_str_table_item_t v2_recog_header_string_table[] = {
 	{{"Multiple-Mode",          		  13},4}
 };
 
+/** Perfect hash slots of v2_recog_header string table */
+static const unsigned char v2_recog_header_hash_slots[128] = {
+	0,24,0,10,0,0,0,0,0,12,39,0,0,0,16,0,
+	0,0,0,43,26,0,0,0,15,0,0,23,0,5,4,41,
+	46,0,14,30,0,0,7,20,35,0,0,19,0,0,0,25,
+	0,40,0,0,1,0,0,0,45,0,0,31,27,6,0,0,
+	0,0,9,0,36,0,0,0,22,0,0,34,0,0,0,0,
+	13,17,0,8,0,0,0,0,0,0,28,0,0,0,0,0,
+	3,33,11,0,0,0,44,18,0,32,0,0,0,0,0,29,
+	0,0,0,0,42,0,0,37,0,2,38,21,0,0,0,0
+};
+
+/** Perfect hash of v2_recog_header string table */
+static const apt_str_table_hash_t v2_recog_header_string_hash = {1762,127,v2_recog_header_hash_slots};
+
 /** String table of MRCPv1 recognizer completion-cause fields (mrcp_recog_completion_cause_e) */
 static const apt_str_table_item_t v1_completion_cause_string_table[] = {
 	{{"success",                     7},1},
@@ -758,7 +788,8 @@ static const mrcp_header_vtable_t v1_vtable = {
 	mrcp_v1_recog_header_generate,
 	mrcp_recog_header_duplicate,
 	v1_recog_header_string_table,
-	RECOGNIZER_HEADER_COUNT
+	RECOGNIZER_HEADER_COUNT,
+	&v1_recog_header_string_hash
 };
 
 static const mrcp_header_vtable_t v2_vtable = {
@@ -768,7 +799,8 @@ static const mrcp_header_vtable_t v2_vtable = {
 	mrcp_v2_recog_header_generate,
 	mrcp_recog_header_duplicate,
 	v2_recog_header_string_table,
-	RECOGNIZER_HEADER_COUNT
+	RECOGNIZER_HEADER_COUNT,
+	&v2_recog_header_string_hash
 };
 
 const mrcp_header_vtable_t* mrcp_recog_header_vtable_get(mrcp_version_e version)
@@ -35,6 +35,14 @@ static const apt_str_table_item_t recorder_header_string_table[] = {
 	{{"New-Audio-Channel",    17},2}
 };
 
+/** Perfect hash slots of recorder_header string table */
+static const unsigned char recorder_header_hash_slots[16] = {
+	8,15,1,14,9,12,0,2,6,11,10,13,4,5,3,7
+};
+
+/** Perfect hash of recorder_header string table */
+static const apt_str_table_hash_t recorder_header_string_hash = {80584,15,recorder_header_hash_slots};
+
 /** String table of recorder completion-cause fields (mrcp_recorder_completion_cause_e) */
 static const apt_str_table_item_t completion_cause_string_table[] = {
 	{{"success-silence",  15},8},
@@ -264,7 +272,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_recorder_header_generate,
 	mrcp_recorder_header_duplicate,
 	recorder_header_string_table,
-	RECORDER_HEADER_COUNT
+	RECORDER_HEADER_COUNT,
+	&recorder_header_string_hash
 };
 
 const mrcp_header_vtable_t* mrcp_recorder_header_vtable_get(mrcp_version_e version)
@@ -41,6 +41,15 @@ static const apt_str_table_item_t synth_header_string_table[] = {
 	{{"Lexicon-Search-Order",20},2}
 };
 
+/** Perfect hash slots of synth_header string table */
+static const unsigned char synth_header_hash_slots[32] = {
+	9,0,0,16,12,18,0,20,21,5,2,0,0,19,11,13,
+	1,15,0,10,0,0,6,3,4,0,0,7,14,0,17,8
+};
+
+/** Perfect hash of synth_header string table */
+static const apt_str_table_hash_t synth_header_string_hash = {10135,31,synth_header_hash_slots};
+
 /** String table of MRCP speech-unit fields (mrcp_speech_unit_t) */
 static const apt_str_table_item_t speech_unit_string_table[] = {
 	{{"Second",   6},2},
@@ -547,7 +556,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_synth_header_generate,
 	mrcp_synth_header_duplicate,
 	synth_header_string_table,
-	SYNTHESIZER_HEADER_COUNT
+	SYNTHESIZER_HEADER_COUNT,
+	&synth_header_string_hash
 };
 
 const mrcp_header_vtable_t* mrcp_synth_header_vtable_get(mrcp_version_e version)
@@ -41,6 +41,15 @@ static const apt_str_table_item_t verifier_header_string_table[] = {
 	{{"Start-Input-Timers",          18},1}
 };
 
+/** Perfect hash slots of verifier_header string table */
+static const unsigned char verifier_header_hash_slots[32] = {
+	3,0,8,0,16,2,14,0,0,6,0,4,15,0,18,0,
+	9,19,0,0,7,0,20,1,13,17,11,5,0,10,21,12
+};
+
+/** Perfect hash of verifier_header string table */
+static const apt_str_table_hash_t verifier_header_string_hash = {6703,31,verifier_header_hash_slots};
+
 /** String table of MRCP verifier completion-cause fields (mrcp_verifier_completion_cause_e) */
 static const apt_str_table_item_t completion_cause_string_table[] = {
 	{{"success",                 7},2},
@@ -335,7 +344,8 @@ static const mrcp_header_vtable_t header_vtable = {
 	mrcp_verifier_header_generate,
 	mrcp_verifier_header_duplicate,
 	verifier_header_string_table,
-	VERIFIER_HEADER_COUNT
+	VERIFIER_HEADER_COUNT,
+	&verifier_header_string_hash
 };
 
 const mrcp_header_vtable_t* mrcp_verifier_header_vtable_get(mrcp_version_e version)
@@ -35,6 +35,10 @@ APT_BEGIN_EXTERN_C
 
 /** Size of the buffer used for MRCP rx/tx stream */
 #define MRCP_STREAM_BUFFER_SIZE 1024
+/** Max number of tx vectors (header and body of each message) sent at once */
+#define MRCP_TX_VECTOR_COUNT 16
+/** Max size of the header of a message not fitting the tx buffer */
+#define MRCP_TX_HEADER_MAX_SIZE (64 * 1024)
 
 /** MRCPv2 connection */
 struct mrcp_connection_t {
@@ -85,6 +89,22 @@ struct mrcp_connection_t {
 	apr_size_t        tx_buffer_size;
 	/** MRCP generator */
 	mrcp_generator_t *generator;
+	/** Tx vectors (header and body of each message) queued to send at the end of poll cycle */
+	struct iovec      tx_vec_arr[MRCP_TX_VECTOR_COUNT];
+	/** Number of queued tx vectors */
+	apr_int32_t       tx_vec_count;
+	/** Length of the tx buffer occupied by the headers of queued messages */
+	apr_size_t        tx_buffer_length;
+	/** Queued to send at the end of poll cycle */
+	apt_bool_t        tx_queued;
+	/** Tx backlog: the data the peer has not accepted yet */
+	char             *tx_backlog;
+	/** Tx backlog size */
+	apr_size_t        tx_backlog_size;
+	/** Offset of the data to send in the tx backlog */
+	apr_size_t        tx_backlog_offset;
+	/** Length of the data to send in the tx backlog */
+	apr_size_t        tx_backlog_length;
 
 	/** Inactivity timer  */
 	apt_timer_t      *inactivity_timer;
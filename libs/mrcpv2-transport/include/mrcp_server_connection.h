@@ -27,6 +27,9 @@
 
 APT_BEGIN_EXTERN_C
 
+/** Default max size of data kept in the tx backlog of a connection */
+#define MRCP_TX_BACKLOG_MAX_SIZE (1024 * 1024)
+
 /**
  * Create connection agent.
  * @param id the identifier of the engine
@@ -91,6 +94,15 @@ MRCP_DECLARE(void) mrcp_server_connection_rx_size_set(
 								mrcp_connection_agent_t *agent,
 								apr_size_t size);
 
+/**
+ * Enable/disable zero-copy parsing of received messages.
+ * @param agent the agent to set the parameter for
+ * @param zero_copy whether header fields and bodies of received messages should refer to rx buffer
+ */
+MRCP_DECLARE(void) mrcp_server_connection_zero_copy_set(
+								mrcp_connection_agent_t *agent,
+								apt_bool_t zero_copy);
+
 /**
  * Set tx buffer size.
  * @param agent the agent to set buffer size for
@@ -100,6 +112,16 @@ MRCP_DECLARE(void) mrcp_server_connection_tx_size_set(
 								mrcp_connection_agent_t *agent,
 								apr_size_t size);
 
+/**
+ * Set max size of the tx backlog.
+ * @param agent the agent to set the parameter for
+ * @param size the max size of data the peer hasn't accepted yet (0 - unlimited)
+ * @remark The connection is closed once the peer falls behind by more than the size.
+ */
+MRCP_DECLARE(void) mrcp_server_connection_max_tx_backlog_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t size);
+
 /**
  * Set max shared use count for an MRCPv2 connection.
  * @param agent the agent to set the parameter for
@@ -83,7 +83,7 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create(
 	agent->rx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
 	agent->tx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
 
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_task_msg_t),pool);
+	msg_pool = apt_task_msg_pool_create_cached(sizeof(connection_task_msg_t),pool);
 
 	agent->task = apt_poller_task_create(
 					max_connection_count,
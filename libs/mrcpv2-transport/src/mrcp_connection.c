@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include "mrcp_connection.h"
 #include "apt_pool.h"
 
@@ -43,6 +44,13 @@ mrcp_connection_t* mrcp_connection_create(void)
 	connection->rx_buffer_size = 0;
 	connection->tx_buffer = NULL;
 	connection->tx_buffer_size = 0;
+	connection->tx_vec_count = 0;
+	connection->tx_buffer_length = 0;
+	connection->tx_queued = FALSE;
+	connection->tx_backlog = NULL;
+	connection->tx_backlog_size = 0;
+	connection->tx_backlog_offset = 0;
+	connection->tx_backlog_length = 0;
 	connection->inactivity_timer = NULL;
 	connection->termination_timer = NULL;
 
@@ -52,6 +60,10 @@ mrcp_connection_t* mrcp_connection_create(void)
 void mrcp_connection_destroy(mrcp_connection_t *connection)
 {
 	if(connection && connection->pool) {
+		if(connection->tx_backlog) {
+			free(connection->tx_backlog);
+			connection->tx_backlog = NULL;
+		}
 		apr_pool_destroy(connection->pool);
 	}
 }
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include "mrcp_connection.h"
 #include "mrcp_server_connection.h"
 #include "mrcp_control_descriptor.h"
@@ -34,11 +35,15 @@ struct mrcp_connection_agent_t {
 	APR_RING_HEAD(mrcp_connection_head_t, mrcp_connection_t) connection_list;
 	/** Table of pending control channels */
 	apr_hash_t                           *pending_channel_table;
+	/** Array of connections with messages queued to send at the end of poll cycle */
+	apr_array_header_t                   *tx_connection_arr;
 
 	apt_bool_t                            force_new_connection;
 	apr_size_t                            max_shared_use_count;
 	apr_size_t                            tx_buffer_size;
+	apr_size_t                            tx_backlog_max_size;
 	apr_size_t                            rx_buffer_size;
+	apt_bool_t                            rx_zero_copy;
 	apr_uint32_t                          inactivity_timeout;
 	apr_uint32_t                          termination_timeout;
 
@@ -70,6 +75,9 @@ struct connection_task_msg_t {
 static apt_bool_t mrcp_server_agent_on_destroy(apt_task_t *task);
 static apt_bool_t mrcp_server_agent_msg_process(apt_task_t *task, apt_task_msg_t *task_msg);
 static apt_bool_t mrcp_server_poller_signal_process(void *obj, const apr_pollfd_t *descriptor);
+static void mrcp_server_poll_complete_process(void *obj);
+static apt_bool_t mrcp_server_agent_backlog_send(mrcp_connection_agent_t *agent, mrcp_connection_t *connection);
+static void mrcp_server_agent_tx_cancel(mrcp_connection_agent_t *agent, mrcp_connection_t *connection);
 
 static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_agent_t *agent);
 static void mrcp_server_agent_listening_socket_destroy(mrcp_connection_agent_t *agent);
@@ -104,7 +112,9 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 	agent->force_new_connection = force_new_connection;
 	agent->max_shared_use_count = 100;
 	agent->rx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
+	agent->rx_zero_copy = FALSE;
 	agent->tx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
+	agent->tx_backlog_max_size = MRCP_TX_BACKLOG_MAX_SIZE;
 	agent->inactivity_timeout = 600000; /* 10 min */
 	agent->termination_timeout = 3000; /* 3 sec */
 
@@ -113,7 +123,7 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 		return NULL;
 	}
 
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_task_msg_t),pool);
+	msg_pool = apt_task_msg_pool_create_cached(sizeof(connection_task_msg_t),pool);
 	
 	agent->task = apt_poller_task_create(
 					max_connection_count + 1,
@@ -125,6 +135,8 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 		return NULL;
 	}
 
+	apt_poller_task_complete_handler_set(agent->task,mrcp_server_poll_complete_process);
+
 	task = apt_poller_task_base_get(agent->task);
 	if(task) {
 		apt_task_name_set(task,id);
@@ -138,6 +150,7 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 
 	APR_RING_INIT(&agent->connection_list, mrcp_connection_t, link);
 	agent->pending_channel_table = apr_hash_make(pool);
+	agent->tx_connection_arr = apr_array_make(pool,(int)max_connection_count,sizeof(mrcp_connection_t*));
 
 	if(mrcp_server_agent_listening_socket_create(agent) != TRUE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Listening Socket [%s] %s:%hu", 
@@ -207,6 +220,14 @@ MRCP_DECLARE(void) mrcp_server_connection_rx_size_set(
 	agent->rx_buffer_size = size;
 }
 
+/** Enable/disable zero-copy parsing of received messages */
+MRCP_DECLARE(void) mrcp_server_connection_zero_copy_set(
+								mrcp_connection_agent_t *agent,
+								apt_bool_t zero_copy)
+{
+	agent->rx_zero_copy = zero_copy;
+}
+
 /** Set tx buffer size */
 MRCP_DECLARE(void) mrcp_server_connection_tx_size_set(
 								mrcp_connection_agent_t *agent,
@@ -218,6 +239,14 @@ MRCP_DECLARE(void) mrcp_server_connection_tx_size_set(
 	agent->tx_buffer_size = size;
 }
 
+/** Set max size of the tx backlog */
+MRCP_DECLARE(void) mrcp_server_connection_max_tx_backlog_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t size)
+{
+	agent->tx_backlog_max_size = size;
+}
+
 /** Set max shared use count for an MRCPv2 connection */
 MRCP_DECLARE(void) mrcp_server_connection_max_shared_use_set(
 								mrcp_connection_agent_t *agent,
@@ -490,6 +519,10 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 		return FALSE;
 	}
 
+	/* data the peer does not accept is kept in the tx backlog instead of blocking the agent */
+	apr_socket_opt_set(connection->sock,APR_SO_NONBLOCK,1);
+	apr_socket_timeout_set(connection->sock,0);
+
 	memset(&connection->sock_pfd,0,sizeof(apr_pollfd_t));
 	connection->sock_pfd.desc_type = APR_POLL_SOCKET;
 	connection->sock_pfd.reqevents = APR_POLLIN;
@@ -512,8 +545,11 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 	connection->tx_buffer = apr_palloc(connection->pool,connection->tx_buffer_size+1);
 
 	connection->rx_buffer_size = agent->rx_buffer_size;
-	connection->rx_buffer = apr_palloc(connection->pool,connection->rx_buffer_size+1);
-	apt_text_stream_init(&connection->rx_stream,connection->rx_buffer,connection->rx_buffer_size);
+	if(agent->rx_zero_copy == FALSE ||
+		mrcp_parser_zero_copy_enable(connection->parser,&connection->rx_stream,connection->rx_buffer_size) == FALSE) {
+		connection->rx_buffer = apr_palloc(connection->pool,connection->rx_buffer_size+1);
+		apt_text_stream_init(&connection->rx_stream,connection->rx_buffer,connection->rx_buffer_size);
+	}
 
 	if(apt_log_masking_get() != APT_LOG_MASKING_NONE) {
 		connection->verbose = FALSE;
@@ -535,6 +571,7 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 
 static apt_bool_t mrcp_server_agent_connection_close(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, apt_bool_t timedout)
 {
+	mrcp_server_agent_tx_cancel(agent,connection);
 	if(connection->sock) {
 		apt_poller_task_descriptor_remove(agent->task,&connection->sock_pfd);
 		apr_socket_close(connection->sock);
@@ -673,43 +710,291 @@ static apt_bool_t mrcp_server_agent_channel_remove(mrcp_connection_agent_t *agen
 	return mrcp_control_channel_remove_respond(agent->vtable,channel,TRUE);
 }
 
+/** Request (or stop requesting) to be signalled once the socket is writable */
+static apt_bool_t mrcp_server_agent_pollout_set(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, apt_bool_t pollout)
+{
+	apr_int16_t reqevents = APR_POLLIN;
+	if(pollout == TRUE) {
+		reqevents |= APR_POLLOUT;
+	}
+	if(connection->sock_pfd.reqevents == reqevents) {
+		return TRUE;
+	}
+
+	apt_poller_task_descriptor_remove(agent->task,&connection->sock_pfd);
+	connection->sock_pfd.reqevents = reqevents;
+	if(apt_poller_task_descriptor_add(agent->task,&connection->sock_pfd) != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",connection->id);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Append data to the tx backlog */
+static apt_bool_t mrcp_server_agent_backlog_append(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, const char *data, apr_size_t length)
+{
+	char *backlog;
+	apr_size_t size;
+	if(agent->tx_backlog_max_size && connection->tx_backlog_length + length > agent->tx_backlog_max_size) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Tx Backlog Exceeds Max Size %s [%"APR_SIZE_T_FMT" bytes]",
+			connection->id,agent->tx_backlog_max_size);
+		return FALSE;
+	}
+
+	if(connection->tx_backlog_offset) {
+		/* move the data not sent yet to the beginning */
+		memmove(connection->tx_backlog,connection->tx_backlog + connection->tx_backlog_offset,connection->tx_backlog_length);
+		connection->tx_backlog_offset = 0;
+	}
+
+	size = connection->tx_backlog_length + length;
+	if(size > connection->tx_backlog_size) {
+		if(size < connection->tx_backlog_size * 2) {
+			size = connection->tx_backlog_size * 2;
+		}
+		backlog = realloc(connection->tx_backlog,size);
+		if(!backlog) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Allocate Tx Backlog %s [%"APR_SIZE_T_FMT" bytes]",connection->id,size);
+			return FALSE;
+		}
+		connection->tx_backlog = backlog;
+		connection->tx_backlog_size = size;
+	}
+
+	memcpy(connection->tx_backlog + connection->tx_backlog_length,data,length);
+	connection->tx_backlog_length += length;
+	return TRUE;
+}
+
+/** Send data from the tx backlog */
+static apt_bool_t mrcp_server_agent_backlog_send(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+{
+	apr_status_t status;
+	apr_size_t length = connection->tx_backlog_length;
+	if(!length) {
+		return mrcp_server_agent_pollout_set(agent,connection,FALSE);
+	}
+
+	status = apr_socket_send(connection->sock,connection->tx_backlog + connection->tx_backlog_offset,&length);
+	if(status != APR_SUCCESS && !APR_STATUS_IS_EAGAIN(status)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send MRCPv2 Data %s",connection->id);
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Send MRCPv2 Backlog %s [%"APR_SIZE_T_FMT" of %"APR_SIZE_T_FMT" bytes]",
+		connection->id,length,connection->tx_backlog_length);
+	connection->tx_backlog_offset += length;
+	connection->tx_backlog_length -= length;
+	if(connection->tx_backlog_length) {
+		return TRUE;
+	}
+
+	connection->tx_backlog_offset = 0;
+	return mrcp_server_agent_pollout_set(agent,connection,FALSE);
+}
+
+/** Send messages queued for the connection by means of a single vectored write */
+static apt_bool_t mrcp_server_agent_connection_flush(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+{
+	apt_bool_t status = TRUE;
+	apr_size_t length = 0;
+	apr_int32_t i;
+	struct iovec *vec;
+
+	if(!connection->tx_vec_count) {
+		return TRUE;
+	}
+
+	if(!connection->tx_backlog_length) {
+		/* nothing is pending, try to send the queue at once */
+		apr_status_t rv = apr_socket_sendv(connection->sock,connection->tx_vec_arr,connection->tx_vec_count,&length);
+		if(rv != APR_SUCCESS && !APR_STATUS_IS_EAGAIN(rv)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send MRCPv2 Data %s",connection->id);
+			connection->tx_vec_count = 0;
+			connection->tx_buffer_length = 0;
+			return FALSE;
+		}
+	}
+
+	/* keep what the peer has not accepted in the backlog, preserving the order */
+	for(i = 0; i < connection->tx_vec_count; i++) {
+		vec = &connection->tx_vec_arr[i];
+		if(length >= vec->iov_len) {
+			length -= vec->iov_len;
+			continue;
+		}
+		if(mrcp_server_agent_backlog_append(agent,connection,(const char*)vec->iov_base + length,vec->iov_len - length) == FALSE) {
+			status = FALSE;
+			break;
+		}
+		length = 0;
+	}
+	connection->tx_vec_count = 0;
+	connection->tx_buffer_length = 0;
+
+	if(status == FALSE) {
+		/* the peer doesn't keep up with the messages sent, rather than losing some of them
+		or buffering without bound, close the connection as if the peer disconnected */
+		mrcp_server_agent_connection_close(agent,connection,FALSE);
+		return FALSE;
+	}
+
+	if(connection->tx_backlog_length) {
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Defer MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]",
+			connection->id,connection->tx_backlog_length);
+		if(mrcp_server_agent_pollout_set(agent,connection,TRUE) == FALSE) {
+			status = FALSE;
+		}
+	}
+	return status;
+}
+
+/** Drop messages queued for the connection */
+static void mrcp_server_agent_tx_cancel(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+{
+	int i;
+	if(connection->tx_queued == TRUE) {
+		for(i = 0; i < agent->tx_connection_arr->nelts; i++) {
+			if(APR_ARRAY_IDX(agent->tx_connection_arr,i,mrcp_connection_t*) == connection) {
+				APR_ARRAY_IDX(agent->tx_connection_arr,i,mrcp_connection_t*) = NULL;
+				break;
+			}
+		}
+		connection->tx_queued = FALSE;
+	}
+	connection->tx_vec_count = 0;
+	connection->tx_buffer_length = 0;
+	connection->tx_backlog_offset = 0;
+	connection->tx_backlog_length = 0;
+}
+
+/* Send messages queued in the poll cycle */
+static void mrcp_server_poll_complete_process(void *obj)
+{
+	mrcp_connection_agent_t *agent = obj;
+	mrcp_connection_t *connection;
+	int i;
+	for(i = 0; i < agent->tx_connection_arr->nelts; i++) {
+		connection = APR_ARRAY_IDX(agent->tx_connection_arr,i,mrcp_connection_t*);
+		if(connection) {
+			connection->tx_queued = FALSE;
+			if(connection->sock) {
+				mrcp_server_agent_connection_flush(agent,connection);
+			}
+		}
+	}
+	apr_array_clear(agent->tx_connection_arr);
+}
+
+/** Generate the header of the message next to the headers queued already */
+static apt_bool_t mrcp_server_agent_header_generate(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, mrcp_message_t *message, apt_text_stream_t *stream)
+{
+	apt_text_stream_init(
+		stream,
+		connection->tx_buffer + connection->tx_buffer_length,
+		connection->tx_buffer_size - connection->tx_buffer_length);
+	return mrcp_message_generate(agent->resource_factory,message,stream);
+}
+
+/** Generate the header of the message not fitting the tx buffer into a buffer of its own */
+static apt_bool_t mrcp_server_agent_large_header_generate(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, mrcp_message_t *message, apt_text_stream_t *stream)
+{
+	char *buffer;
+	apr_size_t size = connection->tx_buffer_size;
+	while(size < MRCP_TX_HEADER_MAX_SIZE) {
+		size *= 2;
+		/* the buffer is sent along with the body, which the message holds until then as well */
+		buffer = apr_palloc(message->pool,size+1);
+		apt_text_stream_init(stream,buffer,size);
+		if(mrcp_message_generate(agent->resource_factory,message,stream) == TRUE) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** Queue the message to send at the end of poll cycle */
 static apt_bool_t mrcp_server_agent_messsage_send(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, mrcp_message_t *message)
 {
-	apt_bool_t status = FALSE;
 	apt_text_stream_t stream;
-	apt_message_status_e result;
+	apr_size_t length;
+	apr_size_t body_length;
+	const char *body;
+	struct iovec *vec;
+	apt_bool_t tx_buffer_used = TRUE;
 	if(!connection || !connection->sock) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Null MRCPv2 Connection " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(message));
 		return FALSE;
 	}
 
-	do {
-		apt_text_stream_init(&stream,connection->tx_buffer,connection->tx_buffer_size);
-		result = mrcp_generator_run(connection->generator,message,&stream);
-		if(result != APT_MESSAGE_STATUS_INVALID) {
-			stream.text.length = stream.pos - stream.text.buf;
-			*stream.pos = '\0';
-
-			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
-					connection->id,
-					stream.text.length,
-					connection->verbose == TRUE ? stream.text.length : 0,
-					stream.text.buf);
-
-			if(apr_socket_send(connection->sock,stream.text.buf,&stream.text.length) == APR_SUCCESS) {
-				status = TRUE;
+	if(connection->tx_vec_count + 2 > MRCP_TX_VECTOR_COUNT) {
+		if(mrcp_server_agent_connection_flush(agent,connection) == FALSE && !connection->sock) {
+			return FALSE;
+		}
+	}
+
+	if(mrcp_server_agent_header_generate(agent,connection,message,&stream) == FALSE) {
+		if(connection->tx_buffer_length) {
+			/* the rest of the tx buffer is not enough, release the buffer and retry */
+			if(mrcp_server_agent_connection_flush(agent,connection) == FALSE && !connection->sock) {
+				return FALSE;
 			}
-			else {
-				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send MRCPv2 Data");
+			if(mrcp_server_agent_header_generate(agent,connection,message,&stream) == FALSE) {
+				tx_buffer_used = FALSE;
 			}
 		}
 		else {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Generate MRCPv2 Data");
+			tx_buffer_used = FALSE;
+		}
+
+		if(tx_buffer_used == FALSE &&
+			mrcp_server_agent_large_header_generate(agent,connection,message,&stream) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Generate MRCPv2 Data " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(message));
+			return FALSE;
 		}
 	}
-	while(result == APT_MESSAGE_STATUS_INCOMPLETE);
 
-	return status;
+	/* the header refers to the tx buffer, the body to the message itself */
+	length = stream.pos - stream.text.buf;
+	vec = &connection->tx_vec_arr[connection->tx_vec_count++];
+	vec->iov_base = stream.text.buf;
+	vec->iov_len = length;
+	if(message->body.length) {
+		vec = &connection->tx_vec_arr[connection->tx_vec_count++];
+		vec->iov_base = message->body.buf;
+		vec->iov_len = message->body.length;
+	}
+	if(tx_buffer_used == TRUE) {
+		connection->tx_buffer_length = stream.pos - connection->tx_buffer;
+	}
+
+	body = message->body.buf;
+	body_length = message->body.length;
+	if(connection->verbose == FALSE) {
+		if(apt_log_masking_get() != APT_LOG_MASKING_NONE) {
+			body = apt_log_data_mask(body,&body_length,message->pool);
+		}
+		else {
+			length = 0;
+			body_length = 0;
+		}
+		if(!body) {
+			body_length = 0;
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s%.*s",
+			connection->id,
+			(apr_size_t)(stream.pos - stream.text.buf) + message->body.length,
+			(int)length,
+			stream.text.buf,
+			(int)body_length,
+			body);
+
+	if(connection->tx_queued == FALSE) {
+		connection->tx_queued = TRUE;
+		APR_ARRAY_PUSH(agent->tx_connection_arr,mrcp_connection_t*) = connection;
+	}
+	return TRUE;
 }
 
 static apt_bool_t mrcp_server_message_handler(mrcp_connection_t *connection, mrcp_message_t *message, apt_message_status_e status)
@@ -766,14 +1051,32 @@ static apt_bool_t mrcp_server_poller_signal_process(void *obj, const apr_pollfd_
 	if(!connection || !connection->sock) {
 		return FALSE;
 	}
+
+	if(descriptor->rtnevents & APR_POLLOUT) {
+		/* the peer is ready to accept more data */
+		mrcp_server_agent_backlog_send(agent,connection);
+		if(!(descriptor->rtnevents & (APR_POLLIN | APR_POLLHUP | APR_POLLERR))) {
+			return TRUE;
+		}
+	}
 	stream = &connection->rx_stream;
 
 	/* calculate offset remaining from the previous receive / if any */
 	offset = stream->pos - stream->text.buf;
 	/* calculate available length */
-	length = connection->rx_buffer_size - offset;
+	if(connection->rx_buffer) {
+		length = connection->rx_buffer_size - offset;
+	}
+	else {
+		/* rx buffer is managed by the zero-copy parser */
+		length = stream->end - stream->pos;
+	}
 
 	status = apr_socket_recv(connection->sock,stream->pos,&length);
+	if(APR_STATUS_IS_EAGAIN(status)) {
+		/* nothing to receive yet */
+		return TRUE;
+	}
 	if(status == APR_EOF || length == 0) {
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"TCP/MRCPv2 Peer Disconnected %s",connection->id);
 		return mrcp_server_agent_connection_close(agent,connection,FALSE);
@@ -801,7 +1104,7 @@ static apt_bool_t mrcp_server_poller_signal_process(void *obj, const apr_pollfd_
 	while(apt_text_is_eos(stream) == FALSE);
 
 	/* scroll remaining stream */
-	apt_text_stream_scroll(stream);
+	mrcp_parser_stream_scroll(connection->parser,stream);
 	return TRUE;
 }
 
@@ -819,6 +1122,8 @@ static apt_bool_t mrcp_server_agent_msg_process(apt_task_t *task, apt_task_msg_t
 			mrcp_server_agent_channel_modify(agent,msg->channel,msg->descriptor);
 			break;
 		case CONNECTION_TASK_MSG_REMOVE_CHANNEL:
+			/* queued messages may refer to the memory of the session being removed */
+			mrcp_server_poll_complete_process(agent);
 			mrcp_server_agent_channel_remove(agent,msg->channel);
 			break;
 		case CONNECTION_TASK_MSG_SEND_MESSAGE:
@@ -28,6 +28,14 @@ static const apt_str_table_item_t rtsp_header_string_table[] = {
 	{{"Content-Length",14},8}
 };
 
+/** Perfect hash slots of rtsp_header string table */
+static const unsigned char rtsp_header_hash_slots[8] = {
+	3,2,6,0,1,5,0,4
+};
+
+/** Perfect hash of rtsp_header string table */
+static const apt_str_table_hash_t rtsp_header_string_hash = {14,7,rtsp_header_hash_slots};
+
 /** String table of RTSP content types (rtsp_content_type) */
 static const apt_str_table_item_t rtsp_content_type_string_table[] = {
 	{{"application/sdp", 15},12},
@@ -364,9 +372,10 @@ static apt_bool_t rtsp_header_field_value_generate(const rtsp_header_t *header,
 RTSP_DECLARE(apt_bool_t) rtsp_header_field_add(rtsp_header_t *header, apt_header_field_t *header_field, apr_pool_t *pool)
 {
 	/* parse header field (name-value) */
-	header_field->id = apt_string_table_id_find(
+	header_field->id = apt_string_table_hash_id_find(
 								rtsp_header_string_table,
 								RTSP_HEADER_FIELD_COUNT,
+								&rtsp_header_string_hash,
 								&header_field->name);
 	if(apt_string_is_empty(&header_field->value) == FALSE) {
 		rtsp_header_field_value_parse(header,header_field->id,&header_field->value,pool);
@@ -383,9 +392,10 @@ RTSP_DECLARE(apt_bool_t) rtsp_header_fields_parse(rtsp_header_t *header, apr_poo
 			header_field != APR_RING_SENTINEL(&header->header_section.ring, apt_header_field_t, link);
 				header_field = APR_RING_NEXT(header_field, link)) {
 
-		header_field->id = apt_string_table_id_find(
+		header_field->id = apt_string_table_hash_id_find(
 								rtsp_header_string_table,
 								RTSP_HEADER_FIELD_COUNT,
+								&rtsp_header_string_hash,
 								&header_field->name);
 		if(apt_string_is_empty(&header_field->value) == FALSE) {
 			rtsp_header_field_value_parse(header,header_field->id,&header_field->value,pool);
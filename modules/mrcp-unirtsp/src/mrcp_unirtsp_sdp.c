@@ -55,10 +55,10 @@ static apr_size_t sdp_rtp_media_generate(char *buffer, apr_size_t size, const mr
 		for(i=0; i<descriptor_arr->nelts; i++) {
 			codec_descriptor = &APR_ARRAY_IDX(descriptor_arr,i,mpf_codec_descriptor_t);
 			if(codec_descriptor->enabled == TRUE && codec_descriptor->name.buf) {
-				offset += snprintf(buffer+offset,size-offset,"a=rtpmap:%d %s/%d\r\n",
+				offset += snprintf(buffer+offset,size-offset,"a=rtpmap:%d %s/%u\r\n",
 					codec_descriptor->payload_type,
 					codec_descriptor->name.buf,
-					codec_descriptor->sampling_rate);
+					mpf_codec_rtp_clock_rate_get(codec_descriptor));
 				if(codec_descriptor->format.buf) {
 					offset += snprintf(buffer+offset,size-offset,"a=fmtp:%d %s\r\n",
 						codec_descriptor->payload_type,
@@ -109,8 +109,8 @@ static apt_bool_t mpf_rtp_media_generate(mpf_rtp_media_descriptor_t *rtp_media,
 		if(codec) {
 			codec->payload_type = (apr_byte_t)map->rm_pt;
 			apt_string_assign(&codec->name,map->rm_encoding,pool);
-			codec->sampling_rate = (apr_uint16_t)map->rm_rate;
 			codec->channel_count = 1;
+			mpf_codec_rtp_clock_rate_set(codec,map->rm_rate);
 		}
 	}
 
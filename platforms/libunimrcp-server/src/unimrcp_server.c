@@ -22,6 +22,7 @@
 #include "unimrcp_server.h"
 #include "mrcp_resource_loader.h"
 #include "mpf_engine.h"
+#include "mpf_engine_factory.h"
 #include "mpf_codec_manager.h"
 #include "mpf_rtp_termination_factory.h"
 #include "mrcp_sofiasip_server_agent.h"
@@ -72,6 +73,9 @@ struct unimrcp_server_loader_t {
 	
 	/** Implicitly detected, cached IP address */
 	const char      *auto_ip;
+
+	/** Table of media engine groups (apr_array_header_t* of mpf_engine_t*) */
+	apr_hash_t      *media_engine_groups;
 };
 
 static apt_bool_t unimrcp_server_load(mrcp_server_t *mrcp_server, apt_dir_layout_t *dir_layout, apr_pool_t *pool);
@@ -492,6 +496,8 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 	apr_size_t termination_timeout = 3; /* sec */
 	apr_size_t rx_buffer_size = 0;
 	apr_size_t tx_buffer_size = 0;
+	apr_size_t max_tx_backlog_size = MRCP_TX_BACKLOG_MAX_SIZE;
+	apt_bool_t zero_copy = FALSE;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading MRCPv2 Agent <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -534,11 +540,21 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 				rx_buffer_size = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"zero-copy") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				zero_copy = cdata_bool_get(elem);
+			}
+		}
 		else if(strcasecmp(elem->name,"tx-buffer-size") == 0) {
 			if(is_cdata_valid(elem) == TRUE) {
 				tx_buffer_size = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"max-tx-backlog-size") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				max_tx_backlog_size = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -554,9 +570,11 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 		if(rx_buffer_size) {
 			mrcp_server_connection_rx_size_set(agent,rx_buffer_size);
 		}
+		mrcp_server_connection_zero_copy_set(agent,zero_copy);
 		if(tx_buffer_size) {
 			mrcp_server_connection_tx_size_set(agent,tx_buffer_size);
 		}
+		mrcp_server_connection_max_tx_backlog_set(agent,max_tx_backlog_size);
 		mrcp_server_connection_max_shared_use_set(agent,max_shared_use_count);
 		mrcp_server_connection_timeout_set(agent,inactivity_timeout);
 		mrcp_server_connection_term_timeout_set(agent,termination_timeout);
@@ -570,6 +588,12 @@ static apt_bool_t unimrcp_server_media_engine_load(unimrcp_server_loader_t *load
 	const apr_xml_elem *elem;
 	mpf_engine_t *media_engine;
 	unsigned long realtime_rate = 1;
+	unsigned long instance_count = 1;
+	int realtime_priority = 0;
+	int cpu_affinity = -1;
+	unsigned long i;
+	apr_array_header_t *group;
+	const char *instance_id;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Media Engine <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -579,16 +603,58 @@ static apt_bool_t unimrcp_server_media_engine_load(unimrcp_server_loader_t *load
 				realtime_rate = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"instance-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				instance_count = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"realtime-priority") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				realtime_priority = atoi(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"cpu-affinity") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				cpu_affinity = atoi(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
 	}
 
-	media_engine = mpf_engine_create(id,loader->pool);
-	if(media_engine) {
+	if(instance_count <= 1) {
+		media_engine = mpf_engine_create(id,loader->pool);
+		if(media_engine) {
+			mpf_engine_scheduler_rate_set(media_engine,realtime_rate);
+			mpf_engine_scheduler_priority_set(media_engine,realtime_priority);
+			mpf_engine_scheduler_cpu_affinity_set(media_engine,cpu_affinity);
+		}
+		return mrcp_server_media_engine_register(loader->server,media_engine);
+	}
+
+	/* create a group of media engines, each running in its own thread, 
+	which can be referenced from a profile by the common identifier */
+	group = apr_array_make(loader->pool,(int)instance_count,sizeof(mpf_engine_t*));
+	for(i=1; i<=instance_count; i++) {
+		instance_id = apr_psprintf(loader->pool,"%s-%lu",id,i);
+		media_engine = mpf_engine_create(instance_id,loader->pool);
+		if(!media_engine) {
+			return FALSE;
+		}
 		mpf_engine_scheduler_rate_set(media_engine,realtime_rate);
+		mpf_engine_scheduler_priority_set(media_engine,realtime_priority);
+		if(cpu_affinity >= 0) {
+			/* pin each instance to its own core, starting from the specified one */
+			mpf_engine_scheduler_cpu_affinity_set(media_engine,cpu_affinity + (int)(i-1));
+		}
+		if(mrcp_server_media_engine_register(loader->server,media_engine) == FALSE) {
+			return FALSE;
+		}
+		APR_ARRAY_PUSH(group,mpf_engine_t*) = media_engine;
 	}
-	return mrcp_server_media_engine_register(loader->server,media_engine);
+	apr_hash_set(loader->media_engine_groups,id,APR_HASH_KEY_STRING,group);
+	return TRUE;
 }
 
 /** Load RTP factory */
@@ -623,6 +689,23 @@ static apt_bool_t unimrcp_server_rtp_factory_load(unimrcp_server_loader_t *loade
 				rtp_config->rtp_port_max = (apr_port_t)atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"io-mode") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				const char *io_mode = cdata_text_get(elem);
+				if(strcasecmp(io_mode,"batched") == 0) {
+					rtp_config->io_mode = RTP_IO_MODE_BATCHED;
+				}
+				else if(strcasecmp(io_mode,"shared") == 0) {
+					rtp_config->io_mode = RTP_IO_MODE_SHARED;
+				}
+				else if(strcasecmp(io_mode,"socket") == 0) {
+					rtp_config->io_mode = RTP_IO_MODE_SOCKET;
+				}
+				else {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown RTP I/O Mode <%s>",io_mode);
+				}
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -711,6 +794,11 @@ static apt_bool_t unimrcp_server_plugin_load(unimrcp_server_loader_t *loader, co
 					config->max_channel_count = atol(cdata_text_get(elem));
 				}
 			}
+			else if(strcasecmp(elem->name,"worker-count") == 0) {
+				if(is_cdata_valid(elem) == TRUE) {
+					config->worker_count = atol(cdata_text_get(elem));
+				}
+			}
 			else if(strcasecmp(elem->name,"param") == 0) {
 				if(name_value_attribs_get(elem,&attr_name,&attr_value) == TRUE) {
 					apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Param %s:%s",attr_name->value,attr_value->value);
@@ -888,6 +976,46 @@ static apr_table_t* resource_engine_map_load(const apr_xml_elem *root, apr_pool_
 	return plugin_map;
 }
 
+/** Create factory of media engines */
+static mpf_engine_factory_t* unimrcp_server_mpf_factory_create(unimrcp_server_loader_t *loader, const apr_xml_elem *elem)
+{
+	mpf_engine_factory_t *mpf_factory = NULL;
+	mpf_engine_t *media_engine;
+	apr_array_header_t *group;
+	int i;
+
+	char *name;
+	char *state;
+	char *list_str = apr_pstrdup(loader->pool,cdata_text_get(elem));
+	do {
+		name = apr_strtok(list_str, ",", &state);
+		if(name) {
+			group = apr_hash_get(loader->media_engine_groups,name,APR_HASH_KEY_STRING);
+			media_engine = mrcp_server_media_engine_get(loader->server,name);
+			if(group || media_engine) {
+				if(!mpf_factory)
+					mpf_factory = mpf_engine_factory_create(loader->pool);
+
+				if(group) {
+					for(i=0; i<group->nelts; i++) {
+						mpf_engine_factory_engine_add(mpf_factory,APR_ARRAY_IDX(group,i,mpf_engine_t*));
+					}
+				}
+				else {
+					mpf_engine_factory_engine_add(mpf_factory,media_engine);
+				}
+			}
+			else {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Media Engine Name <%s>",name);
+			}
+		}
+		list_str = NULL; /* make sure we pass NULL on subsequent calls of apr_strtok() */
+	}
+	while(name);
+
+	return mpf_factory;
+}
+
 /** Load MRCPv2 profile */
 static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root, const char *id)
 {
@@ -895,7 +1023,7 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 	mrcp_server_profile_t *profile;
 	mrcp_sig_agent_t *sip_agent = NULL;
 	mrcp_connection_agent_t *mrcpv2_agent = NULL;
-	mpf_engine_t *media_engine = NULL;
+	mpf_engine_factory_t *mpf_factory = NULL;
 	mpf_termination_factory_t *rtp_factory = NULL;
 	mpf_rtp_settings_t *rtp_settings = NULL;
 	apr_table_t *resource_engine_map = NULL;
@@ -915,7 +1043,7 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 			mrcpv2_agent = mrcp_server_connection_agent_get(loader->server,cdata_text_get(elem));
 		}
 		else if(strcasecmp(elem->name,"media-engine") == 0) {
-			media_engine = mrcp_server_media_engine_get(loader->server,cdata_text_get(elem));
+			mpf_factory = unimrcp_server_mpf_factory_create(loader,elem);
 		}
 		else if(strcasecmp(elem->name,"rtp-factory") == 0) {
 			rtp_factory = mrcp_server_rtp_factory_get(loader->server,cdata_text_get(elem));
@@ -932,13 +1060,13 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 	}
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv2 Profile [%s]",id);
-	profile = mrcp_server_profile_create(
+	profile = mrcp_server_profile_create_ex(
 				id,
 				MRCP_VERSION_2,
 				NULL,
 				sip_agent,
 				mrcpv2_agent,
-				media_engine,
+				mpf_factory,
 				rtp_factory,
 				rtp_settings,
 				loader->pool);
@@ -951,7 +1079,7 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 	const apr_xml_elem *elem;
 	mrcp_server_profile_t *profile;
 	mrcp_sig_agent_t *rtsp_agent = NULL;
-	mpf_engine_t *media_engine = NULL;
+	mpf_engine_factory_t *mpf_factory = NULL;
 	mpf_termination_factory_t *rtp_factory = NULL;
 	mpf_rtp_settings_t *rtp_settings = NULL;
 	apr_table_t *resource_engine_map = NULL;
@@ -968,7 +1096,7 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 			rtsp_agent = mrcp_server_signaling_agent_get(loader->server,cdata_text_get(elem));
 		}
 		else if(strcasecmp(elem->name,"media-engine") == 0) {
-			media_engine = mrcp_server_media_engine_get(loader->server,cdata_text_get(elem));
+			mpf_factory = unimrcp_server_mpf_factory_create(loader,elem);
 		}
 		else if(strcasecmp(elem->name,"rtp-factory") == 0) {
 			rtp_factory = mrcp_server_rtp_factory_get(loader->server,cdata_text_get(elem));
@@ -985,13 +1113,13 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 	}
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv1 Profile [%s]",id);
-	profile = mrcp_server_profile_create(
+	profile = mrcp_server_profile_create_ex(
 				id,
 				MRCP_VERSION_1,
 				NULL,
 				rtsp_agent,
 				NULL,
-				media_engine,
+				mpf_factory,
 				rtp_factory,
 				rtp_settings,
 				loader->pool);
@@ -999,6 +1127,32 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 }
 
 
+/** Load session pool cache settings */
+static apt_bool_t unimrcp_server_session_pool_cache_load(unimrcp_server_loader_t *loader, const apr_xml_elem *elem)
+{
+	const apr_xml_attr *attr;
+	apr_size_t max_count = 0;
+	apr_size_t init_count = 0;
+	apr_size_t pool_size = 0;
+	for(attr = elem->attr; attr; attr = attr->next) {
+		if(strcasecmp(attr->name,"max-count") == 0) {
+			max_count = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"init-count") == 0) {
+			init_count = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"pool-size") == 0) {
+			pool_size = atol(attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property session-pool-cache:%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT,
+		max_count,init_count,pool_size);
+	return mrcp_server_session_pool_cache_set(loader->server,max_count,init_count,pool_size);
+}
+
 /** Load properties */
 static apt_bool_t unimrcp_server_properties_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
 {
@@ -1015,6 +1169,16 @@ static apt_bool_t unimrcp_server_properties_load(unimrcp_server_loader_t *loader
 			loader->ext_ip = unimrcp_server_ip_address_get(loader,elem);
 			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property ext-ip:%s",loader->ext_ip);
 		}
+		else if(strcasecmp(elem->name,"session-worker-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				apr_size_t worker_count = atol(cdata_text_get(elem));
+				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property session-worker-count:%"APR_SIZE_T_FMT,worker_count);
+				mrcp_server_session_worker_count_set(loader->server,worker_count);
+			}
+		}
+		else if(strcasecmp(elem->name,"session-pool-cache") == 0) {
+			unimrcp_server_session_pool_cache_load(loader,elem);
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -1264,6 +1428,7 @@ static apt_bool_t unimrcp_server_load(mrcp_server_t *mrcp_server, apt_dir_layout
 	loader->ip = DEFAULT_IP_ADDRESS;
 	loader->ext_ip = NULL;
 	loader->auto_ip = NULL;
+	loader->media_engine_groups = apr_hash_make(pool);
 
 	/* Navigate through document */
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -29,11 +29,9 @@
 
 #include "mrcp_verifier_engine.h"
 #include "mpf_activity_detector.h"
-#include "apt_consumer_task.h"
+#include "mrcp_engine_worker.h"
 #include "apt_log.h"
 
-#define VERIFIER_ENGINE_TASK_NAME "Demo Verifier Engine"
-
 typedef struct demo_verifier_engine_t demo_verifier_engine_t;
 typedef struct demo_verifier_channel_t demo_verifier_channel_t;
 typedef struct demo_verifier_msg_t demo_verifier_msg_t;
@@ -84,13 +82,16 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of demo verification engine */
 struct demo_verifier_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
 };
 
 /** Declaration of demo verification channel */
 struct demo_verifier_channel_t {
 	/** Back pointer to engine */
 	demo_verifier_engine_t     *demo_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t                 *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
 
@@ -141,21 +142,7 @@ MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(VERIF_PLUGIN,"VERIF-PLUGIN")
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	demo_verifier_engine_t *demo_engine = apr_palloc(pool,sizeof(demo_verifier_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(demo_verifier_msg_t),pool);
-	demo_engine->task = apt_consumer_task_create(demo_engine,msg_pool,pool);
-	if(!demo_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(demo_engine->task);
-	apt_task_name_set(task,VERIFIER_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = demo_verifier_msg_process;
-	}
+	demo_engine->worker_pool = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -168,12 +155,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy verification engine */
 static apt_bool_t demo_verifier_engine_destroy(mrcp_engine_t *engine)
 {
-	demo_verifier_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_destroy(task);
-		demo_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -181,10 +162,12 @@ static apt_bool_t demo_verifier_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t demo_verifier_engine_open(mrcp_engine_t *engine)
 {
 	demo_verifier_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_start(task);
+	/* create workers (threads) to process the requests of the channels */
+	demo_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(demo_verifier_msg_t),demo_verifier_msg_process);
+	if(!demo_engine->worker_pool) {
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	mrcp_worker_pool_start(demo_engine->worker_pool);
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -192,9 +175,9 @@ static apt_bool_t demo_verifier_engine_open(mrcp_engine_t *engine)
 static apt_bool_t demo_verifier_engine_close(mrcp_engine_t *engine)
 {
 	demo_verifier_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(demo_engine->worker_pool) {
+		mrcp_worker_pool_terminate(demo_engine->worker_pool);
+		demo_engine->worker_pool = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -207,6 +190,7 @@ static mrcp_engine_channel_t* demo_verifier_engine_channel_create(mrcp_engine_t
 	/* create demo verification channel */
 	demo_verifier_channel_t *verifier_channel = apr_palloc(pool,sizeof(demo_verifier_channel_t));
 	verifier_channel->demo_engine = engine->obj;
+	verifier_channel->task = mrcp_worker_pool_task_assign(verifier_channel->demo_engine->worker_pool);
 	verifier_channel->verifier_request = NULL;
 	verifier_channel->stop_response = NULL;
 	verifier_channel->detector = mpf_activity_detector_create(pool);
@@ -550,8 +534,7 @@ static apt_bool_t demo_verifier_msg_signal(demo_verifier_msg_type_e type, mrcp_e
 {
 	apt_bool_t status = FALSE;
 	demo_verifier_channel_t *demo_channel = channel->method_obj;
-	demo_verifier_engine_t *demo_engine = demo_channel->demo_engine;
-	apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
+	apt_task_t *task = demo_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		demo_verifier_msg_t *demo_msg;
@@ -28,14 +28,14 @@
  */
 
 #include "mrcp_recog_engine.h"
+#include "mrcp_engine_feeder.h"
+#include "mrcp_engine_worker.h"
 #include "mpf_activity_detector.h"
-#include "apt_consumer_task.h"
 #include "apt_log.h"
 #include "apr_file_info.h"
 #include "nls_asr.h"
 #include <stdlib.h>
 
-#define RECOG_ENGINE_TASK_NAME "Nls Recog Engine"
 #define RECOG_ENGINE_CONF_FILE_NAME "nlsrecog.xml"
 
 typedef struct nls_recog_engine_t nls_recog_engine_t;
@@ -119,13 +119,18 @@ static nls_recog_event_et			nls_recog_sm_get_status(nls_recog_state_machine_t* r
 
 /** Declaration of nls recognizer engine */
 struct nls_recog_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Pool of workers feeding audio to ASR sessions */
+	mrcp_feeder_pool_t     *feeder_pool;
 };
 
 /** Declaration of nls recognizer channel */
 struct nls_recog_channel_t {
 	/** Back pointer to engine */
 	nls_recog_engine_t     *nls_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t             *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
 
@@ -139,8 +144,12 @@ struct nls_recog_channel_t {
 	//mpf_activity_detector_t *detector;
 	/** File to write utterance to */
 	FILE                    *audio_out;
+	/** Feeder passing audio to ASR session off the MPF engine thread */
+	mrcp_feeder_t           *feeder;
+	/** Indicates whether audio is fed to ASR session */
+	apt_bool_t               feeding;
 
-	NlsASRSession			*asr_session;
+	NlsASRSession			*asr_session; // accessed by feeder worker only
 	nls_recog_state_machine_t	*recog_sm;
 };
 
@@ -160,6 +169,23 @@ struct nls_recog_msg_t {
 static apt_bool_t nls_recog_msg_signal(nls_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
 static apt_bool_t nls_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 
+/** Commands processed by feeder worker */
+typedef enum {
+	NLS_FEEDER_SESSION_START,
+	NLS_FEEDER_SESSION_CLOSE,
+	NLS_FEEDER_SESSION_STOP
+} nls_feeder_command_e;
+
+static apt_bool_t nls_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size);
+static apt_bool_t nls_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg);
+static void nls_recog_feeder_close(mrcp_feeder_t *feeder);
+
+static const mrcp_feeder_vtable_t feeder_vtable = {
+	nls_recog_feeder_audio,
+	nls_recog_feeder_command,
+	nls_recog_feeder_close
+};
+
 /** Declare this macro to set plugin version */
 MRCP_PLUGIN_VERSION_DECLARE
 
@@ -177,21 +203,8 @@ MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(RECOG_PLUGIN,"RECOG-PLUGIN")
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	nls_recog_engine_t *nls_engine = (nls_recog_engine_t*)apr_palloc(pool,sizeof(nls_recog_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(nls_recog_msg_t),pool);
-	nls_engine->task = apt_consumer_task_create(nls_engine,msg_pool,pool);
-	if(!nls_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(nls_engine->task);
-	apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = nls_recog_msg_process;
-	}
+	nls_engine->feeder_pool = NULL;
+	nls_engine->worker_pool = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -204,12 +217,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy recognizer engine */
 static apt_bool_t nls_recog_engine_destroy(mrcp_engine_t *engine)
 {
-	nls_recog_engine_t *nls_engine = (nls_recog_engine_t*)engine->obj;
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_destroy(task);
-		nls_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -217,7 +224,6 @@ static apt_bool_t nls_recog_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t nls_recog_engine_open(mrcp_engine_t *engine)
 {
 	nls_recog_engine_t *nls_engine = (nls_recog_engine_t*)engine->obj;
-
 	const apt_dir_layout_t *dir_layout = engine->dir_layout;
 	const char* dir_path_conf = apt_dir_layout_path_get(dir_layout, APT_LAYOUT_CONF_DIR);
 	char* file_path_conf = NULL;
@@ -227,7 +233,7 @@ static apt_bool_t nls_recog_engine_open(mrcp_engine_t *engine)
 			"Get file path for %s failed!!!",
 			RECOG_ENGINE_CONF_FILE_NAME
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 
 	if (NlsASR::GlobalInit(file_path_conf) != 0)
@@ -236,17 +242,32 @@ static apt_bool_t nls_recog_engine_open(mrcp_engine_t *engine)
 			"NlsASR::GlobalInit(%s) failed!!!",
 			file_path_conf
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
 		"NlsASR::GlobalInit(%s) successfully.",
 		file_path_conf
 		);
 
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_start(task);
+	nls_engine->feeder_pool = mrcp_engine_feeder_pool_create(engine);
+	if(!nls_engine->feeder_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Feeder Pool");
+		NlsASR::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	mrcp_feeder_pool_start(nls_engine->feeder_pool);
+
+	/* create workers (threads) to process the requests of the channels, once nothing else may fail */
+	nls_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(nls_recog_msg_t),nls_recog_msg_process);
+	if(!nls_engine->worker_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Workers");
+		mrcp_feeder_pool_terminate(nls_engine->feeder_pool);
+		nls_engine->feeder_pool = NULL;
+		NlsASR::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	mrcp_worker_pool_start(nls_engine->worker_pool);
+
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -255,14 +276,19 @@ static apt_bool_t nls_recog_engine_close(mrcp_engine_t *engine)
 {
 	nls_recog_engine_t *nls_engine = (nls_recog_engine_t*)engine->obj;
 
+	if(nls_engine->feeder_pool) {
+		mrcp_feeder_pool_terminate(nls_engine->feeder_pool);
+		nls_engine->feeder_pool = NULL;
+	}
+
 	NlsASR::GlobalFini();
 	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
 		"NlsASR::GlobalFini() successfully."
 		);
 
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(nls_engine->worker_pool) {
+		mrcp_worker_pool_terminate(nls_engine->worker_pool);
+		nls_engine->worker_pool = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -275,12 +301,22 @@ static mrcp_engine_channel_t* nls_recog_engine_channel_create(mrcp_engine_t *eng
 	/* create nls recog channel */
 	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)apr_palloc(pool,sizeof(nls_recog_channel_t));
 	recog_channel->nls_engine = (nls_recog_engine_t*)engine->obj;
+	recog_channel->task = mrcp_worker_pool_task_assign(recog_channel->nls_engine->worker_pool);
 	recog_channel->recog_request = NULL;
 	recog_channel->stop_response = NULL;
 	//recog_channel->detector = mpf_activity_detector_create(pool);
 	recog_channel->audio_out = NULL;
 	recog_channel->asr_session = NULL;
 	recog_channel->recog_sm = NULL;
+	recog_channel->feeding = FALSE;
+	recog_channel->feeder = mrcp_feeder_create(
+			recog_channel->nls_engine->feeder_pool,
+			&feeder_vtable,
+			recog_channel,
+			MRCP_FEEDER_DEFAULT_CAPACITY);
+	if(!recog_channel->feeder) {
+		return NULL;
+	}
 
 	capabilities = mpf_sink_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -309,7 +345,11 @@ static mrcp_engine_channel_t* nls_recog_engine_channel_create(mrcp_engine_t *eng
 /** Destroy engine channel */
 static apt_bool_t nls_recog_channel_destroy(mrcp_engine_channel_t *channel)
 {
-	/* nothing to destrtoy */
+	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)channel->method_obj;
+	if(recog_channel->feeder) {
+		mrcp_feeder_destroy(recog_channel->feeder);
+		recog_channel->feeder = NULL;
+	}
 	return TRUE;
 }
 
@@ -338,6 +378,7 @@ static apt_bool_t nls_recog_channel_recognize(mrcp_engine_channel_t *channel, mr
 	mrcp_recog_header_t *recog_header;
 	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)channel->method_obj;
 	const mpf_codec_descriptor_t *descriptor = mrcp_engine_sink_stream_codec_get(channel);
+	NlsASRSession *asr_session;
 
 	if(!descriptor) {
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec Descriptor " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
@@ -396,19 +437,23 @@ static apt_bool_t nls_recog_channel_recognize(mrcp_engine_channel_t *channel, mr
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(channel,response);
 
-	recog_channel->asr_session	=	NlsASR::OpenSession(nls_recog_sm_on_notify, recog_channel->recog_sm);
-	if (recog_channel->asr_session == NULL)
+	asr_session	=	NlsASR::OpenSession(nls_recog_sm_on_notify, recog_channel->recog_sm);
+	if (asr_session == NULL)
 	{
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to open NlsASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
 		response->start_line.status_code = MRCP_STATUS_CODE_RESOURCE_SPECIFIC_FAILURE;
 		return FALSE;
 	}
-	if (recog_channel->asr_session->Start() != 0)
+	if (asr_session->Start() != 0)
 	{
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to start NlsASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		NlsASR::CloseSession(asr_session);
 		response->start_line.status_code = MRCP_STATUS_CODE_RESOURCE_SPECIFIC_FAILURE;
 		return FALSE;
 	}
+	/* hand the session over to feeder worker, audio is fed from now on */
+	mrcp_feeder_command_post(recog_channel->feeder,NLS_FEEDER_SESSION_START,asr_session);
+	recog_channel->feeding = TRUE;
 
 	recog_channel->recog_request = request;
 	return TRUE;
@@ -421,17 +466,10 @@ static apt_bool_t nls_recog_channel_stop(mrcp_engine_channel_t *channel, mrcp_me
 	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)channel->method_obj;
 	if (recog_channel != NULL)
 	{
-		if (recog_channel->asr_session != NULL)
-		{
-			NlsASR::CloseSession(recog_channel->asr_session);
-			recog_channel->asr_session = NULL;
-		}
-
-		if (recog_channel->recog_sm != NULL )
-		{
-			nls_recog_sm_delete(recog_channel->recog_sm);
-			recog_channel->recog_sm	=	NULL;
-		}
+		/* the state machine is deleted by feeder worker once the session is closed */
+		recog_channel->feeding = FALSE;
+		mrcp_feeder_command_post(recog_channel->feeder,NLS_FEEDER_SESSION_STOP,recog_channel->recog_sm);
+		recog_channel->recog_sm	=	NULL;
 
 		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"nls_recog_channel_stop() invoked!!!");
 	}
@@ -554,10 +592,11 @@ static apt_bool_t nls_recog_recognition_complete(nls_recog_channel_t *recog_chan
 {
 	if (recog_channel != NULL)
 	{
-		if (recog_channel->asr_session != NULL)
+		if (recog_channel->feeding == TRUE)
 		{
-			NlsASR::CloseSession(recog_channel->asr_session);
-			recog_channel->asr_session = NULL;
+			/* never block here, the session is closed by feeder worker */
+			recog_channel->feeding = FALSE;
+			mrcp_feeder_command_post(recog_channel->feeder,NLS_FEEDER_SESSION_CLOSE,NULL);
 
 			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"nls_recog_recognition_complete() invoked!!!");
 		}
@@ -629,9 +668,9 @@ static apt_bool_t nls_recog_stream_write(mpf_audio_stream_t *stream, const mpf_f
 				break;
 		}
 		*/
-		if(recog_channel->asr_session)
+		if(recog_channel->feeding)
 		{
-			recog_channel->asr_session->FeedAudioData(frame->codec_frame.buffer, frame->codec_frame.size);
+			mrcp_feeder_audio_write(recog_channel->feeder,frame->codec_frame.buffer,frame->codec_frame.size);
 		}
 
 		if(recog_channel->recog_sm)
@@ -712,8 +751,7 @@ static apt_bool_t nls_recog_msg_signal(nls_recog_msg_type_e type, mrcp_engine_ch
 {
 	apt_bool_t status = FALSE;
 	nls_recog_channel_t *nls_channel = (nls_recog_channel_t*)channel->method_obj;
-	nls_recog_engine_t *nls_engine = nls_channel->nls_engine;
-	apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
+	apt_task_t *task = nls_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		nls_recog_msg_t *nls_msg;
@@ -745,7 +783,11 @@ static apt_bool_t nls_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 				recog_channel->audio_out = NULL;
 			}
 
-			mrcp_engine_channel_close_respond(nls_msg->channel);
+			/* the response is sent once feeder worker closes ASR session */
+			recog_channel->feeding = FALSE;
+			if(mrcp_feeder_close(recog_channel->feeder) == FALSE) {
+				mrcp_engine_channel_close_respond(nls_msg->channel);
+			}
 			break;
 		}
 		case NLS_RECOG_MSG_REQUEST_PROCESS:
@@ -757,6 +799,56 @@ static apt_bool_t nls_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	return TRUE;
 }
 
+/** Feed audio to ASR session (feeder worker) */
+static apt_bool_t nls_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size)
+{
+	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	if(!recog_channel->asr_session) {
+		return FALSE;
+	}
+	recog_channel->asr_session->FeedAudioData(data, (uint32_t)size);
+	return TRUE;
+}
+
+/** Process feeder command (feeder worker) */
+static apt_bool_t nls_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg)
+{
+	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	switch(command) {
+		case NLS_FEEDER_SESSION_START:
+			if(recog_channel->asr_session) {
+				NlsASR::CloseSession(recog_channel->asr_session);
+			}
+			recog_channel->asr_session = (NlsASRSession*)arg;
+			break;
+		case NLS_FEEDER_SESSION_CLOSE:
+		case NLS_FEEDER_SESSION_STOP:
+			if(recog_channel->asr_session) {
+				NlsASR::CloseSession(recog_channel->asr_session);
+				recog_channel->asr_session = NULL;
+			}
+			if(command == NLS_FEEDER_SESSION_STOP && arg) {
+				/* no more notifications may come, once the session is closed */
+				nls_recog_sm_delete((nls_recog_state_machine_t*)arg);
+			}
+			break;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+/** Close ASR session and respond to channel close (feeder worker) */
+static void nls_recog_feeder_close(mrcp_feeder_t *feeder)
+{
+	nls_recog_channel_t *recog_channel = (nls_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	if(recog_channel->asr_session) {
+		NlsASR::CloseSession(recog_channel->asr_session);
+		recog_channel->asr_session = NULL;
+	}
+	mrcp_engine_channel_close_respond(recog_channel->channel);
+}
+
 static nls_recog_state_machine_t*	nls_recog_sm_new(apr_pool_t *pool, uint64_t lluTimeoutNoInput, uint64_t lluTimeoutDetecting)
 {
 	nls_recog_state_machine_t*	recog_sm	=	NULL;
@@ -6,7 +6,7 @@
 #include <stdint.h>
 #include <string>
 #include <map>
-#include "mpf_buffer.h"
+#include "mrcp_engine_playout.h"
 #include "apt_log.h"
 
 class NlsTTSSession;
@@ -15,7 +15,7 @@ namespace NlsTTS
 	int32_t	GlobalInit(const std::string& strFilePathConf);
 	int32_t	GlobalFini();
 
-	int32_t	Text2Audio(mpf_buffer_t* pAudioBuffer, const char* pstrText);
+	int32_t	Text2Audio(mrcp_playout_t* pPlayout, const char* pstrText);
 
 	NlsTTSSession*	OpenSession();
 	int32_t	CloseSession(NlsTTSSession* pSession);
@@ -35,7 +35,7 @@ public:
 	int32_t	SetParams(const std::map< std::string, std::string >& mapParams);
 	int32_t	SetParam(const std::string& strParamName, const std::string& strParamValue);
 
-	int32_t	Text2Audio(mpf_buffer_t* pAudioBuffer, const char* pstrText);
+	int32_t	Text2Audio(mrcp_playout_t* pPlayout, const char* pstrText);
 
 	int32_t	OnAudioDataReceived(const char* pcAudioData, uint32_t lenAudioData);
 	int32_t	OnText2AudioFinished(int32_t nResultCode);
@@ -47,7 +47,7 @@ private:
 	std::map< std::string, std::string >	m_mapParams;
 
 	int32_t	m_nResultStatus;
-	mpf_buffer_t*	m_pAudioBuffer;
+	mrcp_playout_t*	m_pPlayout;
 };
 
 #endif //end NLS_TTS_H
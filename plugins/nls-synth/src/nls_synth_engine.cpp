@@ -28,12 +28,11 @@
  */
 
 #include "mrcp_synth_engine.h"
-#include "apt_consumer_task.h"
+#include "mrcp_engine_worker.h"
 #include "apt_log.h"
 #include "apr_file_info.h"
 #include "nls_tts.h"
 
-#define SYNTH_ENGINE_TASK_NAME "Nls Synth Engine"
 #define SYNTH_ENGINE_CONF_FILE_NAME "nlssynth.xml"
 
 typedef struct nls_synth_engine_t nls_synth_engine_t;
@@ -86,13 +85,18 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of nls synthesizer engine */
 struct nls_synth_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Cache of synthesized audio */
+	mrcp_synth_cache_t     *cache;
 };
 
 /** Declaration of nls synthesizer channel */
 struct nls_synth_channel_t {
 	/** Back pointer to engine */
 	nls_synth_engine_t   *nls_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t           *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t *channel;
 
@@ -102,8 +106,8 @@ struct nls_synth_channel_t {
 	mrcp_message_t        *stop_response;
 	/** Is paused */
 	apt_bool_t             paused;
-	/** Speech source (used instead of actual synthesis) */
-	mpf_buffer_t           *audio_buffer;
+	/** Playout of synthesized audio */
+	mrcp_playout_t         *playout;
 };
 
 typedef enum {
@@ -142,22 +146,8 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	/* create nls engine */
 	nls_synth_engine_t *nls_engine = (nls_synth_engine_t*)apr_palloc(pool,sizeof(nls_synth_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	/* create task/thread to run nls engine in the context of this task */
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(nls_synth_msg_t),pool);
-	nls_engine->task = apt_consumer_task_create(nls_engine,msg_pool,pool);
-	if(!nls_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(nls_engine->task);
-	apt_task_name_set(task,SYNTH_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = nls_synth_msg_process;
-	}
+	nls_engine->worker_pool = NULL;
+	nls_engine->cache = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -170,12 +160,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy synthesizer engine */
 static apt_bool_t nls_synth_engine_destroy(mrcp_engine_t *engine)
 {
-	nls_synth_engine_t *nls_engine = (nls_synth_engine_t*)engine->obj;
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_destroy(task);
-		nls_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -183,7 +167,6 @@ static apt_bool_t nls_synth_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t nls_synth_engine_open(mrcp_engine_t *engine)
 {
 	nls_synth_engine_t *nls_engine = (nls_synth_engine_t*)engine->obj;
-
 	const apt_dir_layout_t *dir_layout = engine->dir_layout;
 	const char* dir_path_conf = apt_dir_layout_path_get(dir_layout, APT_LAYOUT_CONF_DIR);
 	char* file_path_conf = NULL;
@@ -193,7 +176,7 @@ static apt_bool_t nls_synth_engine_open(mrcp_engine_t *engine)
 			"Get file path for %s failed!!!",
 			SYNTH_ENGINE_CONF_FILE_NAME
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 
 	if (NlsTTS::GlobalInit(file_path_conf) != 0)
@@ -202,17 +185,27 @@ static apt_bool_t nls_synth_engine_open(mrcp_engine_t *engine)
 			"NlsTTS::GlobalInit(%s) failed!!!",
 			file_path_conf
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 	apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,
 		"NlsTTS::GlobalInit(%s) successfully.",
 		file_path_conf
 		);
 
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_start(task);
+	nls_engine->cache = mrcp_engine_synth_cache_create(engine);
+
+	/* create workers (threads) to process the requests of the channels, once nothing else may fail */
+	nls_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(nls_synth_msg_t),nls_synth_msg_process);
+	if(!nls_engine->worker_pool) {
+		apt_log(SYNTH_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Workers");
+		if(nls_engine->cache) {
+			mrcp_synth_cache_destroy(nls_engine->cache);
+			nls_engine->cache = NULL;
+		}
+		NlsTTS::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	mrcp_worker_pool_start(nls_engine->worker_pool);
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -220,9 +213,13 @@ static apt_bool_t nls_synth_engine_open(mrcp_engine_t *engine)
 static apt_bool_t nls_synth_engine_close(mrcp_engine_t *engine)
 {
 	nls_synth_engine_t *nls_engine = (nls_synth_engine_t*)engine->obj;
-	if(nls_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(nls_engine->worker_pool) {
+		mrcp_worker_pool_terminate(nls_engine->worker_pool);
+		nls_engine->worker_pool = NULL;
+	}
+	if(nls_engine->cache) {
+		mrcp_synth_cache_destroy(nls_engine->cache);
+		nls_engine->cache = NULL;
 	}
 
 	NlsTTS::GlobalFini();
@@ -242,10 +239,11 @@ static mrcp_engine_channel_t* nls_synth_engine_channel_create(mrcp_engine_t *eng
 	/* create nls synth channel */
 	nls_synth_channel_t *synth_channel = (nls_synth_channel_t*)apr_palloc(pool,sizeof(nls_synth_channel_t));
 	synth_channel->nls_engine = (nls_synth_engine_t*)engine->obj;
+	synth_channel->task = mrcp_worker_pool_task_assign(synth_channel->nls_engine->worker_pool);
 	synth_channel->speak_request = NULL;
 	synth_channel->stop_response = NULL;
 	synth_channel->paused = FALSE;
-	synth_channel->audio_buffer = NULL;
+	synth_channel->playout = NULL;
 	
 	capabilities = mpf_source_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -268,7 +266,10 @@ static mrcp_engine_channel_t* nls_synth_engine_channel_create(mrcp_engine_t *eng
 			termination,          /* associated media termination */
 			pool);                /* pool to allocate memory from */
 
-	synth_channel->audio_buffer = mpf_buffer_create(pool);
+	synth_channel->playout = mrcp_engine_playout_create(engine,pool);
+	if(!synth_channel->playout) {
+		return NULL;
+	}
 
 	return synth_channel->channel;
 }
@@ -329,13 +330,23 @@ static apt_bool_t nls_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_m
 		return FALSE;
 	}
 
+	/* look up the cache (may access the disk) before the request is made active,
+	so that the MPF engine reads the audio from the right source from the first frame */
+	mrcp_playout_start(synth_channel->playout, descriptor);
+	apt_bool_t cached = mrcp_playout_cache_lookup(synth_channel->playout, synth_channel->nls_engine->cache, request);
+
 	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(channel,response);
-
 	synth_channel->speak_request = request;
 
-	if (NlsTTS::Text2Audio(synth_channel->audio_buffer, text->buf) != 0)
+	if(cached == TRUE) {
+		apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,"Play Synthesized Audio from Cache " APT_SIDRES_FMT,
+			MRCP_MESSAGE_SIDRES(request));
+		return TRUE;
+	}
+
+	if (NlsTTS::Text2Audio(synth_channel->playout, text->buf) != 0)
 	{
 		apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
 			"NlsTTS::Text2Audio(%s) failed!!! " APT_SIDRES_FMT,
@@ -345,7 +356,7 @@ static apt_bool_t nls_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_m
 		nls_synth_notify_completed(synth_channel, SYNTHESIZER_COMPLETION_CAUSE_ERROR);
 		return FALSE;
 	}
-	mpf_buffer_event_write(synth_channel->audio_buffer, MEDIA_FRAME_TYPE_EVENT);
+	mrcp_playout_complete(synth_channel->playout);
 
 	return TRUE;
 }
@@ -495,19 +506,23 @@ static apt_bool_t nls_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 	if(synth_channel->stop_response) {
 		/* send asynchronous response to STOP request */
 		mrcp_engine_channel_message_send(synth_channel->channel,synth_channel->stop_response);
+		mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 		synth_channel->stop_response = NULL;
 		synth_channel->speak_request = NULL;
 		synth_channel->paused = FALSE;
+		/* discard the rest of the synthesized audio */
+		mrcp_playout_flush(synth_channel->playout);
 		return TRUE;
 	}
 
 	/* check if there is active SPEAK request and it isn't in paused state */
 	if(synth_channel->speak_request && synth_channel->paused == FALSE) {
 		/* normal processing */
-		mpf_buffer_frame_read(synth_channel->audio_buffer, frame);
+		mrcp_playout_frame_read(synth_channel->playout, frame);
 
 		// check if finished
 		if ((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
+			mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 			nls_synth_notify_completed(synth_channel, SYNTHESIZER_COMPLETION_CAUSE_NORMAL);
 		}
 	}
@@ -518,8 +533,7 @@ static apt_bool_t nls_synth_msg_signal(nls_synth_msg_type_e type, mrcp_engine_ch
 {
 	apt_bool_t status = FALSE;
 	nls_synth_channel_t *nls_channel = (nls_synth_channel_t*)channel->method_obj;
-	nls_synth_engine_t *nls_engine = nls_channel->nls_engine;
-	apt_task_t *task = apt_consumer_task_base_get(nls_engine->task);
+	apt_task_t *task = nls_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		nls_synth_msg_t *nls_msg;
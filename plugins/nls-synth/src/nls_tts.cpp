@@ -130,7 +130,7 @@ int32_t	NlsTTS::GlobalFini()
 	return 0;
 }
 
-int32_t	NlsTTS::Text2Audio(mpf_buffer_t* pAudioBuffer, const char* pstrText)
+int32_t	NlsTTS::Text2Audio(mrcp_playout_t* pPlayout, const char* pstrText)
 {
 	int32_t	nRet	=	-1;
 
@@ -145,7 +145,7 @@ int32_t	NlsTTS::Text2Audio(mpf_buffer_t* pAudioBuffer, const char* pstrText)
 			break;
 		}
 
-		nRet	=	pSession->Text2Audio(pAudioBuffer, pstrText);
+		nRet	=	pSession->Text2Audio(pPlayout, pstrText);
 		if (nRet != 0)
 		{
 			break;
@@ -255,7 +255,7 @@ int32_t	NlsTTS::SetParam(std::map< std::string, std::string >& mapParams, const
 }
 
 NlsTTSSession::NlsTTSSession()
-:m_nResultStatus(-1), m_pAudioBuffer(NULL)
+:m_nResultStatus(-1), m_pPlayout(NULL)
 {
 }
 
@@ -283,14 +283,14 @@ int32_t	NlsTTSSession::SetParam(const std::string& strParamName, const std::stri
 	return NlsTTS::SetParam(this->m_mapParams, strParamName, strParamValue);
 }
 
-int32_t	NlsTTSSession::Text2Audio(mpf_buffer_t* pAudioBuffer, const char* pstrText)
+int32_t	NlsTTSSession::Text2Audio(mrcp_playout_t* pPlayout, const char* pstrText)
 {
 	// check parameters
-	if ((pAudioBuffer == NULL) || (pstrText == NULL))
+	if ((pPlayout == NULL) || (pstrText == NULL))
 	{
 		return -1;
 	}
-	this->m_pAudioBuffer	=	pAudioBuffer;
+	this->m_pPlayout	=	pPlayout;
 
 	int32_t	nRet	=	-1;
 
@@ -403,7 +403,8 @@ int32_t	NlsTTSSession::OnAudioDataReceived(const char* pcAudioData, uint32_t len
 		return -1;
 	}
 
-	return mpf_buffer_audio_write(this->m_pAudioBuffer, (void*)pcAudioData, lenAudioData) ? 0 : -1;
+	/* the service is faster than real time, hold the SDK until the ring is drained */
+	return (mrcp_playout_audio_write_wait(this->m_pPlayout, pcAudioData, lenAudioData, MRCP_PLAYOUT_DEFAULT_WRITE_TIMEOUT) == lenAudioData) ? 0 : -1;
 }
 
 int32_t	NlsTTSSession::OnText2AudioFinished(int32_t nResultCode)
@@ -3,6 +3,8 @@
 #define NLS2_ASR_H
 
 #include <stdint.h>
+#include <pthread.h>
+#include <apr_time.h>
 #include <string>
 #include <map>
 #include "mpf_buffer.h"
@@ -30,14 +32,38 @@ using AlibabaNls::SpeechTranscriberRequest;
 
 namespace Nls2ASR
 {
+	typedef int32_t	(*tpfnOnNotify)(NlsEvent* cbEvent, void* pvContext);//pvContext is nls2_recog_channel_t
+	// 自定义事件回调参数
+	struct ParamCallBack {
+		tpfnOnNotify pfnOnNotify;
+		void* pContext;//nls2_recog_channel_t*
+	};
+
 	class ASRSession
 	{
 	public:
-		virtual ~ASRSession(){};
-		virtual int32_t	Start(void* pContext) =0; //pContext is ParamCallBack*
+		ASRSession();
+		virtual ~ASRSession();
+		virtual int32_t	Start(void* pContext); //pContext is ParamCallBack*
 		virtual int32_t	Stop(bool bNeedStop = true) =0;
  
 		virtual int32_t	FeedAudioData(const void* pvAudioData, uint32_t lenAudioData)=0 ;
+
+		int32_t	Prestart(); //start ahead of RECOGNIZE, events are dropped till Attach()
+		void	Attach(void* pContext); //pContext is ParamCallBack*
+		bool	IsAlive(); //false once failed or closed by server
+		apr_interval_time_t	GetHandshakeTime() const; //time spent in blocking start(), usec
+		void	Notify(NlsEvent* cbEvent); //dispatch SDK event to attached channel
+
+	protected:
+		virtual int32_t	Connect() =0; //create request and start it, blocking
+
+		apr_interval_time_t	m_tmHandshake;
+
+	private:
+		pthread_mutex_t	m_mutex;
+		ParamCallBack	m_cbParam;
+		bool	m_bAlive;
 	};
 	//ASR事件类型
 	// enum ET_AsrEventType
@@ -51,15 +77,9 @@ namespace Nls2ASR
 	// 	E_ChannelClosed	=	6,	// 识别结束或发生异常时，会关闭连接通道, sdk内部线程上报ChannelCloseed事件
 	// };
 
-	typedef int32_t	(*tpfnOnNotify)(NlsEvent* cbEvent, void* pvContext);//pvContext is nls2_recog_channel_t
-	// 自定义事件回调参数
-	struct ParamCallBack {
-		tpfnOnNotify pfnOnNotify;
-		void* pContext;//nls2_recog_channel_t*
-	};
-
 	int32_t	GlobalInit(const std::string& strFilePathConf);
 	int32_t	GlobalFini();
+	int32_t	RefreshToken(); //apply for token ahead of expiry, called in background
 
 	ASRSession*	OpenASRSession(int type = 0);
 	int32_t	CloseASRSession(ASRSession* pSession,bool bNeedStop = true);
@@ -69,11 +89,13 @@ namespace Nls2ASR
 	public:
 		SpeechRecognizerSession();
 		~SpeechRecognizerSession();
-		int32_t	Start(void* pContext); //pContext is ParamCallBack*
 		int32_t	Stop(bool bNeedStop = true);
 
 		int32_t	FeedAudioData(const void* pvAudioData, uint32_t lenAudioData);
 
+	protected:
+		int32_t	Connect();
+
 	private:
 		SpeechRecognizerRequest*	m_pNlsReq;
 		SpeechRecognizerCallback*	m_pNlsCB;
@@ -84,11 +106,13 @@ namespace Nls2ASR
 	public:
 		SpeechTranscriberSession();
 		~SpeechTranscriberSession();
-		int32_t	Start(void* pContext); //pContext is ParamCallBack*
 		int32_t	Stop(bool bNeedStop = true);
 
 		int32_t	FeedAudioData(const void* pvAudioData, uint32_t lenAudioData);
 
+	protected:
+		int32_t	Connect();
+
 	private:
 		SpeechTranscriberRequest*	m_pNlsReq;
 		SpeechTranscriberCallback*	m_pNlsCB;
@@ -14,6 +14,13 @@ extern apt_log_source_t *RECOG_PLUGIN;
 /** Use custom log source mark */
 #define RECOG_LOG_MARK   APT_LOG_MARK_DECLARE(RECOG_PLUGIN)
 
+/** Token is applied for in background this long (sec) ahead of expiry */
+#define TOKEN_REFRESH_AHEAD		600
+/** Token is applied for on demand this long (sec) ahead of expiry */
+#define TOKEN_EXPIRE_MARGIN		10
+/** Time (sec) to wait before applying for token in background again once failed */
+#define TOKEN_RETRY_INTERVAL	30
+
 namespace Nls2ASR
 {
 	NlsClient*	g_pNlsClient	=	NULL;
@@ -26,6 +33,8 @@ namespace Nls2ASR
 	int g_iMaxSentenceSilence = 800;
 	std::string g_strToken = "";
 	long g_lExireTime = -1;
+	long g_lTokenRetryTime = 0;
+	pthread_mutex_t	g_mutexToken = PTHREAD_MUTEX_INITIALIZER; //guards token, sessions are started concurrently
 
 	std::string	g_strResultFormat;
 
@@ -138,6 +147,12 @@ int32_t	GlobalFini()
 	g_strDftAccessKeyId.clear();
 	g_strDftAccessKeySecret.clear();
 
+	pthread_mutex_lock(&g_mutexToken);
+	g_strToken.clear();
+	g_lExireTime = -1;
+	g_lTokenRetryTime = 0;
+	pthread_mutex_unlock(&g_mutexToken);
+
 	g_strResultFormat.assign("%s");
 
 	return 0;
@@ -205,6 +220,59 @@ int generateToken(string akId, string akSecret, string* token, long* expireTime)
     return 0;
 }
 
+/**
+ * 获取token, 若lAhead秒内过期则重新生成
+ */
+static int32_t	UpdateToken(long lAhead, std::string* pstrToken)
+{
+	int32_t	nRet	=	0;
+
+	pthread_mutex_lock(&g_mutexToken);
+	if (g_lExireTime - (long)std::time(0) < lAhead)
+	{
+		if (-1 == generateToken(g_strDftAccessKeyId, g_strDftAccessKeySecret, &g_strToken, &g_lExireTime))
+		{
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,
+				"Failed to generate token by AccessKey-ID and AccessKey-Secret!!!"
+				);
+			nRet	=	-1;
+		}
+		else
+		{
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
+				"Token generated, expire time %ld.",
+				g_lExireTime
+				);
+		}
+	}
+	if (nRet == 0 && pstrToken != NULL)
+	{
+		pstrToken->assign(g_strToken);
+	}
+	pthread_mutex_unlock(&g_mutexToken);
+
+	return nRet;
+}
+
+int32_t	RefreshToken()
+{
+	int32_t	nRet	=	0;
+	long	lNow	=	(long)std::time(0);
+
+	// called periodically, so that sessions rarely wait for token on start
+	if (lNow < g_lTokenRetryTime)
+	{
+		return -1;
+	}
+	nRet	=	UpdateToken(TOKEN_REFRESH_AHEAD, NULL);
+	if (nRet != 0)
+	{
+		g_lTokenRetryTime	=	lNow + TOKEN_RETRY_INTERVAL;
+	}
+
+	return nRet;
+}
+
 /**
     * @brief 获取sendAudio发送延时时间
     * @param dataSize 待发送数据大小
@@ -249,8 +317,8 @@ void onTranscriptionStarted(NlsEvent* cbEvent, void* cbParam) {
 		<< ", task id: " << cbEvent->getTaskId()   // 当前任务的task id，方便定位问题，建议输出
 		<< endl;
 	// cout << "onTranscriptionStarted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -268,8 +336,8 @@ void onSentenceBegin(NlsEvent* cbEvent, void* cbParam) {
 		<< ", time: " << cbEvent->getSentenceTime() //当前已处理的音频时长，单位是毫秒
 		<< endl;
 	// cout << "onSentenceBegin: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -290,8 +358,8 @@ void onSentenceEnd(NlsEvent* cbEvent, void* cbParam) {
         << ", confidence: " << cbEvent->getSentenceConfidence()    // 结果置信度,取值范围[0.0,1.0]，值越大表示置信度越高
 		<< endl;
 	// cout << "onSentenceEnd: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -310,8 +378,8 @@ void onTranscriptionResultChanged(NlsEvent* cbEvent, void* cbParam) {
 		<< ", time: " << cbEvent->getSentenceTime()    // 当前句子的音频时长
 		<< endl;
 	// cout << "onTranscriptionResultChanged: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -328,8 +396,8 @@ void onTranscriptionCompleted(NlsEvent* cbEvent, void* cbParam) {
 		<< ", task id: " << cbEvent->getTaskId()   // 当前任务的task id，方便定位问题，建议输出
 		<< endl;
 	// cout << "onTranscriptionCompleted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -347,8 +415,8 @@ void onTaskFailed(NlsEvent* cbEvent, void* cbParam) {
 		<< ", error message: " << cbEvent->getErrorMessage()
 		<< endl;
 	// cout << "onTaskFailed: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 
@@ -366,8 +434,8 @@ void OnRecognitionStarted(NlsEvent* cbEvent, void* cbParam) {
 		<< ", task id: " << cbEvent->getTaskId()   // 当前任务的task id，方便定位问题，建议输出
 		<< endl;
 	// cout << "OnRecognitionStarted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 
 }
 
@@ -385,8 +453,8 @@ void OnRecognitionResultChanged(NlsEvent* cbEvent, void* cbParam) {
 		<< ", result: " << cbEvent->getResult()     // 获取中间识别结果
 		<< endl;
 	// cout << "OnRecognitionResultChanged: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 }
 
 /**
@@ -404,8 +472,8 @@ void OnRecognitionCompleted(NlsEvent* cbEvent, void* cbParam) {
 		<< ", result: " << cbEvent->getResult()  // 获取中间识别结果
 		<< endl;
 	// cout << "OnRecognitionCompleted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
 
 }
 
@@ -418,8 +486,88 @@ void OnRecognitionCompleted(NlsEvent* cbEvent, void* cbParam) {
 */
 void onChannelClosed(NlsEvent* cbEvent, void* cbParam) {
 	cout << "OnChannelCloseed: All response: " << cbEvent->getAllResponse() << endl; // getResponse() 可以通道关闭信息
-	ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-	pSession->pfnOnNotify(cbEvent,pSession->pContext);
+	ASRSession*	pSession	=	(ASRSession*)cbParam;
+	pSession->Notify(cbEvent);
+}
+
+
+ASRSession::ASRSession()
+:m_tmHandshake(-1), m_bAlive(true)
+{
+	pthread_mutex_init(&this->m_mutex, NULL);
+	this->m_cbParam.pfnOnNotify	=	NULL;
+	this->m_cbParam.pContext	=	NULL;
+}
+
+ASRSession::~ASRSession()
+{
+	pthread_mutex_destroy(&this->m_mutex);
+}
+
+int32_t	ASRSession::Start(void* pContext)
+{
+	this->Attach(pContext);
+	return this->Connect();
+}
+
+int32_t	ASRSession::Prestart()
+{
+	this->Attach(NULL);
+	return this->Connect();
+}
+
+void	ASRSession::Attach(void* pContext)
+{
+	pthread_mutex_lock(&this->m_mutex);
+	if (pContext != NULL)
+	{
+		this->m_cbParam	=	*(ParamCallBack*)pContext;
+	}
+	else
+	{
+		this->m_cbParam.pfnOnNotify	=	NULL;
+		this->m_cbParam.pContext	=	NULL;
+	}
+	pthread_mutex_unlock(&this->m_mutex);
+}
+
+bool	ASRSession::IsAlive()
+{
+	bool	bAlive;
+
+	pthread_mutex_lock(&this->m_mutex);
+	bAlive	=	this->m_bAlive;
+	pthread_mutex_unlock(&this->m_mutex);
+
+	return bAlive;
+}
+
+apr_interval_time_t	ASRSession::GetHandshakeTime() const
+{
+	return this->m_tmHandshake;
+}
+
+void	ASRSession::Notify(NlsEvent* cbEvent)
+{
+	pthread_mutex_lock(&this->m_mutex);
+	switch (cbEvent->getMsgType())
+	{
+	case NlsEvent::RecognitionCompleted:
+	case NlsEvent::TranscriptionCompleted:
+	case NlsEvent::TaskFailed:
+	case NlsEvent::Close:
+		// 连接通道已关闭, 不可再用
+		this->m_bAlive	=	false;
+		break;
+	default:
+		break;
+	}
+	// 预先启动的session在Attach()之前没有接收者
+	if (this->m_cbParam.pfnOnNotify != NULL)
+	{
+		this->m_cbParam.pfnOnNotify(cbEvent,this->m_cbParam.pContext);
+	}
+	pthread_mutex_unlock(&this->m_mutex);
 }
 
 
@@ -433,24 +581,20 @@ SpeechRecognizerSession::~SpeechRecognizerSession()
 	this->Stop();
 }
 
-int32_t	SpeechRecognizerSession::Start(void* pContext)
+int32_t	SpeechRecognizerSession::Connect()
 {
 	int32_t	nRet	=	-1;
 
 	for (int32_t iOnce=0; iOnce<1; ++iOnce)
 	{
 		/**
-		 * 获取当前系统时间戳，判断token是否过期
+		 * 获取token, 通常已由后台提前更新
 		 */
-		std::time_t curTime = std::time(0);
-		if (g_lExireTime - curTime < 10) {
-			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,
-			 "the token will be expired, please generate new token by AccessKey-ID and AccessKey-Secret." 
-			 );
-			if (-1 == generateToken(g_strDftAccessKeyId, g_strDftAccessKeySecret, &g_strToken, &g_lExireTime)) {
-				nRet	=	-1;
-				break;
-			}
+		std::string	strToken;
+		if (UpdateToken(TOKEN_EXPIRE_MARGIN, &strToken) != 0)
+		{
+			nRet	=	-1;
+			break;
 		}
 		
 		this->m_pNlsCB	=	new SpeechRecognizerCallback();
@@ -463,11 +607,11 @@ int32_t	SpeechRecognizerSession::Start(void* pContext)
 			nRet	=	-1;
 			break;
 		}
-		this->m_pNlsCB->setOnRecognitionStarted(OnRecognitionStarted, pContext); // 设置识别启动回调函数
-		this->m_pNlsCB->setOnRecognitionResultChanged(OnRecognitionResultChanged, pContext); // 设置识别结果变化回调函数
-		this->m_pNlsCB->setOnRecognitionCompleted(OnRecognitionCompleted, pContext); // 设置语音转写结束回调函数
-		this->m_pNlsCB->setOnTaskFailed(onTaskFailed, pContext); // 设置异常识别回调函数
-		this->m_pNlsCB->setOnChannelClosed(onChannelClosed, pContext); // 设置识别通道关闭回调函数
+		this->m_pNlsCB->setOnRecognitionStarted(OnRecognitionStarted, this); // 设置识别启动回调函数
+		this->m_pNlsCB->setOnRecognitionResultChanged(OnRecognitionResultChanged, this); // 设置识别结果变化回调函数
+		this->m_pNlsCB->setOnRecognitionCompleted(OnRecognitionCompleted, this); // 设置语音转写结束回调函数
+		this->m_pNlsCB->setOnTaskFailed(onTaskFailed, this); // 设置异常识别回调函数
+		this->m_pNlsCB->setOnChannelClosed(onChannelClosed, this); // 设置识别通道关闭回调函数
 
 
 		this->m_pNlsReq	=	g_pNlsClient->createRecognizerRequest(this->m_pNlsCB);
@@ -491,10 +635,11 @@ int32_t	SpeechRecognizerSession::Start(void* pContext)
 														//需要先设置enable_voice_detection为true. 建议时间2~5秒.
 		//this->m_pNlsReq->setMaxEndSilence(g_iMaxSentenceSilence);//允许的最大结束静音, 可选, 单位是毫秒. 超出后服务端将会发送RecognitionCompleted事件, 结束本次识别.
     													//需要先设置enable_voice_detection为true. 建议时间0~5秒.
-		this->m_pNlsReq->setToken(g_strToken.c_str()); // 设置账号校验token, 必填参数
+		this->m_pNlsReq->setToken(strToken.c_str()); // 设置账号校验token, 必填参数
 		/*
 		* 3: start()为阻塞操作, 发送start指令之后, 会等待服务端响应, 或超时之后才返回
 		*/
+		apr_time_t	tmStart	=	apr_time_now();
 		if (this->m_pNlsReq->start() < 0) {
 			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,
 				"SpeechRecognizerSession::Start() failed!!!"
@@ -502,9 +647,11 @@ int32_t	SpeechRecognizerSession::Start(void* pContext)
 			nRet	=	-1;
 			break;
 		}
+		this->m_tmHandshake	=	apr_time_now() - tmStart;
 
 		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
-			"SpeechRecognizerSession::Start() successfully."
+			"SpeechRecognizerSession::Start() successfully, handshake %ld ms.",
+			(long)(this->m_tmHandshake / 1000)
 			);
 
 		nRet	=	0;
@@ -569,24 +716,20 @@ SpeechTranscriberSession::~SpeechTranscriberSession()
 	this->Stop();
 }
 
-int32_t	SpeechTranscriberSession::Start(void* pContext)
+int32_t	SpeechTranscriberSession::Connect()
 {
 	int32_t	nRet	=	-1;
 
 	for (int32_t iOnce=0; iOnce<1; ++iOnce)
 	{
 		/**
-		 * 获取当前系统时间戳，判断token是否过期
+		 * 获取token, 通常已由后台提前更新
 		 */
-		std::time_t curTime = std::time(0);
-		if (g_lExireTime - curTime < 10) {
-			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,
-			 "the token will be expired, please generate new token by AccessKey-ID and AccessKey-Secret." 
-			 );
-			if (-1 == generateToken(g_strDftAccessKeyId, g_strDftAccessKeySecret, &g_strToken, &g_lExireTime)) {
-				nRet	=	-1;
-				break;
-			}
+		std::string	strToken;
+		if (UpdateToken(TOKEN_EXPIRE_MARGIN, &strToken) != 0)
+		{
+			nRet	=	-1;
+			break;
 		}
 		
 		this->m_pNlsCB	=	new SpeechTranscriberCallback();
@@ -599,13 +742,13 @@ int32_t	SpeechTranscriberSession::Start(void* pContext)
 			nRet	=	-1;
 			break;
 		}
-		this->m_pNlsCB->setOnTranscriptionStarted(onTranscriptionStarted, pContext); // 设置识别启动回调函数
-		this->m_pNlsCB->setOnTranscriptionResultChanged(onTranscriptionResultChanged, pContext); // 设置识别结果变化回调函数
-		this->m_pNlsCB->setOnTranscriptionCompleted(onTranscriptionCompleted, pContext); // 设置语音转写结束回调函数
-		this->m_pNlsCB->setOnSentenceBegin(onSentenceBegin, pContext); // 设置一句话开始回调函数
-		this->m_pNlsCB->setOnSentenceEnd(onSentenceEnd, pContext); // 设置一句话结束回调函数
-		this->m_pNlsCB->setOnTaskFailed(onTaskFailed, pContext); // 设置异常识别回调函数
-		this->m_pNlsCB->setOnChannelClosed(onChannelClosed, pContext); // 设置识别通道关闭回调函数
+		this->m_pNlsCB->setOnTranscriptionStarted(onTranscriptionStarted, this); // 设置识别启动回调函数
+		this->m_pNlsCB->setOnTranscriptionResultChanged(onTranscriptionResultChanged, this); // 设置识别结果变化回调函数
+		this->m_pNlsCB->setOnTranscriptionCompleted(onTranscriptionCompleted, this); // 设置语音转写结束回调函数
+		this->m_pNlsCB->setOnSentenceBegin(onSentenceBegin, this); // 设置一句话开始回调函数
+		this->m_pNlsCB->setOnSentenceEnd(onSentenceEnd, this); // 设置一句话结束回调函数
+		this->m_pNlsCB->setOnTaskFailed(onTaskFailed, this); // 设置异常识别回调函数
+		this->m_pNlsCB->setOnChannelClosed(onChannelClosed, this); // 设置识别通道关闭回调函数
 
 
 		this->m_pNlsReq	=	g_pNlsClient->createTranscriberRequest(this->m_pNlsCB);
@@ -626,10 +769,11 @@ int32_t	SpeechTranscriberSession::Start(void* pContext)
 		this->m_pNlsReq->setInverseTextNormalization(false); // 设置是否在后处理中执行数字转写, 可选参数. 默认false
 		this->m_pNlsReq->setSemanticSentenceDetection(false); // 设置是否语义断句, 可选参数. 默认false
 		this->m_pNlsReq->setMaxSentenceSilence(g_iMaxSentenceSilence);
-		this->m_pNlsReq->setToken(g_strToken.c_str()); // 设置账号校验token, 必填参数
+		this->m_pNlsReq->setToken(strToken.c_str()); // 设置账号校验token, 必填参数
 		/*
 		* 3: start()为阻塞操作, 发送start指令之后, 会等待服务端响应, 或超时之后才返回
 		*/
+		apr_time_t	tmStart	=	apr_time_now();
 		if (this->m_pNlsReq->start() < 0) {
 			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,
 				"SpeechTranscriberSession::Start() failed!!!"
@@ -637,9 +781,11 @@ int32_t	SpeechTranscriberSession::Start(void* pContext)
 			nRet	=	-1;
 			break;
 		}
+		this->m_tmHandshake	=	apr_time_now() - tmStart;
 
 		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
-			"SpeechTranscriberSession::Start() successfully."
+			"SpeechTranscriberSession::Start() successfully, handshake %ld ms.",
+			(long)(this->m_tmHandshake / 1000)
 			);
 
 		nRet	=	0;
@@ -72,13 +72,14 @@
 #include <stdlib.h>
 #include "mpf_buffer.h"
 #include "apt_log.h"
-#include "apt_consumer_task.h"
 #include "mrcp_recog_engine.h"
+#include "mrcp_engine_feeder.h"
+#include "mrcp_engine_worker.h"
+#include "mrcp_engine_prewarm.h"
 #include "mpf_activity_detector.h"
 #include "apr_file_info.h"
 #include "nls2_asr.h"
 
-#define RECOG_ENGINE_TASK_NAME "Nls2 Recog Engine"
 #define RECOG_ENGINE_CONF_FILE_NAME "nls2recog.xml"
 
 typedef struct nls2_recog_engine_t nls2_recog_engine_t;
@@ -131,13 +132,20 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of nls recognizer engine */
 struct nls2_recog_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Pool of workers feeding audio to ASR sessions */
+	mrcp_feeder_pool_t     *feeder_pool;
+	/** Pool of ASR sessions started ahead of RECOGNIZE */
+	mrcp_prewarm_pool_t    *prewarm_pool;
 };
 
 /** Declaration of nls recognizer channel */
 struct nls2_recog_channel_t {
 	/** Back pointer to engine */
 	nls2_recog_engine_t     *nls2_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t              *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
 
@@ -154,8 +162,12 @@ struct nls2_recog_channel_t {
 	mpf_activity_detector_t *detector;
 	/** File to write utterance to */
 	FILE                    *audio_out;
+	/** Feeder passing audio to ASR session off the MPF engine thread */
+	mrcp_feeder_t           *feeder;
+	/** Indicates whether audio is fed to ASR session */
+	apt_bool_t               feeding;
 
-	Nls2ASR::ASRSession	*asr_session; //Nls2::ASRSession
+	Nls2ASR::ASRSession	*asr_session; //Nls2::ASRSession, accessed by feeder worker only
 	Nls2ASR::ParamCallBack		cbParam;
 };
 
@@ -186,6 +198,34 @@ struct nls2_recog_msg_t {
 static apt_bool_t nls2_recog_msg_signal(nls2_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
 static apt_bool_t nls2_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 
+/** Commands processed by feeder worker */
+typedef enum {
+	NLS2_FEEDER_SESSION_START,
+	NLS2_FEEDER_SESSION_CLOSE
+} nls2_feeder_command_e;
+
+static apt_bool_t nls2_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size);
+static apt_bool_t nls2_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg);
+static void nls2_recog_feeder_close(mrcp_feeder_t *feeder);
+
+static const mrcp_feeder_vtable_t feeder_vtable = {
+	nls2_recog_feeder_audio,
+	nls2_recog_feeder_command,
+	nls2_recog_feeder_close
+};
+
+static void* nls2_recog_prewarm_create(mrcp_prewarm_pool_t *prewarm_pool);
+static apt_bool_t nls2_recog_prewarm_check(mrcp_prewarm_pool_t *prewarm_pool, void *session);
+static void nls2_recog_prewarm_destroy(mrcp_prewarm_pool_t *prewarm_pool, void *session);
+static void nls2_recog_prewarm_maintain(mrcp_prewarm_pool_t *prewarm_pool);
+
+static const mrcp_prewarm_vtable_t prewarm_vtable = {
+	nls2_recog_prewarm_create,
+	nls2_recog_prewarm_check,
+	nls2_recog_prewarm_destroy,
+	nls2_recog_prewarm_maintain
+};
+
 static int32_t nls2_recog_on_speechrecognizer_notify(NlsEvent* cbEvent, void* pvContext);
 static int32_t nls2_recog_on_speechtranscriber_notify(NlsEvent* cbEvent, void* pvContext);
 /** Declare this macro to set plugin version */
@@ -205,21 +245,9 @@ MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(RECOG_PLUGIN,"RECOG-PLUGIN")
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	nls2_recog_engine_t *nls2_engine = (nls2_recog_engine_t*)apr_palloc(pool,sizeof(nls2_recog_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(nls2_recog_msg_t),pool);
-	nls2_engine->task = apt_consumer_task_create(nls2_engine,msg_pool,pool);
-	if(!nls2_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(nls2_engine->task);
-	apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = nls2_recog_msg_process;
-	}
+	nls2_engine->feeder_pool = NULL;
+	nls2_engine->worker_pool = NULL;
+	nls2_engine->prewarm_pool = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -232,12 +260,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy recognizer engine */
 static apt_bool_t nls2_recog_engine_destroy(mrcp_engine_t *engine)
 {
-	nls2_recog_engine_t *nls2_engine = (nls2_recog_engine_t*)engine->obj;
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_destroy(task);
-		nls2_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -245,7 +267,6 @@ static apt_bool_t nls2_recog_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t nls2_recog_engine_open(mrcp_engine_t *engine)
 {
 	nls2_recog_engine_t *nls2_engine = (nls2_recog_engine_t*)engine->obj;
-
 	const apt_dir_layout_t *dir_layout = engine->dir_layout;
 	const char* dir_path_conf = apt_dir_layout_path_get(dir_layout, APT_LAYOUT_CONF_DIR);
 	char* file_path_conf = NULL;
@@ -255,7 +276,7 @@ static apt_bool_t nls2_recog_engine_open(mrcp_engine_t *engine)
 			"Get file path for %s failed!!!",
 			RECOG_ENGINE_CONF_FILE_NAME
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 
 	if (Nls2ASR::GlobalInit(file_path_conf) != 0)
@@ -264,17 +285,38 @@ static apt_bool_t nls2_recog_engine_open(mrcp_engine_t *engine)
 			"Nls2ASR::GlobalInit(%s) failed!!!",
 			file_path_conf
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
 		"Nls2ASR::GlobalInit(%s) successfully.",
 		file_path_conf
 		);
 
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_start(task);
+	nls2_engine->feeder_pool = mrcp_engine_feeder_pool_create(engine);
+	if(!nls2_engine->feeder_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Feeder Pool");
+		Nls2ASR::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	mrcp_feeder_pool_start(nls2_engine->feeder_pool);
+
+	/* create workers (threads) to process the requests of the channels, once nothing else may fail */
+	nls2_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(nls2_recog_msg_t),nls2_recog_msg_process);
+	if(!nls2_engine->worker_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Workers");
+		mrcp_feeder_pool_terminate(nls2_engine->feeder_pool);
+		nls2_engine->feeder_pool = NULL;
+		Nls2ASR::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	mrcp_worker_pool_start(nls2_engine->worker_pool);
+
+	/* start sessions ahead of RECOGNIZE, if configured */
+	nls2_engine->prewarm_pool = mrcp_engine_prewarm_pool_create(engine,&prewarm_vtable,nls2_engine);
+	if(nls2_engine->prewarm_pool) {
+		mrcp_prewarm_pool_start(nls2_engine->prewarm_pool);
+	}
+
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -283,14 +325,24 @@ static apt_bool_t nls2_recog_engine_close(mrcp_engine_t *engine)
 {
 	nls2_recog_engine_t *nls2_engine = (nls2_recog_engine_t*)engine->obj;
 
+	if(nls2_engine->prewarm_pool) {
+		mrcp_prewarm_pool_terminate(nls2_engine->prewarm_pool);
+		nls2_engine->prewarm_pool = NULL;
+	}
+
+	if(nls2_engine->feeder_pool) {
+		mrcp_feeder_pool_terminate(nls2_engine->feeder_pool);
+		nls2_engine->feeder_pool = NULL;
+	}
+
 	Nls2ASR::GlobalFini();
 	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,
 		"Nls2ASR::GlobalFini() successfully."
 		);
 
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(nls2_engine->worker_pool) {
+		mrcp_worker_pool_terminate(nls2_engine->worker_pool);
+		nls2_engine->worker_pool = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -303,6 +355,7 @@ static mrcp_engine_channel_t* nls2_recog_engine_channel_create(mrcp_engine_t *en
 	/* create nls recog channel */
 	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)apr_palloc(pool,sizeof(nls2_recog_channel_t));
 	recog_channel->nls2_engine = (nls2_recog_engine_t*)engine->obj;
+	recog_channel->task = mrcp_worker_pool_task_assign(recog_channel->nls2_engine->worker_pool);
 	recog_channel->recog_request = NULL;
 	recog_channel->stop_response = NULL;
 	recog_channel->detector = mpf_activity_detector_create(pool);
@@ -312,6 +365,15 @@ static mrcp_engine_channel_t* nls2_recog_engine_channel_create(mrcp_engine_t *en
 	recog_channel->cbParam.pContext = recog_channel;
 	recog_channel->timers_started = FALSE;
 	// recog_channel->asrserver_disconnected = FALSE;
+	recog_channel->feeding = FALSE;
+	recog_channel->feeder = mrcp_feeder_create(
+			recog_channel->nls2_engine->feeder_pool,
+			&feeder_vtable,
+			recog_channel,
+			MRCP_FEEDER_DEFAULT_CAPACITY);
+	if(!recog_channel->feeder) {
+		return NULL;
+	}
 
 	capabilities = mpf_sink_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -340,7 +402,11 @@ static mrcp_engine_channel_t* nls2_recog_engine_channel_create(mrcp_engine_t *en
 /** Destroy engine channel */
 static apt_bool_t nls2_recog_channel_destroy(mrcp_engine_channel_t *channel)
 {
-	/* nothing to destrtoy */
+	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)channel->method_obj;
+	if(recog_channel->feeder) {
+		mrcp_feeder_destroy(recog_channel->feeder);
+		recog_channel->feeder = NULL;
+	}
 	return TRUE;
 }
 
@@ -367,17 +433,8 @@ static apt_bool_t nls2_recog_channel_open(mrcp_engine_channel_t *channel)
 /** Close engine channel (asynchronous response MUST be sent)*/
 static apt_bool_t nls2_recog_channel_close(mrcp_engine_channel_t *channel)
 {
-	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)channel->method_obj;
-	if (recog_channel != NULL)
-	{
-		if (recog_channel->asr_session != NULL)
-		{
-			Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
-			recog_channel->asr_session = NULL;
-		}
-
-		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"nls2_recog_channel_close() invoked!!!");
-	}
+	/* ASR session is closed by feeder worker once the feeder is closed */
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"nls2_recog_channel_close() invoked!!!");
 	return nls2_recog_msg_signal(NLS2_RECOG_MSG_CLOSE_CHANNEL,channel,NULL);
 }
 
@@ -407,6 +464,22 @@ static apt_bool_t nls2_recog_start_of_input(nls2_recog_channel_t *recog_channel)
 }
 
 
+/** Borrow ASR session started ahead of RECOGNIZE and attach it to the channel */
+static Nls2ASR::ASRSession* nls2_recog_session_borrow(nls2_recog_channel_t *recog_channel)
+{
+	Nls2ASR::ASRSession *asr_session = (Nls2ASR::ASRSession*)mrcp_prewarm_pool_borrow(recog_channel->nls2_engine->prewarm_pool);
+	if(!asr_session) {
+		return NULL;
+	}
+	asr_session->Attach(&recog_channel->cbParam);
+	if(!asr_session->IsAlive()) {
+		/* dropped by the server right before attached, its events are lost */
+		Nls2ASR::CloseASRSession(asr_session,false);
+		return NULL;
+	}
+	return asr_session;
+}
+
 /** Process RECOGNIZE request */
 static apt_bool_t nls2_recog_channel_recognize(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
 {
@@ -414,6 +487,8 @@ static apt_bool_t nls2_recog_channel_recognize(mrcp_engine_channel_t *channel, m
 	mrcp_recog_header_t *recog_header;
 	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)channel->method_obj;
 	const mpf_codec_descriptor_t *descriptor = mrcp_engine_sink_stream_codec_get(channel);
+	Nls2ASR::ASRSession *asr_session;
+	apt_bool_t prestarted = FALSE;
 
 	if(!descriptor) {
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec Descriptor " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
@@ -451,25 +526,40 @@ static apt_bool_t nls2_recog_channel_recognize(mrcp_engine_channel_t *channel, m
 	recog_channel->recog_request = request;
 	if(recog_header->multiple_mode == FALSE){
 		recog_channel->cbParam.pfnOnNotify = nls2_recog_on_speechrecognizer_notify;
-		recog_channel->asr_session	=	Nls2ASR::OpenASRSession();
+		asr_session	=	nls2_recog_session_borrow(recog_channel);
+		if(asr_session) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Use Prestarted Nls2ASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+			prestarted = TRUE;
+		}
+		else {
+			asr_session	=	Nls2ASR::OpenASRSession();
+		}
 	}else{
 		recog_channel->cbParam.pfnOnNotify = nls2_recog_on_speechtranscriber_notify;
-		recog_channel->asr_session	=	Nls2ASR::OpenASRSession(1);
+		asr_session	=	Nls2ASR::OpenASRSession(1);
 	}
 
-	if (recog_channel->asr_session == NULL)
+	if (asr_session == NULL)
 	{
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to open Nls2ASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
 		response->start_line.status_code = MRCP_STATUS_CODE_RESOURCE_SPECIFIC_FAILURE;
 		return FALSE;
 	}
 	
-	if (recog_channel->asr_session->Start(&recog_channel->cbParam) != 0)
+	if (prestarted == FALSE)
 	{
-		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to start Nls2ASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
-		response->start_line.status_code = MRCP_STATUS_CODE_RESOURCE_SPECIFIC_FAILURE;
-		return FALSE;
+		if (asr_session->Start(&recog_channel->cbParam) != 0)
+		{
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to start Nls2ASR session " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+			Nls2ASR::CloseASRSession(asr_session,false);
+			response->start_line.status_code = MRCP_STATUS_CODE_RESOURCE_SPECIFIC_FAILURE;
+			return FALSE;
+		}
+		mrcp_prewarm_pool_handshake_record(recog_channel->nls2_engine->prewarm_pool,asr_session->GetHandshakeTime());
 	}
+	/* hand the session over to feeder worker, audio is fed from now on */
+	mrcp_feeder_command_post(recog_channel->feeder,NLS2_FEEDER_SESSION_START,asr_session);
+	recog_channel->feeding = TRUE;
 	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(channel,response);
@@ -483,10 +573,10 @@ static apt_bool_t nls2_recog_channel_stop(mrcp_engine_channel_t *channel, mrcp_m
 	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)channel->method_obj;
 	if (recog_channel != NULL)
 	{
-		if (recog_channel->asr_session != NULL)
+		if (recog_channel->feeding == TRUE)
 		{
-			Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
-			recog_channel->asr_session = NULL;
+			recog_channel->feeding = FALSE;
+			mrcp_feeder_command_post(recog_channel->feeder,NLS2_FEEDER_SESSION_CLOSE,NULL);
 		}
 
 		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"nls2_recog_channel_stop() invoked!!!");
@@ -673,18 +763,18 @@ static apt_bool_t nls2_recog_stream_write(mpf_audio_stream_t *stream, const mpf_
 			case MPF_DETECTOR_EVENT_INACTIVITY:
 				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Inactivity " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				if(recog_channel->asr_session ){
-					Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
-					recog_channel->asr_session = NULL;
+				if(recog_channel->feeding ){
+					recog_channel->feeding = FALSE;
+					mrcp_feeder_command_post(recog_channel->feeder,NLS2_FEEDER_SESSION_CLOSE,NULL);
 					// nls2_recog_recognition_complete(recog_channel,NULL,RECOGNIZER_COMPLETION_CAUSE_SUCCESS);
 				}			
 				break;
 			case MPF_DETECTOR_EVENT_NOINPUT:
 				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Noinput " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				if(recog_header->multiple_mode == FALSE && recog_channel->timers_started == TRUE && recog_channel->asr_session) {
-					Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
-					recog_channel->asr_session = NULL;
+				if(recog_header->multiple_mode == FALSE && recog_channel->timers_started == TRUE && recog_channel->feeding) {
+					recog_channel->feeding = FALSE;
+					mrcp_feeder_command_post(recog_channel->feeder,NLS2_FEEDER_SESSION_CLOSE,NULL);
 				}
 				break;
 			default:
@@ -706,14 +796,9 @@ static apt_bool_t nls2_recog_stream_write(mpf_audio_stream_t *stream, const mpf_
 						frame->event_frame.duration);
 				}
 			}else{
-				if(recog_channel->timers_started && recog_channel->asr_session){
-					if(recog_channel->asr_session->FeedAudioData(frame->codec_frame.buffer, frame->codec_frame.size)==-1)
-					{
-						Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
-						recog_channel->asr_session = NULL;
-						apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"nls2_recog_stream_write() FeedAudioData Failed,asrserver disconnected!");
-						return TRUE;
-					}
+				if(recog_channel->timers_started && recog_channel->feeding){
+					/* never block here, the audio is fed to ASR session by feeder worker */
+					mrcp_feeder_audio_write(recog_channel->feeder,frame->codec_frame.buffer,frame->codec_frame.size);
 				}
 			}
 		}
@@ -729,8 +814,7 @@ static apt_bool_t nls2_recog_msg_signal(nls2_recog_msg_type_e type, mrcp_engine_
 {
 	apt_bool_t status = FALSE;
 	nls2_recog_channel_t *nls2_channel = (nls2_recog_channel_t*)channel->method_obj;
-	nls2_recog_engine_t *nls2_engine = nls2_channel->nls2_engine;
-	apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
+	apt_task_t *task = nls2_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		nls2_recog_msg_t *nls2_msg;
@@ -762,7 +846,11 @@ static apt_bool_t nls2_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 				recog_channel->audio_out = NULL;
 			}
 
-			mrcp_engine_channel_close_respond(nls2_msg->channel);
+			/* the response is sent once feeder worker closes ASR session */
+			recog_channel->feeding = FALSE;
+			if(mrcp_feeder_close(recog_channel->feeder) == FALSE) {
+				mrcp_engine_channel_close_respond(nls2_msg->channel);
+			}
 			break;
 		}
 		case NLS2_RECOG_MSG_REQUEST_PROCESS:
@@ -774,6 +862,91 @@ static apt_bool_t nls2_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	return TRUE;
 }
 
+/** Feed audio to ASR session (feeder worker) */
+static apt_bool_t nls2_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size)
+{
+	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	if(!recog_channel->asr_session) {
+		return FALSE;
+	}
+	if(recog_channel->asr_session->FeedAudioData(data,(uint32_t)size) == -1)
+	{
+		Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
+		recog_channel->asr_session = NULL;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"nls2_recog_feeder_audio() FeedAudioData Failed,asrserver disconnected!");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Process feeder command (feeder worker) */
+static apt_bool_t nls2_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg)
+{
+	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	switch(command) {
+		case NLS2_FEEDER_SESSION_START:
+			if(recog_channel->asr_session) {
+				Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
+			}
+			recog_channel->asr_session = (Nls2ASR::ASRSession*)arg;
+			break;
+		case NLS2_FEEDER_SESSION_CLOSE:
+			if(recog_channel->asr_session) {
+				Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
+				recog_channel->asr_session = NULL;
+			}
+			break;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+/** Close ASR session and respond to channel close (feeder worker) */
+static void nls2_recog_feeder_close(mrcp_feeder_t *feeder)
+{
+	nls2_recog_channel_t *recog_channel = (nls2_recog_channel_t*)mrcp_feeder_object_get(feeder);
+	if(recog_channel->asr_session) {
+		Nls2ASR::CloseASRSession(recog_channel->asr_session,recog_channel->timers_started);
+		recog_channel->asr_session = NULL;
+	}
+	mrcp_engine_channel_close_respond(recog_channel->channel);
+}
+
+/** Start ASR session ahead of RECOGNIZE (prewarm pool thread) */
+static void* nls2_recog_prewarm_create(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	Nls2ASR::ASRSession *asr_session = Nls2ASR::OpenASRSession();
+	if(!asr_session) {
+		return NULL;
+	}
+	if(asr_session->Prestart() != 0) {
+		Nls2ASR::CloseASRSession(asr_session,false);
+		return NULL;
+	}
+	mrcp_prewarm_pool_handshake_record(prewarm_pool,asr_session->GetHandshakeTime());
+	return asr_session;
+}
+
+/** Check whether idle ASR session is still connected */
+static apt_bool_t nls2_recog_prewarm_check(mrcp_prewarm_pool_t *prewarm_pool, void *session)
+{
+	Nls2ASR::ASRSession *asr_session = (Nls2ASR::ASRSession*)session;
+	return asr_session->IsAlive() ? TRUE : FALSE;
+}
+
+/** Close idle ASR session (prewarm pool thread) */
+static void nls2_recog_prewarm_destroy(mrcp_prewarm_pool_t *prewarm_pool, void *session)
+{
+	Nls2ASR::ASRSession *asr_session = (Nls2ASR::ASRSession*)session;
+	Nls2ASR::CloseASRSession(asr_session,asr_session->IsAlive());
+}
+
+/** Refresh token ahead of expiry (prewarm pool thread) */
+static void nls2_recog_prewarm_maintain(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	Nls2ASR::RefreshToken();
+}
 
 static int32_t	nls2_recog_on_speechrecognizer_notify(NlsEvent* cbEvent, void* pvContext)
 {
@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <apr_time.h>
 #include <map>
 #include "mpf_buffer.h"
 #include "apt_log.h"
@@ -30,6 +31,7 @@ namespace Nls2TTS
 
 	int32_t	GlobalInit(const std::string& strFilePathConf);
 	int32_t	GlobalFini();
+	int32_t	RefreshToken(); //apply for token ahead of expiry, called in background
 
 	TTSSession*	OpenSession();
 	int32_t	CloseSession(TTSSession* pSession,bool bNeedStop = true);
@@ -40,12 +42,18 @@ namespace Nls2TTS
 	public:
 		TTSSession();
 		~TTSSession();
+		int32_t	Prepare(); //create and configure request ahead of SPEAK
 		int32_t	Start(const char* value,void* pContext); //pContext is ParamCallBack*
 		int32_t	Stop(bool bNeedStop = true);
 
+		apr_interval_time_t	GetHandshakeTime() const; //time spent in blocking start(), usec
+		void	Notify(NlsEvent* cbEvent); //dispatch SDK event to channel
+
 	private:
 		SpeechSynthesizerRequest*	m_pNlsReq;
 		SpeechSynthesizerCallback*	m_pNlsCB;
+		ParamCallBack	m_cbParam;
+		apr_interval_time_t	m_tmHandshake;
 	};
 };
 #endif //end NLS2_TTS_H
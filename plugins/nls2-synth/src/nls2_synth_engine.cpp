@@ -34,12 +34,13 @@
 #include "nls2_tts.h"
 
 #include "mrcp_synth_engine.h"
+#include "mrcp_engine_worker.h"
 #include "apt_consumer_task.h"
 #include "apt_log.h"
 #include "apr_file_info.h"
-#include "mpf_buffer.h"
+#include "mrcp_engine_playout.h"
+#include "mrcp_engine_prewarm.h"
 
-#define SYNTH_ENGINE_TASK_NAME "Nls2 Synth Engine"
 #define SYNTH_ENGINE_CONF_FILE_NAME "nls2synth.xml"
 
 typedef struct nls2_synth_engine_t nls2_synth_engine_t;
@@ -92,13 +93,20 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of Nls2TTS synthesizer engine */
 struct nls2_synth_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Cache of synthesized audio */
+	mrcp_synth_cache_t     *cache;
+	/** Pool of TTS sessions prepared ahead of SPEAK */
+	mrcp_prewarm_pool_t    *prewarm_pool;
 };
 
 /** Declaration of Nls2TTS synthesizer channel */
 struct nls2_synth_channel_t {
 	/** Back pointer to engine */
 	nls2_synth_engine_t   *nls2_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t            *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t *channel;
 
@@ -110,9 +118,8 @@ struct nls2_synth_channel_t {
 	apr_size_t             time_to_complete;
 	/** Is paused */
 	apt_bool_t             paused;
-	/** Speech source (used instead of actual synthesis) */
-
-	mpf_buffer_t          *audio_buffer;
+	/** Playout of synthesized audio */
+	mrcp_playout_t        *playout;
 
 	Nls2TTS::TTSSession	*tts_session; //Nls2TTS::TTSSession
 	Nls2TTS::ParamCallBack		cbParam;
@@ -139,6 +146,17 @@ static void nls2_synth_on_start(apt_task_t *task);
 static void nls2_synth_on_terminate(apt_task_t *task);
 
 static int32_t	nls2_synth_on_nls2tts_notify(NlsEvent* cbEvent, void* pvContext);
+
+static void* nls2_synth_prewarm_create(mrcp_prewarm_pool_t *prewarm_pool);
+static void nls2_synth_prewarm_destroy(mrcp_prewarm_pool_t *prewarm_pool, void *session);
+static void nls2_synth_prewarm_maintain(mrcp_prewarm_pool_t *prewarm_pool);
+
+static const mrcp_prewarm_vtable_t prewarm_vtable = {
+	nls2_synth_prewarm_create,
+	NULL,
+	nls2_synth_prewarm_destroy,
+	nls2_synth_prewarm_maintain
+};
 /** Declare this macro to set plugin version */
 MRCP_PLUGIN_VERSION_DECLARE
 
@@ -157,24 +175,9 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	/* create Nls2TTS engine */
 	nls2_synth_engine_t *nls2_engine = (nls2_synth_engine_t*)apr_palloc(pool,sizeof(nls2_synth_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	/* create task/thread to run Nls2TTS engine in the context of this task */
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(nls2_synth_msg_t),pool);
-	nls2_engine->task = apt_consumer_task_create(nls2_engine,msg_pool,pool);
-	if(!nls2_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(nls2_engine->task);
-	apt_task_name_set(task,SYNTH_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = nls2_synth_msg_process;
-		// vtable->on_pre_run = nls2_synth_on_start;
-		// vtable->on_post_run = nls2_synth_on_terminate;
-	}
+	nls2_engine->worker_pool = NULL;
+	nls2_engine->cache = NULL;
+	nls2_engine->prewarm_pool = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -187,12 +190,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy synthesizer engine */
 static apt_bool_t nls2_synth_engine_destroy(mrcp_engine_t *engine)
 {
-	nls2_synth_engine_t *nls2_engine = (nls2_synth_engine_t*)engine->obj;
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_destroy(task);
-		nls2_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -200,10 +197,6 @@ static apt_bool_t nls2_synth_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t nls2_synth_engine_open(mrcp_engine_t *engine)
 {
 	nls2_synth_engine_t *nls2_engine = (nls2_synth_engine_t*)engine->obj;
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_start(task);
-	}
 	const apt_dir_layout_t *dir_layout = engine->dir_layout;
 	const char* dir_path_conf = apt_dir_layout_path_get(dir_layout, APT_LAYOUT_CONF_DIR);
 	char* file_path_conf = NULL;
@@ -213,7 +206,7 @@ static apt_bool_t nls2_synth_engine_open(mrcp_engine_t *engine)
 			"Get file path for %s failed!!!",
 			SYNTH_ENGINE_CONF_FILE_NAME
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 
 	if (Nls2TTS::GlobalInit(file_path_conf) != 0)
@@ -222,12 +215,33 @@ static apt_bool_t nls2_synth_engine_open(mrcp_engine_t *engine)
 			"Nls2TTS::GlobalInit(%s) failed!!!",
 			file_path_conf
 			);
-		return FALSE;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 	apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,
 		"Nls2TTS::GlobalInit(%s) successfully.",
 		file_path_conf
 		);
+
+	nls2_engine->cache = mrcp_engine_synth_cache_create(engine);
+
+	/* create workers (threads) to process the requests of the channels, once nothing else may fail */
+	nls2_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(nls2_synth_msg_t),nls2_synth_msg_process);
+	if(!nls2_engine->worker_pool) {
+		apt_log(SYNTH_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Workers");
+		if(nls2_engine->cache) {
+			mrcp_synth_cache_destroy(nls2_engine->cache);
+			nls2_engine->cache = NULL;
+		}
+		Nls2TTS::GlobalFini();
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	mrcp_worker_pool_start(nls2_engine->worker_pool);
+
+	/* prepare sessions ahead of SPEAK, if configured */
+	nls2_engine->prewarm_pool = mrcp_engine_prewarm_pool_create(engine,&prewarm_vtable,nls2_engine);
+	if(nls2_engine->prewarm_pool) {
+		mrcp_prewarm_pool_start(nls2_engine->prewarm_pool);
+	}
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -235,9 +249,17 @@ static apt_bool_t nls2_synth_engine_open(mrcp_engine_t *engine)
 static apt_bool_t nls2_synth_engine_close(mrcp_engine_t *engine)
 {
 	nls2_synth_engine_t *nls2_engine = (nls2_synth_engine_t*)engine->obj;
-	if(nls2_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(nls2_engine->worker_pool) {
+		mrcp_worker_pool_terminate(nls2_engine->worker_pool);
+		nls2_engine->worker_pool = NULL;
+	}
+	if(nls2_engine->cache) {
+		mrcp_synth_cache_destroy(nls2_engine->cache);
+		nls2_engine->cache = NULL;
+	}
+	if(nls2_engine->prewarm_pool) {
+		mrcp_prewarm_pool_terminate(nls2_engine->prewarm_pool);
+		nls2_engine->prewarm_pool = NULL;
 	}
 	Nls2TTS::GlobalFini();
 	apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,
@@ -257,11 +279,12 @@ static mrcp_engine_channel_t* nls2_synth_engine_channel_create(mrcp_engine_t *en
 	/* create Nls2TTS synth channel */
 	nls2_synth_channel_t *synth_channel = (nls2_synth_channel_t*)apr_palloc(pool,sizeof(nls2_synth_channel_t));
 	synth_channel->nls2_engine = (nls2_synth_engine_t*)engine->obj;
+	synth_channel->task = mrcp_worker_pool_task_assign(synth_channel->nls2_engine->worker_pool);
 	synth_channel->speak_request = NULL;
 	synth_channel->stop_response = NULL;
 	synth_channel->time_to_complete = 0;
 	synth_channel->paused = FALSE;
-	synth_channel->audio_buffer = NULL;
+	synth_channel->playout = NULL;
 	synth_channel->tts_session = NULL;
 	synth_channel->cbParam.pfnOnNotify = nls2_synth_on_nls2tts_notify;
 	synth_channel->cbParam.pContext = synth_channel;
@@ -287,7 +310,10 @@ static mrcp_engine_channel_t* nls2_synth_engine_channel_create(mrcp_engine_t *en
 			termination,          /* associated media termination */
 			pool);                /* pool to allocate memory from */
 
-	synth_channel->audio_buffer = mpf_buffer_create(pool);
+	synth_channel->playout = mrcp_engine_playout_create(engine,pool);
+	if(!synth_channel->playout) {
+		return NULL;
+	}
 	return synth_channel->channel;
 }
 
@@ -362,11 +388,22 @@ static apt_bool_t nls2_synth_notify_completed(nls2_synth_channel_t* synth_channe
 	return TRUE;
 }
 
+/** Stop the TTS session of the previous request, so that its audio is never written to the playout of the next one */
+static void nls2_synth_session_stop(nls2_synth_channel_t *synth_channel)
+{
+	if(synth_channel->tts_session) {
+		/* stop() returns once the request is ended, no callback of the session is invoked afterwards */
+		Nls2TTS::CloseSession(synth_channel->tts_session);
+		synth_channel->tts_session = NULL;
+	}
+}
+
 /** Process SPEAK request */
 static apt_bool_t nls2_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
 {
 	apt_log(SYNTH_LOG_MARK, APT_PRIO_INFO, "[Nls2TTS tts] process speak request");
 	apt_str_t *body;
+	apt_bool_t cached;
 	nls2_synth_channel_t *synth_channel = (nls2_synth_channel_t*)channel->method_obj;
 	const mpf_codec_descriptor_t *descriptor = mrcp_engine_source_stream_codec_get(channel);
 
@@ -376,22 +413,36 @@ static apt_bool_t nls2_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_
 		return FALSE;
 	}
 
-	synth_channel->speak_request = request;
-	body = &synth_channel->speak_request->body;
+	body = &request->body;
 	if(!body->length) {
-		synth_channel->speak_request = NULL;
 		synth_response_construct(response,MRCP_STATUS_CODE_MISSING_PARAM,SYNTHESIZER_COMPLETION_CAUSE_ERROR);
 		mrcp_engine_channel_message_send(synth_channel->channel,response);
 		return FALSE;
 	}
 
+	nls2_synth_session_stop(synth_channel);
+	/* look up the cache (may access the disk) before the request is made active,
+	so that the MPF engine reads the audio from the right source from the first frame */
+	mrcp_playout_start(synth_channel->playout,descriptor);
+	cached = mrcp_playout_cache_lookup(synth_channel->playout,synth_channel->nls2_engine->cache,request);
+
 	synth_channel->time_to_complete = 0;
 
 	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(channel,response);
+	synth_channel->speak_request = request;
+
+	if(cached == TRUE) {
+		apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,"Play Synthesized Audio from Cache " APT_SIDRES_FMT,
+			MRCP_MESSAGE_SIDRES(request));
+		return TRUE;
+	}
 
-	synth_channel->tts_session	=	Nls2TTS::OpenSession();
+	synth_channel->tts_session	=	(Nls2TTS::TTSSession*)mrcp_prewarm_pool_borrow(synth_channel->nls2_engine->prewarm_pool);
+	if(!synth_channel->tts_session) {
+		synth_channel->tts_session	=	Nls2TTS::OpenSession();
+	}
 	int32_t ret = synth_channel->tts_session->Start(body->buf,&synth_channel->cbParam);
 	if ( ret != 0)
 	{
@@ -405,9 +456,36 @@ static apt_bool_t nls2_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_
 		nls2_synth_notify_completed(synth_channel, SYNTHESIZER_COMPLETION_CAUSE_ERROR);
 		return FALSE;
 	}
+	mrcp_prewarm_pool_handshake_record(synth_channel->nls2_engine->prewarm_pool,synth_channel->tts_session->GetHandshakeTime());
 	return TRUE;
 }
 
+/** Create and configure TTS session ahead of SPEAK (prewarm pool thread) */
+static void* nls2_synth_prewarm_create(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	Nls2TTS::TTSSession *tts_session = Nls2TTS::OpenSession();
+	if(!tts_session) {
+		return NULL;
+	}
+	if(tts_session->Prepare() != 0) {
+		Nls2TTS::CloseSession(tts_session,false);
+		return NULL;
+	}
+	return tts_session;
+}
+
+/** Release idle TTS session (prewarm pool thread) */
+static void nls2_synth_prewarm_destroy(mrcp_prewarm_pool_t *prewarm_pool, void *session)
+{
+	Nls2TTS::CloseSession((Nls2TTS::TTSSession*)session,false);
+}
+
+/** Refresh token ahead of expiry (prewarm pool thread) */
+static void nls2_synth_prewarm_maintain(mrcp_prewarm_pool_t *prewarm_pool)
+{
+	Nls2TTS::RefreshToken();
+}
+
 static APR_INLINE nls2_synth_channel_t* nls2_synth_channel_get(apt_task_t *task)
 {
 	apt_consumer_task_t *consumer_task = (apt_consumer_task_t*)apt_task_object_get(task);
@@ -434,6 +512,8 @@ static apt_bool_t nls2_synth_channel_stop(mrcp_engine_channel_t *channel, mrcp_m
 	nls2_synth_channel_t *synth_channel = (nls2_synth_channel_t*)channel->method_obj;
 	/* store the request, make sure there is no more activity and only then send the response */
 	synth_channel->stop_response = response;
+	/* the playout is flushed by the MPF engine meanwhile, which releases the producer */
+	nls2_synth_session_stop(synth_channel);
 	return TRUE;
 }
 
@@ -608,9 +688,12 @@ static apt_bool_t nls2_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 	if(synth_channel->stop_response) {
 		/* send asynchronous response to STOP request */
 		mrcp_engine_channel_message_send(synth_channel->channel,synth_channel->stop_response);
+		mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 		synth_channel->stop_response = NULL;
 		synth_channel->speak_request = NULL;
 		synth_channel->paused = FALSE;
+		/* discard the rest of the synthesized audio */
+		mrcp_playout_flush(synth_channel->playout);
 		return TRUE;
 	}
 
@@ -618,10 +701,11 @@ static apt_bool_t nls2_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 	if(synth_channel->speak_request && synth_channel->paused == FALSE) {
 		// apt_log(SYNTH_LOG_MARK, APT_PRIO_INFO, "[Nls2TTS tts] read audio buffer to frame");
 		/* normal processing */
-		mpf_buffer_frame_read(synth_channel->audio_buffer,frame);
+		mrcp_playout_frame_read(synth_channel->playout,frame);
 			/* raise SPEAK-COMPLETE event */
 		if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
 			frame->type &= ~MEDIA_FRAME_TYPE_EVENT;
+			mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 			nls2_synth_speak_complete_raise(synth_channel);
 		}
 	}
@@ -632,8 +716,7 @@ static apt_bool_t nls2_synth_msg_signal(nls2_synth_msg_type_e type, mrcp_engine_
 {
 	apt_bool_t status = FALSE;
 	nls2_synth_channel_t *nls2_channel = (nls2_synth_channel_t *)channel->method_obj;
-	nls2_synth_engine_t *nls2_engine = nls2_channel->nls2_engine;
-	apt_task_t *task = apt_consumer_task_base_get(nls2_engine->task);
+	apt_task_t *task = nls2_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		nls2_synth_msg_t *nls2_msg;
@@ -682,7 +765,13 @@ static int32_t	nls2_synth_on_nls2tts_notify(NlsEvent* cbEvent, void* pvContext)
 				apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,"on Binary, event(\"begin-speaking\") should be emitted " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(synth_channel->speak_request));
 				std::vector<unsigned char> data = cbEvent->getBinaryData(); // getBinaryData() 获取文本合成的二进制音频数据
-				mpf_buffer_audio_write(synth_channel->audio_buffer, (char*)&data[0], data.size());
+				/* the service is faster than real time, hold the SDK until the ring is drained */
+				apr_size_t written = mrcp_playout_audio_write_wait(synth_channel->playout, &data[0], data.size(), MRCP_PLAYOUT_DEFAULT_WRITE_TIMEOUT);
+				if(written < data.size()) {
+					apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,"Audio Ring Overrun [%" APR_SIZE_T_FMT " bytes dropped] " APT_SIDRES_FMT,
+						data.size() - written,
+						MRCP_MESSAGE_SIDRES(synth_channel->speak_request));
+				}
 			}
 			break;
 		}
@@ -700,7 +789,7 @@ static int32_t	nls2_synth_on_nls2tts_notify(NlsEvent* cbEvent, void* pvContext)
 			if(synth_channel->speak_request){
 				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,"on SynthesisCompleted " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(synth_channel->speak_request));
-				mpf_buffer_event_write(synth_channel->audio_buffer, MEDIA_FRAME_TYPE_EVENT);
+				mrcp_playout_complete(synth_channel->playout);
 				// nls2_synth_notify_completed(synth_channel,SYNTHESIZER_COMPLETION_CAUSE_NORMAL);
 			}
 			break;
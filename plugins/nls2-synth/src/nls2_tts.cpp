@@ -1,6 +1,7 @@
 #include <ctime>
 #include <iostream>
 #include <vector>
+#include <pthread.h>
 #include "nls2_tts.h"
 
 #include "tinyxml2.h"
@@ -15,6 +16,13 @@ extern apt_log_source_t *SYNTH_PLUGIN;
 /** Use custom log source mark */
 #define SYNTH_LOG_MARK   APT_LOG_MARK_DECLARE(SYNTH_PLUGIN)
 
+/** Token is applied for in background this long (sec) ahead of expiry */
+#define TOKEN_REFRESH_AHEAD		600
+/** Token is applied for on demand this long (sec) ahead of expiry */
+#define TOKEN_EXPIRE_MARGIN		10
+/** Time (sec) to wait before applying for token in background again once failed */
+#define TOKEN_RETRY_INTERVAL	30
+
 namespace Nls2TTS
 {
 	NlsClient*	g_pNlsClient	=	NULL;
@@ -32,6 +40,8 @@ namespace Nls2TTS
 	int g_iPitchRate = 0;
 	int g_iTimeout = 0;
 	std::string g_strVoice = "xiaoyun";
+	long g_lTokenRetryTime = 0;
+	pthread_mutex_t	g_mutexToken = PTHREAD_MUTEX_INITIALIZER; //guards token, sessions are started concurrently
 
 	int32_t	GlobalInit(const std::string& strFilePathConf)
 	{
@@ -147,6 +157,12 @@ namespace Nls2TTS
 		g_strDftAccessKeyId.clear();
 		g_strDftAccessKeySecret.clear();
 
+		pthread_mutex_lock(&g_mutexToken);
+		g_strToken.clear();
+		g_lExireTime = -1;
+		g_lTokenRetryTime = 0;
+		pthread_mutex_unlock(&g_mutexToken);
+
 		return 0;
 	}
 
@@ -206,6 +222,59 @@ namespace Nls2TTS
 		return 0;
 	}
 
+	/**
+	 * 获取token, 若lAhead秒内过期则重新生成
+	 */
+	static int32_t	UpdateToken(long lAhead, std::string* pstrToken)
+	{
+		int32_t	nRet	=	0;
+
+		pthread_mutex_lock(&g_mutexToken);
+		if (g_lExireTime - (long)std::time(0) < lAhead)
+		{
+			if (-1 == generateToken(g_strDftAccessKeyId, g_strDftAccessKeySecret, &g_strToken, &g_lExireTime))
+			{
+				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
+					"Failed to generate token by AccessKey-ID and AccessKey-Secret!!!"
+					);
+				nRet	=	-1;
+			}
+			else
+			{
+				apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,
+					"Token generated, expire time %ld.",
+					g_lExireTime
+					);
+			}
+		}
+		if (nRet == 0 && pstrToken != NULL)
+		{
+			pstrToken->assign(g_strToken);
+		}
+		pthread_mutex_unlock(&g_mutexToken);
+
+		return nRet;
+	}
+
+	int32_t	RefreshToken()
+	{
+		int32_t	nRet	=	0;
+		long	lNow	=	(long)std::time(0);
+
+		// called periodically, so that sessions rarely wait for token on start
+		if (lNow < g_lTokenRetryTime)
+		{
+			return -1;
+		}
+		nRet	=	UpdateToken(TOKEN_REFRESH_AHEAD, NULL);
+		if (nRet != 0)
+		{
+			g_lTokenRetryTime	=	lNow + TOKEN_RETRY_INTERVAL;
+		}
+
+		return nRet;
+	}
+
 
 	/**
 		* @brief 调用start(), 发送text至云端, sdk内部线程上报started事件
@@ -221,8 +290,8 @@ namespace Nls2TTS
 			<< ", task id: " << cbEvent->getTaskId()   // 当前任务的task id，方便定位问题，建议输出
 			<< endl;
 		//cout << "OnSynthesisStarted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-		ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-		pSession->pfnOnNotify(cbEvent,pSession->pContext);
+		TTSSession*	pSession	=	(TTSSession*)cbParam;
+		pSession->Notify(cbEvent);
 
 	}
 
@@ -241,8 +310,8 @@ namespace Nls2TTS
 			<< ", task id: " << cbEvent->getTaskId()   // 当前任务的task id，方便定位问题，建议输出
 			<< endl;
 		// cout << "OnSynthesisCompleted: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
-		ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-		pSession->pfnOnNotify(cbEvent,pSession->pContext);
+		TTSSession*	pSession	=	(TTSSession*)cbParam;
+		pSession->Notify(cbEvent);
 
 	}
 
@@ -263,8 +332,8 @@ namespace Nls2TTS
 			<< endl;
 		// cout << "OnSynthesisTaskFailed: All response:" << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
 
-		ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-		pSession->pfnOnNotify(cbEvent,pSession->pContext);
+		TTSSession*	pSession	=	(TTSSession*)cbParam;
+		pSession->Notify(cbEvent);
 
 	}
 
@@ -278,8 +347,8 @@ namespace Nls2TTS
 	void OnSynthesisChannelClosed(NlsEvent* cbEvent, void* cbParam) {
 		cout << "OnRecognitionChannelCloseed: All response: " << cbEvent->getAllResponse() << endl; // 获取服务端返回的全部信息
 
-		ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-		pSession->pfnOnNotify(cbEvent,pSession->pContext);
+		TTSSession*	pSession	=	(TTSSession*)cbParam;
+		pSession->Notify(cbEvent);
 	}
 
 	/**
@@ -302,14 +371,16 @@ namespace Nls2TTS
 		// if (data.size() > 0) {
 		// 	tmpParam->audioFile.write((char*)&data[0], data.size());
 		// }
-		ParamCallBack*	pSession	=	(ParamCallBack*)cbParam;
-		pSession->pfnOnNotify(cbEvent,pSession->pContext);
+		TTSSession*	pSession	=	(TTSSession*)cbParam;
+		pSession->Notify(cbEvent);
 	}
 
 
 	TTSSession::TTSSession()
-	:m_pNlsReq(NULL), m_pNlsCB(NULL)
+	:m_pNlsReq(NULL), m_pNlsCB(NULL), m_tmHandshake(-1)
 	{
+		this->m_cbParam.pfnOnNotify	=	NULL;
+		this->m_cbParam.pContext	=	NULL;
 	}
 
 	TTSSession::~TTSSession()
@@ -317,48 +388,34 @@ namespace Nls2TTS
 	}
 
 
-	int32_t	TTSSession::Start(const char* value,void* pContext)
+	int32_t	TTSSession::Prepare()
 	{
 		int32_t	nRet	=	-1;
 
 		for (int32_t iOnce=0; iOnce<1; ++iOnce)
 		{
-			/**
-			 * 获取当前系统时间戳，判断token是否过期
-			 */
-			std::time_t curTime = std::time(0);
-			if (g_lExireTime - curTime < 10) {
-				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
-				"the token will be expired, please generate new token by AccessKey-ID and AccessKey-Secret." 
-				);
-				if (-1 == generateToken(g_strDftAccessKeyId, g_strDftAccessKeySecret, &g_strToken, &g_lExireTime)) {
-					nRet	=	-1;
-					break;
-				}
-			}
-			
 			this->m_pNlsCB	=	new SpeechSynthesizerCallback();
 			if (this->m_pNlsCB == NULL)
 			{
 				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
-					"TTSSession::Start() failed on new SpeechSynthesizerCallback()!!!"
+					"TTSSession::Prepare() failed on new SpeechSynthesizerCallback()!!!"
 					);
 
 				nRet	=	-1;
 				break;
 			}
-			this->m_pNlsCB->setOnSynthesisStarted(OnSynthesisStarted, pContext); // 设置音频合成启动成功回调函数
-			this->m_pNlsCB->setOnSynthesisCompleted(OnSynthesisCompleted, pContext); // 设置音频合成结束回调函数
-			this->m_pNlsCB->setOnChannelClosed(OnSynthesisChannelClosed, pContext); // 设置音频合成通道关闭回调函数
-			this->m_pNlsCB->setOnTaskFailed(OnSynthesisTaskFailed, pContext); // 设置异常失败回调函数
-			this->m_pNlsCB->setOnBinaryDataReceived(OnBinaryDataRecved, pContext); // 设置文本音频数据接收回调函数
+			this->m_pNlsCB->setOnSynthesisStarted(OnSynthesisStarted, this); // 设置音频合成启动成功回调函数
+			this->m_pNlsCB->setOnSynthesisCompleted(OnSynthesisCompleted, this); // 设置音频合成结束回调函数
+			this->m_pNlsCB->setOnChannelClosed(OnSynthesisChannelClosed, this); // 设置音频合成通道关闭回调函数
+			this->m_pNlsCB->setOnTaskFailed(OnSynthesisTaskFailed, this); // 设置异常失败回调函数
+			this->m_pNlsCB->setOnBinaryDataReceived(OnBinaryDataRecved, this); // 设置文本音频数据接收回调函数
 
 
 			this->m_pNlsReq	=	NlsClient::getInstance()->createSynthesizerRequest(this->m_pNlsCB);
 			if (this->m_pNlsReq == NULL)
 			{
 				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
-					"TTSSession::Start() failed on g_pNlsClient->createSynthesizerRequest!!!"
+					"TTSSession::Prepare() failed on g_pNlsClient->createSynthesizerRequest!!!"
 					);
 
 				nRet	=	-1;
@@ -373,12 +430,47 @@ namespace Nls2TTS
 			this->m_pNlsReq->setPitchRate(g_iPitchRate); // 语调, 范围是-500~500, 可选参数, 默认是0
 			this->m_pNlsReq->setMethod(g_iMethod); // 合成方法, 可选参数, 默认是0. 参数含义0:不带录音的参数合成; 1:带录音的拼接合成; 2:不带录音的拼接合成; 3:带录音的参数合成
 
-			this->m_pNlsReq->setToken(g_strToken.c_str()); // 设置账号校验token, 必填参数
+			nRet	=	0;
+		}
+		if (nRet != 0)
+		{
+			this->Stop(false);
+		}
+
+		return nRet;
+	}
+
+	int32_t	TTSSession::Start(const char* value,void* pContext)
+	{
+		int32_t	nRet	=	-1;
+
+		for (int32_t iOnce=0; iOnce<1; ++iOnce)
+		{
+			/**
+			 * 获取token, 通常已由后台提前更新
+			 */
+			std::string	strToken;
+			if (UpdateToken(TOKEN_EXPIRE_MARGIN, &strToken) != 0)
+			{
+				nRet	=	-1;
+				break;
+			}
+
+			// 事件在start()之后才上报, 此前设置接收者无需加锁
+			this->m_cbParam	=	*(ParamCallBack*)pContext;
+			if (this->m_pNlsReq == NULL && this->Prepare() != 0)
+			{
+				nRet	=	-1;
+				break;
+			}
+
+			this->m_pNlsReq->setToken(strToken.c_str()); // 设置账号校验token, 必填参数
 			this->m_pNlsReq->setText(value); // 设置待合成文本, 必填参数. 文本内容必须为UTF-8编码。
 
 			/*
 			* 3: start()为阻塞操作, 发送start指令之后, 会等待服务端响应, 或超时之后才返回
 			*/
+			apr_time_t	tmStart	=	apr_time_now();
 			if (this->m_pNlsReq->start() < 0) {
 				apt_log(SYNTH_LOG_MARK,APT_PRIO_WARNING,
 					"TTSSession::Start() failed!, text is %s !!",value
@@ -386,9 +478,11 @@ namespace Nls2TTS
 				nRet	=	-1;
 				break;
 			}
+			this->m_tmHandshake	=	apr_time_now() - tmStart;
 
 			apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,
-				"TTSSession::Start() successfully. text is %s",value
+				"TTSSession::Start() successfully, handshake %ld ms. text is %s",
+				(long)(this->m_tmHandshake / 1000),value
 				);
 
 			nRet	=	0;
@@ -426,4 +520,18 @@ namespace Nls2TTS
 
 		return 0;
 	}
+
+	apr_interval_time_t	TTSSession::GetHandshakeTime() const
+	{
+		return this->m_tmHandshake;
+	}
+
+	void	TTSSession::Notify(NlsEvent* cbEvent)
+	{
+		// 预先创建的session在Start()之前没有接收者
+		if (this->m_cbParam.pfnOnNotify != NULL)
+		{
+			this->m_cbParam.pfnOnNotify(cbEvent,this->m_cbParam.pContext);
+		}
+	}
 }; //namespace Nls2
@@ -28,20 +28,25 @@
  */
 #include <stdlib.h>
 #include "mrcp_recog_engine.h"
+#include "mrcp_engine_feeder.h"
+#include "mrcp_engine_worker.h"
 #include "mpf_activity_detector.h"
-#include "apt_consumer_task.h"
+#include "apt_pool.h"
 #include "apt_log.h"
 #include "qisr.h"
 #include "msp_cmn.h"
 #include "msp_errors.h"
 
 
-#define RECOG_ENGINE_TASK_NAME "XFyun Recog Engine"
-
 typedef struct xfyun_recog_engine_t xfyun_recog_engine_t;
 typedef struct xfyun_recog_channel_t xfyun_recog_channel_t;
 typedef struct xfyun_recog_msg_t xfyun_recog_msg_t;
 
+/** Interval to poll for the final result at (msec) */
+#define XFYUN_RESULT_POLL_INTERVAL  150
+/** Max number of polls for the final result (15 sec) */
+#define XFYUN_RESULT_POLL_MAX_COUNT 100
+
 /** Declaration of recognizer engine methods */
 static apt_bool_t xfyun_recog_engine_destroy(mrcp_engine_t *engine);
 static apt_bool_t xfyun_recog_engine_open(mrcp_engine_t *engine);
@@ -92,13 +97,18 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of xfyun recognizer engine */
 struct xfyun_recog_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Pool of workers feeding audio to ASR sessions */
+	mrcp_feeder_pool_t     *feeder_pool;
 };
 
 /** Declaration of xfyun recognizer channel */
 struct xfyun_recog_channel_t {
 	/** Back pointer to engine */
 	xfyun_recog_engine_t     *xfyun_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t               *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
 
@@ -112,10 +122,23 @@ struct xfyun_recog_channel_t {
 	mpf_activity_detector_t *detector;
 	/** File to write utterance to */
 	FILE                    *audio_out;
+	/** Feeder passing audio to ASR session off the MPF engine thread */
+	mrcp_feeder_t           *feeder;
 	
+	/** The fields below are accessed by feeder worker only */
 	const char				*session_id;
 	const char				*last_result;
 	apt_bool_t				recog_started;
+	/** Whether the final result is yet to be polled for */
+	apt_bool_t				result_pending;
+	/** Request to complete once the final result is available */
+	mrcp_message_t			*complete_request;
+	/** Completion cause to complete the request with */
+	mrcp_recog_completion_cause_e complete_cause;
+	/** Number of polls for the final result so far */
+	apr_size_t				poll_count;
+	/** Pool the results are allocated from */
+	apr_pool_t				*result_pool;
 };
 
 typedef enum {
@@ -134,6 +157,25 @@ struct xfyun_recog_msg_t {
 static apt_bool_t xfyun_recog_msg_signal(xfyun_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
 static apt_bool_t xfyun_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 
+/** Commands processed by feeder worker */
+typedef enum {
+	XFYUN_FEEDER_SESSION_START,
+	XFYUN_FEEDER_SESSION_STOP,
+	XFYUN_FEEDER_COMPLETE_SUCCESS,
+	XFYUN_FEEDER_COMPLETE_NO_INPUT,
+	XFYUN_FEEDER_RESULT_POLL
+} xfyun_feeder_command_e;
+
+static apt_bool_t xfyun_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size);
+static apt_bool_t xfyun_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg);
+static void xfyun_recog_feeder_close(mrcp_feeder_t *feeder);
+
+static const mrcp_feeder_vtable_t feeder_vtable = {
+	xfyun_recog_feeder_audio,
+	xfyun_recog_feeder_command,
+	xfyun_recog_feeder_close
+};
+
 /** Declare this macro to set plugin version */
 MRCP_PLUGIN_VERSION_DECLARE
 
@@ -167,25 +209,13 @@ static apt_bool_t xfyun_login()
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	xfyun_recog_engine_t *xfyun_engine = apr_palloc(pool,sizeof(xfyun_recog_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
 
 	if(!xfyun_login()) {
 		return NULL;
 	}
 
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(xfyun_recog_msg_t),pool);
-	xfyun_engine->task = apt_consumer_task_create(xfyun_engine,msg_pool,pool);
-	if(!xfyun_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(xfyun_engine->task);
-	apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = xfyun_recog_msg_process;
-	}
+	xfyun_engine->feeder_pool = NULL;
+	xfyun_engine->worker_pool = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -198,12 +228,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy recognizer engine */
 static apt_bool_t xfyun_recog_engine_destroy(mrcp_engine_t *engine)
 {
-	xfyun_recog_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_destroy(task);
-		xfyun_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -211,10 +235,22 @@ static apt_bool_t xfyun_recog_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t xfyun_recog_engine_open(mrcp_engine_t *engine)
 {
 	xfyun_recog_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_start(task);
+	xfyun_engine->feeder_pool = mrcp_engine_feeder_pool_create(engine);
+	if(!xfyun_engine->feeder_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Feeder Pool");
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	mrcp_feeder_pool_start(xfyun_engine->feeder_pool);
+
+	/* create workers (threads) to process the requests of the channels, once nothing else may fail */
+	xfyun_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(xfyun_recog_msg_t),xfyun_recog_msg_process);
+	if(!xfyun_engine->worker_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Create Workers");
+		mrcp_feeder_pool_terminate(xfyun_engine->feeder_pool);
+		xfyun_engine->feeder_pool = NULL;
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	mrcp_worker_pool_start(xfyun_engine->worker_pool);
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -222,9 +258,13 @@ static apt_bool_t xfyun_recog_engine_open(mrcp_engine_t *engine)
 static apt_bool_t xfyun_recog_engine_close(mrcp_engine_t *engine)
 {
 	xfyun_recog_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(xfyun_engine->feeder_pool) {
+		mrcp_feeder_pool_terminate(xfyun_engine->feeder_pool);
+		xfyun_engine->feeder_pool = NULL;
+	}
+	if(xfyun_engine->worker_pool) {
+		mrcp_worker_pool_terminate(xfyun_engine->worker_pool);
+		xfyun_engine->worker_pool = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -237,6 +277,7 @@ static mrcp_engine_channel_t* xfyun_recog_engine_channel_create(mrcp_engine_t *e
 	/* create xfyun recog channel */
 	xfyun_recog_channel_t *recog_channel = apr_palloc(pool,sizeof(xfyun_recog_channel_t));
 	recog_channel->xfyun_engine = engine->obj;
+	recog_channel->task = mrcp_worker_pool_task_assign(recog_channel->xfyun_engine->worker_pool);
 	recog_channel->recog_request = NULL;
 	recog_channel->stop_response = NULL;
 	recog_channel->detector = mpf_activity_detector_create(pool);
@@ -244,6 +285,22 @@ static mrcp_engine_channel_t* xfyun_recog_engine_channel_create(mrcp_engine_t *e
 	recog_channel->session_id = NULL;
 	recog_channel->last_result = NULL;
 	recog_channel->recog_started = FALSE;
+	recog_channel->result_pending = FALSE;
+	recog_channel->complete_request = NULL;
+	recog_channel->complete_cause = RECOGNIZER_COMPLETION_CAUSE_SUCCESS;
+	recog_channel->poll_count = 0;
+	recog_channel->result_pool = apt_pool_create();
+	recog_channel->feeder = mrcp_feeder_create(
+			recog_channel->xfyun_engine->feeder_pool,
+			&feeder_vtable,
+			recog_channel,
+			MRCP_FEEDER_DEFAULT_CAPACITY);
+	if(!recog_channel->feeder) {
+		if(recog_channel->result_pool) {
+			apr_pool_destroy(recog_channel->result_pool);
+		}
+		return NULL;
+	}
 	capabilities = mpf_sink_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
 			&capabilities->codecs,
@@ -271,7 +328,15 @@ static mrcp_engine_channel_t* xfyun_recog_engine_channel_create(mrcp_engine_t *e
 /** Destroy engine channel */
 static apt_bool_t xfyun_recog_channel_destroy(mrcp_engine_channel_t *channel)
 {
-	/* nothing to destrtoy */
+	xfyun_recog_channel_t *recog_channel = channel->method_obj;
+	if(recog_channel->feeder) {
+		mrcp_feeder_destroy(recog_channel->feeder);
+		recog_channel->feeder = NULL;
+	}
+	if(recog_channel->result_pool) {
+		apr_pool_destroy(recog_channel->result_pool);
+		recog_channel->result_pool = NULL;
+	}
 	return TRUE;
 }
 
@@ -346,16 +411,16 @@ static apt_bool_t xfyun_recog_channel_recognize(mrcp_engine_channel_t *channel,
 	/* reset */
 	int errcode = MSP_SUCCESS;
 	const char*	session_begin_params = "sub = iat, domain = iat, language = zh_cn, accent = mandarin, sample_rate = 8000, result_type = plain, result_encoding = utf8";
-	recog_channel->session_id = QISRSessionBegin(NULL, session_begin_params, &errcode); //听写不需要语法，第一个参数为NULL
+	const char *session_id = QISRSessionBegin(NULL, session_begin_params, &errcode); //听写不需要语法，第一个参数为NULL
 	if (MSP_SUCCESS != errcode)
 	{
 		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"[xfyun] QISRSessionBegin failed! error code:%d\n", errcode);
 		return FALSE;
 	}
 	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"[xfyun] QISRSessionBegin suceess!");
-	
-	recog_channel->last_result = NULL;
-	recog_channel->recog_started = FALSE;
+
+	/* hand the session over to feeder worker, audio is fed from now on */
+	mrcp_feeder_command_post(recog_channel->feeder,XFYUN_FEEDER_SESSION_START,(void*)session_id);
 
 	recog_channel->recog_request = request;
 
@@ -367,7 +432,7 @@ static apt_bool_t xfyun_recog_channel_stop(mrcp_engine_channel_t *channel, mrcp_
 {
 	/* process STOP request */
 	xfyun_recog_channel_t *recog_channel = channel->method_obj;
-	xfyun_recog_end_session(recog_channel);
+	mrcp_feeder_command_post(recog_channel->feeder,XFYUN_FEEDER_SESSION_STOP,NULL);
 	/* store STOP request, make sure there is no more activity and only then send the response */
 	recog_channel->stop_response = response;
 	return TRUE;
@@ -485,7 +550,9 @@ static apt_bool_t xfyun_recog_result_load(xfyun_recog_channel_t *recog_channel,
 	return TRUE;
 }
 
-void xfyun_recog_end_session(xfyun_recog_channel_t *recog_channel){
+static void xfyun_recog_end_session(xfyun_recog_channel_t *recog_channel){
+	/* a request waiting for the final result is not completed anymore */
+	recog_channel->complete_request = NULL;
 	if(recog_channel->session_id) {
 		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"[xfyun] QISRSessionEnd suceess!");
 		QISRSessionEnd(recog_channel->session_id, "mrcp channel closed");
@@ -493,17 +560,17 @@ void xfyun_recog_end_session(xfyun_recog_channel_t *recog_channel){
 	}
 }
 
-/* Raise xfyun RECOGNITION-COMPLETE event */
-static apt_bool_t xfyun_recog_recognition_complete(xfyun_recog_channel_t *recog_channel, mrcp_recog_completion_cause_e cause)
+/* Send xfyun RECOGNITION-COMPLETE event (feeder worker) */
+static apt_bool_t xfyun_recog_recognition_complete_send(xfyun_recog_channel_t *recog_channel, mrcp_message_t *recog_request, mrcp_recog_completion_cause_e cause)
 {
-	xfyun_recog_stream_recog(recog_channel, NULL, 0);
-	xfyun_recog_end_session(recog_channel);
 	mrcp_recog_header_t *recog_header;
+	mrcp_message_t *message;
+	xfyun_recog_end_session(recog_channel);
 	/* create RECOGNITION-COMPLETE event */
-	mrcp_message_t *message = mrcp_event_create(
-						recog_channel->recog_request,
+	message = mrcp_event_create(
+						recog_request,
 						RECOGNIZER_RECOGNITION_COMPLETE,
-						recog_channel->recog_request->pool);
+						recog_request->pool);
 	if(!message) {
 		return FALSE;
 	}
@@ -522,11 +589,80 @@ static apt_bool_t xfyun_recog_recognition_complete(xfyun_recog_channel_t *recog_
 		xfyun_recog_result_load(recog_channel,message);
 	}
 
-	recog_channel->recog_request = NULL;
 	/* send asynch event */
 	return mrcp_engine_channel_message_send(recog_channel->channel,message);
 }
 
+/* Fetch the result available so far (feeder worker) */
+static apt_bool_t xfyun_recog_result_fetch(xfyun_recog_channel_t *recog_channel, int *rec_stat)
+{
+	int ret = 0;
+	const char *rslt;
+	if(NULL == recog_channel->session_id) {
+		return FALSE;
+	}
+	rslt = QISRGetResult(recog_channel->session_id, rec_stat, 0, &ret);
+	if (MSP_SUCCESS != ret)
+	{
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"[xfyun] QISRGetResult failed, error code: %d", ret);
+		return FALSE;
+	}
+	if (NULL != rslt)
+	{
+		if(NULL == recog_channel->last_result) {
+			recog_channel->last_result = apr_pstrdup(recog_channel->result_pool,rslt);
+		} else {
+			recog_channel->last_result = apr_pstrcat(recog_channel->result_pool, recog_channel->last_result, rslt, NULL);
+		}
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"[xfyun] Get recog result:%s",rslt);
+	return TRUE;
+}
+
+/* Raise xfyun RECOGNITION-COMPLETE event once the final result is available (feeder worker) */
+static apt_bool_t xfyun_recog_recognition_complete(xfyun_recog_channel_t *recog_channel, mrcp_message_t *recog_request, mrcp_recog_completion_cause_e cause)
+{
+	recog_channel->result_pending = FALSE;
+	xfyun_recog_stream_recog(recog_channel, NULL, 0);
+	if(recog_channel->result_pending == TRUE) {
+		/* poll for the final result later, the worker is shared with other channels */
+		recog_channel->complete_request = recog_request;
+		recog_channel->complete_cause = cause;
+		recog_channel->poll_count = 0;
+		if(mrcp_feeder_command_defer(recog_channel->feeder,XFYUN_FEEDER_RESULT_POLL,NULL,XFYUN_RESULT_POLL_INTERVAL) == TRUE) {
+			return TRUE;
+		}
+		recog_channel->complete_request = NULL;
+	}
+	return xfyun_recog_recognition_complete_send(recog_channel,recog_request,cause);
+}
+
+/* Poll for the final result and complete the request once it's available (feeder worker) */
+static apt_bool_t xfyun_recog_result_poll(xfyun_recog_channel_t *recog_channel)
+{
+	int rec_stat = MSP_REC_STATUS_SUCCESS;
+	mrcp_message_t *recog_request = recog_channel->complete_request;
+	if(!recog_request) {
+		/* the session has been ended meanwhile */
+		return TRUE;
+	}
+
+	if(xfyun_recog_result_fetch(recog_channel,&rec_stat) == TRUE && MSP_REC_STATUS_COMPLETE != rec_stat) {
+		recog_channel->poll_count++;
+		if(recog_channel->poll_count < XFYUN_RESULT_POLL_MAX_COUNT) {
+			if(mrcp_feeder_command_defer(recog_channel->feeder,XFYUN_FEEDER_RESULT_POLL,NULL,XFYUN_RESULT_POLL_INTERVAL) == TRUE) {
+				return TRUE;
+			}
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"[xfyun] Final result timed out " APT_SIDRES_FMT,
+				MRCP_MESSAGE_SIDRES(recog_request));
+		}
+	}
+	recog_channel->complete_request = NULL;
+	return xfyun_recog_recognition_complete_send(recog_channel,recog_request,recog_channel->complete_cause);
+}
+
 static apt_bool_t xfyun_recog_stream_recog(xfyun_recog_channel_t *recog_channel,
 							   const void *voice_data,
 							   unsigned int voice_len 
@@ -557,30 +693,12 @@ static apt_bool_t xfyun_recog_stream_recog(xfyun_recog_channel_t *recog_channel,
 		// apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"[xfyun] no need recog,rec_stat=%d,aud_stat=%d",rec_stat,aud_stat);
 		return TRUE;
 	}
-	while (1) 
-	{
-		const char *rslt = QISRGetResult(recog_channel->session_id, &rec_stat, 0, &ret);
-		if (MSP_SUCCESS != ret)
-		{
-			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"[xfyun] QISRGetResult failed, error code: %d", ret);
-			return FALSE;
-		}
-		if (NULL != rslt)
-		{
-			if(NULL == recog_channel->last_result) {
-				recog_channel->last_result = apr_pstrdup(recog_channel->channel->pool,rslt);
-			} else {
-				// recog_channel->last_result = apr_psprintf(recog_channel->channel->pool,"%s%s",recog_channel->last_result,rslt);
-				recog_channel->last_result = apr_pstrcat(recog_channel->channel->pool, recog_channel->last_result, rslt, NULL);
-			}
-		}
-		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"[xfyun] Get recog result:%s",rslt);
-
-		if(MSP_AUDIO_SAMPLE_LAST == aud_stat && MSP_REC_STATUS_COMPLETE != rec_stat) {
-			usleep(150*1000);
-			continue;
-		}
-		break;
+	if(xfyun_recog_result_fetch(recog_channel, &rec_stat) == FALSE) {
+		return FALSE;
+	}
+	if(MSP_AUDIO_SAMPLE_LAST == aud_stat && MSP_REC_STATUS_COMPLETE != rec_stat) {
+		/* never sleep here, the final result is polled for by deferred command */
+		recog_channel->result_pending = TRUE;
 	}
 	return TRUE;
 }
@@ -596,8 +714,9 @@ static apt_bool_t xfyun_recog_stream_write(mpf_audio_stream_t *stream, const mpf
 		recog_channel->recog_request = NULL;
 		return TRUE;
 	}
-	if(frame->codec_frame.size) {
-		xfyun_recog_stream_recog(recog_channel, frame->codec_frame.buffer, frame->codec_frame.size);
+	if(recog_channel->recog_request && frame->codec_frame.size) {
+		/* never block here, the audio is written to ASR session by feeder worker */
+		mrcp_feeder_audio_write(recog_channel->feeder, frame->codec_frame.buffer, frame->codec_frame.size);
 	}
 	if(recog_channel->recog_request) {
 		mpf_detector_event_e det_event = mpf_activity_detector_process(recog_channel->detector,frame);
@@ -610,13 +729,15 @@ static apt_bool_t xfyun_recog_stream_write(mpf_audio_stream_t *stream, const mpf
 			case MPF_DETECTOR_EVENT_INACTIVITY:
 				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Inactivity " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				xfyun_recog_recognition_complete(recog_channel,RECOGNIZER_COMPLETION_CAUSE_SUCCESS);
+				mrcp_feeder_command_post(recog_channel->feeder,XFYUN_FEEDER_COMPLETE_SUCCESS,recog_channel->recog_request);
+				recog_channel->recog_request = NULL;
 				break;
 			case MPF_DETECTOR_EVENT_NOINPUT:
 				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Noinput " APT_SIDRES_FMT,
 					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
 				if(recog_channel->timers_started == TRUE) {
-					xfyun_recog_recognition_complete(recog_channel,RECOGNIZER_COMPLETION_CAUSE_NO_INPUT_TIMEOUT);
+					mrcp_feeder_command_post(recog_channel->feeder,XFYUN_FEEDER_COMPLETE_NO_INPUT,recog_channel->recog_request);
+					recog_channel->recog_request = NULL;
 				}
 				break;
 			default:
@@ -650,8 +771,7 @@ static apt_bool_t xfyun_recog_msg_signal(xfyun_recog_msg_type_e type, mrcp_engin
 {
 	apt_bool_t status = FALSE;
 	xfyun_recog_channel_t *xfyun_channel = channel->method_obj;
-	xfyun_recog_engine_t *xfyun_engine = xfyun_channel->xfyun_engine;
-	apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
+	apt_task_t *task = xfyun_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		xfyun_recog_msg_t *xfyun_msg;
@@ -683,7 +803,10 @@ static apt_bool_t xfyun_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 				recog_channel->audio_out = NULL;
 			}
 
-			mrcp_engine_channel_close_respond(xfyun_msg->channel);
+			/* the response is sent once feeder worker ends ASR session */
+			if(mrcp_feeder_close(recog_channel->feeder) == FALSE) {
+				mrcp_engine_channel_close_respond(xfyun_msg->channel);
+			}
 			break;
 		}
 		case XFYUN_RECOG_MSG_REQUEST_PROCESS:
@@ -694,3 +817,50 @@ static apt_bool_t xfyun_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	}
 	return TRUE;
 }
+
+/** Write audio to ASR session (feeder worker) */
+static apt_bool_t xfyun_recog_feeder_audio(mrcp_feeder_t *feeder, const void *data, apr_size_t size)
+{
+	xfyun_recog_channel_t *recog_channel = mrcp_feeder_object_get(feeder);
+	return xfyun_recog_stream_recog(recog_channel, data, (unsigned int)size);
+}
+
+/** Process feeder command (feeder worker) */
+static apt_bool_t xfyun_recog_feeder_command(mrcp_feeder_t *feeder, int command, void *arg)
+{
+	xfyun_recog_channel_t *recog_channel = mrcp_feeder_object_get(feeder);
+	switch(command) {
+		case XFYUN_FEEDER_SESSION_START:
+			xfyun_recog_end_session(recog_channel);
+			if(recog_channel->result_pool) {
+				apr_pool_clear(recog_channel->result_pool);
+			}
+			recog_channel->session_id = arg;
+			recog_channel->last_result = NULL;
+			recog_channel->recog_started = FALSE;
+			break;
+		case XFYUN_FEEDER_SESSION_STOP:
+			xfyun_recog_end_session(recog_channel);
+			break;
+		case XFYUN_FEEDER_COMPLETE_SUCCESS:
+			xfyun_recog_recognition_complete(recog_channel,arg,RECOGNIZER_COMPLETION_CAUSE_SUCCESS);
+			break;
+		case XFYUN_FEEDER_COMPLETE_NO_INPUT:
+			xfyun_recog_recognition_complete(recog_channel,arg,RECOGNIZER_COMPLETION_CAUSE_NO_INPUT_TIMEOUT);
+			break;
+		case XFYUN_FEEDER_RESULT_POLL:
+			xfyun_recog_result_poll(recog_channel);
+			break;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+/** End ASR session and respond to channel close (feeder worker) */
+static void xfyun_recog_feeder_close(mrcp_feeder_t *feeder)
+{
+	xfyun_recog_channel_t *recog_channel = mrcp_feeder_object_get(feeder);
+	xfyun_recog_end_session(recog_channel);
+	mrcp_engine_channel_close_respond(recog_channel->channel);
+}
@@ -36,11 +36,11 @@
 #include "msp_errors.h"
 
 #include "mrcp_synth_engine.h"
+#include "mrcp_engine_worker.h"
 #include "apt_consumer_task.h"
 #include "apt_log.h"
-#include "mpf_buffer.h"
+#include "mrcp_engine_playout.h"
 
-#define SYNTH_ENGINE_TASK_NAME "XFyun Synth Engine"
 
 typedef struct xfyun_synth_engine_t xfyun_synth_engine_t;
 typedef struct xfyun_synth_channel_t xfyun_synth_channel_t;
@@ -92,13 +92,18 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of xfyun synthesizer engine */
 struct xfyun_synth_engine_t {
-	apt_consumer_task_t    *task;
+	/** Workers the channels are processed by */
+	mrcp_worker_pool_t     *worker_pool;
+	/** Cache of synthesized audio */
+	mrcp_synth_cache_t     *cache;
 };
 
 /** Declaration of xfyun synthesizer channel */
 struct xfyun_synth_channel_t {
 	/** Back pointer to engine */
 	xfyun_synth_engine_t   *xfyun_engine;
+	/** Worker the channel is pinned to */
+	apt_task_t             *task;
 	/** Engine channel base */
 	mrcp_engine_channel_t *channel;
 
@@ -110,9 +115,8 @@ struct xfyun_synth_channel_t {
 	apr_size_t             time_to_complete;
 	/** Is paused */
 	apt_bool_t             paused;
-	/** Speech source (used instead of actual synthesis) */
-
-	mpf_buffer_t          *audio_buffer;
+	/** Playout of synthesized audio */
+	mrcp_playout_t        *playout;
 
 };
 
@@ -153,24 +157,8 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	/* create xfyun engine */
 	xfyun_synth_engine_t *xfyun_engine = apr_palloc(pool,sizeof(xfyun_synth_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	/* create task/thread to run xfyun engine in the context of this task */
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(xfyun_synth_msg_t),pool);
-	xfyun_engine->task = apt_consumer_task_create(xfyun_engine,msg_pool,pool);
-	if(!xfyun_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(xfyun_engine->task);
-	apt_task_name_set(task,SYNTH_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = xfyun_synth_msg_process;
-		// vtable->on_pre_run = xfyun_synth_on_start;
-		// vtable->on_post_run = xfyun_synth_on_terminate;
-	}
+	xfyun_engine->worker_pool = NULL;
+	xfyun_engine->cache = NULL;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -183,12 +171,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy synthesizer engine */
 static apt_bool_t xfyun_synth_engine_destroy(mrcp_engine_t *engine)
 {
-	xfyun_synth_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_destroy(task);
-		xfyun_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -196,10 +178,13 @@ static apt_bool_t xfyun_synth_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t xfyun_synth_engine_open(mrcp_engine_t *engine)
 {
 	xfyun_synth_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_start(task);
+	/* create workers (threads) to process the requests of the channels */
+	xfyun_engine->worker_pool = mrcp_engine_worker_pool_create(engine,sizeof(xfyun_synth_msg_t),xfyun_synth_msg_process);
+	if(!xfyun_engine->worker_pool) {
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
+	xfyun_engine->cache = mrcp_engine_synth_cache_create(engine);
+	mrcp_worker_pool_start(xfyun_engine->worker_pool);
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
@@ -207,9 +192,13 @@ static apt_bool_t xfyun_synth_engine_open(mrcp_engine_t *engine)
 static apt_bool_t xfyun_synth_engine_close(mrcp_engine_t *engine)
 {
 	xfyun_synth_engine_t *xfyun_engine = engine->obj;
-	if(xfyun_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(xfyun_engine->worker_pool) {
+		mrcp_worker_pool_terminate(xfyun_engine->worker_pool);
+		xfyun_engine->worker_pool = NULL;
+	}
+	if(xfyun_engine->cache) {
+		mrcp_synth_cache_destroy(xfyun_engine->cache);
+		xfyun_engine->cache = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -224,11 +213,12 @@ static mrcp_engine_channel_t* xfyun_synth_engine_channel_create(mrcp_engine_t *e
 	/* create xfyun synth channel */
 	xfyun_synth_channel_t *synth_channel = apr_palloc(pool,sizeof(xfyun_synth_channel_t));
 	synth_channel->xfyun_engine = engine->obj;
+	synth_channel->task = mrcp_worker_pool_task_assign(synth_channel->xfyun_engine->worker_pool);
 	synth_channel->speak_request = NULL;
 	synth_channel->stop_response = NULL;
 	synth_channel->time_to_complete = 0;
 	synth_channel->paused = FALSE;
-	synth_channel->audio_buffer = NULL;
+	synth_channel->playout = NULL;
 	
 	capabilities = mpf_source_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -251,7 +241,10 @@ static mrcp_engine_channel_t* xfyun_synth_engine_channel_create(mrcp_engine_t *e
 			termination,          /* associated media termination */
 			pool);                /* pool to allocate memory from */
 
-	synth_channel->audio_buffer = mpf_buffer_create(pool);
+	synth_channel->playout = mrcp_engine_playout_create(engine,pool);
+	if(!synth_channel->playout) {
+		return NULL;
+	}
 	return synth_channel->channel;
 }
 
@@ -280,7 +273,19 @@ static apt_bool_t xfyun_synth_channel_request_process(mrcp_engine_channel_t *cha
 	return xfyun_synth_msg_signal(XFYUN_SYNTH_MSG_REQUEST_PROCESS,channel,request);
 }
 
-static apt_bool_t xfyun_synth_text_to_speech(const char* src_text, const char* params, mpf_buffer_t *buffer) {
+/** Write audio to the playout, waiting for the consumer to drain it (called from the task thread) */
+static apt_bool_t xfyun_synth_audio_write(mrcp_playout_t *playout, const void *data, apr_size_t size)
+{
+	apr_size_t written = mrcp_playout_audio_write_wait(playout, data, size, MRCP_PLAYOUT_DEFAULT_WRITE_TIMEOUT);
+	if(written < size) {
+		apt_log(APT_LOG_MARK, APT_PRIO_WARNING,"[xfyun] Audio Ring Overrun [%"APR_SIZE_T_FMT" bytes dropped]",
+			size - written);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t xfyun_synth_text_to_speech(const char* src_text, const char* params, mrcp_playout_t *playout) {
 	int ret = -1;
 	const char*  sessionID = NULL;
 	int synth_status = MSP_TTS_FLAG_STILL_HAVE_DATA;
@@ -308,7 +313,7 @@ static apt_bool_t xfyun_synth_text_to_speech(const char* src_text, const char* p
 			break;
 		if (NULL != data)
 		{
-			mpf_buffer_audio_write(buffer, data, audio_len);
+			xfyun_synth_audio_write(playout, data, audio_len);
 		}
 		if (MSP_TTS_FLAG_DATA_END == synth_status)
 			break;
@@ -349,6 +354,7 @@ static apt_bool_t xfyun_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp
 {
 	apt_log(APT_LOG_MARK, APT_PRIO_INFO, "[xfyun tts] process speak request");
 	apt_str_t *body;
+	apt_bool_t cached;
 	const char* session_begin_params = "voice_name = xiaoyan, text_encoding = utf8, sample_rate = 8000, speed = 50, volume = 50, pitch = 50, rdn = 2";
 	xfyun_synth_channel_t *synth_channel = channel->method_obj;
 	const mpf_codec_descriptor_t *descriptor = mrcp_engine_source_stream_codec_get(channel);
@@ -359,23 +365,36 @@ static apt_bool_t xfyun_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp
 		return FALSE;
 	}
 
-	synth_channel->speak_request = request;
-	body = &synth_channel->speak_request->body;
+	body = &request->body;
 	if(!body->length) {
-		synth_channel->speak_request = NULL;
 		synth_response_construct(response,MRCP_STATUS_CODE_MISSING_PARAM,SYNTHESIZER_COMPLETION_CAUSE_ERROR);
 		mrcp_engine_channel_message_send(synth_channel->channel,response);
 		return FALSE;
 	}
 
+	/* look up the cache (may access the disk) before the request is made active,
+	so that the MPF engine reads the audio from the right source from the first frame */
+	mrcp_playout_start(synth_channel->playout,descriptor);
+	cached = mrcp_playout_cache_lookup(synth_channel->playout,synth_channel->xfyun_engine->cache,request);
+
 	synth_channel->time_to_complete = 0;
 
 	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(channel,response);
+	synth_channel->speak_request = request;
 
-	xfyun_synth_text_to_speech(body->buf, session_begin_params, synth_channel->audio_buffer); 
-	mpf_buffer_event_write(synth_channel->audio_buffer, MEDIA_FRAME_TYPE_EVENT);
+	if(cached == TRUE) {
+		apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,"Play Synthesized Audio from Cache " APT_SIDRES_FMT,
+			MRCP_MESSAGE_SIDRES(request));
+		return TRUE;
+	}
+
+	if(xfyun_synth_text_to_speech(body->buf, session_begin_params, synth_channel->playout) == FALSE) {
+		/* don't cache the audio of a failed synthesis */
+		mrcp_playout_cache_discard(synth_channel->playout);
+	}
+	mrcp_playout_complete(synth_channel->playout);
 	return TRUE;
 }
 
@@ -579,9 +598,12 @@ static apt_bool_t xfyun_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_
 	if(synth_channel->stop_response) {
 		/* send asynchronous response to STOP request */
 		mrcp_engine_channel_message_send(synth_channel->channel,synth_channel->stop_response);
+		mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 		synth_channel->stop_response = NULL;
 		synth_channel->speak_request = NULL;
 		synth_channel->paused = FALSE;
+		/* discard the rest of the synthesized audio */
+		mrcp_playout_flush(synth_channel->playout);
 		return TRUE;
 	}
 
@@ -589,10 +611,11 @@ static apt_bool_t xfyun_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_
 	if(synth_channel->speak_request && synth_channel->paused == FALSE) {
 		// apt_log(APT_LOG_MARK, APT_PRIO_INFO, "[xfyun tts] read audio buffer to frame");
 		/* normal processing */
-		mpf_buffer_frame_read(synth_channel->audio_buffer,frame);
+		mrcp_playout_frame_read(synth_channel->playout,frame);
 			/* raise SPEAK-COMPLETE event */
 		if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
 			frame->type &= ~MEDIA_FRAME_TYPE_EVENT;
+			mrcp_playout_stats_log(synth_channel->playout,synth_channel->speak_request);
 			xfyun_synth_speak_complete_raise(synth_channel);
 		}
 	}
@@ -603,8 +626,7 @@ static apt_bool_t xfyun_synth_msg_signal(xfyun_synth_msg_type_e type, mrcp_engin
 {
 	apt_bool_t status = FALSE;
 	xfyun_synth_channel_t *xfyun_channel = channel->method_obj;
-	xfyun_synth_engine_t *xfyun_engine = xfyun_channel->xfyun_engine;
-	apt_task_t *task = apt_consumer_task_base_get(xfyun_engine->task);
+	apt_task_t *task = xfyun_channel->task;
 	apt_task_msg_t *msg = apt_task_msg_get(task);
 	if(msg) {
 		xfyun_synth_msg_t *xfyun_msg;
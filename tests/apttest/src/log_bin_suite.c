@@ -0,0 +1,165 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "apt_log_bin.h"
+
+#define LOG_BIN_TEST_BUFFER_SIZE 4096
+#define LOG_BIN_TEST_ITERATION_COUNT 1000000
+
+typedef struct log_bin_test_t log_bin_test_t;
+
+struct log_bin_test_t {
+	char         expected[LOG_BIN_TEST_BUFFER_SIZE];
+	char         encoded[LOG_BIN_TEST_BUFFER_SIZE];
+	char         rendered[LOG_BIN_TEST_BUFFER_SIZE];
+	apr_size_t   encoded_size;
+};
+
+/** Format the arguments as text, encode them as binary and compare the rendered text */
+static apt_bool_t log_bin_test_check(log_bin_test_t *test, const char *format, ...)
+{
+	apt_log_bin_arg_t args[APT_LOG_BIN_MAX_ARG_COUNT];
+	int count = apt_log_bin_format_compile(format,args,APT_LOG_BIN_MAX_ARG_COUNT);
+	va_list arg_ptr;
+	if(count < 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Compile Format [%s]",format);
+		return FALSE;
+	}
+
+	va_start(arg_ptr,format);
+	apr_vsnprintf(test->expected,sizeof(test->expected),format,arg_ptr);
+	va_end(arg_ptr);
+
+	va_start(arg_ptr,format);
+	test->encoded_size = apt_log_bin_args_encode(args,count,test->encoded,sizeof(test->encoded),arg_ptr);
+	va_end(arg_ptr);
+
+	apt_log_bin_args_render(format,test->encoded,test->encoded_size,test->rendered,sizeof(test->rendered));
+	if(strcmp(test->expected,test->rendered) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Render Mismatch [%s]: expected [%s] rendered [%s]",
+			format,test->expected,test->rendered);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t log_bin_roundtrip_test(log_bin_test_t *test)
+{
+	apt_str_t sid;
+	const char *name = "Recognizer";
+
+	if(log_bin_test_check(test,"Process %s Request " APT_SIDRES_FMT " [%d]","RECOGNIZE","1a2b3c4d","speechrecog",1) == FALSE ||
+		log_bin_test_check(test,"Sizes %"APR_SIZE_T_FMT" %"APR_SSIZE_T_FMT" %u %ld %lu",
+			(apr_size_t)12345,(apr_ssize_t)-7,4000000000u,-1234567L,9876543UL) == FALSE ||
+		log_bin_test_check(test,"Int64 %"APR_INT64_T_FMT" %"APR_UINT64_T_HEX_FMT,
+			(apr_int64_t)-1234567890123LL,(apr_uint64_t)0xdeadbeefcafeULL) == FALSE ||
+		log_bin_test_check(test,"Flags [%-8s] [%8s] [%05d] [%+d] [%x] [%X] [%o] [%c] [%%]",
+			name,name,42,42,255,255,8,'A') == FALSE ||
+		log_bin_test_check(test,"Star [%*d] [%-*d] [%.*s] [%*.*s]",6,42,6,42,3,name,8,4,name) == FALSE ||
+		log_bin_test_check(test,"Precision [%.3s] [%.2f] [%e] [%g]",name,3.14159,1234.5,0.001) == FALSE ||
+		log_bin_test_check(test,"Pointer " APT_PTR_FMT,(unsigned long)0x7f001234) == FALSE ||
+		log_bin_test_check(test,"Null [%s]",(const char*)NULL) == FALSE) {
+		return FALSE;
+	}
+
+	if(log_bin_test_check(test,"Session " APT_NAMESIDRES_FMT,name,"5e6f","speechsynth") == FALSE ||
+		apt_log_bin_sid_get("Session " APT_NAMESIDRES_FMT,test->encoded,test->encoded_size,&sid) == FALSE ||
+		sid.length != 4 || strncmp(sid.buf,"5e6f",4) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Session Id");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apr_size_t log_bin_encode(const apt_log_bin_arg_t *args, int count, char *buf, apr_size_t size, ...)
+{
+	apr_size_t encoded_size;
+	va_list arg_ptr;
+	va_start(arg_ptr,size);
+	encoded_size = apt_log_bin_args_encode(args,count,buf,size,arg_ptr);
+	va_end(arg_ptr);
+	return encoded_size;
+}
+
+static apr_size_t log_bin_format(char *buf, apr_size_t size, const char *format, ...)
+{
+	apr_size_t length;
+	va_list arg_ptr;
+	va_start(arg_ptr,format);
+	length = apr_vsnprintf(buf,size,format,arg_ptr);
+	va_end(arg_ptr);
+	return length;
+}
+
+/** Compare the cost of encoding typical log arguments to the cost of formatting them */
+static void log_bin_benchmark(log_bin_test_t *test, apr_size_t iterations)
+{
+	static const char format[] = "Process %s Request " APT_SIDRES_FMT " [%"APR_SIZE_T_FMT"] %d bytes";
+	apt_log_bin_arg_t args[APT_LOG_BIN_MAX_ARG_COUNT];
+	int count = apt_log_bin_format_compile(format,args,APT_LOG_BIN_MAX_ARG_COUNT);
+	apr_time_t start;
+	apr_interval_time_t format_time;
+	apr_interval_time_t encode_time;
+	apr_size_t i;
+
+	start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		log_bin_format(test->expected,sizeof(test->expected),format,"RECOGNIZE","1a2b3c4d5e6f7a8b","speechrecog",i,1024);
+	}
+	format_time = apr_time_now() - start;
+
+	start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		log_bin_encode(args,count,test->encoded,sizeof(test->encoded),"RECOGNIZE","1a2b3c4d5e6f7a8b","speechrecog",i,1024);
+	}
+	encode_time = apr_time_now() - start;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Format %.1f nsec/entry, Encode %.1f nsec/entry [%"APR_SIZE_T_FMT" entries]",
+		(double)format_time * 1000 / iterations,
+		(double)encode_time * 1000 / iterations,
+		iterations);
+}
+
+static apt_bool_t log_bin_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_size_t iterations = LOG_BIN_TEST_ITERATION_COUNT;
+	log_bin_test_t *test = apr_palloc(suite->pool,sizeof(log_bin_test_t));
+
+	if(argc > 0) {
+		int value = atoi(argv[0]);
+		if(value > 0) {
+			iterations = value;
+		}
+	}
+
+	if(log_bin_roundtrip_test(test) == FALSE) {
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Binary Log Round-Trip Passed");
+
+	log_bin_benchmark(test,iterations);
+	return TRUE;
+}
+
+apt_test_suite_t* log_bin_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"logbin",NULL,log_bin_test_run);
+	return suite;
+}
@@ -20,6 +20,9 @@
 apt_test_suite_t* task_test_suite_create(apr_pool_t *pool);
 apt_test_suite_t* consumer_task_test_suite_create(apr_pool_t *pool);
 apt_test_suite_t* multipart_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* msg_queue_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* log_bin_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* pool_cache_test_suite_create(apr_pool_t *pool);
 
 int main(int argc, const char * const *argv)
 {
@@ -46,6 +49,15 @@ int main(int argc, const char * const *argv)
 	test_suite = multipart_test_suite_create(pool);
 	apt_test_framework_suite_add(test_framework,test_suite);
 
+	test_suite = msg_queue_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = log_bin_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = pool_cache_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
 	/* run tests */
 	apt_test_framework_run(test_framework,argc,argv);
 
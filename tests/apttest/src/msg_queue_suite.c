@@ -0,0 +1,207 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <apr_time.h>
+#include <apr_queue.h>
+#include <apr_thread_proc.h>
+#include "apt_test_suite.h"
+#include "apt_mpsc_queue.h"
+#include "apt_log.h"
+
+/** Default number of messages sent by each producer */
+#define MSG_QUEUE_TEST_MESSAGE_COUNT  100000
+/** Default number of producers */
+#define MSG_QUEUE_TEST_PRODUCER_COUNT 4
+
+typedef struct msg_queue_bench_t msg_queue_bench_t;
+
+/** Message queue benchmark (one consumer, many producers) */
+struct msg_queue_bench_t {
+	/** Name of the implementation */
+	const char          *name;
+	/** Pool of task messages */
+	apt_task_msg_pool_t *msg_pool;
+	/** Legacy queue */
+	apr_queue_t         *apr_queue;
+	/** MPSC queue */
+	apt_mpsc_queue_t    *mpsc_queue;
+	/** Number of messages sent by each producer */
+	apr_size_t           message_count;
+};
+
+typedef struct {
+	apr_time_t timestamp;
+} bench_msg_data_t;
+
+static apt_bool_t msg_queue_bench_push(msg_queue_bench_t *bench, apt_task_msg_t *msg)
+{
+	if(bench->mpsc_queue) {
+		return apt_mpsc_queue_push(bench->mpsc_queue,msg);
+	}
+	return apr_queue_push(bench->apr_queue,msg) == APR_SUCCESS ? TRUE : FALSE;
+}
+
+static apt_task_msg_t* msg_queue_bench_pop(msg_queue_bench_t *bench)
+{
+	void *msg = NULL;
+	if(bench->mpsc_queue) {
+		apt_task_msg_t *task_msg = NULL;
+		apt_mpsc_queue_pop(bench->mpsc_queue,-1,&task_msg);
+		return task_msg;
+	}
+	if(apr_queue_pop(bench->apr_queue,&msg) != APR_SUCCESS) {
+		return NULL;
+	}
+	return msg;
+}
+
+static void* APR_THREAD_FUNC msg_queue_producer_run(apr_thread_t *thread, void *data)
+{
+	msg_queue_bench_t *bench = data;
+	apt_task_msg_t *msg;
+	bench_msg_data_t *msg_data;
+	apr_size_t i;
+	for(i=0; i<bench->message_count; i++) {
+		msg = apt_task_msg_acquire(bench->msg_pool);
+		msg_data = (bench_msg_data_t*)msg->data;
+		msg_data->timestamp = apr_time_now();
+		if(msg_queue_bench_push(bench,msg) == FALSE) {
+			apt_task_msg_release(msg);
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static int msg_queue_latency_compare(const void *left, const void *right)
+{
+	apr_interval_time_t l = *(const apr_interval_time_t*)left;
+	apr_interval_time_t r = *(const apr_interval_time_t*)right;
+	return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+/** Run producers against the consumer (the calling thread) and report throughput and latency */
+static apt_bool_t msg_queue_bench_run(msg_queue_bench_t *bench, apr_size_t producer_count, apr_pool_t *pool)
+{
+	apr_thread_t **thread_arr;
+	apr_interval_time_t *latency_arr;
+	apr_size_t total = bench->message_count * producer_count;
+	apr_size_t received = 0;
+	apr_size_t i;
+	apt_task_msg_t *msg;
+	apr_status_t retval;
+	apr_time_t start;
+	apr_interval_time_t elapsed;
+
+	thread_arr = apr_palloc(pool,sizeof(apr_thread_t*) * producer_count);
+	latency_arr = apr_palloc(pool,sizeof(apr_interval_time_t) * total);
+
+	start = apr_time_now();
+	for(i=0; i<producer_count; i++) {
+		if(apr_thread_create(&thread_arr[i],NULL,msg_queue_producer_run,bench,pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Producer Thread");
+			return FALSE;
+		}
+	}
+
+	while(received < total) {
+		msg = msg_queue_bench_pop(bench);
+		if(!msg) {
+			continue;
+		}
+		latency_arr[received++] = apr_time_now() - ((bench_msg_data_t*)msg->data)->timestamp;
+		apt_task_msg_release(msg);
+	}
+	elapsed = apr_time_now() - start;
+
+	for(i=0; i<producer_count; i++) {
+		apr_thread_join(&retval,thread_arr[i]);
+	}
+
+	qsort(latency_arr,total,sizeof(apr_interval_time_t),msg_queue_latency_compare);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,
+		"%-7s %"APR_SIZE_T_FMT" producers: %.0f msgs/sec, latency usec p50 %"APR_INT64_T_FMT" p90 %"APR_INT64_T_FMT" p99 %"APR_INT64_T_FMT" max %"APR_INT64_T_FMT,
+		bench->name,
+		producer_count,
+		elapsed > 0 ? (double)total * APR_USEC_PER_SEC / elapsed : 0.0,
+		(apr_int64_t)latency_arr[total / 2],
+		(apr_int64_t)latency_arr[total * 90 / 100],
+		(apr_int64_t)latency_arr[total * 99 / 100],
+		(apr_int64_t)latency_arr[total - 1]);
+	return TRUE;
+}
+
+static apt_bool_t msg_queue_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	msg_queue_bench_t legacy;
+	msg_queue_bench_t mpsc;
+	apr_size_t message_count = MSG_QUEUE_TEST_MESSAGE_COUNT;
+	apr_size_t producer_count = MSG_QUEUE_TEST_PRODUCER_COUNT;
+	apr_size_t count;
+
+	if(argc > 0 && atoi(argv[0]) > 0) {
+		message_count = atoi(argv[0]);
+	}
+	if(argc > 1 && atoi(argv[1]) > 0) {
+		producer_count = atoi(argv[1]);
+	}
+
+	/* the implementation used so far: apr_queue_t and malloc/free of every message */
+	legacy.name = "legacy";
+	legacy.msg_pool = apt_task_msg_pool_create_dynamic(sizeof(bench_msg_data_t),suite->pool);
+	legacy.mpsc_queue = NULL;
+	legacy.message_count = message_count;
+	if(apr_queue_create(&legacy.apr_queue,1024,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Queue");
+		return FALSE;
+	}
+
+	/* lock-free queue and per-thread cached messages */
+	mpsc.name = "mpsc";
+	mpsc.msg_pool = apt_task_msg_pool_create_cached(sizeof(bench_msg_data_t),suite->pool);
+	mpsc.apr_queue = NULL;
+	mpsc.message_count = message_count;
+	mpsc.mpsc_queue = apt_mpsc_queue_create(suite->pool);
+	if(!mpsc.msg_pool || !mpsc.mpsc_queue) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create MPSC Queue");
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Message Queue Benchmark [%"APR_SIZE_T_FMT" msgs per producer]",message_count);
+	for(count=1; ; count*=2) {
+		if(count > producer_count) {
+			count = producer_count;
+		}
+		if(msg_queue_bench_run(&legacy,count,suite->pool) == FALSE) {
+			return FALSE;
+		}
+		if(msg_queue_bench_run(&mpsc,count,suite->pool) == FALSE) {
+			return FALSE;
+		}
+		if(count == producer_count) {
+			break;
+		}
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* msg_queue_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"msgqueue",NULL,msg_queue_test_run);
+	return suite;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+/** Max number of pools kept in the cache */
+#define POOL_CACHE_TEST_MAX_COUNT    8
+/** Number of pools created in advance */
+#define POOL_CACHE_TEST_INIT_COUNT   4
+/** Size of memory to preallocate per pool */
+#define POOL_CACHE_TEST_POOL_SIZE    (64 * 1024)
+/** Number of allocations per session (a typical session allocates several KB in small chunks) */
+#define POOL_CACHE_TEST_ALLOC_COUNT  64
+/** Size of an allocation */
+#define POOL_CACHE_TEST_ALLOC_SIZE   256
+/** Default number of iterations (sessions) */
+#define POOL_CACHE_TEST_ITERATION_COUNT 100000
+
+static apr_status_t pool_cache_test_cleanup(void *data)
+{
+	apr_size_t *count = data;
+	(*count)++;
+	return APR_SUCCESS;
+}
+
+static void pool_cache_test_use(apr_pool_t *pool)
+{
+	apr_size_t i;
+	for(i=0; i<POOL_CACHE_TEST_ALLOC_COUNT; i++) {
+		apr_palloc(pool,POOL_CACHE_TEST_ALLOC_SIZE);
+	}
+}
+
+/** Verify the free list bounds, the reuse of pools and the statistics */
+static apt_bool_t pool_cache_test_verify(apr_pool_t *pool)
+{
+	apr_pool_t *pool_arr[POOL_CACHE_TEST_MAX_COUNT * 2];
+	apt_pool_cache_stat_t stat;
+	apr_size_t cleanup_count = 0;
+	apr_size_t i;
+	apt_pool_cache_t *cache = apt_pool_cache_create(
+								POOL_CACHE_TEST_MAX_COUNT,
+								POOL_CACHE_TEST_INIT_COUNT,
+								POOL_CACHE_TEST_POOL_SIZE,
+								pool);
+	if(!cache) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pool Cache");
+		return FALSE;
+	}
+
+	apt_pool_cache_stat_get(cache,&stat);
+	if(stat.free_count != POOL_CACHE_TEST_INIT_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Free Count [%"APR_SIZE_T_FMT"]",stat.free_count);
+		return FALSE;
+	}
+
+	for(i=0; i<POOL_CACHE_TEST_MAX_COUNT * 2; i++) {
+		pool_arr[i] = apt_pool_cache_acquire(cache);
+		if(!pool_arr[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Acquire Pool");
+			return FALSE;
+		}
+		pool_cache_test_use(pool_arr[i]);
+		apr_pool_cleanup_register(pool_arr[i],&cleanup_count,pool_cache_test_cleanup,apr_pool_cleanup_null);
+	}
+	for(i=0; i<POOL_CACHE_TEST_MAX_COUNT * 2; i++) {
+		apt_pool_cache_release(cache,pool_arr[i]);
+	}
+
+	apt_pool_cache_stat_get(cache,&stat);
+	if(cleanup_count != POOL_CACHE_TEST_MAX_COUNT * 2 ||
+		stat.busy_count != 0 ||
+		stat.busy_high_water != POOL_CACHE_TEST_MAX_COUNT * 2 ||
+		stat.free_count != POOL_CACHE_TEST_MAX_COUNT ||
+		stat.hit_count != POOL_CACHE_TEST_INIT_COUNT ||
+		stat.miss_count != POOL_CACHE_TEST_MAX_COUNT * 2 - POOL_CACHE_TEST_INIT_COUNT ||
+		stat.discard_count != POOL_CACHE_TEST_MAX_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Statistics: cleanups %"APR_SIZE_T_FMT
+			" free %"APR_SIZE_T_FMT" busy %"APR_SIZE_T_FMT" high-water %"APR_SIZE_T_FMT
+			" hits %"APR_SIZE_T_FMT" misses %"APR_SIZE_T_FMT" discards %"APR_SIZE_T_FMT,
+			cleanup_count,
+			stat.free_count,
+			stat.busy_count,
+			stat.busy_high_water,
+			stat.hit_count,
+			stat.miss_count,
+			stat.discard_count);
+		return FALSE;
+	}
+
+	/* the pool released last is reused first */
+	if(apt_pool_cache_acquire(cache) != pool_arr[POOL_CACHE_TEST_MAX_COUNT - 1]) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Pool Is Not Reused");
+		return FALSE;
+	}
+	apt_pool_cache_release(cache,pool_arr[POOL_CACHE_TEST_MAX_COUNT - 1]);
+
+	/* the cached pools are destroyed ahead of the pool of the cache */
+	apt_pool_cache_destroy(cache);
+	return TRUE;
+}
+
+/** Measure the cost of a session pool created and destroyed per session */
+static double pool_create_measure(apr_size_t iterations)
+{
+	apr_size_t i;
+	apr_pool_t *pool;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		pool = apt_pool_create();
+		pool_cache_test_use(pool);
+		apr_pool_destroy(pool);
+	}
+	elapsed = apr_time_now() - start;
+	return (double)elapsed * 1000 / iterations;
+}
+
+/** Measure the cost of a session pool acquired from and released to the cache */
+static double pool_cache_measure(apt_pool_cache_t *cache, apr_size_t iterations)
+{
+	apr_size_t i;
+	apr_pool_t *pool;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		pool = apt_pool_cache_acquire(cache);
+		pool_cache_test_use(pool);
+		apt_pool_cache_release(cache,pool);
+	}
+	elapsed = apr_time_now() - start;
+	return (double)elapsed * 1000 / iterations;
+}
+
+static apt_bool_t pool_cache_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_size_t iterations = POOL_CACHE_TEST_ITERATION_COUNT;
+	apt_pool_cache_t *cache;
+
+	if(argc > 0) {
+		int value = atoi(argv[0]);
+		if(value > 0) {
+			iterations = value;
+		}
+	}
+
+	if(pool_cache_test_verify(suite->pool) == FALSE) {
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Pool Cache Verification Passed");
+
+	cache = apt_pool_cache_create(POOL_CACHE_TEST_MAX_COUNT,1,POOL_CACHE_TEST_POOL_SIZE,suite->pool);
+	if(!cache) {
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Session Pool Benchmark [%"APR_SIZE_T_FMT" sessions x %d bytes]",
+		iterations,POOL_CACHE_TEST_ALLOC_COUNT * POOL_CACHE_TEST_ALLOC_SIZE);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create/Destroy %.1f nsec/session, Acquire/Release %.1f nsec/session",
+		pool_create_measure(iterations),
+		pool_cache_measure(cache,iterations));
+	apt_pool_cache_destroy(cache);
+	return TRUE;
+}
+
+apt_test_suite_t* pool_cache_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"poolcache",NULL,pool_cache_test_run);
+	return suite;
+}
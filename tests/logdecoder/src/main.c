@@ -0,0 +1,294 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <apr_hash.h>
+#include <apr_time.h>
+#include "apt_pool.h"
+#include "apt_log.h"
+#include "apt_log_bin.h"
+
+#define MAX_MESSAGE_SIZE (16 * 1024)
+
+/** Call site defined by the format record */
+typedef struct log_format_t log_format_t;
+
+struct log_format_t {
+	apr_uint32_t  line;
+	const char   *source;
+	const char   *file;
+	const char   *format;
+};
+
+static const char *priority_names[APT_PRIO_COUNT] = {
+	"EMERG",
+	"ALERT",
+	"CRITIC",
+	"ERROR",
+	"WARN",
+	"NOTICE",
+	"INFO",
+	"DEBUG"
+};
+
+static char message_buffer[MAX_MESSAGE_SIZE];
+
+static char* log_file_read(const char *path, apr_size_t *size, apr_pool_t *pool)
+{
+	char *data;
+	long length;
+	FILE *file = fopen(path, "rb");
+	if(!file) {
+		fprintf(stderr,"cannot open file %s\n",path);
+		return NULL;
+	}
+
+	fseek(file,0,SEEK_END);
+	length = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if(length < 0) {
+		fclose(file);
+		return NULL;
+	}
+
+	data = apr_palloc(pool,length + 1);
+	*size = fread(data,1,length,file);
+	fclose(file);
+	return data;
+}
+
+static apt_bool_t log_file_header_check(const char *path, const char *data, apr_size_t size)
+{
+	apt_log_bin_file_header_t header;
+	if(size < sizeof(header)) {
+		fprintf(stderr,"%s: not a binary log file\n",path);
+		return FALSE;
+	}
+
+	memcpy(&header,data,sizeof(header));
+	if(memcmp(header.magic,APT_LOG_BIN_MAGIC,sizeof(APT_LOG_BIN_MAGIC)) != 0) {
+		fprintf(stderr,"%s: not a binary log file\n",path);
+		return FALSE;
+	}
+	if(header.byte_order != APT_LOG_BIN_BYTE_ORDER) {
+		fprintf(stderr,"%s: byte order mismatch\n",path);
+		return FALSE;
+	}
+	if(header.version != APT_LOG_BIN_VERSION) {
+		fprintf(stderr,"%s: unsupported version %u\n",path,header.version);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Get the next record, FALSE at the end or if the record is corrupted */
+static apt_bool_t log_record_next(const char *data, apr_size_t size, apr_size_t *offset, apt_log_bin_record_t *record)
+{
+	if(size - *offset < sizeof(apt_log_bin_record_t)) {
+		return FALSE;
+	}
+	memcpy(record,data + *offset,sizeof(apt_log_bin_record_t));
+	if(record->size < sizeof(apt_log_bin_record_t) || record->size > size - *offset) {
+		fprintf(stderr,"corrupted record at offset %"APR_SIZE_T_FMT"\n",*offset);
+		return FALSE;
+	}
+	*offset += record->size;
+	return TRUE;
+}
+
+/** Load the format records, which may follow the entries referring to them */
+static apr_hash_t* log_formats_load(const char *data, apr_size_t size, apr_pool_t *pool)
+{
+	apt_log_bin_record_t record;
+	log_format_t *format;
+	apr_uint32_t *id;
+	const char *payload;
+	const char *end;
+	apr_size_t offset = sizeof(apt_log_bin_file_header_t);
+	apr_hash_t *formats = apr_hash_make(pool);
+
+	while(log_record_next(data,size,&offset,&record) == TRUE) {
+		if(record.type != APT_LOG_BIN_RECORD_FORMAT) {
+			continue;
+		}
+
+		payload = data + offset - record.size + sizeof(apt_log_bin_record_t);
+		end = data + offset;
+		if(end - payload < (long)sizeof(apr_uint32_t) + 3 || *(end - 1) != '\0') {
+			continue;
+		}
+
+		format = apr_palloc(pool,sizeof(log_format_t));
+		memcpy(&format->line,payload,sizeof(apr_uint32_t));
+		format->source = payload + sizeof(apr_uint32_t);
+		format->file = format->source + strlen(format->source) + 1;
+		format->format = format->file + strlen(format->file) + 1;
+		if(format->format >= end) {
+			continue;
+		}
+
+		id = apr_palloc(pool,sizeof(apr_uint32_t));
+		*id = record.format_id;
+		apr_hash_set(formats,id,sizeof(apr_uint32_t),format);
+	}
+	return formats;
+}
+
+static void json_string_write(const char *str, apr_size_t length)
+{
+	apr_size_t i;
+	unsigned char ch;
+	putchar('"');
+	for(i=0; i<length; i++) {
+		ch = (unsigned char)str[i];
+		switch(ch) {
+			case '"':  fputs("\\\"",stdout); break;
+			case '\\': fputs("\\\\",stdout); break;
+			case '\n': fputs("\\n",stdout); break;
+			case '\r': fputs("\\r",stdout); break;
+			case '\t': fputs("\\t",stdout); break;
+			default:
+				if(ch < 0x20) {
+					printf("\\u%04x",ch);
+				}
+				else {
+					putchar(ch);
+				}
+				break;
+		}
+	}
+	putchar('"');
+}
+
+static void log_entry_write(const apt_log_bin_record_t *record, const log_format_t *format, const char *payload, apr_size_t payload_size, apt_bool_t json)
+{
+	apr_time_exp_t result;
+	apr_size_t length;
+	apt_str_t sid;
+	const char *priority = record->priority < APT_PRIO_COUNT ? priority_names[record->priority] : "UNKNOWN";
+
+	if(format) {
+		length = apt_log_bin_args_render(format->format,payload,payload_size,message_buffer,sizeof(message_buffer));
+	}
+	else {
+		for(length = 0; length < payload_size && length < sizeof(message_buffer) - 1 && payload[length]; length++) {
+			message_buffer[length] = payload[length];
+		}
+		message_buffer[length] = '\0';
+	}
+
+	apr_time_exp_lt(&result,record->timestamp);
+	if(json == FALSE) {
+		printf("%4d-%02d-%02d %02d:%02d:%02d:%06d %05u [%s] ",
+			result.tm_year+1900,result.tm_mon+1,result.tm_mday,
+			result.tm_hour,result.tm_min,result.tm_sec,result.tm_usec,
+			record->thread_id,priority);
+		if(format) {
+			printf("%s %s:%u ",format->source,format->file,format->line);
+		}
+		printf("%s\n",message_buffer);
+		return;
+	}
+
+	printf("{\"time\":\"%4d-%02d-%02dT%02d:%02d:%02d.%06d\",\"timestamp\":%"APR_INT64_T_FMT",\"priority\":\"%s\",\"thread\":%u",
+		result.tm_year+1900,result.tm_mon+1,result.tm_mday,
+		result.tm_hour,result.tm_min,result.tm_sec,result.tm_usec,
+		record->timestamp,priority,record->thread_id);
+	if(format) {
+		printf(",\"source\":");
+		json_string_write(format->source,strlen(format->source));
+		printf(",\"file\":");
+		json_string_write(format->file,strlen(format->file));
+		printf(",\"line\":%u",format->line);
+		if(apt_log_bin_sid_get(format->format,payload,payload_size,&sid) == TRUE) {
+			printf(",\"sid\":");
+			json_string_write(sid.buf,sid.length);
+		}
+	}
+	if(record->obj) {
+		printf(",\"obj\":\"0x%"APR_UINT64_T_HEX_FMT"\"",record->obj);
+	}
+	printf(",\"message\":");
+	json_string_write(message_buffer,length);
+	printf("}\n");
+}
+
+static apt_bool_t log_file_decode(const char *path, apt_bool_t json, apr_pool_t *pool)
+{
+	apt_log_bin_record_t record;
+	apr_hash_t *formats;
+	const log_format_t *format;
+	const char *payload;
+	apr_size_t offset = sizeof(apt_log_bin_file_header_t);
+	apr_size_t size = 0;
+	const char *data = log_file_read(path,&size,pool);
+	if(!data || log_file_header_check(path,data,size) == FALSE) {
+		return FALSE;
+	}
+
+	formats = log_formats_load(data,size,pool);
+	while(log_record_next(data,size,&offset,&record) == TRUE) {
+		payload = data + offset - record.size + sizeof(apt_log_bin_record_t);
+		if(record.type == APT_LOG_BIN_RECORD_ENTRY) {
+			format = apr_hash_get(formats,&record.format_id,sizeof(apr_uint32_t));
+			if(!format) {
+				fprintf(stderr,"undefined format %u at offset %"APR_SIZE_T_FMT"\n",record.format_id,offset - record.size);
+				continue;
+			}
+			log_entry_write(&record,format,payload,record.size - sizeof(apt_log_bin_record_t),json);
+		}
+		else if(record.type == APT_LOG_BIN_RECORD_TEXT) {
+			log_entry_write(&record,NULL,payload,record.size - sizeof(apt_log_bin_record_t),json);
+		}
+	}
+	return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+	apr_pool_t *pool = NULL;
+	apt_bool_t json = FALSE;
+	int i = 1;
+
+	/* one time apr global initialization */
+	if(apr_initialize() != APR_SUCCESS) {
+		return 0;
+	}
+	pool = apt_pool_create();
+
+	if(argc > 1 && strcmp(argv[1],"-j") == 0) {
+		json = TRUE;
+		i++;
+	}
+	if(i >= argc) {
+		printf("usage: logdecoder [-j] file.log [file.log ...]\n");
+		printf("  -j  output JSON (one object per line) instead of text\n");
+		apr_pool_destroy(pool);
+		apr_terminate();
+		return 0;
+	}
+
+	for(; i<argc; i++) {
+		log_file_decode(argv[i],json,pool);
+		apr_pool_clear(pool);
+	}
+
+	apr_pool_destroy(pool);
+	/* final apr global termination */
+	apr_terminate();
+	return 0;
+}
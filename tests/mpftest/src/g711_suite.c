@@ -0,0 +1,236 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "g711/g711.h"
+
+/** Number of samples processed per iteration (1 sec of 8kHz audio) */
+#define G711_TEST_SAMPLE_COUNT   8000
+/** Default number of iterations */
+#define G711_TEST_ITERATION_COUNT 1000
+
+typedef void (*g711_encode_f)(apr_byte_t *encoded, const apr_int16_t *linear, apr_size_t count);
+typedef void (*g711_decode_f)(apr_int16_t *linear, const apr_byte_t *encoded, apr_size_t count);
+
+/** Reference per-sample u-law encoder */
+static void ulaw_encode_generic(apr_byte_t *ulaw, const apr_int16_t *linear, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		ulaw[i] = linear_to_ulaw(linear[i]);
+	}
+}
+
+/** Reference per-sample u-law decoder */
+static void ulaw_decode_generic(apr_int16_t *linear, const apr_byte_t *ulaw, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		linear[i] = ulaw_to_linear(ulaw[i]);
+	}
+}
+
+/** Reference per-sample A-law encoder */
+static void alaw_encode_generic(apr_byte_t *alaw, const apr_int16_t *linear, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		alaw[i] = linear_to_alaw(linear[i]);
+	}
+}
+
+/** Reference per-sample A-law decoder */
+static void alaw_decode_generic(apr_int16_t *linear, const apr_byte_t *alaw, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		linear[i] = alaw_to_linear(alaw[i]);
+	}
+}
+
+/** Measure the throughput of an encoder in samples per second */
+static double g711_encode_measure(g711_encode_f encode, apr_byte_t *encoded, const apr_int16_t *linear, apr_size_t iterations)
+{
+	apr_size_t i;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		encode(encoded,linear,G711_TEST_SAMPLE_COUNT);
+	}
+	elapsed = apr_time_now() - start;
+	if(elapsed <= 0) {
+		elapsed = 1;
+	}
+	return (double)iterations * G711_TEST_SAMPLE_COUNT * APR_USEC_PER_SEC / elapsed;
+}
+
+/** Measure the throughput of a decoder in samples per second */
+static double g711_decode_measure(g711_decode_f decode, apr_int16_t *linear, const apr_byte_t *encoded, apr_size_t iterations)
+{
+	apr_size_t i;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		decode(linear,encoded,G711_TEST_SAMPLE_COUNT);
+	}
+	elapsed = apr_time_now() - start;
+	if(elapsed <= 0) {
+		elapsed = 1;
+	}
+	return (double)iterations * G711_TEST_SAMPLE_COUNT * APR_USEC_PER_SEC / elapsed;
+}
+
+/** Verify and benchmark a pair of the generic and block codec routines */
+static apt_bool_t g711_codec_test(
+					const char *name,
+					g711_encode_f encode_generic,
+					g711_encode_f encode_block,
+					g711_decode_f decode_generic,
+					g711_decode_f decode_block,
+					const apr_int16_t *linear,
+					apr_size_t iterations,
+					apr_pool_t *pool)
+{
+	apr_size_t i;
+	apr_byte_t code;
+	apr_byte_t *encoded_generic = apr_palloc(pool,G711_TEST_SAMPLE_COUNT);
+	apr_byte_t *encoded_block = apr_palloc(pool,G711_TEST_SAMPLE_COUNT);
+	apr_int16_t *decoded_generic = apr_palloc(pool,G711_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+	apr_int16_t *decoded_block = apr_palloc(pool,G711_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+	apr_int16_t sample;
+	apr_byte_t code_generic;
+	apr_byte_t code_block;
+	apr_int16_t linear_generic;
+	apr_int16_t linear_block;
+	double generic_rate;
+	double block_rate;
+
+	/* verify the whole linear range against the reference encoder */
+	for(i=0; i<=0xFFFF; i++) {
+		sample = (apr_int16_t)i;
+		encode_generic(&code_generic,&sample,1);
+		encode_block(&code_block,&sample,1);
+		if(code_generic != code_block) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"%s Encode Mismatch [%d]: %02x != %02x",
+				name,sample,code_block,code_generic);
+			return FALSE;
+		}
+	}
+
+	/* verify all the codes against the reference decoder */
+	for(i=0; i<=0xFF; i++) {
+		code = (apr_byte_t)i;
+		decode_generic(&linear_generic,&code,1);
+		decode_block(&linear_block,&code,1);
+		if(linear_generic != linear_block) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"%s Decode Mismatch [%02x]: %d != %d",
+				name,code,linear_block,linear_generic);
+			return FALSE;
+		}
+	}
+
+	generic_rate = g711_encode_measure(encode_generic,encoded_generic,linear,iterations);
+	block_rate = g711_encode_measure(encode_block,encoded_block,linear,iterations);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"%s Encode: generic %.0f samples/s, block %.0f samples/s",
+		name,generic_rate,block_rate);
+	if(memcmp(encoded_generic,encoded_block,G711_TEST_SAMPLE_COUNT) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"%s Encoded Output Mismatch",name);
+		return FALSE;
+	}
+
+	generic_rate = g711_decode_measure(decode_generic,decoded_generic,encoded_generic,iterations);
+	block_rate = g711_decode_measure(decode_block,decoded_block,encoded_generic,iterations);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"%s Decode: generic %.0f samples/s, block %.0f samples/s",
+		name,generic_rate,block_rate);
+	if(memcmp(decoded_generic,decoded_block,G711_TEST_SAMPLE_COUNT * sizeof(apr_int16_t)) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"%s Decoded Output Mismatch",name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Verify the block u-law/A-law transcoders against the per-sample ones */
+static apt_bool_t g711_transcode_test(void)
+{
+	apr_size_t i;
+	apr_byte_t codes[256];
+	apr_byte_t alaw[256];
+	apr_byte_t ulaw[256];
+
+	for(i=0; i<256; i++) {
+		codes[i] = (apr_byte_t)i;
+	}
+
+	ulaw_to_alaw_block(alaw,codes,256);
+	alaw_to_ulaw_block(ulaw,codes,256);
+	for(i=0; i<256; i++) {
+		if(alaw[i] != ulaw_to_alaw(codes[i]) || ulaw[i] != alaw_to_ulaw(codes[i])) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Transcode Mismatch [%02x]",codes[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static apt_bool_t g711_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_size_t i;
+	apr_size_t iterations = G711_TEST_ITERATION_COUNT;
+	apr_int16_t *linear;
+	unsigned int seed = 1;
+
+	if(argc > 0) {
+		int value = atoi(argv[0]);
+		if(value > 0) {
+			iterations = value;
+		}
+	}
+
+	g711_tables_init();
+
+	/* generate pseudo-random samples covering the whole linear range */
+	linear = apr_palloc(suite->pool,G711_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+	for(i=0; i<G711_TEST_SAMPLE_COUNT; i++) {
+		seed = seed * 1103515245 + 12345;
+		linear[i] = (apr_int16_t)(seed >> 16);
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run G.711 Benchmark [%"APR_SIZE_T_FMT" x %d samples]",
+		iterations,G711_TEST_SAMPLE_COUNT);
+	if(g711_codec_test("PCMU",
+			ulaw_encode_generic,ulaw_encode_block,
+			ulaw_decode_generic,ulaw_decode_block,
+			linear,iterations,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	if(g711_codec_test("PCMA",
+			alaw_encode_generic,alaw_encode_block,
+			alaw_decode_generic,alaw_decode_block,
+			linear,iterations,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	return g711_transcode_test();
+}
+
+apt_test_suite_t* g711_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"g711",NULL,g711_test_run);
+	return suite;
+}
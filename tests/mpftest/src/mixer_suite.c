@@ -0,0 +1,187 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_mixer.h"
+
+/** Number of samples per frame (20 msec of 16kHz audio) */
+#define MIXER_TEST_SAMPLE_COUNT    (160 * 2)
+/** Max number of sources */
+#define MIXER_TEST_MAX_SOURCE_COUNT 32
+/** Default number of iterations (frames) */
+#define MIXER_TEST_ITERATION_COUNT 10000
+
+/** Reference saturating mixer of a single output */
+static void mixer_reference_mix(apr_int16_t *mix, apr_int16_t **source_arr, apr_size_t source_count, apr_size_t skip)
+{
+	apr_size_t i,k;
+	apr_int32_t sum;
+	for(i=0; i<MIXER_TEST_SAMPLE_COUNT; i++) {
+		sum = 0;
+		for(k=0; k<source_count; k++) {
+			if(k != skip) {
+				sum += source_arr[k][i];
+			}
+		}
+		if(sum > 32767) sum = 32767;
+		else if(sum < -32768) sum = -32768;
+		mix[i] = (apr_int16_t)sum;
+	}
+}
+
+/** Verify the mix and mix-minus kernels against the reference mixer */
+static apt_bool_t mixer_verify(apr_int16_t **source_arr, apr_size_t source_count, apr_int32_t *acc, apr_int16_t *mix, apr_int16_t *ref)
+{
+	apr_size_t k;
+	memset(acc,0,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int32_t));
+	for(k=0; k<source_count; k++) {
+		mpf_mix_accumulate(acc,source_arr[k],MIXER_TEST_SAMPLE_COUNT);
+	}
+
+	mpf_mix_saturate(mix,acc,MIXER_TEST_SAMPLE_COUNT);
+	mixer_reference_mix(ref,source_arr,source_count,source_count);
+	if(memcmp(mix,ref,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int16_t)) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Mix Mismatch [%"APR_SIZE_T_FMT" sources]",source_count);
+		return FALSE;
+	}
+
+	for(k=0; k<source_count; k++) {
+		mpf_mix_minus_saturate(mix,acc,source_arr[k],MIXER_TEST_SAMPLE_COUNT);
+		mixer_reference_mix(ref,source_arr,source_count,k);
+		if(memcmp(mix,ref,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int16_t)) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Mix-Minus Mismatch [%"APR_SIZE_T_FMT" sources, output %"APR_SIZE_T_FMT"]",
+				source_count,k);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/** Measure the cost of N-way mix-minus in one pass (accumulate once, subtract per output) */
+static double mixer_mix_minus_measure(apr_int16_t **source_arr, apr_size_t source_count, apr_int32_t *acc, apr_int16_t *mix, apr_size_t iterations)
+{
+	apr_size_t i,k;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		memset(acc,0,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int32_t));
+		for(k=0; k<source_count; k++) {
+			mpf_mix_accumulate(acc,source_arr[k],MIXER_TEST_SAMPLE_COUNT);
+		}
+		for(k=0; k<source_count; k++) {
+			mpf_mix_minus_saturate(mix,acc,source_arr[k],MIXER_TEST_SAMPLE_COUNT);
+		}
+	}
+	elapsed = apr_time_now() - start;
+	return (double)elapsed / iterations;
+}
+
+/** Measure the cost of N separate mixers of N-1 sources each (the topology of multipliers and mixers) */
+static double mixer_separate_measure(apr_int16_t **source_arr, apr_size_t source_count, apr_int32_t *acc, apr_int16_t *mix, apr_size_t iterations)
+{
+	apr_size_t i,j,k;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		for(j=0; j<source_count; j++) {
+			memset(acc,0,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int32_t));
+			for(k=0; k<source_count; k++) {
+				if(k != j) {
+					mpf_mix_accumulate(acc,source_arr[k],MIXER_TEST_SAMPLE_COUNT);
+				}
+			}
+			mpf_mix_saturate(mix,acc,MIXER_TEST_SAMPLE_COUNT);
+		}
+	}
+	elapsed = apr_time_now() - start;
+	return (double)elapsed / iterations;
+}
+
+/** Measure the cost of N reference scalar mixers of N-1 sources each */
+static double mixer_reference_measure(apr_int16_t **source_arr, apr_size_t source_count, apr_int16_t *mix, apr_size_t iterations)
+{
+	apr_size_t i,j;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		for(j=0; j<source_count; j++) {
+			mixer_reference_mix(mix,source_arr,source_count,j);
+		}
+	}
+	elapsed = apr_time_now() - start;
+	return (double)elapsed / iterations;
+}
+
+static apt_bool_t mixer_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_size_t i,k;
+	apr_size_t source_count;
+	apr_size_t iterations = MIXER_TEST_ITERATION_COUNT;
+	apr_int16_t *source_arr[MIXER_TEST_MAX_SOURCE_COUNT];
+	apr_int32_t *acc;
+	apr_int16_t *mix;
+	apr_int16_t *ref;
+	unsigned int seed = 1;
+
+	if(argc > 0) {
+		int value = atoi(argv[0]);
+		if(value > 0) {
+			iterations = value;
+		}
+	}
+
+	/* generate loud pseudo-random sources to exercise the saturation */
+	for(k=0; k<MIXER_TEST_MAX_SOURCE_COUNT; k++) {
+		source_arr[k] = apr_palloc(suite->pool,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+		for(i=0; i<MIXER_TEST_SAMPLE_COUNT; i++) {
+			seed = seed * 1103515245 + 12345;
+			source_arr[k][i] = (apr_int16_t)(seed >> 16);
+		}
+	}
+	/* include the extremes */
+	source_arr[0][0] = source_arr[1][0] = 32767;
+	source_arr[0][1] = source_arr[1][1] = -32768;
+
+	acc = apr_palloc(suite->pool,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int32_t));
+	mix = apr_palloc(suite->pool,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+	ref = apr_palloc(suite->pool,MIXER_TEST_SAMPLE_COUNT * sizeof(apr_int16_t));
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Mixer Benchmark [%"APR_SIZE_T_FMT" x %d samples]",
+		iterations,MIXER_TEST_SAMPLE_COUNT);
+	for(source_count=2; source_count<=MIXER_TEST_MAX_SOURCE_COUNT; source_count*=2) {
+		if(mixer_verify(source_arr,source_count,acc,mix,ref) == FALSE) {
+			return FALSE;
+		}
+
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,
+			"%2"APR_SIZE_T_FMT" Sources: reference %.2f usec/frame, separate %.2f usec/frame, mix-minus %.2f usec/frame",
+			source_count,
+			mixer_reference_measure(source_arr,source_count,mix,iterations),
+			mixer_separate_measure(source_arr,source_count,acc,mix,iterations),
+			mixer_mix_minus_measure(source_arr,source_count,acc,mix,iterations));
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* mixer_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"mixer",NULL,mixer_test_run);
+	return suite;
+}
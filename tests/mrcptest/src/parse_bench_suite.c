@@ -0,0 +1,553 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <apr_time.h>
+#include <apr_file_io.h>
+#include "apt_test_suite.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+#include "mrcp_resource_loader.h"
+#include "mrcp_resource_factory.h"
+#include "mrcp_resource.h"
+#include "mrcp_generic_header.h"
+#include "mrcp_message.h"
+#include "mrcp_stream.h"
+
+/** Default number of iterations */
+#define PARSE_BENCH_ITERATION_COUNT 100000
+/** Max length of header field name */
+#define PARSE_BENCH_MAX_NAME_LENGTH 64
+/** Size of rx buffer */
+#define PARSE_BENCH_RX_BUFFER_SIZE 1024
+/** Number of requests received in a row */
+#define PARSE_BENCH_MESSAGE_COUNT 100
+/** Directory of recorded MRCPv2 messages */
+#define PARSE_BENCH_TRAFFIC_DIR "v2"
+
+/** Typical recognition request */
+static const char parse_bench_message[] =
+	"MRCP/2.0 399 RECOGNIZE 543257\r\n"
+	"Channel-Identifier:32AECB23433801@speechrecog\r\n"
+	"Confidence-Threshold:0.9\r\n"
+	"Sensitivity-Level:0.5\r\n"
+	"Speed-Vs-Accuracy:0.5\r\n"
+	"N-Best-List-Length:1\r\n"
+	"No-Input-Timeout:5000\r\n"
+	"Recognition-Timeout:10000\r\n"
+	"Start-Input-Timers:true\r\n"
+	"Speech-Complete-Timeout:800\r\n"
+	"Speech-Incomplete-Timeout:1500\r\n"
+	"Logging-Tag:session-1\r\n"
+	"Content-Type:text/uri-list\r\n"
+	"Content-Length:19\r\n"
+	"\r\n"
+	"builtin:grammar/yes";
+
+/** Verify the perfect hash resolves each field in any case and rejects unknown fields */
+static apt_bool_t header_hash_verify(const char *name, const mrcp_header_vtable_t *vtable)
+{
+	char buf[PARSE_BENCH_MAX_NAME_LENGTH];
+	apt_str_t value;
+	apr_size_t id;
+	apr_size_t i;
+
+	if(!vtable->field_hash) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Perfect Hash [%s]",name);
+		return FALSE;
+	}
+
+	for(id=0; id<vtable->field_count; id++) {
+		value = vtable->field_table[id].value;
+		if(value.length + 1 >= sizeof(buf)) {
+			continue;
+		}
+		if(apt_string_table_hash_id_find(vtable->field_table,vtable->field_count,vtable->field_hash,&value) != id) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Field Not Found [%s] %s",name,value.buf);
+			return FALSE;
+		}
+
+		for(i=0; i<value.length; i++) {
+			buf[i] = (char)toupper((unsigned char)value.buf[i]);
+		}
+		buf[i] = '\0';
+		value.buf = buf;
+		if(apt_string_table_hash_id_find(vtable->field_table,vtable->field_count,vtable->field_hash,&value) != id) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Field Not Found [%s] %s",name,buf);
+			return FALSE;
+		}
+
+		buf[value.length] = 'x';
+		value.length++;
+		if(apt_string_table_hash_id_find(vtable->field_table,vtable->field_count,vtable->field_hash,&value) < vtable->field_count) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Field Found [%s] %.*s",name,(int)value.length,buf);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/** Measure the cost of looking up each field by means of the linear search or the perfect hash */
+static double header_lookup_measure(const mrcp_header_vtable_t *vtable, apt_bool_t hash, apr_size_t iterations)
+{
+	apr_size_t i;
+	apr_size_t id;
+	apr_size_t sum = 0;
+	apr_interval_time_t elapsed;
+	apr_time_t start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		for(id=0; id<vtable->field_count; id++) {
+			if(hash == TRUE) {
+				sum += apt_string_table_hash_id_find(vtable->field_table,vtable->field_count,vtable->field_hash,&vtable->field_table[id].value);
+			}
+			else {
+				sum += apt_string_table_id_find(vtable->field_table,vtable->field_count,&vtable->field_table[id].value);
+			}
+		}
+	}
+	elapsed = apr_time_now() - start;
+	if(sum == 0) {
+		/* keep the lookups from being optimized out */
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Empty Table");
+	}
+	return (double)elapsed * 1000 / (iterations * vtable->field_count);
+}
+
+static apt_bool_t header_lookup_run(const char *name, const mrcp_header_vtable_t *vtable, apr_size_t iterations)
+{
+	if(header_hash_verify(name,vtable) == FALSE) {
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"%-16s %2"APR_SIZE_T_FMT" fields: linear %.1f nsec/lookup, hash %.1f nsec/lookup",
+		name,
+		vtable->field_count,
+		header_lookup_measure(vtable,FALSE,iterations),
+		header_lookup_measure(vtable,TRUE,iterations));
+	return TRUE;
+}
+
+/** Measure the cost of parsing the typical request */
+static apt_bool_t message_parse_run(mrcp_resource_factory_t *factory, apr_size_t iterations, apr_pool_t *pool)
+{
+	char buffer[sizeof(parse_bench_message)];
+	apt_text_stream_t stream;
+	mrcp_parser_t *parser;
+	mrcp_message_t *message;
+	apt_message_status_e status;
+	apr_interval_time_t elapsed;
+	apr_time_t start;
+	apr_size_t i;
+	apr_pool_t *message_pool = apt_subpool_create(pool);
+
+	start = apr_time_now();
+	for(i=0; i<iterations; i++) {
+		memcpy(buffer,parse_bench_message,sizeof(parse_bench_message));
+		apt_text_stream_init(&stream,buffer,sizeof(parse_bench_message)-1);
+		parser = mrcp_parser_create(factory,message_pool);
+		message = NULL;
+		status = mrcp_parser_run(parser,&stream,&message);
+		if(status != APT_MESSAGE_STATUS_COMPLETE || !message) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message");
+			apr_pool_destroy(message_pool);
+			return FALSE;
+		}
+		apr_pool_clear(message_pool);
+	}
+	elapsed = apr_time_now() - start;
+
+	apr_pool_destroy(message_pool);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Parse RECOGNIZE Request: %.2f usec/message [%"APR_SIZE_T_FMT" messages]",
+		(double)elapsed / iterations,
+		iterations);
+	return TRUE;
+}
+
+/** Feed the stream to the parser in segments as received by a connection, collecting the parsed messages */
+static apt_bool_t message_stream_feed(
+					mrcp_parser_t *parser,
+					apt_text_stream_t *stream,
+					char *rx_buffer,
+					const char *data,
+					apr_size_t size,
+					apr_size_t segment_size,
+					mrcp_message_t **messages,
+					apr_size_t *count)
+{
+	apr_size_t offset;
+	apr_size_t length;
+	mrcp_message_t *message;
+	apt_message_status_e status;
+	const char *end = data + size;
+
+	*count = 0;
+	while(data < end) {
+		offset = stream->pos - stream->text.buf;
+		if(rx_buffer) {
+			length = PARSE_BENCH_RX_BUFFER_SIZE - offset;
+		}
+		else {
+			/* rx buffer is managed by the zero-copy parser */
+			length = stream->end - stream->pos;
+		}
+		if(length > segment_size) {
+			length = segment_size;
+		}
+		if(length > (apr_size_t)(end - data)) {
+			length = end - data;
+		}
+
+		memcpy(stream->pos,data,length);
+		data += length;
+		stream->text.length = offset + length;
+		stream->pos[length] = '\0';
+		apt_text_stream_reset(stream);
+
+		do {
+			status = mrcp_parser_run(parser,stream,&message);
+			if(status == APT_MESSAGE_STATUS_INVALID) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message");
+				return FALSE;
+			}
+			if(status == APT_MESSAGE_STATUS_COMPLETE && message) {
+				if(messages) {
+					messages[*count] = message;
+				}
+				(*count)++;
+			}
+		}
+		while(apt_text_is_eos(stream) == FALSE);
+
+		mrcp_parser_stream_scroll(parser,stream);
+	}
+	return TRUE;
+}
+
+/** Compare header fields and body of the messages */
+static apt_bool_t message_compare(const mrcp_message_t *message, const mrcp_message_t *ref)
+{
+	const apt_header_section_t *header = &message->header.header_section;
+	const apt_header_section_t *ref_header = &ref->header.header_section;
+	const apt_header_field_t *header_field = APR_RING_FIRST(&header->ring);
+	const apt_header_field_t *ref_header_field = APR_RING_FIRST(&ref_header->ring);
+
+	for(; ref_header_field != APR_RING_SENTINEL(&ref_header->ring, apt_header_field_t, link);
+			ref_header_field = APR_RING_NEXT(ref_header_field, link)) {
+		if(header_field == APR_RING_SENTINEL(&header->ring, apt_header_field_t, link)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Missing Header Field %s",ref_header_field->name.buf);
+			return FALSE;
+		}
+		if(strcmp(header_field->name.buf,ref_header_field->name.buf) != 0 ||
+			strcmp(header_field->value.buf,ref_header_field->value.buf) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Header Field Mismatch %s: %s != %s: %s",
+				header_field->name.buf,header_field->value.buf,
+				ref_header_field->name.buf,ref_header_field->value.buf);
+			return FALSE;
+		}
+		header_field = APR_RING_NEXT(header_field, link);
+	}
+
+	if(message->body.length != ref->body.length || strcmp(message->body.buf,ref->body.buf) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Body Mismatch");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Verify requests parsed in zero-copy mode stay intact while the following ones are received */
+static apt_bool_t zero_copy_verify(mrcp_resource_factory_t *factory, const char *data, apr_size_t size, apr_pool_t *pool)
+{
+	static const apr_size_t segment_sizes[] = {1, 7, 64, 399, 400, PARSE_BENCH_RX_BUFFER_SIZE};
+	mrcp_message_t *messages[PARSE_BENCH_MESSAGE_COUNT];
+	mrcp_message_t *ref;
+	apt_text_stream_t stream;
+	mrcp_parser_t *parser;
+	apr_size_t count;
+	apr_size_t i,k;
+	apr_pool_t *message_pool = apt_subpool_create(pool);
+
+	/* parse the reference message in copy mode */
+	parser = mrcp_parser_create(factory,pool);
+	apt_text_stream_init(&stream,apr_palloc(pool,PARSE_BENCH_RX_BUFFER_SIZE+1),0);
+	if(message_stream_feed(parser,&stream,stream.text.buf,data,sizeof(parse_bench_message)-1,
+			PARSE_BENCH_RX_BUFFER_SIZE,&ref,&count) == FALSE || count != 1) {
+		apr_pool_destroy(message_pool);
+		return FALSE;
+	}
+
+	for(k=0; k<sizeof(segment_sizes)/sizeof(segment_sizes[0]); k++) {
+		parser = mrcp_parser_create(factory,message_pool);
+		if(mrcp_parser_zero_copy_enable(parser,&stream,PARSE_BENCH_RX_BUFFER_SIZE) == FALSE ||
+			message_stream_feed(parser,&stream,NULL,data,size,segment_sizes[k],messages,&count) == FALSE) {
+			apr_pool_destroy(message_pool);
+			return FALSE;
+		}
+		if(count != PARSE_BENCH_MESSAGE_COUNT) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Parsed %"APR_SIZE_T_FMT" of %d Messages [%"APR_SIZE_T_FMT" bytes segments]",
+				count,PARSE_BENCH_MESSAGE_COUNT,segment_sizes[k]);
+			apr_pool_destroy(message_pool);
+			return FALSE;
+		}
+		for(i=0; i<count; i++) {
+			if(message_compare(messages[i],ref) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Message %"APR_SIZE_T_FMT" Mismatch [%"APR_SIZE_T_FMT" bytes segments]",
+					i,segment_sizes[k]);
+				apr_pool_destroy(message_pool);
+				return FALSE;
+			}
+		}
+		apr_pool_clear(message_pool);
+	}
+
+	apr_pool_destroy(message_pool);
+	return TRUE;
+}
+
+/** Measure the cost of parsing the requests received one per segment in copy or zero-copy mode */
+static double message_receive_measure(mrcp_resource_factory_t *factory, const char *data, apr_size_t size, apt_bool_t zero_copy, apr_size_t iterations, apr_pool_t *pool)
+{
+	apt_text_stream_t stream;
+	mrcp_parser_t *parser;
+	char *rx_buffer = NULL;
+	apr_size_t count;
+	apr_size_t i;
+	apr_interval_time_t elapsed;
+	apr_time_t start;
+	apr_pool_t *message_pool = apt_subpool_create(pool);
+
+	start = apr_time_now();
+	for(i=0; i<iterations; i+=PARSE_BENCH_MESSAGE_COUNT) {
+		parser = mrcp_parser_create(factory,message_pool);
+		if(zero_copy == TRUE) {
+			mrcp_parser_zero_copy_enable(parser,&stream,PARSE_BENCH_RX_BUFFER_SIZE);
+		}
+		else {
+			rx_buffer = apr_palloc(message_pool,PARSE_BENCH_RX_BUFFER_SIZE+1);
+			apt_text_stream_init(&stream,rx_buffer,0);
+		}
+		message_stream_feed(parser,&stream,rx_buffer,data,size,sizeof(parse_bench_message)-1,NULL,&count);
+		apr_pool_clear(message_pool);
+	}
+	elapsed = apr_time_now() - start;
+
+	apr_pool_destroy(message_pool);
+	return (double)elapsed / i;
+}
+
+static apt_bool_t zero_copy_run(mrcp_resource_factory_t *factory, apr_size_t iterations, apr_pool_t *pool)
+{
+	apr_size_t i;
+	apr_size_t size = (sizeof(parse_bench_message)-1) * PARSE_BENCH_MESSAGE_COUNT;
+	char *data = apr_palloc(pool,size);
+	for(i=0; i<PARSE_BENCH_MESSAGE_COUNT; i++) {
+		memcpy(data + i * (sizeof(parse_bench_message)-1),parse_bench_message,sizeof(parse_bench_message)-1);
+	}
+
+	if(zero_copy_verify(factory,data,size,pool) == FALSE) {
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Receive RECOGNIZE Requests: copy %.2f usec/message, zero-copy %.2f usec/message",
+		message_receive_measure(factory,data,size,FALSE,iterations,pool),
+		message_receive_measure(factory,data,size,TRUE,iterations,pool));
+	return TRUE;
+}
+
+/** Append the content of the file to the traffic */
+static apt_bool_t traffic_file_append(const char *file_path, apt_str_t *traffic, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apr_size_t length;
+	char *buf;
+
+	if(apr_file_open(&file,file_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open File [%s]",file_path);
+		return FALSE;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) != APR_SUCCESS) {
+		apr_file_close(file);
+		return FALSE;
+	}
+
+	length = (apr_size_t)finfo.size;
+	buf = apr_palloc(pool,traffic->length + length + 1);
+	if(traffic->length) {
+		memcpy(buf,traffic->buf,traffic->length);
+	}
+	if(apr_file_read_full(file,buf + traffic->length,length,&length) != APR_SUCCESS) {
+		apr_file_close(file);
+		return FALSE;
+	}
+	apr_file_close(file);
+
+	traffic->buf = buf;
+	traffic->length += length;
+	traffic->buf[traffic->length] = '\0';
+	return TRUE;
+}
+
+/** Load recorded traffic from the specified file or the directory of recorded MRCPv2 messages */
+static apt_bool_t traffic_load(const char *file_path, apt_str_t *traffic, apr_pool_t *pool)
+{
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	char *path;
+
+	apt_string_reset(traffic);
+	if(file_path) {
+		return traffic_file_append(file_path,traffic,pool);
+	}
+
+	if(apr_dir_open(&dir,PARSE_BENCH_TRAFFIC_DIR,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cannot Open Directory [%s]",PARSE_BENCH_TRAFFIC_DIR);
+		return FALSE;
+	}
+	while(apr_dir_read(&finfo,APR_FINFO_DIRENT,dir) == APR_SUCCESS) {
+		if(finfo.filetype == APR_REG && finfo.name) {
+			apr_filepath_merge(&path,PARSE_BENCH_TRAFFIC_DIR,finfo.name,APR_FILEPATH_NATIVE,pool);
+			traffic_file_append(path,traffic,pool);
+		}
+	}
+	apr_dir_close(dir);
+	return traffic->length ? TRUE : FALSE;
+}
+
+/** Measure the rate of parsing the recorded traffic (RECOGNIZE, DEFINE-GRAMMAR with inline SRGS grammars, etc) */
+static apt_bool_t traffic_parse_run(mrcp_resource_factory_t *factory, const char *file_path, apr_size_t iterations, apr_pool_t *pool)
+{
+	apt_str_t traffic;
+	apt_text_stream_t stream;
+	mrcp_parser_t *parser;
+	mrcp_message_t *message;
+	apt_message_status_e status;
+	apr_size_t count = 0;
+	apr_size_t passes;
+	apr_size_t i;
+	apr_interval_time_t elapsed;
+	apr_time_t start;
+	apr_pool_t *message_pool;
+
+	if(traffic_load(file_path,&traffic,pool) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Recorded Traffic");
+		return FALSE;
+	}
+
+	/* parse about the same amount of data as the typical requests */
+	passes = iterations * (sizeof(parse_bench_message)-1) / traffic.length;
+	if(!passes) {
+		passes = 1;
+	}
+
+	message_pool = apt_subpool_create(pool);
+	start = apr_time_now();
+	for(i=0; i<passes; i++) {
+		parser = mrcp_parser_create(factory,message_pool);
+		apt_text_stream_init(&stream,traffic.buf,traffic.length);
+		do {
+			status = mrcp_parser_run(parser,&stream,&message);
+			if(status == APT_MESSAGE_STATUS_INVALID) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Recorded Traffic");
+				apr_pool_destroy(message_pool);
+				return FALSE;
+			}
+			if(status == APT_MESSAGE_STATUS_COMPLETE && message) {
+				count++;
+			}
+		}
+		while(apt_text_is_eos(&stream) == FALSE);
+		apr_pool_clear(message_pool);
+	}
+	elapsed = apr_time_now() - start;
+	apr_pool_destroy(message_pool);
+
+	if(!elapsed) {
+		elapsed = 1;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Parse Recorded Traffic: %.1f MB/sec, %.2f usec/message [%"APR_SIZE_T_FMT" bytes, %"APR_SIZE_T_FMT" messages]",
+		(double)traffic.length * passes / elapsed,
+		(double)elapsed / count,
+		traffic.length,
+		count / passes);
+	return TRUE;
+}
+
+static apt_bool_t parse_bench_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mrcp_resource_factory_t *factory;
+	mrcp_resource_loader_t *resource_loader;
+	mrcp_resource_t *resource;
+	mrcp_resource_id resource_id;
+	apt_bool_t status = TRUE;
+	apr_size_t iterations = PARSE_BENCH_ITERATION_COUNT;
+
+	if(argc > 0) {
+		int value = atoi(argv[0]);
+		if(value > 0) {
+			iterations = value;
+		}
+	}
+
+	resource_loader = mrcp_resource_loader_create(TRUE,suite->pool);
+	if(!resource_loader) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Loader");
+		return FALSE;
+	}
+	factory = mrcp_resource_factory_get(resource_loader);
+	if(!factory) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Factory");
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Header Lookup Benchmark [%"APR_SIZE_T_FMT" iterations]",iterations);
+	status = header_lookup_run("generic",mrcp_generic_header_vtable_get(MRCP_VERSION_2),iterations);
+	for(resource_id=0; resource_id<MRCP_RESOURCE_TYPE_COUNT && status == TRUE; resource_id++) {
+		resource = mrcp_resource_get(factory,resource_id);
+		if(!resource) {
+			continue;
+		}
+		status = header_lookup_run(
+					apr_psprintf(suite->pool,"%s v1",resource->name.buf),
+					resource->get_resource_header_vtable(MRCP_VERSION_1),
+					iterations);
+		if(status == TRUE) {
+			status = header_lookup_run(
+						apr_psprintf(suite->pool,"%s v2",resource->name.buf),
+						resource->get_resource_header_vtable(MRCP_VERSION_2),
+						iterations);
+		}
+	}
+
+	if(status == TRUE) {
+		status = message_parse_run(factory,iterations,suite->pool);
+	}
+	if(status == TRUE) {
+		status = zero_copy_run(factory,iterations,suite->pool);
+	}
+	if(status == TRUE) {
+		status = traffic_parse_run(factory,argc > 1 ? argv[1] : NULL,iterations,suite->pool);
+	}
+
+	mrcp_resource_factory_destroy(factory);
+	return status;
+}
+
+apt_test_suite_t* parse_bench_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"parse-bench",NULL,parse_bench_test_run);
+	return suite;
+}
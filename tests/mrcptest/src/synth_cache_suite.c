@@ -0,0 +1,345 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+/* common includes */
+#include "mrcp_resource_loader.h"
+#include "mrcp_resource_factory.h"
+#include "mrcp_message.h"
+#include "mrcp_generic_header.h"
+/* synthesizer includes */
+#include "mrcp_synth_header.h"
+#include "mrcp_synth_resource.h"
+#include "mrcp_synth_cache.h"
+
+#define SAMPLE_CONTENT_TYPE "text/plain"
+#define SAMPLE_VOICE_NAME   "xiaoyun"
+#define SAMPLE_CODEC_NAME   "LPCM"
+#define SAMPLE_SAMPLING_RATE 8000
+
+/** Size of audio of an entry */
+#define SYNTH_CACHE_TEST_ENTRY_SIZE 1000
+/** Max size of audio kept in memory (fits 2 entries) */
+#define SYNTH_CACHE_TEST_CAPACITY   (SYNTH_CACHE_TEST_ENTRY_SIZE * 2 + SYNTH_CACHE_TEST_ENTRY_SIZE / 2)
+
+/* Create SPEAK request */
+static mrcp_message_t* speak_request_create(mrcp_resource_factory_t *factory, const char *body, apr_pool_t *pool)
+{
+	mrcp_message_t *message;
+	mrcp_resource_t *resource = mrcp_resource_get(factory,MRCP_SYNTHESIZER_RESOURCE);
+	if(!resource) {
+		return NULL;
+	}
+	message = mrcp_request_create(resource,MRCP_VERSION_2,SYNTHESIZER_SPEAK,pool);
+	if(message) {
+		mrcp_generic_header_t *generic_header;
+		mrcp_synth_header_t *synth_header;
+		generic_header = mrcp_generic_header_prepare(message);
+		if(generic_header) {
+			apt_string_assign(&generic_header->content_type,SAMPLE_CONTENT_TYPE,message->pool);
+			mrcp_generic_header_property_add(message,GENERIC_HEADER_CONTENT_TYPE);
+		}
+		synth_header = mrcp_resource_header_prepare(message);
+		if(synth_header) {
+			apt_string_assign(&synth_header->voice_param.name,SAMPLE_VOICE_NAME,message->pool);
+			mrcp_resource_header_property_add(message,SYNTHESIZER_HEADER_VOICE_NAME);
+		}
+		apt_string_assign(&message->body,body,message->pool);
+	}
+	return message;
+}
+
+/* Generate the key of a SPEAK request */
+static const char* synth_cache_test_key_generate(
+						mrcp_resource_factory_t *factory,
+						const char *body,
+						const mpf_codec_descriptor_t *descriptor,
+						apr_pool_t *pool)
+{
+	mrcp_message_t *message = speak_request_create(factory,body,pool);
+	if(!message) {
+		return NULL;
+	}
+	return mrcp_synth_cache_key_generate(message,descriptor,pool);
+}
+
+/* Record an entry of the specified size filled with the specified value */
+static apt_bool_t synth_cache_test_record(mrcp_synth_cache_t *cache, const char *key, int value)
+{
+	apr_byte_t data[SYNTH_CACHE_TEST_ENTRY_SIZE];
+	mrcp_synth_cache_record_t *record = mrcp_synth_cache_record_begin(cache,key);
+	if(!record) {
+		return FALSE;
+	}
+	memset(data,value,sizeof(data));
+	/* write in 2 chunks as audio is written frame by frame */
+	if(mrcp_synth_cache_record_write(record,data,sizeof(data) / 2) != TRUE ||
+		mrcp_synth_cache_record_write(record,data + sizeof(data) / 2,sizeof(data) - sizeof(data) / 2) != TRUE) {
+		mrcp_synth_cache_record_discard(record);
+		return FALSE;
+	}
+	return mrcp_synth_cache_record_commit(record);
+}
+
+/* Look up an entry and verify its audio */
+static apt_bool_t synth_cache_test_lookup(mrcp_synth_cache_t *cache, const char *key, int value)
+{
+	apr_size_t i;
+	apr_size_t size = 0;
+	const apr_byte_t *data;
+	mrcp_synth_cache_entry_t *entry = mrcp_synth_cache_lookup(cache,key);
+	if(!entry) {
+		return FALSE;
+	}
+	data = mrcp_synth_cache_entry_data_get(entry,&size);
+	if(size != SYNTH_CACHE_TEST_ENTRY_SIZE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry Size [%"APR_SIZE_T_FMT"]",size);
+		mrcp_synth_cache_entry_release(entry);
+		return FALSE;
+	}
+	for(i=0; i<size; i++) {
+		if(data[i] != (apr_byte_t)value) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry Data at [%"APR_SIZE_T_FMT"]",i);
+			mrcp_synth_cache_entry_release(entry);
+			return FALSE;
+		}
+	}
+	mrcp_synth_cache_entry_release(entry);
+	return TRUE;
+}
+
+/** Verify that the key is composed of the params and the normalized body */
+static apt_bool_t synth_cache_key_test(mrcp_resource_factory_t *factory, apr_pool_t *pool)
+{
+	mpf_codec_descriptor_t descriptor;
+	const char *key;
+	const char *expected_key;
+	const char *other_key;
+
+	mpf_codec_descriptor_init(&descriptor);
+	apt_string_set(&descriptor.name,SAMPLE_CODEC_NAME);
+	descriptor.sampling_rate = SAMPLE_SAMPLING_RATE;
+	descriptor.channel_count = 1;
+
+	expected_key = "codec=" SAMPLE_CODEC_NAME "/8000/1;type=" SAMPLE_CONTENT_TYPE ";voice=" SAMPLE_VOICE_NAME ";Hello world";
+	key = synth_cache_test_key_generate(factory," \r\n Hello \t  world\r\n",&descriptor,pool);
+	if(!key || strcmp(key,expected_key) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Key [%s] Expected [%s]",key ? key : "null",expected_key);
+		return FALSE;
+	}
+
+	/* the same text differing in white space only maps to the same key */
+	other_key = synth_cache_test_key_generate(factory,"Hello world",&descriptor,pool);
+	if(!other_key || strcmp(key,other_key) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Keys Differ [%s] [%s]",key,other_key ? other_key : "null");
+		return FALSE;
+	}
+
+	/* the same text synthesized to another codec maps to another key */
+	descriptor.sampling_rate = SAMPLE_SAMPLING_RATE * 2;
+	other_key = synth_cache_test_key_generate(factory,"Hello world",&descriptor,pool);
+	if(!other_key || strcmp(key,other_key) == 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Keys Match [%s]",key);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Verify that the least recently used entry is evicted */
+static apt_bool_t synth_cache_lru_test(apr_pool_t *pool)
+{
+	mrcp_synth_cache_stats_t stats;
+	mrcp_synth_cache_t *cache = mrcp_synth_cache_create(SYNTH_CACHE_TEST_CAPACITY,0,NULL,pool);
+	if(!cache) {
+		return FALSE;
+	}
+
+	if(synth_cache_test_record(cache,"a",'a') != TRUE || synth_cache_test_record(cache,"b",'b') != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Record Entry");
+		mrcp_synth_cache_destroy(cache);
+		return FALSE;
+	}
+	/* make "b" the least recently used entry */
+	if(synth_cache_test_lookup(cache,"a",'a') != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Look Up Entry [a]");
+		mrcp_synth_cache_destroy(cache);
+		return FALSE;
+	}
+	if(synth_cache_test_record(cache,"c",'c') != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Record Entry");
+		mrcp_synth_cache_destroy(cache);
+		return FALSE;
+	}
+
+	if(synth_cache_test_lookup(cache,"b",'b') == TRUE ||
+		synth_cache_test_lookup(cache,"a",'a') != TRUE ||
+		synth_cache_test_lookup(cache,"c",'c') != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry Evicted");
+		mrcp_synth_cache_destroy(cache);
+		return FALSE;
+	}
+
+	mrcp_synth_cache_stats_get(cache,&stats);
+	mrcp_synth_cache_destroy(cache);
+	if(stats.insertions != 3 ||
+		stats.evictions != 1 ||
+		stats.entry_count != 2 ||
+		stats.size != SYNTH_CACHE_TEST_ENTRY_SIZE * 2 ||
+		stats.memory_hits != 3 ||
+		stats.misses != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Statistics: insertions %"APR_SIZE_T_FMT
+			" evictions %"APR_SIZE_T_FMT" entries %"APR_SIZE_T_FMT" size %"APR_SIZE_T_FMT
+			" hits %"APR_SIZE_T_FMT" misses %"APR_SIZE_T_FMT,
+			stats.insertions,
+			stats.evictions,
+			stats.entry_count,
+			stats.size,
+			stats.memory_hits,
+			stats.misses);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Remove the directory along with the files in it */
+static void synth_cache_test_dir_remove(const char *dir_path, apr_pool_t *pool)
+{
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	char *file_path;
+	if(apr_dir_open(&dir,dir_path,pool) == APR_SUCCESS) {
+		while(apr_dir_read(&finfo,APR_FINFO_NAME | APR_FINFO_TYPE,dir) == APR_SUCCESS) {
+			if(finfo.filetype != APR_REG) {
+				continue;
+			}
+			if(apr_filepath_merge(&file_path,dir_path,finfo.name,0,pool) == APR_SUCCESS) {
+				apr_file_remove(file_path,pool);
+			}
+		}
+		apr_dir_close(dir);
+	}
+	apr_dir_remove(dir_path,pool);
+}
+
+/** Verify that an entry stored in the directory is loaded by another cache */
+static apt_bool_t synth_cache_file_test(apr_pool_t *pool)
+{
+	mrcp_synth_cache_stats_t stats;
+	mrcp_synth_cache_t *cache;
+	const char *temp_dir;
+	char *dir_path;
+	apt_bool_t status = FALSE;
+
+	if(apr_temp_dir_get(&temp_dir,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Temp Dir");
+		return FALSE;
+	}
+	if(apr_filepath_merge(&dir_path,temp_dir,
+			apr_psprintf(pool,"synthcache-%"APR_TIME_T_FMT,apr_time_now()),0,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+
+	cache = mrcp_synth_cache_create(SYNTH_CACHE_TEST_CAPACITY,0,dir_path,pool);
+	if(!cache) {
+		return FALSE;
+	}
+	if(synth_cache_test_record(cache,"a",'a') != TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Record Entry");
+		mrcp_synth_cache_destroy(cache);
+		synth_cache_test_dir_remove(dir_path,pool);
+		return FALSE;
+	}
+	mrcp_synth_cache_destroy(cache);
+
+	/* another cache (e.g. after a restart) loads the entry from the directory */
+	cache = mrcp_synth_cache_create(SYNTH_CACHE_TEST_CAPACITY,0,dir_path,pool);
+	if(!cache) {
+		synth_cache_test_dir_remove(dir_path,pool);
+		return FALSE;
+	}
+	if(synth_cache_test_lookup(cache,"a",'a') == TRUE &&
+		synth_cache_test_lookup(cache,"a",'a') == TRUE &&
+		synth_cache_test_lookup(cache,"b",'b') == FALSE) {
+		mrcp_synth_cache_stats_get(cache,&stats);
+		if(stats.disk_hits == 1 && stats.memory_hits == 1 && stats.misses == 1) {
+			status = TRUE;
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Statistics: disk hits %"APR_SIZE_T_FMT
+				" memory hits %"APR_SIZE_T_FMT" misses %"APR_SIZE_T_FMT,
+				stats.disk_hits,
+				stats.memory_hits,
+				stats.misses);
+		}
+	}
+	else {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Load Entry from [%s]",dir_path);
+	}
+	mrcp_synth_cache_destroy(cache);
+	synth_cache_test_dir_remove(dir_path,pool);
+	return status;
+}
+
+static apt_bool_t synth_cache_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_bool_t status = TRUE;
+	mrcp_resource_factory_t *factory;
+	mrcp_resource_loader_t *resource_loader;
+	resource_loader = mrcp_resource_loader_create(TRUE,suite->pool);
+	if(!resource_loader) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Loader");
+		return FALSE;
+	}
+
+	factory = mrcp_resource_factory_get(resource_loader);
+	if(!factory) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Factory");
+		return FALSE;
+	}
+
+	if(synth_cache_key_test(factory,suite->pool) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Key Normalization Test Passed");
+	}
+	else {
+		status = FALSE;
+	}
+	if(synth_cache_lru_test(suite->pool) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"LRU Eviction Test Passed");
+	}
+	else {
+		status = FALSE;
+	}
+	if(synth_cache_file_test(suite->pool) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"File Round-Trip Test Passed");
+	}
+	else {
+		status = FALSE;
+	}
+
+	mrcp_resource_factory_destroy(factory);
+	return status;
+}
+
+apt_test_suite_t* synth_cache_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"synthcache",NULL,synth_cache_test_run);
+	return suite;
+}
@@ -52,6 +52,57 @@ static apt_bool_t string_table_key_generate(apt_str_table_item_t table[], apr_si
 	return TRUE;
 }
 
+/** Max number of strings in the table */
+#define MAX_STRING_COUNT 100
+/** Max number of slots of the perfect hash */
+#define MAX_SLOT_COUNT 1024
+/** Number of seeds to try before the number of slots is doubled */
+#define MAX_SEED_COUNT 0x100000
+
+/** Find the seed, which maps the strings to distinct slots */
+static apt_bool_t string_table_hash_generate(const apt_str_table_item_t table[], apr_size_t count,
+											 apr_uint32_t *seed, apr_uint32_t *mask, unsigned char slots[])
+{
+	apr_size_t i;
+	apr_uint32_t slot;
+	apr_uint32_t slot_count = 1;
+	while(slot_count < count) {
+		slot_count <<= 1;
+	}
+
+	for(; slot_count <= MAX_SLOT_COUNT; slot_count <<= 1) {
+		*mask = slot_count - 1;
+		for(*seed = 1; *seed <= MAX_SEED_COUNT; (*seed)++) {
+			memset(slots,0,slot_count);
+			for(i=0; i<count; i++) {
+				slot = apt_string_table_hash(table[i].value.buf,table[i].value.length,*seed) & *mask;
+				if(slots[slot]) {
+					break;
+				}
+				slots[slot] = (unsigned char)(i + 1);
+			}
+			if(i == count) {
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+static apt_bool_t string_table_hash_write(const char *name, apr_uint32_t seed, apr_uint32_t mask, const unsigned char slots[], FILE *file)
+{
+	apr_uint32_t i;
+	fprintf(file,"\r\n/** Perfect hash slots of %s string table */\r\n",name);
+	fprintf(file,"static const unsigned char %s_hash_slots[%u] = {",name,mask + 1);
+	for(i=0; i<=mask; i++) {
+		fprintf(file,"%s%s%u",i ? "," : "",(i % 16) ? "" : "\r\n\t",slots[i]);
+	}
+	fprintf(file,"\r\n};\r\n");
+	fprintf(file,"\r\n/** Perfect hash of %s string table */\r\n",name);
+	fprintf(file,"static const apt_str_table_hash_t %s_string_hash = {%u,%u,%s_hash_slots};\r\n",name,seed,mask,name);
+	return TRUE;
+}
+
 #define TEST_BUFFER_SIZE 2048
 static char parse_buffer[TEST_BUFFER_SIZE];
 
@@ -96,8 +147,12 @@ static apt_bool_t string_table_write(const apt_str_table_item_t table[], apr_siz
 int main(int argc, char *argv[])
 {
 	apr_pool_t *pool = NULL;
-	apt_str_table_item_t table[100];
+	apt_str_table_item_t table[MAX_STRING_COUNT];
+	unsigned char slots[MAX_SLOT_COUNT];
+	apr_uint32_t seed = 0;
+	apr_uint32_t mask = 0;
 	apr_size_t count;
+	const char *hash_name = NULL;
 	FILE *file_in, *file_out;
 
 	/* one time apr global initialization */
@@ -106,8 +161,16 @@ int main(int argc, char *argv[])
 	}
 	pool = apt_pool_create();
 
+	if(argc > 2 && strcmp(argv[1],"-p") == 0) {
+		/* generate the perfect hash of the table as well */
+		hash_name = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+
 	if(argc < 2) {
-		printf("usage: stringtablegen stringtable.in [stringtable.out]\n");
+		printf("usage: stringtablegen [-p name] stringtable.in [stringtable.out]\n");
+		printf("  -p name  generate the perfect hash (name_string_hash) of the table\n");
 		return 0;
 	}
 	file_in = fopen(argv[1], "rb");
@@ -124,7 +187,7 @@ int main(int argc, char *argv[])
 	}
 
 	/* read items (strings) from the file */
-	count = string_table_read(table,100,file_in,pool);
+	count = string_table_read(table,MAX_STRING_COUNT,file_in,pool);
 
 	/* generate string table */
 	string_table_key_generate(table,count);
@@ -132,6 +195,15 @@ int main(int argc, char *argv[])
 	/* dump string table to the file */
 	string_table_write(table,count,file_out);
 
+	if(hash_name) {
+		if(string_table_hash_generate(table,count,&seed,&mask,slots) == TRUE) {
+			string_table_hash_write(hash_name,seed,mask,slots,file_out);
+		}
+		else {
+			printf("cannot generate perfect hash\n");
+		}
+	}
+
 	fclose(file_in);
 	if(file_out != stdout) {
 		fclose(file_out);